@@ -288,7 +288,27 @@ namespace ofxRulr {
 				auto node = this->getNodeInstance();
 				json["NodeTypeName"] = node->getTypeName();
 				json["Name"] = node->getName();
-				node->serialize(json["Content"]);
+
+				if (!node->getChangesTracked()) {
+					node->serialize(json["Content"]);
+				}
+				else {
+					//read the count first, so that a change made whilst we serialize makes the cache out of date
+					auto changeCount = node->getChangeCount();
+					auto filename = Utils::Serializable::getCurrentFilename();
+					if (!this->contentCached || changeCount != this->cachedChangeCount || filename != this->cachedFilename) {
+						this->cachedContent = Json::Value();
+						node->serialize(this->cachedContent, this->cachedSidecars);
+						this->cachedChangeCount = changeCount;
+						this->cachedFilename = filename;
+						this->contentCached = true;
+					}
+					else {
+						//the document needs them again, even though the node didn't add them this time
+						Utils::Serializable::addSidecars(this->cachedSidecars);
+					}
+					json["Content"] = this->cachedContent;
+				}
 			}
 		}
 	}
@@ -38,6 +38,14 @@ namespace ofxRulr {
 				ofxCvGui::PanelPtr nodeView;
 				ofxCvGui::ElementGroupPtr elements;
 				ofxCvGui::ElementGroupPtr inputPins;
+
+				//the content of a node which tracks its own changes, reused whilst its change count is the one we cached
+				// (and we're saving to the same file, since the names of its sidecars depend on that)
+				Json::Value cachedContent;
+				Utils::Serializable::Sidecars cachedSidecars;
+				string cachedFilename;
+				uint64_t cachedChangeCount = 0;
+				bool contentCached = false;
 			};
 		}
 	}
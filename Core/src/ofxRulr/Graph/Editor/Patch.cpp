@@ -1,6 +1,7 @@
 #include "pch_RulrCore.h"
 #include "Patch.h"
 #include "ofxRulr/Utils/ScopedProcess.h"
+#include "ofxRulr/Graph/World.h"
 
 #include "ofxCvGui/Widgets/Button.h"
 
@@ -245,6 +246,8 @@ namespace ofxRulr {
 
 				auto & canvasJson = json["Canvas"];
 				canvasJson["Scroll"] << this->view->getScrollPosition();
+
+				Utils::Serializable::serialize(json, this->parameters);
 			}
 
 			//----------
@@ -257,6 +260,8 @@ namespace ofxRulr {
 				ofVec2f canvasScrollPosiition;
 				canvasJson["Scroll"] >> canvasScrollPosiition;
 				this->view->setScrollPosition(canvasScrollPosiition);
+
+				Utils::Serializable::deserialize(json, this->parameters);
 			}
 
 			//----------
@@ -347,11 +352,29 @@ namespace ofxRulr {
 			void Patch::update() {
 				//update selection
 				this->selection.reset();
+				vector<shared_ptr<Nodes::Base>> nodes;
 				for (auto nodeHost : this->nodeHosts) {
 					if (ofxCvGui::isBeingInspected(nodeHost.second->getNodeInstance())) {
 						this->selection = nodeHost.second;
 					}
-					nodeHost.second->getNodeInstance()->update();
+					nodes.push_back(nodeHost.second->getNodeInstance());
+				}
+
+				//update the nodes (in dependency order and optionally in parallel)
+				auto & scheduler = World::X().getScheduler();
+				scheduler.setParallelEnabled(this->parameters.parallelUpdate);
+				scheduler.update(nodes);
+
+				//saving (World performs the autosave)
+				{
+					const auto & saving = this->parameters.saving;
+					auto & world = World::X();
+					world.setAutosaveInterval(saving.autosave.get()
+						? chrono::duration_cast<chrono::system_clock::duration>(chrono::duration<float>(saving.autosaveInterval.get()))
+						: chrono::system_clock::duration::zero());
+					world.setSaveEncoding(saving.binaryEncoding.get()
+						? Utils::Serializable::Encoding::Binary
+						: Utils::Serializable::Encoding::Text);
 				}
 			}
 
@@ -539,6 +562,24 @@ namespace ofxRulr {
 			void Patch::populateInspector(ofxCvGui::InspectArguments & inspectArguments) {
 				auto inspector = inspectArguments.inspector;
 				
+				inspector->addToggle(this->parameters.parallelUpdate);
+				inspector->addLiveValueHistory("Graph update [ms]", []() {
+					const auto & scheduler = World::X().getScheduler();
+					return (float) chrono::duration_cast<chrono::microseconds>(scheduler.getLastFrameDuration()).count() / 1000.0f;
+				});
+				inspector->addLiveValue<size_t>("Nodes on worker threads", []() {
+					return World::X().getScheduler().getLastWorkerNodeCount();
+				});
+
+				inspector->addParameterGroup(this->parameters.saving);
+				inspector->addLiveValue<float>("Save serialize [ms]", []() {
+					return (float) chrono::duration_cast<chrono::microseconds>(World::X().getSaveStatistics().serializeDuration).count() / 1000.0f;
+				});
+				inspector->addLiveValue<string>("Files written / unchanged", []() {
+					const auto saveStatistics = World::X().getSaveStatistics();
+					return ofToString(saveStatistics.writtenCount) + " / " + ofToString(saveStatistics.unchangedCount);
+				});
+
 				inspector->addButton("Clear patch", [this]() {
 					this->nodeHosts.clear();
 					this->rebuildLinkHosts();
@@ -85,6 +85,19 @@ namespace ofxRulr {
 
 				shared_ptr<TemporaryLinkHost> newLink;
 				weak_ptr<NodeHost> selection;
+
+				struct : ofParameterGroup {
+					ofParameter<bool> parallelUpdate{ "Parallel update", false };
+
+					struct : ofParameterGroup {
+						ofParameter<bool> autosave{ "Autosave", false };
+						ofParameter<float> autosaveInterval{ "Autosave interval [s]", 30.0f, 1.0f, 600.0f };
+						ofParameter<bool> binaryEncoding{ "Binary encoding", false };
+						PARAM_DECLARE("Saving", autosave, autosaveInterval, binaryEncoding);
+					} saving;
+
+					PARAM_DECLARE("Patch", parallelUpdate, saving);
+				} parameters;
 			};
 		}
 	}
@@ -0,0 +1,216 @@
+#include "pch_RulrCore.h"
+#include "Scheduler.h"
+
+#include "ofxRulr/Exception.h"
+
+namespace ofxRulr {
+	namespace Graph {
+		//----------
+		Scheduler::Scheduler() {
+
+		}
+
+		//----------
+		Scheduler::~Scheduler() {
+
+		}
+
+		//----------
+		void Scheduler::update(const vector<shared_ptr<Nodes::Base>> & nodes) {
+			auto startTime = chrono::high_resolution_clock::now();
+			{
+				if (this->parallelEnabled && nodes.size() > 1) {
+					this->updateParallel(nodes);
+				}
+				else {
+					this->updateSerial(nodes);
+				}
+			}
+			this->lastFrameDuration = chrono::high_resolution_clock::now() - startTime;
+		}
+
+		//----------
+		void Scheduler::setParallelEnabled(bool parallelEnabled) {
+			this->parallelEnabled = parallelEnabled;
+		}
+
+		//----------
+		bool Scheduler::getParallelEnabled() const {
+			return this->parallelEnabled;
+		}
+
+		//----------
+		const chrono::high_resolution_clock::duration & Scheduler::getLastFrameDuration() const {
+			return this->lastFrameDuration;
+		}
+
+		//----------
+		size_t Scheduler::getLastWorkerNodeCount() const {
+			return this->lastWorkerNodeCount;
+		}
+
+		//----------
+		size_t Scheduler::getWorkerCount() const {
+			return Utils::ThreadPool::X().getPoolSize();
+		}
+
+		//----------
+		void Scheduler::updateSerial(const vector<shared_ptr<Nodes::Base>> & nodes) {
+			for (auto node : nodes) {
+				node->update();
+			}
+			this->lastWorkerNodeCount = 0;
+		}
+
+		//----------
+		void Scheduler::updateParallel(const vector<shared_ptr<Nodes::Base>> & nodes) {
+			//--
+			//Build the dependency graph
+			//--
+			//
+			vector<Task> tasks(nodes.size());
+			map<Nodes::Base *, size_t> taskIndexForNode;
+			for (size_t i = 0; i < nodes.size(); i++) {
+				tasks[i].node = nodes[i];
+				taskIndexForNode[nodes[i].get()] = i;
+			}
+
+			for (size_t i = 0; i < nodes.size(); i++) {
+				set<size_t> inputTaskIndices;
+				for (auto inputPin : nodes[i]->getInputPins()) {
+					auto inputNode = inputPin->getConnectionUntyped();
+					if (!inputNode) {
+						continue;
+					}
+					auto findInput = taskIndexForNode.find(inputNode.get());
+					if (findInput != taskIndexForNode.end() && findInput->second != i) {
+						inputTaskIndices.insert(findInput->second);
+					}
+				}
+				for (auto inputTaskIndex : inputTaskIndices) {
+					tasks[inputTaskIndex].dependents.push_back(i);
+				}
+				tasks[i].pendingInputs = inputTaskIndices.size();
+			}
+			//
+			//--
+
+
+
+			//--
+			//Run the graph in topological order
+			//--
+			//
+			deque<size_t> readyTasks;
+			for (size_t i = 0; i < tasks.size(); i++) {
+				if (tasks[i].pendingInputs == 0) {
+					readyTasks.push_back(i);
+				}
+			}
+
+			size_t remainingTasks = tasks.size();
+			size_t tasksInFlight = 0;
+			size_t workerNodeCount = 0;
+			vector<bool> taskComplete(tasks.size(), false);
+
+			auto markComplete = [&](size_t taskIndex) {
+				taskComplete[taskIndex] = true;
+				remainingTasks--;
+				for (auto dependent : tasks[taskIndex].dependents) {
+					if (--tasks[dependent].pendingInputs == 0) {
+						readyTasks.push_back(dependent);
+					}
+				}
+			};
+
+			{
+				unique_lock<mutex> lock(this->completedMutex);
+				this->completedTasks.clear();
+			}
+
+			while (remainingTasks > 0) {
+				//dispatch worker tasks first so that they run whilst we process main thread tasks
+				deque<size_t> mainThreadTasks;
+				while (!readyTasks.empty()) {
+					auto taskIndex = readyTasks.front();
+					readyTasks.pop_front();
+
+					auto node = tasks[taskIndex].node;
+					if (node->getUpdateOnWorkerThread()) {
+						auto dispatched = Utils::ThreadPool::X().performAsync([this, node, taskIndex]() {
+							try {
+								node->update();
+							}
+							RULR_CATCH_ALL_TO_ERROR;
+
+							{
+								unique_lock<mutex> lock(this->completedMutex);
+								this->completedTasks.push_back(taskIndex);
+							}
+							this->completedSignal.notify_one();
+						}, Utils::ThreadPool::Priority::NodeUpdate);
+						if (dispatched) {
+							tasksInFlight++;
+							workerNodeCount++;
+							continue;
+						}
+					}
+
+					mainThreadTasks.push_back(taskIndex);
+				}
+
+				if (!mainThreadTasks.empty()) {
+					auto taskIndex = mainThreadTasks.front();
+					mainThreadTasks.pop_front();
+
+					//return the rest so they're considered again after new dispatches
+					readyTasks.insert(readyTasks.begin(), mainThreadTasks.begin(), mainThreadTasks.end());
+
+					tasks[taskIndex].node->update();
+					markComplete(taskIndex);
+				}
+				else if (tasksInFlight > 0) {
+					vector<size_t> completedTasks;
+					{
+						unique_lock<mutex> lock(this->completedMutex);
+						this->completedSignal.wait(lock, [this]() {
+							return !this->completedTasks.empty();
+						});
+						swap(completedTasks, this->completedTasks);
+					}
+					for (auto taskIndex : completedTasks) {
+						tasksInFlight--;
+						markComplete(taskIndex);
+					}
+				}
+				else {
+					//nothing is ready and nothing is running, so the remaining nodes form a cycle
+					//fall back to updating them in patch order (Base::update guards against repeats)
+					for (size_t i = 0; i < tasks.size(); i++) {
+						if (!taskComplete[i]) {
+							tasks[i].node->update();
+						}
+					}
+					break;
+				}
+
+				//collect any worker tasks which finished whilst we were busy
+				{
+					vector<size_t> completedTasks;
+					{
+						unique_lock<mutex> lock(this->completedMutex);
+						swap(completedTasks, this->completedTasks);
+					}
+					for (auto taskIndex : completedTasks) {
+						tasksInFlight--;
+						markComplete(taskIndex);
+					}
+				}
+			}
+			//
+			//--
+
+			this->lastWorkerNodeCount = workerNodeCount;
+		}
+	}
+}
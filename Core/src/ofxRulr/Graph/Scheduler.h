@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../Nodes/Base.h"
+#include "../Utils/ThreadPool.h"
+
+#include <mutex>
+#include <condition_variable>
+
+namespace ofxRulr {
+	namespace Graph {
+		///Updates a set of nodes in dependency order (inputs before the nodes which use them).
+		///Nodes which have opted in with setUpdateOnWorkerThread(true) are updated on the shared
+		/// Utils::ThreadPool whilst independent branches of the graph continue on the main thread.
+		///All other nodes (e.g. anything touching GL) are always updated on the main thread.
+		class RULR_EXPORTS Scheduler {
+		public:
+			Scheduler();
+			virtual ~Scheduler();
+
+			void update(const vector<shared_ptr<Nodes::Base>> &);
+
+			void setParallelEnabled(bool);
+			bool getParallelEnabled() const;
+
+			const chrono::high_resolution_clock::duration & getLastFrameDuration() const;
+			size_t getLastWorkerNodeCount() const;
+			size_t getWorkerCount() const;
+		protected:
+			struct Task {
+				shared_ptr<Nodes::Base> node;
+				size_t pendingInputs = 0;
+				vector<size_t> dependents;
+			};
+
+			void updateSerial(const vector<shared_ptr<Nodes::Base>> &);
+			void updateParallel(const vector<shared_ptr<Nodes::Base>> &);
+
+			bool parallelEnabled = false;
+
+			chrono::high_resolution_clock::duration lastFrameDuration;
+			size_t lastWorkerNodeCount = 0;
+
+			mutex completedMutex;
+			condition_variable completedSignal;
+			vector<size_t> completedTasks;
+		};
+	}
+}
@@ -24,7 +24,14 @@ namespace ofxRulr {
 
 		//-----------
 		World::~World() {
-
+			if (this->saveThread.joinable()) {
+				{
+					lock_guard<mutex> lock(this->saveMutex);
+					this->closing = true;
+				}
+				this->saveSignal.notify_all();
+				this->saveThread.join();
+			}
 		}
 
 		//-----------
@@ -138,7 +145,10 @@ namespace ofxRulr {
 				saveAllButton->onDraw += [this](ofxCvGui::DrawArguments & args) {
 					//show time since last save if >1min
 					auto duration = chrono::system_clock::now() - this->lastSaveOrLoad;
-					if (duration > chrono::minutes(1)) {
+					if (this->isSaving()) {
+						ofxAssets::font(ofxCvGui::getDefaultTypeface(), 8).drawString("[saving]", 6, 27);
+					}
+					else if (duration > chrono::minutes(1)) {
 						ofxAssets::font(ofxCvGui::getDefaultTypeface(), 8).drawString(Utils::formatDuration(duration, true, true, false) + "[since last save]", 6, 27);
 					}
 				};
@@ -201,20 +211,152 @@ namespace ofxRulr {
 		}
 
 		//-----------
-		void World::saveAll() const {
+		void World::saveAll() {
+			auto startTime = chrono::high_resolution_clock::now();
+
+			//serialize here, since nodes are only safe to read on the main thread
+			map<string, SaveJob> saves;
 			for(auto node : * this) {
-				node->save(node->getDefaultFilename() + ".json");
+				auto filename = node->getDefaultFilename() + ".json";
+
+				//read the count before serializing, so that a change made whilst we serialize is saved next time
+				auto changeCount = node->getChangeCount();
+				if (node->getChangesTracked() && ofFile::doesFileExist(filename)) {
+					lock_guard<mutex> lock(this->saveMutex);
+					auto findSavedChangeCount = this->savedChangeCounts.find(filename);
+					if (findSavedChangeCount != this->savedChangeCounts.end() && findSavedChangeCount->second == changeCount) {
+						continue;
+					}
+				}
+
+				try {
+					SaveJob save;
+					save.changeCount = changeCount;
+					node->serializeDocument(save.document, filename);
+					save.encoding = this->saveEncoding;
+					saves[filename] = move(save);
+				}
+				RULR_CATCH_ALL_TO_ERROR;
+			}
+
+			{
+				lock_guard<mutex> lock(this->saveMutex);
+				for (auto & save : saves) {
+					this->pendingSaves[save.first] = move(save.second);
+				}
+				this->saveStatistics.serializedCount = saves.size();
+				this->saveStatistics.serializeDuration = chrono::high_resolution_clock::now() - startTime;
+			}
+
+			if (!this->saveThread.joinable()) {
+				this->saveThread = thread([this]() {
+					this->saveThreadFunction();
+				});
+			}
+			this->saveSignal.notify_all();
+
+			this->lastSaveOrLoad = chrono::system_clock::now();
+		}
+
+		//-----------
+		void World::waitForSaves() {
+			unique_lock<mutex> lock(this->saveMutex);
+			this->savesCompleteSignal.wait(lock, [this]() {
+				return this->pendingSaves.empty() && this->activeSaveCount == 0;
+			});
+		}
+
+		//-----------
+		bool World::isSaving() const {
+			lock_guard<mutex> lock(this->saveMutex);
+			return !this->pendingSaves.empty() || this->activeSaveCount > 0;
+		}
+
+		//-----------
+		void World::setAutosaveInterval(const chrono::system_clock::duration & autosaveInterval) {
+			this->autosaveInterval = autosaveInterval;
+		}
+
+		//-----------
+		void World::setSaveEncoding(Utils::Serializable::Encoding saveEncoding) {
+			this->saveEncoding = saveEncoding;
+		}
+
+		//-----------
+		World::SaveStatistics World::getSaveStatistics() const {
+			lock_guard<mutex> lock(this->saveMutex);
+			return this->saveStatistics;
+		}
+
+		//-----------
+		void World::update() {
+			Utils::Set<Nodes::Base>::update();
+
+			if (this->autosaveInterval > chrono::system_clock::duration::zero()
+				&& chrono::system_clock::now() - this->lastSaveOrLoad > this->autosaveInterval
+				&& !this->isSaving()) {
+				this->saveAll();
+			}
+		}
+
+		//-----------
+		void World::saveThreadFunction() {
+			unique_lock<mutex> lock(this->saveMutex);
+			while (true) {
+				this->saveSignal.wait(lock, [this]() {
+					return !this->pendingSaves.empty() || this->closing;
+				});
+				if (this->pendingSaves.empty()) {
+					//closing (we only exit once everything has been written)
+					break;
+				}
+
+				auto filename = this->pendingSaves.begin()->first;
+				auto save = move(this->pendingSaves.begin()->second);
+				this->pendingSaves.erase(this->pendingSaves.begin());
+				this->activeSaveCount++;
+				lock.unlock();
+
+				bool written = false;
+				string error;
+				try {
+					written = Utils::Serializable::writeDocument(save.document, filename, save.encoding);
+				}
+				catch (const std::exception & e) {
+					error = e.what();
+				}
+
+				lock.lock();
+				this->activeSaveCount--;
+				if (error.empty()) {
+					(written ? this->saveStatistics.writtenCount : this->saveStatistics.unchangedCount)++;
+					this->savedChangeCounts[filename] = save.changeCount;
+				}
+				else {
+					ofLogError("ofxRulr::Graph::World") << "Couldn't save [" << filename << "] : " << error;
+					this->saveStatistics.lastError = error;
+				}
+				if (this->pendingSaves.empty() && this->activeSaveCount == 0) {
+					this->savesCompleteSignal.notify_all();
+				}
 			}
-			const_cast<World*>(this)->lastSaveOrLoad = chrono::system_clock::now();
 		}
 
 		//-----------
 		void World::loadAll(bool printDebug) {
+			//don't let a queued save overwrite what we're about to load
+			this->waitForSaves();
+
 			for(auto node : * this) {
 				if (printDebug) {
 					ofLogNotice("ofxRulr") << "Loading node [" << node->getName() << "]";
 				}
-				node->load(node->getDefaultFilename() + ".json");
+				auto filename = node->getDefaultFilename() + ".json";
+				node->load(filename);
+
+				//the file now matches the node
+				lock_guard<mutex> lock(this->saveMutex);
+				this->savedChangeCounts[filename] = node->getChangeCount();
 			}
 			this->lastSaveOrLoad = chrono::system_clock::now();
 		}
@@ -232,5 +374,10 @@ namespace ofxRulr {
 		ofxCvGui::PanelGroupPtr World::getGuiGrid() const {
 			return this->guiGrid;
 		}
+
+		//----------
+		Scheduler & World::getScheduler() {
+			return this->scheduler;
+		}
 	}
 }
\ No newline at end of file
@@ -2,11 +2,16 @@
 
 #include "../Utils/Set.h"
 #include "../Nodes/Base.h"
+#include "Scheduler.h"
 
 #include "ofxCvGui/Controller.h"
 #include "ofxCvGui/Panels/SharedView.h"
 #include "ofxSingleton.h"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 namespace ofxRulr {
 	namespace Graph {
 		class RULR_EXPORTS World : public Utils::Set<Nodes::Base>, public ofxSingleton::Singleton<World> {
@@ -15,13 +20,57 @@ namespace ofxRulr {
 			virtual ~World();
 			void init(ofxCvGui::Controller &, bool enableSummaryView = true);
 			void loadAll(bool printDebug = false);
-			void saveAll() const;
+
+			///Serializes the nodes here (skipping nodes which track their changes and haven't changed since they were
+			/// last saved), then encodes and writes the files on a background thread. Files whose content hasn't
+			/// changed aren't written.
+			void saveAll();
+			///Blocks until all the files queued by saveAll() have been written
+			void waitForSaves();
+			bool isSaving() const;
+
+			///Save every interval (if the interval is zero then don't autosave)
+			void setAutosaveInterval(const chrono::system_clock::duration &);
+			void setSaveEncoding(Utils::Serializable::Encoding);
+
+			struct SaveStatistics {
+				size_t serializedCount = 0; // documents serialized in the last save
+				size_t writtenCount = 0; // files written (since startup)
+				size_t unchangedCount = 0; // files skipped since their content hadn't changed (since startup)
+				chrono::high_resolution_clock::duration serializeDuration = chrono::high_resolution_clock::duration::zero(); // time spent on the main thread in the last save
+				string lastError;
+			};
+			SaveStatistics getSaveStatistics() const;
+
+			void update();
 			static ofxCvGui::Controller & getGuiController();
 			ofxCvGui::PanelGroupPtr getGuiGrid() const;
+			Scheduler & getScheduler();
 		protected:
 			static ofxCvGui::Controller * gui; ///< Why is this static? Needs comment.  I presume it's so we can grid multiple worlds?
 			ofxCvGui::PanelGroupPtr guiGrid;
 			chrono::system_clock::time_point lastSaveOrLoad = chrono::system_clock::now();
+			Scheduler scheduler;
+
+			struct SaveJob {
+				Utils::Serializable::Document document;
+				Utils::Serializable::Encoding encoding;
+				uint64_t changeCount; // of the node when it was serialized
+			};
+			void saveThreadFunction();
+
+			map<string, SaveJob> pendingSaves; // by filename, a newer save of the same file replaces the pending one
+			map<string, uint64_t> savedChangeCounts; // by filename, the node's change count when its file was last written or loaded
+			size_t activeSaveCount = 0;
+			bool closing = false;
+			mutable mutex saveMutex;
+			condition_variable saveSignal;
+			condition_variable savesCompleteSignal;
+			thread saveThread;
+
+			chrono::system_clock::duration autosaveInterval = chrono::system_clock::duration::zero();
+			Utils::Serializable::Encoding saveEncoding = Utils::Serializable::Encoding::Text;
+			SaveStatistics saveStatistics; // guarded by saveMutex
 		};
 	}
 }
\ No newline at end of file
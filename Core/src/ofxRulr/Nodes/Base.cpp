@@ -14,10 +14,16 @@ namespace ofxRulr {
 			this->initialized = false;
 			this->lastFrameUpdate = 0;
 			this->updateAllInputsFirst = true;
+			this->updateOnWorkerThread = false;
+			this->lastUpdateDuration.store(0);
 		}
 
 		//----------
 		Base::~Base() {
+			for (auto & parameters : this->managedParameters) {
+				ofRemoveListener(parameters.parameterChangedE(), this, &Base::managedParameterChanged);
+			}
+
 			if (this->initialized) {
 				//pins will try to notify this node when connections are dropped, so drop the pins first
 				for (auto pin : this->inputPins) {
@@ -47,9 +53,11 @@ namespace ofxRulr {
 
 		//----------
 		void Base::update() {
-			auto currentFrameIndex = ofGetFrameNum() + 1; // otherwise confusions at 0th frame
-			if (currentFrameIndex > this->lastFrameUpdate) {
-				this->lastFrameUpdate = currentFrameIndex;
+			uint64_t currentFrameIndex = ofGetFrameNum() + 1; // otherwise confusions at 0th frame
+			auto lastFrameUpdate = this->lastFrameUpdate.load();
+
+			//the exchange ensures only one thread performs the update when the Scheduler runs us in parallel
+			if (currentFrameIndex > lastFrameUpdate && this->lastFrameUpdate.compare_exchange_strong(lastFrameUpdate, currentFrameIndex)) {
 				if (this->updateAllInputsFirst) {
 					for (auto inputPin : this->inputPins) {
 						auto inputNode = inputPin->getConnectionUntyped();
@@ -58,10 +66,23 @@ namespace ofxRulr {
 						}
 					}
 				}
+
+				auto startTime = chrono::high_resolution_clock::now();
 				this->onUpdate.notifyListeners();
+				this->lastUpdateDuration.store((chrono::high_resolution_clock::now() - startTime).count());
 			}
 		}
 
+		//----------
+		bool Base::getUpdateOnWorkerThread() const {
+			return this->updateOnWorkerThread;
+		}
+
+		//----------
+		chrono::high_resolution_clock::duration Base::getLastUpdateDuration() const {
+			return chrono::high_resolution_clock::duration(this->lastUpdateDuration.load());
+		}
+
 		//----------
 		string Base::getName() const {
 			if (this->name.empty()) {
@@ -149,6 +170,13 @@ namespace ofxRulr {
 
 			inspector->add(new Widgets::Title(this->getTypeName(), ofxCvGui::Widgets::Title::Level::H3));
 
+			inspector->addLiveValueHistory("Update duration [ms]", [this]() {
+				return (float) chrono::duration_cast<chrono::microseconds>(this->getLastUpdateDuration()).count() / 1000.0f;
+			});
+			if (this->updateOnWorkerThread) {
+				inspector->add(new Widgets::Title("Updates on worker thread", ofxCvGui::Widgets::Title::Level::H3));
+			}
+
 			inspector->add(new Widgets::Button("Save Node...", [this] () {
 				try {
 					auto result = ofSystemSaveDialog(this->getDefaultFilename() + ".json", "Save node [" + this->getName() + "] as json");
@@ -215,6 +243,10 @@ namespace ofxRulr {
 					args.inspector->addParameterGroup(parameters);
 				};
 			}
+
+			//changes to parameters (including those in nested groups) mark the node as needing to be saved
+			ofAddListener(parameters.parameterChangedE(), this, &Base::managedParameterChanged);
+			this->managedParameters.push_back(parameters);
 		}
 
 		//----------
@@ -258,5 +290,15 @@ namespace ofxRulr {
 		bool Base::getUpdateAllInputsFirst() const {
 			return this->updateAllInputsFirst;
 		}
+
+		//----------
+		void Base::setUpdateOnWorkerThread(bool updateOnWorkerThread) {
+			this->updateOnWorkerThread = updateOnWorkerThread;
+		}
+
+		//----------
+		void Base::managedParameterChanged(ofAbstractParameter &) {
+			this->markDirty();
+		}
 	}
 }
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include "ofxAssets.h"
 
 #include <string>
+#include <atomic>
 
 #define RULR_NODE_INIT_LISTENER \
 	this->onInit += [this]() { \
@@ -50,6 +51,10 @@ namespace ofxRulr {
 			///Note : manually calling update more than once per frame will have no effect
 			void update();
 
+			///Nodes which are safe to update away from the main thread (e.g. no GL calls) opt in via setUpdateOnWorkerThread
+			bool getUpdateOnWorkerThread() const;
+			chrono::high_resolution_clock::duration getLastUpdateDuration() const;
+
 			string getName() const override;
 			void setName(const string);
 
@@ -167,7 +172,11 @@ namespace ofxRulr {
 			void setUpdateAllInputsFirst(bool);
 			bool getUpdateAllInputsFirst() const;
 
+			void setUpdateOnWorkerThread(bool);
+
 		private:
+			void managedParameterChanged(ofAbstractParameter &);
+
 			Graph::Editor::NodeHost * nodeHost;
 			Graph::PinSet inputPins;
 			shared_ptr<ofBaseDraws> customIcon;
@@ -176,8 +185,11 @@ namespace ofxRulr {
 
 			string name;
 			bool initialized;
-			uint64_t lastFrameUpdate;
+			atomic<uint64_t> lastFrameUpdate;
 			bool updateAllInputsFirst;
+			bool updateOnWorkerThread;
+			atomic<int64_t> lastUpdateDuration; // [high_resolution_clock ticks] written by whichever thread updates us
+			vector<ofParameterGroup> managedParameters; // shares the groups, so we can stop listening to them
 
 			//we'd love to have parameters for drawWorldEnabled, etc
 			//but adding ofParameters here seems to cause crashes
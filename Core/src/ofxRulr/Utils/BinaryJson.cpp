@@ -0,0 +1,276 @@
+#include "pch_RulrCore.h"
+#include "BinaryJson.h"
+#include "ofxRulr/Exception.h"
+
+#include <unordered_map>
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			const char magic[8] = { 'R', 'U', 'L', 'R', 'B', 'J', 'S', 'N' };
+			const uint8_t version = 1;
+
+			enum Tag : uint8_t {
+				Null = 0,
+				False,
+				True,
+				Int, // zigzag varint
+				UInt, // varint
+				Float, // float32
+				Double, // float64
+				String, // varint size, bytes
+				Array, // varint count, values
+				Object // varint count, (key, value) pairs
+			};
+
+			//----------
+			class Encoder {
+			public:
+				Encoder(vector<uint8_t> & data)
+				: data(data) { }
+
+				void writeVarint(uint64_t value) {
+					while (value >= 0x80) {
+						this->data.push_back((uint8_t) (value | 0x80));
+						value >>= 7;
+					}
+					this->data.push_back((uint8_t) value);
+				}
+
+				void writeBytes(const void * bytes, size_t size) {
+					auto begin = (const uint8_t *) bytes;
+					this->data.insert(this->data.end(), begin, begin + size);
+				}
+
+				//keys are written in full the first time (size << 1), and then as an index ((index << 1) | 1)
+				void writeKey(const string & key) {
+					auto findKey = this->keys.find(key);
+					if (findKey != this->keys.end()) {
+						this->writeVarint(((uint64_t) findKey->second << 1) | 1);
+					}
+					else {
+						this->writeVarint((uint64_t) key.size() << 1);
+						this->writeBytes(key.data(), key.size());
+						auto index = this->keys.size();
+						this->keys.emplace(key, index);
+					}
+				}
+
+				void writeValue(const Json::Value & json) {
+					switch (json.type()) {
+					case Json::nullValue:
+						this->data.push_back(Tag::Null);
+						break;
+					case Json::booleanValue:
+						this->data.push_back(json.asBool() ? Tag::True : Tag::False);
+						break;
+					case Json::intValue:
+					{
+						auto value = (int64_t) json.asLargestInt();
+						this->data.push_back(Tag::Int);
+						this->writeVarint(((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+						break;
+					}
+					case Json::uintValue:
+						this->data.push_back(Tag::UInt);
+						this->writeVarint((uint64_t) json.asLargestUInt());
+						break;
+					case Json::realValue:
+					{
+						auto value = json.asDouble();
+						auto floatValue = (float) value;
+						if ((double) floatValue == value) {
+							this->data.push_back(Tag::Float);
+							this->writeBytes(&floatValue, sizeof(floatValue));
+						}
+						else {
+							this->data.push_back(Tag::Double);
+							this->writeBytes(&value, sizeof(value));
+						}
+						break;
+					}
+					case Json::stringValue:
+					{
+						const auto value = json.asString();
+						this->data.push_back(Tag::String);
+						this->writeVarint(value.size());
+						this->writeBytes(value.data(), value.size());
+						break;
+					}
+					case Json::arrayValue:
+						this->data.push_back(Tag::Array);
+						this->writeVarint(json.size());
+						for (const auto & item : json) {
+							this->writeValue(item);
+						}
+						break;
+					case Json::objectValue:
+					{
+						const auto names = json.getMemberNames();
+						this->data.push_back(Tag::Object);
+						this->writeVarint(names.size());
+						for (const auto & name : names) {
+							this->writeKey(name);
+							this->writeValue(json[name]);
+						}
+						break;
+					}
+					}
+				}
+			protected:
+				vector<uint8_t> & data;
+				unordered_map<string, size_t> keys;
+			};
+
+			//----------
+			class Decoder {
+			public:
+				Decoder(const uint8_t * data, size_t size)
+				: position(data)
+				, end(data + size) { }
+
+				void need(size_t size) const {
+					if ((size_t) (this->end - this->position) < size) {
+						throw(ofxRulr::Exception("Binary JSON is truncated"));
+					}
+				}
+
+				uint8_t readByte() {
+					this->need(1);
+					return *this->position++;
+				}
+
+				uint64_t readVarint() {
+					uint64_t value = 0;
+					for (int shift = 0; shift < 64; shift += 7) {
+						auto byte = this->readByte();
+						value |= (uint64_t) (byte & 0x7f) << shift;
+						if (!(byte & 0x80)) {
+							return value;
+						}
+					}
+					throw(ofxRulr::Exception("Binary JSON has a malformed varint"));
+				}
+
+				template<typename T>
+				T readRaw() {
+					T value;
+					this->need(sizeof(T));
+					memcpy(&value, this->position, sizeof(T));
+					this->position += sizeof(T);
+					return value;
+				}
+
+				string readString(size_t size) {
+					this->need(size);
+					string value((const char *) this->position, size);
+					this->position += size;
+					return value;
+				}
+
+				const string & readKey() {
+					auto header = this->readVarint();
+					if (header & 1) {
+						auto index = header >> 1;
+						if (index >= this->keys.size()) {
+							throw(ofxRulr::Exception("Binary JSON has a bad key index"));
+						}
+						return this->keys[index];
+					}
+					else {
+						this->keys.push_back(this->readString(header >> 1));
+						return this->keys.back();
+					}
+				}
+
+				void readValue(Json::Value & json) {
+					auto tag = this->readByte();
+					switch (tag) {
+					case Tag::Null:
+						json = Json::Value();
+						break;
+					case Tag::False:
+						json = false;
+						break;
+					case Tag::True:
+						json = true;
+						break;
+					case Tag::Int:
+					{
+						auto zigzag = this->readVarint();
+						json = (Json::Value::LargestInt) ((int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1));
+						break;
+					}
+					case Tag::UInt:
+						json = (Json::Value::LargestUInt) this->readVarint();
+						break;
+					case Tag::Float:
+						json = (double) this->readRaw<float>();
+						break;
+					case Tag::Double:
+						json = this->readRaw<double>();
+						break;
+					case Tag::String:
+						json = this->readString(this->readVarint());
+						break;
+					case Tag::Array:
+					{
+						auto count = this->readVarint();
+						json = Json::Value(Json::arrayValue);
+						for (uint64_t i = 0; i < count; i++) {
+							this->readValue(json[(Json::ArrayIndex) i]);
+						}
+						break;
+					}
+					case Tag::Object:
+					{
+						auto count = this->readVarint();
+						json = Json::Value(Json::objectValue);
+						for (uint64_t i = 0; i < count; i++) {
+							//copy the key since reading the value may grow the key table
+							auto key = this->readKey();
+							this->readValue(json[key]);
+						}
+						break;
+					}
+					default:
+						throw(ofxRulr::Exception("Binary JSON has an unknown value type [" + ofToString((int) tag) + "]"));
+					}
+				}
+			protected:
+				const uint8_t * position;
+				const uint8_t * end;
+				vector<string> keys;
+			};
+		}
+
+		//----------
+		void BinaryJson::encode(const Json::Value & json, vector<uint8_t> & data) {
+			data.clear();
+			data.insert(data.end(), magic, magic + sizeof(magic));
+			data.push_back(version);
+
+			Encoder encoder(data);
+			encoder.writeValue(json);
+		}
+
+		//----------
+		void BinaryJson::decode(const uint8_t * data, size_t size, Json::Value & json) {
+			if (!isBinaryJson(data, size)) {
+				throw(ofxRulr::Exception("Data isn't binary JSON"));
+			}
+			if (data[sizeof(magic)] != version) {
+				throw(ofxRulr::Exception("Binary JSON version [" + ofToString((int) data[sizeof(magic)]) + "] isn't supported"));
+			}
+
+			Decoder decoder(data + sizeof(magic) + 1, size - sizeof(magic) - 1);
+			decoder.readValue(json);
+		}
+
+		//----------
+		bool BinaryJson::isBinaryJson(const uint8_t * data, size_t size) {
+			return size > sizeof(magic)
+				&& memcmp(data, magic, sizeof(magic)) == 0;
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ofxRulr/Utils/Constants.h"
+
+#include <json/json.h>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Compact binary encoding of a Json::Value, used for saving documents when text isn't needed.
+		///Numbers are stored as varints or float32/float64 (float32 whenever that's exact), and each object key
+		/// is only written in full the first time it appears (afterwards it's an index into the keys seen so far).
+		///
+		///File layout :
+		/// "RULRBJSN", uint8 version, then the root value
+		class RULR_EXPORTS BinaryJson {
+		public:
+			static void encode(const Json::Value &, std::vector<uint8_t> & data);
+			static void decode(const uint8_t * data, size_t size, Json::Value &); ///< Throws if the data is malformed
+			static bool isBinaryJson(const uint8_t * data, size_t size);
+		};
+	}
+}
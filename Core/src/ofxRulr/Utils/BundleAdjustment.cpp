@@ -0,0 +1,1043 @@
+#include "pch_RulrCore.h"
+#include "BundleAdjustment.h"
+#include "ofxRulr/Utils/ThreadPool.h"
+#include "ofxRulr/Exception.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			//view parameters : rotation increment (3), translation (3), fx, fy, cx, cy, k1, k2, p1, p2, k3
+			const size_t viewParameterCount = 15;
+			const size_t intrinsicsOffset = 6;
+			const size_t maxStructureParameterCount = 6;
+			const size_t observationsPerChunk = 1024;
+
+			struct Pose {
+				cv::Matx33d rotation;
+				cv::Vec3d translation;
+			};
+
+			struct ViewState {
+				Pose pose;
+				double intrinsics[9]; // fx, fy, cx, cy, k1, k2, p1, p2, k3
+			};
+
+			struct State {
+				vector<ViewState> views;
+				vector<cv::Vec3d> points;
+				vector<Pose> objects;
+			};
+
+			struct Linearisation {
+				bool valid;
+				double residual[2];
+				double weight;
+				double viewJacobian[2][viewParameterCount];
+				double structureJacobian[2][maxStructureParameterCount];
+			};
+
+			//----------
+			cv::Matx33d toRotationMatrix(const cv::Vec3d & rotationVector) {
+				cv::Matx33d rotation;
+				cv::Rodrigues(rotationVector, rotation);
+				return rotation;
+			}
+
+			//----------
+			cv::Vec3d toRotationVector(const cv::Matx33d & rotation) {
+				cv::Vec3d rotationVector;
+				cv::Rodrigues(rotation, rotationVector);
+				return rotationVector;
+			}
+
+			//----------
+			ViewState toViewState(const BundleAdjustment::View & view) {
+				ViewState viewState;
+				viewState.pose.rotation = toRotationMatrix(view.rotationVector);
+				viewState.pose.translation = view.translation;
+				viewState.intrinsics[0] = view.focalLength[0];
+				viewState.intrinsics[1] = view.focalLength[1];
+				viewState.intrinsics[2] = view.principalPoint[0];
+				viewState.intrinsics[3] = view.principalPoint[1];
+				for (size_t i = 0; i < 5; i++) {
+					viewState.intrinsics[4 + i] = view.distortion[i];
+				}
+				return viewState;
+			}
+
+			//----------
+			cv::Vec3d readVector3(const cv::Mat & mat) {
+				cv::Mat asDouble;
+				mat.convertTo(asDouble, CV_64F);
+				if (asDouble.total() != 3) {
+					throw(ofxRulr::Exception("BundleAdjustment : expected a 3 element vector"));
+				}
+				auto data = asDouble.ptr<double>();
+				return cv::Vec3d(data[0], data[1], data[2]);
+			}
+
+			//----------
+			//writes d(-[a]x b)/db, i.e. the derivative of (exp(delta) * a) w.r.t. delta at delta = 0
+			void writeRotationJacobian(const cv::Vec3d & a, double out[3][3]) {
+				out[0][0] = 0.0; out[0][1] = a[2]; out[0][2] = -a[1];
+				out[1][0] = -a[2]; out[1][1] = 0.0; out[1][2] = a[0];
+				out[2][0] = a[1]; out[2][1] = -a[0]; out[2][2] = 0.0;
+			}
+
+			//----------
+			//returns false if the point is behind the view
+			bool project(const ViewState & view
+				, const cv::Vec3d & pointInView
+				, double imagePoint[2]
+				, double dImagePoint_dPoint[2][3]
+				, double dImagePoint_dIntrinsics[2][9]) {
+				const auto z = pointInView[2];
+				if (!(z > 1e-9)) {
+					return false;
+				}
+
+				const auto & intrinsics = view.intrinsics;
+				const auto fx = intrinsics[0], fy = intrinsics[1], cx = intrinsics[2], cy = intrinsics[3];
+				const auto k1 = intrinsics[4], k2 = intrinsics[5], p1 = intrinsics[6], p2 = intrinsics[7], k3 = intrinsics[8];
+
+				const auto inverseZ = 1.0 / z;
+				const auto x = pointInView[0] * inverseZ;
+				const auto y = pointInView[1] * inverseZ;
+				const auto r2 = x * x + y * y;
+				const auto r4 = r2 * r2;
+				const auto r6 = r4 * r2;
+				const auto radial = 1.0 + k1 * r2 + k2 * r4 + k3 * r6;
+				const auto xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+				const auto yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+
+				imagePoint[0] = fx * xd + cx;
+				imagePoint[1] = fy * yd + cy;
+
+				if (!dImagePoint_dPoint) {
+					return true;
+				}
+
+				//distorted w.r.t. normalised
+				const auto dRadial_dR2 = k1 + 2.0 * k2 * r2 + 3.0 * k3 * r4;
+				const auto dxd_dx = radial + 2.0 * x * x * dRadial_dR2 + 2.0 * p1 * y + 6.0 * p2 * x;
+				const auto dxd_dy = 2.0 * x * y * dRadial_dR2 + 2.0 * p1 * x + 2.0 * p2 * y;
+				const auto dyd_dx = 2.0 * x * y * dRadial_dR2 + 2.0 * p1 * x + 2.0 * p2 * y;
+				const auto dyd_dy = radial + 2.0 * y * y * dRadial_dR2 + 6.0 * p1 * y + 2.0 * p2 * x;
+
+				//normalised w.r.t. point in view : dx = (dX - x dZ) / Z
+				dImagePoint_dPoint[0][0] = fx * dxd_dx * inverseZ;
+				dImagePoint_dPoint[0][1] = fx * dxd_dy * inverseZ;
+				dImagePoint_dPoint[0][2] = -fx * (dxd_dx * x + dxd_dy * y) * inverseZ;
+				dImagePoint_dPoint[1][0] = fy * dyd_dx * inverseZ;
+				dImagePoint_dPoint[1][1] = fy * dyd_dy * inverseZ;
+				dImagePoint_dPoint[1][2] = -fy * (dyd_dx * x + dyd_dy * y) * inverseZ;
+
+				auto & du = dImagePoint_dIntrinsics[0];
+				auto & dv = dImagePoint_dIntrinsics[1];
+				du[0] = xd; du[1] = 0.0; du[2] = 1.0; du[3] = 0.0;
+				dv[0] = 0.0; dv[1] = yd; dv[2] = 0.0; dv[3] = 1.0;
+				du[4] = fx * x * r2; dv[4] = fy * y * r2;
+				du[5] = fx * x * r4; dv[5] = fy * y * r4;
+				du[6] = fx * 2.0 * x * y; dv[6] = fy * (r2 + 2.0 * y * y);
+				du[7] = fx * (r2 + 2.0 * x * x); dv[7] = fy * 2.0 * x * y;
+				du[8] = fx * x * r6; dv[8] = fy * y * r6;
+
+				return true;
+			}
+
+			//----------
+			//returns the robust cost of a residual of length (squared) and writes the IRLS weight
+			double getRobustCost(double residualSquared, const BundleAdjustment::Settings & settings, double & weight) {
+				const auto scale = settings.lossScale;
+				switch (settings.loss) {
+				case BundleAdjustment::Loss::Huber:
+				{
+					const auto residual = sqrt(residualSquared);
+					if (residual <= scale) {
+						weight = 1.0;
+						return residualSquared;
+					}
+					weight = scale / residual;
+					return 2.0 * scale * residual - scale * scale;
+				}
+				case BundleAdjustment::Loss::Cauchy:
+				{
+					const auto scaleSquared = scale * scale;
+					weight = 1.0 / (1.0 + residualSquared / scaleSquared);
+					return scaleSquared * log(1.0 + residualSquared / scaleSquared);
+				}
+				case BundleAdjustment::Loss::Squared:
+				default:
+					weight = 1.0;
+					return residualSquared;
+				}
+			}
+
+			//----------
+			//in place inverse of a symmetric positive definite n x n matrix (row major). returns false if it isn't positive definite
+			bool invertSymmetric(double * matrix, size_t n) {
+				double lower[maxStructureParameterCount * maxStructureParameterCount] = { 0 };
+				for (size_t i = 0; i < n; i++) {
+					for (size_t j = 0; j <= i; j++) {
+						auto sum = matrix[i * n + j];
+						for (size_t k = 0; k < j; k++) {
+							sum -= lower[i * n + k] * lower[j * n + k];
+						}
+						if (i == j) {
+							if (!(sum > 0.0)) {
+								return false;
+							}
+							lower[i * n + i] = sqrt(sum);
+						}
+						else {
+							lower[i * n + j] = sum / lower[j * n + j];
+						}
+					}
+				}
+
+				//inverse of lower (lower triangular)
+				double lowerInverse[maxStructureParameterCount * maxStructureParameterCount] = { 0 };
+				for (size_t i = 0; i < n; i++) {
+					lowerInverse[i * n + i] = 1.0 / lower[i * n + i];
+					for (size_t j = 0; j < i; j++) {
+						double sum = 0.0;
+						for (size_t k = j; k < i; k++) {
+							sum -= lower[i * n + k] * lowerInverse[k * n + j];
+						}
+						lowerInverse[i * n + j] = sum / lower[i * n + i];
+					}
+				}
+
+				//inverse = lowerInverse^T * lowerInverse
+				for (size_t i = 0; i < n; i++) {
+					for (size_t j = 0; j < n; j++) {
+						double sum = 0.0;
+						for (size_t k = max(i, j); k < n; k++) {
+							sum += lowerInverse[k * n + i] * lowerInverse[k * n + j];
+						}
+						matrix[i * n + j] = sum;
+					}
+				}
+				return true;
+			}
+
+			//----------
+			void forEachChunk(size_t count, bool multiThreaded, const function<void(size_t, size_t, size_t)> & action) {
+				const auto chunkCount = (count + observationsPerChunk - 1) / observationsPerChunk;
+				auto actionForChunk = [&](size_t chunkIndex) {
+					const auto begin = chunkIndex * observationsPerChunk;
+					action(chunkIndex, begin, min(begin + observationsPerChunk, count));
+				};
+				if (multiThreaded && chunkCount > 1) {
+					ThreadPool::X().parallelFor(0, chunkCount, actionForChunk, 1, ThreadPool::Priority::Batch);
+				}
+				else {
+					for (size_t i = 0; i < chunkCount; i++) {
+						actionForChunk(i);
+					}
+				}
+			}
+
+			//----------
+			void forEachIndex(size_t count, bool multiThreaded, const function<void(size_t)> & action) {
+				if (multiThreaded && count > 1) {
+					ThreadPool::X().parallelFor(0, count, action, 1, ThreadPool::Priority::Batch);
+				}
+				else {
+					for (size_t i = 0; i < count; i++) {
+						action(i);
+					}
+				}
+			}
+		}
+
+#pragma mark View
+		//----------
+		void BundleAdjustment::View::setIntrinsics(const cv::Mat & cameraMatrix, const cv::Mat & distortionCoefficients) {
+			cv::Mat cameraMatrix64;
+			cameraMatrix.convertTo(cameraMatrix64, CV_64F);
+			this->focalLength[0] = cameraMatrix64.at<double>(0, 0);
+			this->focalLength[1] = cameraMatrix64.at<double>(1, 1);
+			this->principalPoint[0] = cameraMatrix64.at<double>(0, 2);
+			this->principalPoint[1] = cameraMatrix64.at<double>(1, 2);
+
+			cv::Mat distortion64;
+			distortionCoefficients.convertTo(distortion64, CV_64F);
+			auto count = distortion64.total();
+			if (count > 5) {
+				//we only model k1, k2, p1, p2, k3
+				throw(ofxRulr::Exception("BundleAdjustment supports at most 5 distortion coefficients"));
+			}
+			for (size_t i = 0; i < 5; i++) {
+				this->distortion[i] = i < count ? distortion64.ptr<double>()[i] : 0.0;
+			}
+		}
+
+		//----------
+		void BundleAdjustment::View::setExtrinsics(const cv::Mat & rotationVector, const cv::Mat & translation) {
+			this->rotationVector = readVector3(rotationVector);
+			this->translation = readVector3(translation);
+		}
+
+		//----------
+		cv::Mat BundleAdjustment::View::getCameraMatrix() const {
+			cv::Mat cameraMatrix = cv::Mat::eye(3, 3, CV_64F);
+			cameraMatrix.at<double>(0, 0) = this->focalLength[0];
+			cameraMatrix.at<double>(1, 1) = this->focalLength[1];
+			cameraMatrix.at<double>(0, 2) = this->principalPoint[0];
+			cameraMatrix.at<double>(1, 2) = this->principalPoint[1];
+			return cameraMatrix;
+		}
+
+		//----------
+		cv::Mat BundleAdjustment::View::getDistortionCoefficients(int count) const {
+			cv::Mat distortionCoefficients = cv::Mat::zeros(count, 1, CV_64F);
+			for (int i = 0; i < count && i < 5; i++) {
+				distortionCoefficients.at<double>(i) = this->distortion[i];
+			}
+			return distortionCoefficients;
+		}
+
+		//----------
+		void BundleAdjustment::View::getExtrinsics(cv::Mat & rotationVector, cv::Mat & translation) const {
+			rotationVector = cv::Mat(this->rotationVector, true);
+			translation = cv::Mat(this->translation, true);
+		}
+
+#pragma mark Object
+		//----------
+		void BundleAdjustment::Object::setPose(const cv::Mat & rotationVector, const cv::Mat & translation) {
+			this->rotationVector = readVector3(rotationVector);
+			this->translation = readVector3(translation);
+		}
+
+		//----------
+		void BundleAdjustment::Object::getPose(cv::Mat & rotationVector, cv::Mat & translation) const {
+			rotationVector = cv::Mat(this->rotationVector, true);
+			translation = cv::Mat(this->translation, true);
+		}
+
+#pragma mark BundleAdjustment
+		//----------
+		size_t BundleAdjustment::addView(const View & view) {
+			this->views.push_back(view);
+			return this->views.size() - 1;
+		}
+
+		//----------
+		size_t BundleAdjustment::addPoint(const Point & point) {
+			this->points.push_back(point);
+			return this->points.size() - 1;
+		}
+
+		//----------
+		size_t BundleAdjustment::addObject(const Object & object) {
+			this->objects.push_back(object);
+			return this->objects.size() - 1;
+		}
+
+		//----------
+		void BundleAdjustment::addObservation(size_t viewIndex, size_t pointIndex, const cv::Point2f & imagePoint) {
+			if (viewIndex >= this->views.size() || pointIndex >= this->points.size()) {
+				throw(ofxRulr::Exception("BundleAdjustment : observation refers to a view or point which hasn't been added"));
+			}
+			this->observations.push_back(Observation{ (uint32_t) viewIndex, (uint32_t) pointIndex, 0, false, imagePoint });
+		}
+
+		//----------
+		void BundleAdjustment::addObjectObservation(size_t viewIndex, size_t objectIndex, size_t objectPointIndex, const cv::Point2f & imagePoint) {
+			if (viewIndex >= this->views.size() || objectIndex >= this->objects.size()
+				|| objectPointIndex >= this->objects[objectIndex].points.size()) {
+				throw(ofxRulr::Exception("BundleAdjustment : observation refers to a view or object which hasn't been added"));
+			}
+			this->observations.push_back(Observation{ (uint32_t) viewIndex, (uint32_t) objectIndex, (uint32_t) objectPointIndex, true, imagePoint });
+		}
+
+		//----------
+		BundleAdjustment::Result BundleAdjustment::solve(const Settings & settings) {
+			Result result;
+			result.observationCount = this->observations.size();
+			if (this->observations.empty()) {
+				throw(ofxRulr::Exception("BundleAdjustment : no observations to solve"));
+			}
+
+			//--
+			//Parameter layout
+			//--
+			//
+			//the active view parameters make up the reduced (Schur complement) system
+			vector<array<uint8_t, viewParameterCount>> viewActiveParameters(this->views.size());
+			vector<size_t> viewActiveCounts(this->views.size(), 0);
+			vector<size_t> viewOffsets(this->views.size(), 0);
+			size_t reducedSize = 0;
+			for (size_t i = 0; i < this->views.size(); i++) {
+				const auto & view = this->views[i];
+				bool active[viewParameterCount];
+				for (size_t j = 0; j < 6; j++) {
+					active[j] = !view.fixPose;
+				}
+				active[6] = active[7] = !view.fixFocalLength;
+				active[8] = active[9] = !view.fixPrincipalPoint;
+				for (size_t j = 10; j < viewParameterCount; j++) {
+					active[j] = !view.fixDistortion;
+				}
+
+				auto & count = viewActiveCounts[i];
+				for (size_t j = 0; j < viewParameterCount; j++) {
+					if (active[j]) {
+						viewActiveParameters[i][count++] = (uint8_t) j;
+					}
+				}
+				viewOffsets[i] = reducedSize;
+				reducedSize += count;
+			}
+
+			//structures are the points followed by the objects. each is eliminated on its own
+			const auto structureCount = this->points.size() + this->objects.size();
+			vector<size_t> structureSizes(structureCount);
+			for (size_t i = 0; i < this->points.size(); i++) {
+				structureSizes[i] = this->points[i].fixed ? 0 : 3;
+			}
+			for (size_t i = 0; i < this->objects.size(); i++) {
+				structureSizes[this->points.size() + i] = this->objects[i].fixed ? 0 : 6;
+			}
+			auto getStructureIndex = [this](const Observation & observation) {
+				return observation.isObject
+					? this->points.size() + observation.structure
+					: (size_t) observation.structure;
+			};
+
+			vector<vector<uint32_t>> structureObservations(structureCount);
+			for (size_t i = 0; i < this->observations.size(); i++) {
+				structureObservations[getStructureIndex(this->observations[i])].push_back((uint32_t) i);
+			}
+
+			result.parameterCount = reducedSize;
+			for (auto structureSize : structureSizes) {
+				result.parameterCount += structureSize;
+			}
+
+			//--
+			//Evaluation
+			//--
+			//
+			State state;
+			for (const auto & view : this->views) {
+				state.views.push_back(toViewState(view));
+			}
+			for (const auto & point : this->points) {
+				state.points.push_back(cv::Vec3d(point.position.x, point.position.y, point.position.z));
+			}
+			for (const auto & object : this->objects) {
+				state.objects.push_back(Pose{ toRotationMatrix(object.rotationVector), object.translation });
+			}
+
+			//writes the residual (and Jacobians if linearisation has them) for one observation
+			auto evaluateObservation = [this](const State & state, const Observation & observation, Linearisation & linearisation, bool withJacobians) {
+				cv::Vec3d worldPoint;
+				cv::Vec3d objectPointRotated;
+				if (observation.isObject) {
+					const auto & object = state.objects[observation.structure];
+					const auto & objectPoint = this->objects[observation.structure].points[observation.objectPoint];
+					objectPointRotated = object.rotation * cv::Vec3d(objectPoint.x, objectPoint.y, objectPoint.z);
+					worldPoint = objectPointRotated + object.translation;
+				}
+				else {
+					worldPoint = state.points[observation.structure];
+				}
+
+				const auto & view = state.views[observation.view];
+				const cv::Vec3d worldPointRotated = view.pose.rotation * worldPoint;
+				const cv::Vec3d pointInView = worldPointRotated + view.pose.translation;
+
+				double imagePoint[2];
+				double dImagePoint_dPoint[2][3];
+				double dImagePoint_dIntrinsics[2][9];
+				linearisation.valid = project(view
+					, pointInView
+					, imagePoint
+					, withJacobians ? dImagePoint_dPoint : nullptr
+					, dImagePoint_dIntrinsics);
+				if (!linearisation.valid) {
+					return;
+				}
+				linearisation.residual[0] = imagePoint[0] - observation.imagePoint.x;
+				linearisation.residual[1] = imagePoint[1] - observation.imagePoint.y;
+
+				if (!withJacobians) {
+					return;
+				}
+
+				//view pose : d(pointInView) = -[R X]x dRotation + dTranslation
+				double dPoint_dViewRotation[3][3];
+				writeRotationJacobian(worldPointRotated, dPoint_dViewRotation);
+
+				//d(pointInView)/d(worldPoint) = R_view, then d(worldPoint)/d(structure)
+				double dWorldPoint_dStructure[3][maxStructureParameterCount] = { 0 };
+				if (observation.isObject) {
+					double dObjectRotation[3][3];
+					writeRotationJacobian(objectPointRotated, dObjectRotation);
+					for (int i = 0; i < 3; i++) {
+						for (int j = 0; j < 3; j++) {
+							dWorldPoint_dStructure[i][j] = dObjectRotation[i][j];
+						}
+						dWorldPoint_dStructure[i][3 + i] = 1.0;
+					}
+				}
+				else {
+					for (int i = 0; i < 3; i++) {
+						dWorldPoint_dStructure[i][i] = 1.0;
+					}
+				}
+
+				for (int row = 0; row < 2; row++) {
+					auto & viewRow = linearisation.viewJacobian[row];
+					for (int j = 0; j < 3; j++) {
+						double rotationSum = 0.0;
+						for (int k = 0; k < 3; k++) {
+							rotationSum += dImagePoint_dPoint[row][k] * dPoint_dViewRotation[k][j];
+						}
+						viewRow[j] = rotationSum;
+						viewRow[3 + j] = dImagePoint_dPoint[row][j];
+					}
+					for (int j = 0; j < 9; j++) {
+						viewRow[intrinsicsOffset + j] = dImagePoint_dIntrinsics[row][j];
+					}
+
+					//image point w.r.t. world point
+					double dImagePoint_dWorldPoint[3];
+					for (int j = 0; j < 3; j++) {
+						double sum = 0.0;
+						for (int k = 0; k < 3; k++) {
+							sum += dImagePoint_dPoint[row][k] * view.pose.rotation(k, j);
+						}
+						dImagePoint_dWorldPoint[j] = sum;
+					}
+					for (size_t j = 0; j < maxStructureParameterCount; j++) {
+						double sum = 0.0;
+						for (int k = 0; k < 3; k++) {
+							sum += dImagePoint_dWorldPoint[k] * dWorldPoint_dStructure[k][j];
+						}
+						linearisation.structureJacobian[row][j] = sum;
+					}
+				}
+			};
+
+			//returns the total robust cost, and the count of observations in front of their views
+			const auto chunkCount = (this->observations.size() + observationsPerChunk - 1) / observationsPerChunk;
+			vector<Linearisation> linearisations(this->observations.size());
+			auto evaluate = [&](const State & state, bool withJacobians, size_t & validCount, double & squaredErrorSum) {
+				vector<double> chunkCosts(chunkCount, 0.0);
+				vector<double> chunkSquaredErrors(chunkCount, 0.0);
+				vector<size_t> chunkValidCounts(chunkCount, 0);
+				forEachChunk(this->observations.size(), settings.multiThreaded, [&](size_t chunkIndex, size_t begin, size_t end) {
+					Linearisation scratch;
+					for (size_t i = begin; i < end; i++) {
+						auto & linearisation = withJacobians ? linearisations[i] : scratch;
+						evaluateObservation(state, this->observations[i], linearisation, withJacobians);
+						if (!linearisation.valid) {
+							continue;
+						}
+						const auto residualSquared = linearisation.residual[0] * linearisation.residual[0]
+							+ linearisation.residual[1] * linearisation.residual[1];
+						chunkCosts[chunkIndex] += getRobustCost(residualSquared, settings, linearisation.weight);
+						chunkSquaredErrors[chunkIndex] += residualSquared;
+						chunkValidCounts[chunkIndex]++;
+					}
+				});
+
+				double cost = 0.0;
+				validCount = 0;
+				squaredErrorSum = 0.0;
+				for (size_t i = 0; i < chunkCount; i++) {
+					cost += chunkCosts[i];
+					squaredErrorSum += chunkSquaredErrors[i];
+					validCount += chunkValidCounts[i];
+				}
+				return cost;
+			};
+
+			auto getRMS = [](double squaredErrorSum, size_t validCount) {
+				return validCount > 0 ? sqrt(squaredErrorSum / (double) validCount) : 0.0;
+			};
+
+			size_t validCount;
+			double squaredErrorSum;
+			auto cost = evaluate(state, true, validCount, squaredErrorSum);
+			if (validCount == 0) {
+				throw(ofxRulr::Exception("BundleAdjustment : no observed points are in front of their views"));
+			}
+			result.initialCost = cost;
+			result.initialReprojectionError = getRMS(squaredErrorSum, validCount);
+			result.reprojectionError = result.initialReprojectionError;
+
+			//--
+			//Levenberg-Marquardt
+			//--
+			//
+			vector<vector<double>> viewHessians(this->views.size()); // U (active x active)
+			vector<vector<double>> viewGradients(this->views.size());
+			vector<array<double, maxStructureParameterCount * maxStructureParameterCount>> structureHessians(structureCount); // V
+			vector<array<double, maxStructureParameterCount>> structureGradients(structureCount);
+
+			//W summed per (view, structure) pair. a structure's blocks are contiguous, and each view lists its own
+			struct CrossTermBlock {
+				uint32_t view;
+				uint32_t structure;
+				size_t offset; // into crossTerms (active view parameters x structure parameters)
+			};
+			vector<CrossTermBlock> crossTermBlocks;
+			vector<size_t> structureBlocksBegin(structureCount + 1, 0);
+			vector<vector<uint32_t>> viewBlocks(this->views.size());
+			vector<uint32_t> observationBlocks(this->observations.size());
+			vector<double> crossTerms;
+			vector<double> crossTermsTimesInverse; // Y = W V*^-1 for each block
+
+			//W = Jv^T w Js for one observation (active view parameters x structure parameters)
+			auto getCrossTerm = [&](size_t observationIndex, double * out) {
+				const auto & observation = this->observations[observationIndex];
+				const auto & linearisation = linearisations[observationIndex];
+				const auto & active = viewActiveParameters[observation.view];
+				const auto activeCount = viewActiveCounts[observation.view];
+				const auto structureSize = structureSizes[getStructureIndex(observation)];
+				for (size_t i = 0; i < activeCount; i++) {
+					for (size_t j = 0; j < structureSize; j++) {
+						out[i * structureSize + j] = linearisation.weight
+							* (linearisation.viewJacobian[0][active[i]] * linearisation.structureJacobian[0][j]
+								+ linearisation.viewJacobian[1][active[i]] * linearisation.structureJacobian[1][j]);
+					}
+				}
+			};
+
+			double lambda = settings.initialLambda;
+			bool converged = false;
+			for (result.iterations = 0; result.iterations < settings.maxIterations && !converged; result.iterations++) {
+				//accumulate the normal equations of the blocks
+				for (size_t i = 0; i < this->views.size(); i++) {
+					viewHessians[i].assign(viewActiveCounts[i] * viewActiveCounts[i], 0.0);
+					viewGradients[i].assign(viewActiveCounts[i], 0.0);
+				}
+				for (size_t i = 0; i < structureCount; i++) {
+					structureHessians[i].fill(0.0);
+					structureGradients[i].fill(0.0);
+				}
+				for (size_t o = 0; o < this->observations.size(); o++) {
+					const auto & linearisation = linearisations[o];
+					if (!linearisation.valid) {
+						continue;
+					}
+					const auto & observation = this->observations[o];
+					const auto weight = linearisation.weight;
+
+					const auto & active = viewActiveParameters[observation.view];
+					const auto activeCount = viewActiveCounts[observation.view];
+					auto & viewHessian = viewHessians[observation.view];
+					auto & viewGradient = viewGradients[observation.view];
+					for (size_t i = 0; i < activeCount; i++) {
+						const auto ji0 = linearisation.viewJacobian[0][active[i]];
+						const auto ji1 = linearisation.viewJacobian[1][active[i]];
+						viewGradient[i] += weight * (ji0 * linearisation.residual[0] + ji1 * linearisation.residual[1]);
+						for (size_t j = 0; j <= i; j++) {
+							viewHessian[i * activeCount + j] += weight
+								* (ji0 * linearisation.viewJacobian[0][active[j]] + ji1 * linearisation.viewJacobian[1][active[j]]);
+						}
+					}
+
+					const auto structureIndex = getStructureIndex(observation);
+					const auto structureSize = structureSizes[structureIndex];
+					auto & structureHessian = structureHessians[structureIndex];
+					auto & structureGradient = structureGradients[structureIndex];
+					for (size_t i = 0; i < structureSize; i++) {
+						const auto ji0 = linearisation.structureJacobian[0][i];
+						const auto ji1 = linearisation.structureJacobian[1][i];
+						structureGradient[i] += weight * (ji0 * linearisation.residual[0] + ji1 * linearisation.residual[1]);
+						for (size_t j = 0; j <= i; j++) {
+							structureHessian[i * structureSize + j] += weight
+								* (ji0 * linearisation.structureJacobian[0][j] + ji1 * linearisation.structureJacobian[1][j]);
+						}
+					}
+				}
+
+				//we only filled the lower triangles
+				for (size_t v = 0; v < this->views.size(); v++) {
+					const auto n = viewActiveCounts[v];
+					for (size_t i = 0; i < n; i++) {
+						for (size_t j = i + 1; j < n; j++) {
+							viewHessians[v][i * n + j] = viewHessians[v][j * n + i];
+						}
+					}
+				}
+				for (size_t s = 0; s < structureCount; s++) {
+					const auto n = structureSizes[s];
+					for (size_t i = 0; i < n; i++) {
+						for (size_t j = i + 1; j < n; j++) {
+							structureHessians[s][i * n + j] = structureHessians[s][j * n + i];
+						}
+					}
+				}
+
+				//sum W over the observations of each structure in each view (e.g. all the points of a board seen by one
+				// camera), so that the reduced system is formed from one block per view rather than per observation
+				crossTermBlocks.clear();
+				for (auto & blocks : viewBlocks) {
+					blocks.clear();
+				}
+				size_t crossTermsSize = 0;
+				{
+					vector<int64_t> blockOfView(this->views.size(), -1); // blocks before this structure's are stale
+					for (size_t s = 0; s < structureCount; s++) {
+						structureBlocksBegin[s] = crossTermBlocks.size();
+						const auto n = structureSizes[s];
+						if (n == 0 || reducedSize == 0) {
+							continue;
+						}
+						for (auto observationIndex : structureObservations[s]) {
+							if (!linearisations[observationIndex].valid) {
+								continue;
+							}
+							const auto view = this->observations[observationIndex].view;
+							auto & block = blockOfView[view];
+							if (block < (int64_t) structureBlocksBegin[s]) {
+								block = (int64_t) crossTermBlocks.size();
+								crossTermBlocks.push_back(CrossTermBlock{ view, (uint32_t) s, crossTermsSize });
+								viewBlocks[view].push_back((uint32_t) block);
+								crossTermsSize += viewActiveCounts[view] * n;
+							}
+							observationBlocks[observationIndex] = (uint32_t) block;
+						}
+					}
+					structureBlocksBegin[structureCount] = crossTermBlocks.size();
+				}
+				crossTerms.assign(crossTermsSize, 0.0);
+				crossTermsTimesInverse.resize(crossTermsSize);
+
+				//each structure owns its blocks, so they're accumulated in parallel
+				forEachIndex(structureCount, settings.multiThreaded, [&](size_t s) {
+					if (structureBlocksBegin[s] == structureBlocksBegin[s + 1]) {
+						return;
+					}
+					double crossTerm[viewParameterCount * maxStructureParameterCount];
+					for (auto observationIndex : structureObservations[s]) {
+						if (!linearisations[observationIndex].valid) {
+							continue;
+						}
+						const auto & block = crossTermBlocks[observationBlocks[observationIndex]];
+						const auto size = viewActiveCounts[block.view] * structureSizes[s];
+						getCrossTerm(observationIndex, crossTerm);
+						auto blockCrossTerm = crossTerms.data() + block.offset;
+						for (size_t i = 0; i < size; i++) {
+							blockCrossTerm[i] += crossTerm[i];
+						}
+					}
+				});
+
+				//try steps until one improves the cost (or we give up)
+				bool improved = false;
+				while (!improved) {
+					if (lambda > 1e16) {
+						converged = true;
+						break;
+					}
+
+					//reduced camera system S = U* - sum(W V*^-1 W^T), rhs = -g_view + sum(W V*^-1 g_structure)
+					cv::Mat reducedSystem = cv::Mat::zeros((int) reducedSize, (int) reducedSize, CV_64F);
+					cv::Mat reducedRHS = cv::Mat::zeros((int) reducedSize, 1, CV_64F);
+					for (size_t v = 0; v < this->views.size(); v++) {
+						const auto n = viewActiveCounts[v];
+						const auto offset = viewOffsets[v];
+						for (size_t i = 0; i < n; i++) {
+							for (size_t j = 0; j < n; j++) {
+								auto value = viewHessians[v][i * n + j];
+								if (i == j) {
+									value += lambda * max(value, 1e-6);
+								}
+								reducedSystem.at<double>((int) (offset + i), (int) (offset + j)) = value;
+							}
+							reducedRHS.at<double>((int) (offset + i)) = -viewGradients[v][i];
+						}
+					}
+
+					vector<array<double, maxStructureParameterCount * maxStructureParameterCount>> structureInverses(structureCount);
+					bool structuresInvertible = true;
+					for (size_t s = 0; s < structureCount && structuresInvertible; s++) {
+						const auto n = structureSizes[s];
+						if (n == 0) {
+							continue;
+						}
+						auto & inverse = structureInverses[s];
+						inverse = structureHessians[s];
+						for (size_t i = 0; i < n; i++) {
+							inverse[i * n + i] += lambda * max(inverse[i * n + i], 1e-6);
+						}
+						structuresInvertible = invertSymmetric(inverse.data(), n);
+					}
+					if (!structuresInvertible) {
+						lambda *= 10.0;
+						continue;
+					}
+
+					if (reducedSize > 0) {
+						//Y = W V*^-1 for each block
+						forEachIndex(structureCount, settings.multiThreaded, [&](size_t s) {
+							const auto n = structureSizes[s];
+							const auto & inverse = structureInverses[s];
+							for (auto b = structureBlocksBegin[s]; b < structureBlocksBegin[s + 1]; b++) {
+								const auto & block = crossTermBlocks[b];
+								const auto activeCount = viewActiveCounts[block.view];
+								const auto crossTerm = crossTerms.data() + block.offset;
+								auto crossTermTimesInverse = crossTermsTimesInverse.data() + block.offset;
+								for (size_t i = 0; i < activeCount; i++) {
+									for (size_t j = 0; j < n; j++) {
+										double sum = 0.0;
+										for (size_t k = 0; k < n; k++) {
+											sum += crossTerm[i * n + k] * inverse[k * n + j];
+										}
+										crossTermTimesInverse[i * n + j] = sum;
+									}
+								}
+							}
+						});
+
+						//each view forms its own rows from the structures it sees, so the views are done in parallel
+						forEachIndex(this->views.size(), settings.multiThreaded, [&](size_t viewA) {
+							const auto activeCountA = viewActiveCounts[viewA];
+							const auto offsetA = viewOffsets[viewA];
+							for (auto blockA : viewBlocks[viewA]) {
+								const auto s = crossTermBlocks[blockA].structure;
+								const auto n = structureSizes[s];
+								const auto crossTermTimesInverse = crossTermsTimesInverse.data() + crossTermBlocks[blockA].offset;
+
+								for (size_t i = 0; i < activeCountA; i++) {
+									double sum = 0.0;
+									for (size_t k = 0; k < n; k++) {
+										sum += crossTermTimesInverse[i * n + k] * structureGradients[s][k];
+									}
+									reducedRHS.at<double>((int) (offsetA + i)) += sum;
+								}
+
+								for (auto b = structureBlocksBegin[s]; b < structureBlocksBegin[s + 1]; b++) {
+									const auto & blockB = crossTermBlocks[b];
+									const auto activeCountB = viewActiveCounts[blockB.view];
+									const auto offsetB = viewOffsets[blockB.view];
+									const auto crossTermB = crossTerms.data() + blockB.offset;
+									for (size_t i = 0; i < activeCountA; i++) {
+										auto row = reducedSystem.ptr<double>((int) (offsetA + i)) + offsetB;
+										for (size_t j = 0; j < activeCountB; j++) {
+											double sum = 0.0;
+											for (size_t k = 0; k < n; k++) {
+												sum += crossTermTimesInverse[i * n + k] * crossTermB[j * n + k];
+											}
+											row[j] -= sum;
+										}
+									}
+								}
+							}
+						});
+					}
+
+					cv::Mat viewStep;
+					if (reducedSize > 0) {
+						if (!cv::solve(reducedSystem, reducedRHS, viewStep, cv::DECOMP_CHOLESKY)) {
+							lambda *= 10.0;
+							continue;
+						}
+					}
+
+					//back substitute for the structure : step = V*^-1 (-g_structure - sum(W^T viewStep))
+					vector<array<double, maxStructureParameterCount>> structureSteps(structureCount);
+					forEachIndex(structureCount, settings.multiThreaded, [&](size_t s) {
+						const auto n = structureSizes[s];
+						if (n == 0) {
+							return;
+						}
+						double rhs[maxStructureParameterCount];
+						for (size_t i = 0; i < n; i++) {
+							rhs[i] = -structureGradients[s][i];
+						}
+						for (auto b = structureBlocksBegin[s]; b < structureBlocksBegin[s + 1]; b++) {
+							const auto & block = crossTermBlocks[b];
+							const auto activeCount = viewActiveCounts[block.view];
+							const auto offset = viewOffsets[block.view];
+							const auto crossTerm = crossTerms.data() + block.offset;
+							for (size_t i = 0; i < activeCount; i++) {
+								const auto step = viewStep.at<double>((int) (offset + i));
+								for (size_t j = 0; j < n; j++) {
+									rhs[j] -= crossTerm[i * n + j] * step;
+								}
+							}
+						}
+						for (size_t i = 0; i < n; i++) {
+							double sum = 0.0;
+							for (size_t j = 0; j < n; j++) {
+								sum += structureInverses[s][i * n + j] * rhs[j];
+							}
+							structureSteps[s][i] = sum;
+						}
+					});
+
+					//apply the step
+					State candidate = state;
+					double stepSquared = 0.0;
+					for (size_t v = 0; v < this->views.size(); v++) {
+						double step[viewParameterCount] = { 0 };
+						for (size_t i = 0; i < viewActiveCounts[v]; i++) {
+							step[viewActiveParameters[v][i]] = viewStep.at<double>((int) (viewOffsets[v] + i));
+							stepSquared += step[viewActiveParameters[v][i]] * step[viewActiveParameters[v][i]];
+						}
+						auto & view = candidate.views[v];
+						view.pose.rotation = toRotationMatrix(cv::Vec3d(step[0], step[1], step[2])) * view.pose.rotation;
+						view.pose.translation += cv::Vec3d(step[3], step[4], step[5]);
+						for (size_t i = 0; i < 9; i++) {
+							view.intrinsics[i] += step[intrinsicsOffset + i];
+						}
+					}
+					for (size_t p = 0; p < this->points.size(); p++) {
+						if (structureSizes[p] == 0) {
+							continue;
+						}
+						const auto & step = structureSteps[p];
+						candidate.points[p] += cv::Vec3d(step[0], step[1], step[2]);
+						stepSquared += step[0] * step[0] + step[1] * step[1] + step[2] * step[2];
+					}
+					for (size_t o = 0; o < this->objects.size(); o++) {
+						const auto s = this->points.size() + o;
+						if (structureSizes[s] == 0) {
+							continue;
+						}
+						const auto & step = structureSteps[s];
+						auto & object = candidate.objects[o];
+						object.rotation = toRotationMatrix(cv::Vec3d(step[0], step[1], step[2])) * object.rotation;
+						object.translation += cv::Vec3d(step[3], step[4], step[5]);
+						for (size_t i = 0; i < 6; i++) {
+							stepSquared += step[i] * step[i];
+						}
+					}
+
+					//we don't accept steps which push points behind their views
+					size_t candidateValidCount;
+					double candidateSquaredErrorSum;
+					const auto candidateCost = evaluate(candidate, false, candidateValidCount, candidateSquaredErrorSum);
+					if (candidateValidCount >= validCount && candidateCost < cost) {
+						const auto improvement = cost - candidateCost;
+						state = move(candidate);
+						lambda = max(lambda / 10.0, 1e-12);
+						improved = true;
+
+						cost = evaluate(state, true, validCount, squaredErrorSum);
+						result.reprojectionError = getRMS(squaredErrorSum, validCount);
+
+						if (improvement < settings.relativeCostTolerance * cost
+							|| sqrt(stepSquared) < settings.parameterTolerance) {
+							converged = true;
+						}
+					}
+					else {
+						if (sqrt(stepSquared) < settings.parameterTolerance) {
+							converged = true;
+							break;
+						}
+						lambda *= 10.0;
+					}
+				}
+			}
+
+			//--
+			//Write back
+			//--
+			//
+			for (size_t i = 0; i < this->views.size(); i++) {
+				auto & view = this->views[i];
+				const auto & viewState = state.views[i];
+				view.rotationVector = toRotationVector(viewState.pose.rotation);
+				view.translation = viewState.pose.translation;
+				view.focalLength[0] = viewState.intrinsics[0];
+				view.focalLength[1] = viewState.intrinsics[1];
+				view.principalPoint[0] = viewState.intrinsics[2];
+				view.principalPoint[1] = viewState.intrinsics[3];
+				for (size_t j = 0; j < 5; j++) {
+					view.distortion[j] = viewState.intrinsics[4 + j];
+				}
+			}
+			for (size_t i = 0; i < this->points.size(); i++) {
+				const auto & position = state.points[i];
+				this->points[i].position = cv::Point3d(position[0], position[1], position[2]);
+			}
+			for (size_t i = 0; i < this->objects.size(); i++) {
+				this->objects[i].rotationVector = toRotationVector(state.objects[i].rotation);
+				this->objects[i].translation = state.objects[i].translation;
+			}
+
+			result.cost = cost;
+			result.success = result.cost <= result.initialCost;
+			return result;
+		}
+
+		//----------
+		double BundleAdjustment::getReprojectionError() const {
+			vector<ViewState> viewStates;
+			for (const auto & view : this->views) {
+				viewStates.push_back(toViewState(view));
+			}
+			vector<cv::Matx33d> objectRotations;
+			for (const auto & object : this->objects) {
+				objectRotations.push_back(toRotationMatrix(object.rotationVector));
+			}
+
+			double squaredErrorSum = 0.0;
+			size_t count = 0;
+			for (const auto & observation : this->observations) {
+				cv::Vec3d worldPoint;
+				if (observation.isObject) {
+					const auto & object = this->objects[observation.structure];
+					const auto & objectPoint = object.points[observation.objectPoint];
+					worldPoint = objectRotations[observation.structure] * cv::Vec3d(objectPoint.x, objectPoint.y, objectPoint.z) + object.translation;
+				}
+				else {
+					const auto & position = this->points[observation.structure].position;
+					worldPoint = cv::Vec3d(position.x, position.y, position.z);
+				}
+
+				const auto & view = viewStates[observation.view];
+				double imagePoint[2];
+				if (!project(view, view.pose.rotation * worldPoint + view.pose.translation, imagePoint, nullptr, nullptr)) {
+					continue;
+				}
+				const auto dx = imagePoint[0] - observation.imagePoint.x;
+				const auto dy = imagePoint[1] - observation.imagePoint.y;
+				squaredErrorSum += dx * dx + dy * dy;
+				count++;
+			}
+			return count > 0 ? sqrt(squaredErrorSum / (double) count) : 0.0;
+		}
+
+		//----------
+		const vector<BundleAdjustment::View> & BundleAdjustment::getViews() const {
+			return this->views;
+		}
+
+		//----------
+		const vector<BundleAdjustment::Point> & BundleAdjustment::getPoints() const {
+			return this->points;
+		}
+
+		//----------
+		const vector<BundleAdjustment::Object> & BundleAdjustment::getObjects() const {
+			return this->objects;
+		}
+
+		//----------
+		BundleAdjustment::View & BundleAdjustment::getView(size_t index) {
+			return this->views.at(index);
+		}
+
+		//----------
+		BundleAdjustment::Point & BundleAdjustment::getPoint(size_t index) {
+			return this->points.at(index);
+		}
+
+		//----------
+		BundleAdjustment::Object & BundleAdjustment::getObject(size_t index) {
+			return this->objects.at(index);
+		}
+	}
+}
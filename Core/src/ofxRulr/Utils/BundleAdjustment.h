@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ofxRulr/Utils/Constants.h"
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+
+using namespace std;
+
+namespace ofxRulr {
+	namespace Utils {
+		///Sparse bundle adjustment of views (cameras / projectors) against the points they observe.
+		///Levenberg-Marquardt where the structure (free points, and rigid objects such as boards) is eliminated with the
+		/// Schur complement, so that each iteration only needs a dense solve over the view parameters.
+		///Residuals and Jacobians are evaluated in parallel on the ThreadPool. Jacobians are closed form.
+		///All poses are world (or object) -> view, i.e. the same as cv::solvePnP / cv::calibrateCamera.
+		///Note : if every view and every point is free then the solution is only defined up to a similarity transform,
+		/// so fix the pose of at least one view (and for 2 views with free points, expect the scale to be arbitrary).
+		class RULR_EXPORTS BundleAdjustment {
+		public:
+			enum class Loss {
+				Squared,
+				Huber, ///< Quadratic within lossScale [px], linear outside
+				Cauchy ///< Strongly downweights residuals beyond lossScale [px]
+			};
+
+			struct RULR_EXPORTS View {
+				void setIntrinsics(const cv::Mat & cameraMatrix, const cv::Mat & distortionCoefficients);
+				void setExtrinsics(const cv::Mat & rotationVector, const cv::Mat & translation);
+				cv::Mat getCameraMatrix() const;
+				cv::Mat getDistortionCoefficients(int count = 5) const;
+				void getExtrinsics(cv::Mat & rotationVector, cv::Mat & translation) const;
+
+				cv::Vec3d rotationVector;
+				cv::Vec3d translation;
+				double focalLength[2] = { 1.0, 1.0 };
+				double principalPoint[2] = { 0.0, 0.0 };
+				double distortion[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 }; // k1, k2, p1, p2, k3
+
+				bool fixPose = false;
+				bool fixFocalLength = true;
+				bool fixPrincipalPoint = true;
+				bool fixDistortion = true;
+			};
+
+			///A point in world space
+			struct Point {
+				cv::Point3d position;
+				bool fixed = false;
+			};
+
+			///A rigid set of points (e.g. a board) whose pose (object -> world) is solved
+			struct RULR_EXPORTS Object {
+				void setPose(const cv::Mat & rotationVector, const cv::Mat & translation);
+				void getPose(cv::Mat & rotationVector, cv::Mat & translation) const;
+
+				vector<cv::Point3f> points;
+				cv::Vec3d rotationVector;
+				cv::Vec3d translation;
+				bool fixed = false;
+			};
+
+			struct Settings {
+				int maxIterations = 100;
+				Loss loss = Loss::Huber;
+				double lossScale = 2.0; // [px]
+				double initialLambda = 1e-3;
+				double relativeCostTolerance = 1e-10; // stop when the cost improves by less than this fraction
+				double parameterTolerance = 1e-12; // stop when the step is smaller than this
+				bool multiThreaded = true;
+			};
+
+			struct Result {
+				bool success = false;
+				int iterations = 0;
+				size_t observationCount = 0;
+				size_t parameterCount = 0;
+				double initialCost = 0.0; // robust cost (the quantity which is minimised)
+				double cost = 0.0;
+				double initialReprojectionError = 0.0; // RMS [px], reported only (this can rise whilst outliers are down-weighted)
+				double reprojectionError = 0.0; // RMS [px]
+			};
+
+			size_t addView(const View &);
+			size_t addPoint(const Point &);
+			size_t addObject(const Object &);
+			void addObservation(size_t viewIndex, size_t pointIndex, const cv::Point2f & imagePoint);
+			void addObjectObservation(size_t viewIndex, size_t objectIndex, size_t objectPointIndex, const cv::Point2f & imagePoint);
+
+			///Throws if the problem is malformed. On success the views, points and objects hold the solution.
+			Result solve(const Settings &);
+
+			///RMS reprojection error [px] of the current views, points and objects
+			double getReprojectionError() const;
+
+			const vector<View> & getViews() const;
+			const vector<Point> & getPoints() const;
+			const vector<Object> & getObjects() const;
+			View & getView(size_t);
+			Point & getPoint(size_t);
+			Object & getObject(size_t);
+		protected:
+			struct Observation {
+				uint32_t view;
+				uint32_t structure; // index into points, or into objects if isObject
+				uint32_t objectPoint;
+				bool isObject;
+				cv::Point2f imagePoint;
+			};
+
+			vector<View> views;
+			vector<Point> points;
+			vector<Object> objects;
+			vector<Observation> observations;
+		};
+	}
+}
@@ -1,6 +1,7 @@
 #include "pch_RulrCore.h"
 
 #include "CaptureSet.h"
+#include "ofxRulr/Exception.h"
 #include "ofxCvGui.h"
 
 using namespace ofxCvGui;
@@ -13,21 +14,10 @@ namespace ofxRulr {
 			this->selected.addListener(this, &BaseCapture::callbackSelectedChanged);
 
 			this->onSerialize += [this](Json::Value & json) {
-				json << this->selected;
-				json << this->color;
-				json["timestamp"] << chrono::system_clock::to_time_t(this->timestamp.get());
+				this->serializeBase(json);
 			};
 			this->onDeserialize += [this](const Json::Value & json) {
-				json >> this->selected;
-				json >> this->color;
-
-				{
-					time_t time;
-					json["timestamp"] >> time;
-					this->timestamp = chrono::system_clock::from_time_t(time);
-				}
-
-				this->rebuildDateStrings();
+				this->deserializeBase(json);
 			};
 
 			{
@@ -135,20 +125,85 @@ namespace ofxRulr {
 			}
 		}
 
+		//----------
+		void AbstractCaptureSet::BaseCapture::materialize() {
+			if (!this->deferredStore) {
+				return;
+			}
+
+			//we clear the deferred state first, since deserializing sets 'selected' which calls back into here
+			auto store = move(this->deferredStore);
+			auto json = move(this->deferredJson);
+			this->deferredStore.reset();
+			this->deferredJson = Json::Value();
+
+			//keep any changes made to the base properties whilst deferred (e.g. selection)
+			this->serializeBase(json);
+
+			CaptureStore::Scope scope(*store);
+			this->deserialize(json);
+		}
+
+		//----------
+		bool AbstractCaptureSet::BaseCapture::isMaterialized() const {
+			return !this->deferredStore;
+		}
+
 		//----------
 		ofxCvGui::ElementPtr AbstractCaptureSet::BaseCapture::getDataDisplay() {
 			auto element = make_shared<ofxCvGui::Element>();
 			element->onDraw += [this](ofxCvGui::DrawArguments & args) {
-				ofxCvGui::Utils::drawText(this->getDisplayString(), args.localBounds.x, args.localBounds.y, false);
+				ofxCvGui::Utils::drawText(this->isMaterialized() ? this->getDisplayString() : "Not loaded"
+					, args.localBounds.x, args.localBounds.y, false);
 			};
 			return element;
 		}
 
 		//----------
 		void AbstractCaptureSet::BaseCapture::callbackSelectedChanged(bool & value) {
+			if (value) {
+				this->materialize();
+			}
 			this->onSelectionChanged.notifyListeners(value);
 		}
 
+		//----------
+		void AbstractCaptureSet::BaseCapture::serializeBase(Json::Value & json) {
+			json << this->selected;
+			json << this->color;
+			json["timestamp"] << chrono::system_clock::to_time_t(this->timestamp.get());
+		}
+
+		//----------
+		void AbstractCaptureSet::BaseCapture::deserializeBase(const Json::Value & json) {
+			json >> this->selected;
+			json >> this->color;
+
+			{
+				time_t time;
+				json["timestamp"] >> time;
+				this->timestamp = chrono::system_clock::from_time_t(time);
+			}
+
+			this->rebuildDateStrings();
+		}
+
+		//----------
+		void AbstractCaptureSet::BaseCapture::serializeDeferred(Json::Value & json, CaptureStore::Writer & writer) {
+			//copy the arrays across from the old store without decoding them
+			//(our own json and store are left as they are, since a store is never overwritten)
+			json = this->deferredJson;
+			this->serializeBase(json);
+			writer.copyReferences(json, *this->deferredStore);
+		}
+
+		//----------
+		void AbstractCaptureSet::BaseCapture::deserializeDeferred(const Json::Value & json, shared_ptr<CaptureStore::Reader> store) {
+			this->deserializeBase(json);
+			this->deferredJson = json;
+			this->deferredStore = store;
+		}
+
 		//----------
 		void AbstractCaptureSet::BaseCapture::rebuildDateStrings() {
 			time_t time = chrono::system_clock::to_time_t(this->timestamp.get());
@@ -281,6 +336,7 @@ namespace ofxRulr {
 			widgetsPanel->addLiveValue<int>("Count", [this]() {
 				return this->captures.size();
 			});
+			widgetsPanel->addToggle(this->useCaptureStore);
 
 			widgetsPanel->addButton("Clear", [this]() {
 				this->clear();
@@ -336,26 +392,70 @@ namespace ofxRulr {
 
 		//----------
 		void AbstractCaptureSet::serialize(Json::Value & json) {
+			json << this->useCaptureStore;
+
+			//the store is only possible when we're saving to a file
 			auto & jsonCaptures = json["captures"];
-			int index = 0;
-			for (auto capture : this->captures) {
-				capture->serialize(jsonCaptures[index++]);
+			if (!this->useCaptureStore.get() || Serializable::getCurrentFilename().empty()) {
+				int index = 0;
+				for (auto capture : this->captures) {
+					capture->materialize();
+					capture->serialize(jsonCaptures[index++]);
+				}
+				return;
 			}
+
+			CaptureStore::Writer writer;
+			{
+				CaptureStore::Scope scope(writer);
+				int index = 0;
+				for (auto capture : this->captures) {
+					auto & jsonCapture = jsonCaptures[index++];
+					if (capture->isMaterialized()) {
+						capture->serialize(jsonCapture);
+					}
+					else {
+						capture->serializeDeferred(jsonCapture, writer);
+					}
+				}
+			}
+
+			//the store is written with the document (and only if its content has changed)
+			vector<uint8_t> data;
+			writer.encode(data);
+			json["captureStore"] = Serializable::addSidecar("captures", move(data));
 		}
 
 		//----------
 		void AbstractCaptureSet::deserialize(const Json::Value & json) {
 			this->captures.clear();
+			json >> this->useCaptureStore;
+
+			//with a store, unselected captures aren't materialized until they're needed
+			shared_ptr<CaptureStore::Reader> store;
+			if (json.isMember("captureStore")) {
+				store = make_shared<CaptureStore::Reader>(Serializable::getSidecarPath(json["captureStore"].asString()));
+			}
+
 			auto & jsonCaptures = json["captures"];
 			for (const auto & jsonCapture : jsonCaptures) {
 				auto capture = this->makeEmpty();
-				capture->deserialize(jsonCapture);
+				if (store) {
+					capture->deserializeDeferred(jsonCapture, store);
+					if (capture->isSelected()) {
+						capture->materialize();
+					}
+				}
+				else {
+					capture->deserialize(jsonCapture);
+				}
 				this->add(capture); //ensure event listeners are attached
 			}
 		}
 
 		//----------
 		vector<shared_ptr<ofxRulr::Utils::AbstractCaptureSet::BaseCapture>> AbstractCaptureSet::getSelectionUntyped() const {
+			//selected captures are materialized when selected, so we don't need to do that here
 			auto selection = this->captures;
 			for (auto it = selection.begin(); it != selection.end(); ) {
 				if (!(*it)->isSelected()) {
@@ -370,6 +470,9 @@ namespace ofxRulr {
 
 		//----------
 		vector<shared_ptr<ofxRulr::Utils::AbstractCaptureSet::BaseCapture>> AbstractCaptureSet::getAllCapturesUntyped() const {
+			for (auto capture : this->captures) {
+				capture->materialize();
+			}
 			return this->captures;
 		}
 	}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Serializable.h"
+#include "CaptureStore.h"
 #include "ofxCvGui/Element.h"
 #include "ofxCvGui/InspectController.h"
 
@@ -20,15 +21,28 @@ namespace ofxRulr {
 				bool isSelected() const;
 				void setSelected(bool);
 
+				///Captures loaded from a capture store are held as json until they are selected or materialized
+				void materialize();
+				bool isMaterialized() const;
+
 				ofParameter<ofColor> color{ "Color", ofColor() };
 
 				ofxLiquidEvent<void> onDeletePressed;
 				ofxLiquidEvent<bool> onSelectionChanged;
 			protected:
+				friend class AbstractCaptureSet;
+
 				ofParameter<bool> selected{ "Selected", true };
 				virtual ofxCvGui::ElementPtr getDataDisplay();
 				void callbackSelectedChanged(bool &);
 
+				void serializeBase(Json::Value &);
+				void deserializeBase(const Json::Value &);
+				void serializeDeferred(Json::Value &, CaptureStore::Writer &);
+				void deserializeDeferred(const Json::Value &, shared_ptr<CaptureStore::Reader>);
+				Json::Value deferredJson;
+				shared_ptr<CaptureStore::Reader> deferredStore;
+
 				void rebuildDateStrings();
 				ofParameter<chrono::system_clock::time_point> timestamp{ "Timestamp", chrono::system_clock::now() };
 				string timeString;
@@ -61,6 +75,9 @@ namespace ofxRulr {
 			virtual bool getIsMultipleSelectionAllowed() = 0;
 			vector<shared_ptr<BaseCapture>> captures;
 
+			///Save capture data to a binary sidecar file which is loaded lazily (see CaptureStore)
+			ofParameter<bool> useCaptureStore{ "Binary capture store", false };
+
 			shared_ptr<ofxCvGui::Panels::Widgets> listView;
 
 			bool viewDirty = true;
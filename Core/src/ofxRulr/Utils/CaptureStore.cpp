@@ -0,0 +1,291 @@
+#include "pch_RulrCore.h"
+#include "CaptureStore.h"
+#include "Serializable.h"
+#include "ofxRulr/Exception.h"
+
+#include "Poco/File.h"
+#include "Poco/SharedMemory.h"
+
+#include <fstream>
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			const char magic[8] = { 'R', 'U', 'L', 'R', 'C', 'A', 'P', 'S' };
+			const uint32_t version = 1;
+			const size_t alignment = 16;
+
+			const char * referenceKey = "captureStoreColumn";
+
+			thread_local CaptureStore::Writer * currentWriter = nullptr;
+			thread_local const CaptureStore::Reader * currentReader = nullptr;
+
+			//----------
+			size_t align(size_t offset) {
+				return (offset + alignment - 1) / alignment * alignment;
+			}
+
+			//----------
+			template<typename VectorType, int Components>
+			void serializeArray(Json::Value & json, const string & name, const vector<VectorType> & values) {
+				static_assert(sizeof(VectorType) == sizeof(float) * Components, "Vector type must be tightly packed floats");
+				if (currentWriter) {
+					currentWriter->add(json[name], name, values.empty() ? nullptr : &values[0].x, values.size(), Components);
+				}
+				else {
+					json[name] << values;
+				}
+			}
+
+			//----------
+			template<typename VectorType, int Components>
+			void deserializeArray(const Json::Value & json, const string & name, vector<VectorType> & values) {
+				const auto & jsonValue = json[name];
+				if (!CaptureStore::isReference(jsonValue)) {
+					jsonValue >> values;
+					return;
+				}
+
+				if (!currentReader) {
+					throw(ofxRulr::Exception("Capture data for [" + name + "] is in a capture store which isn't open"));
+				}
+				size_t count;
+				auto data = currentReader->get(jsonValue, Components, count);
+				values.resize(count);
+				if (count > 0) {
+					memcpy(&values[0].x, data, count * sizeof(VectorType));
+				}
+			}
+		}
+
+#pragma mark Writer
+		//----------
+		void CaptureStore::Writer::add(Json::Value & json, const string & columnName, const float * data, size_t count, int components) {
+			auto & column = this->columns[columnName];
+			if (column.components == 0) {
+				column.components = components;
+			}
+			else if (column.components != components) {
+				throw(ofxRulr::Exception("Capture store column [" + columnName + "] has mixed component counts"));
+			}
+
+			const auto first = column.data.size() / components;
+			column.data.insert(column.data.end(), data, data + count * components);
+
+			json = Json::Value(Json::objectValue);
+			json[referenceKey] = columnName;
+			json["first"] = (Json::UInt64) first;
+			json["count"] = (Json::UInt64) count;
+		}
+
+		//----------
+		void CaptureStore::Writer::copyReferences(Json::Value & json, const Reader & reader) {
+			if (isReference(json)) {
+				const auto columnName = json[referenceKey].asString();
+				const auto components = reader.getComponents(columnName);
+				size_t count;
+				auto data = reader.get(json, components, count);
+				this->add(json, columnName, data, count, components);
+				return;
+			}
+
+			if (json.isObject() || json.isArray()) {
+				for (auto & child : json) {
+					this->copyReferences(child, reader);
+				}
+			}
+		}
+
+		//----------
+		void CaptureStore::Writer::encode(vector<uint8_t> & data) const {
+			//header describes where each column sits in the file
+			Json::Value header;
+			header["version"] = version;
+			size_t headerSize;
+			{
+				//offsets are relative to the start of the data (which follows the header)
+				size_t dataOffset = 0;
+				for (const auto & it : this->columns) {
+					auto & jsonColumn = header["columns"][it.first];
+					jsonColumn["components"] = it.second.components;
+					jsonColumn["count"] = (Json::UInt64) (it.second.data.size() / it.second.components);
+					jsonColumn["offset"] = (Json::UInt64) dataOffset;
+					dataOffset = align(dataOffset + it.second.data.size() * sizeof(float));
+				}
+			}
+			Json::FastWriter writer;
+			auto headerString = writer.write(header);
+			headerSize = headerString.size();
+			const auto dataStart = align(sizeof(magic) + sizeof(uint32_t) * 2 + headerSize);
+
+			auto write = [&data](const void * bytes, size_t size) {
+				data.insert(data.end(), (const uint8_t *) bytes, (const uint8_t *) bytes + size);
+			};
+
+			data.clear();
+			const char padding[alignment] = { 0 };
+			auto headerSize32 = (uint32_t) headerSize;
+			write(magic, sizeof(magic));
+			write(&version, sizeof(version));
+			write(&headerSize32, sizeof(headerSize32));
+			write(headerString.data(), headerString.size());
+			write(padding, dataStart - (sizeof(magic) + sizeof(uint32_t) * 2 + headerSize));
+
+			size_t written = 0;
+			for (const auto & it : this->columns) {
+				const auto & columnData = it.second.data;
+				if (!columnData.empty()) {
+					write(columnData.data(), columnData.size() * sizeof(float));
+				}
+				written += columnData.size() * sizeof(float);
+				write(padding, align(written) - written);
+				written = align(written);
+			}
+		}
+
+		//----------
+		void CaptureStore::Writer::save(const string & filename) const {
+			vector<uint8_t> data;
+			this->encode(data);
+
+			ofstream file(filename, ios::binary | ios::out | ios::trunc);
+			if (!file.is_open()) {
+				throw(ofxRulr::Exception("Couldn't open capture store [" + filename + "] for writing"));
+			}
+			file.write((const char *) data.data(), data.size());
+			if (!file.good()) {
+				throw(ofxRulr::Exception("Failed to write capture store [" + filename + "]"));
+			}
+		}
+
+#pragma mark Reader
+		//----------
+		CaptureStore::Reader::Reader(const string & filename) {
+			try {
+				this->memory = make_unique<Poco::SharedMemory>(Poco::File(filename), Poco::SharedMemory::AM_READ);
+			}
+			catch (const Poco::Exception & e) {
+				throw(ofxRulr::Exception("Couldn't map capture store [" + filename + "] : " + e.displayText()));
+			}
+
+			const auto begin = this->memory->begin();
+			const auto size = (size_t) (this->memory->end() - begin);
+			const auto preambleSize = sizeof(magic) + sizeof(uint32_t) * 2;
+			if (size < preambleSize || memcmp(begin, magic, sizeof(magic)) != 0) {
+				throw(ofxRulr::Exception("[" + filename + "] is not a capture store"));
+			}
+
+			uint32_t fileVersion, headerSize;
+			memcpy(&fileVersion, begin + sizeof(magic), sizeof(fileVersion));
+			memcpy(&headerSize, begin + sizeof(magic) + sizeof(fileVersion), sizeof(headerSize));
+			if (fileVersion != version) {
+				throw(ofxRulr::Exception("Capture store [" + filename + "] has unsupported version " + ofToString(fileVersion)));
+			}
+			if (preambleSize + headerSize > size) {
+				throw(ofxRulr::Exception("Capture store [" + filename + "] is truncated"));
+			}
+
+			Json::Value header;
+			Json::Reader jsonReader;
+			if (!jsonReader.parse(begin + preambleSize, begin + preambleSize + headerSize, header)) {
+				throw(ofxRulr::Exception("Capture store [" + filename + "] has a malformed header"));
+			}
+
+			const auto dataStart = align(preambleSize + headerSize);
+			const auto & jsonColumns = header["columns"];
+			for (const auto & name : jsonColumns.getMemberNames()) {
+				const auto & jsonColumn = jsonColumns[name];
+				Column column;
+				column.components = jsonColumn["components"].asInt();
+				column.count = (size_t) jsonColumn["count"].asUInt64();
+				const auto offset = dataStart + (size_t) jsonColumn["offset"].asUInt64();
+				if (column.components <= 0 || offset + column.count * column.components * sizeof(float) > size) {
+					throw(ofxRulr::Exception("Capture store [" + filename + "] column [" + name + "] is out of bounds"));
+				}
+				column.data = (const float *) (begin + offset);
+				this->columns.emplace(name, column);
+			}
+		}
+
+		//----------
+		CaptureStore::Reader::~Reader() {
+			//defined here so that unique_ptr can see the complete SharedMemory type
+		}
+
+		//----------
+		const float * CaptureStore::Reader::get(const Json::Value & reference, int components, size_t & count) const {
+			const auto columnName = reference[referenceKey].asString();
+			auto findColumn = this->columns.find(columnName);
+			if (findColumn == this->columns.end()) {
+				throw(ofxRulr::Exception("Capture store has no column [" + columnName + "]"));
+			}
+			const auto & column = findColumn->second;
+			if (components != 0 && column.components != components) {
+				throw(ofxRulr::Exception("Capture store column [" + columnName + "] has " + ofToString(column.components) + " components, expected " + ofToString(components)));
+			}
+
+			const auto first = (size_t) reference["first"].asUInt64();
+			count = (size_t) reference["count"].asUInt64();
+			if (first + count > column.count) {
+				throw(ofxRulr::Exception("Capture store reference into [" + columnName + "] is out of bounds"));
+			}
+			return column.data + first * column.components;
+		}
+
+		//----------
+		int CaptureStore::Reader::getComponents(const string & columnName) const {
+			auto findColumn = this->columns.find(columnName);
+			if (findColumn == this->columns.end()) {
+				throw(ofxRulr::Exception("Capture store has no column [" + columnName + "]"));
+			}
+			return findColumn->second.components;
+		}
+
+#pragma mark Scope
+		//----------
+		CaptureStore::Scope::Scope(Writer & writer)
+		: previousWriter(currentWriter)
+		, previousReader(currentReader) {
+			currentWriter = &writer;
+		}
+
+		//----------
+		CaptureStore::Scope::Scope(const Reader & reader)
+		: previousWriter(currentWriter)
+		, previousReader(currentReader) {
+			currentReader = &reader;
+		}
+
+		//----------
+		CaptureStore::Scope::~Scope() {
+			currentWriter = this->previousWriter;
+			currentReader = this->previousReader;
+		}
+
+#pragma mark CaptureStore
+		//----------
+		bool CaptureStore::isReference(const Json::Value & json) {
+			return json.isObject() && json.isMember(referenceKey);
+		}
+
+		//----------
+		void CaptureStore::serialize(Json::Value & json, const string & name, const vector<ofVec2f> & values) {
+			serializeArray<ofVec2f, 2>(json, name, values);
+		}
+
+		//----------
+		void CaptureStore::serialize(Json::Value & json, const string & name, const vector<ofVec3f> & values) {
+			serializeArray<ofVec3f, 3>(json, name, values);
+		}
+
+		//----------
+		void CaptureStore::deserialize(const Json::Value & json, const string & name, vector<ofVec2f> & values) {
+			deserializeArray<ofVec2f, 2>(json, name, values);
+		}
+
+		//----------
+		void CaptureStore::deserialize(const Json::Value & json, const string & name, vector<ofVec3f> & values) {
+			deserializeArray<ofVec3f, 3>(json, name, values);
+		}
+	}
+}
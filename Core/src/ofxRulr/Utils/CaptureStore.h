@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ofxRulr/Utils/Constants.h"
+#include "ofVec2f.h"
+#include "ofVec3f.h"
+
+#include <json/json.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Poco {
+	class SharedMemory;
+}
+
+namespace ofxRulr {
+	namespace Utils {
+		///Binary sidecar file for the bulk data of captures (e.g. image points, object points).
+		///Arrays are stored as float32 columns (one column per field name, shared by all the captures in a set).
+		///The capture's JSON keeps a small reference { captureStoreColumn, first, count } in place of the array.
+		///The file is memory mapped when read, so the arrays of captures which are never materialised are never touched.
+		///
+		///File layout (little endian) :
+		/// "RULRCAPS", uint32 version, uint32 header size, header JSON, padding, then the columns (each 16 byte aligned)
+		class RULR_EXPORTS CaptureStore {
+		public:
+			class Reader;
+
+			class RULR_EXPORTS Writer {
+			public:
+				///Appends the data to the named column and writes a reference to it into json
+				void add(Json::Value & json, const std::string & column, const float * data, size_t count, int components);
+
+				///Copies the data of any references in json (searched recursively) from reader into this store, and updates the references
+				void copyReferences(Json::Value & json, const Reader & reader);
+
+				///Encodes the store in the format described above (e.g. to be written as a sidecar by Serializable)
+				void encode(std::vector<uint8_t> &) const;
+				void save(const std::string & filename) const;
+			protected:
+				struct Column {
+					int components = 0;
+					std::vector<float> data;
+				};
+				std::map<std::string, Column> columns;
+			};
+
+			class RULR_EXPORTS Reader {
+			public:
+				Reader(const std::string & filename); ///< Throws if the file can't be mapped or is malformed
+				~Reader();
+
+				///Returns a pointer into the mapped file for a reference written by Writer::add
+				const float * get(const Json::Value & reference, int components, size_t & count) const;
+				int getComponents(const std::string & column) const;
+			protected:
+				struct Column {
+					int components;
+					const float * data;
+					size_t count;
+				};
+				std::unique_ptr<Poco::SharedMemory> memory;
+				std::map<std::string, Column> columns;
+			};
+
+			///While a Scope is alive, serialize() / deserialize() on this thread use its writer / reader
+			class RULR_EXPORTS Scope {
+			public:
+				Scope(Writer &);
+				Scope(const Reader &);
+				~Scope();
+			protected:
+				Writer * previousWriter;
+				const Reader * previousReader;
+			};
+
+			static bool isReference(const Json::Value &);
+
+			///Writes json[name] as a reference into the current writer, or as a plain JSON array if there isn't one
+			static void serialize(Json::Value & json, const std::string & name, const std::vector<ofVec2f> &);
+			static void serialize(Json::Value & json, const std::string & name, const std::vector<ofVec3f> &);
+
+			///Reads json[name] from the current reader if it is a reference, or as a plain JSON array otherwise
+			static void deserialize(const Json::Value & json, const std::string & name, std::vector<ofVec2f> &);
+			static void deserialize(const Json::Value & json, const std::string & name, std::vector<ofVec3f> &);
+		};
+	}
+}
@@ -0,0 +1,116 @@
+#include "pch_RulrCore.h"
+#include "LatencyHistogram.h"
+
+using namespace ofxCvGui;
+
+namespace ofxRulr {
+	namespace Utils {
+		//----------
+		LatencyHistogram::LatencyHistogram(chrono::microseconds range, size_t binCount)
+		: range(range)
+		, bins(binCount > 0 ? binCount : 1, 0) {
+
+		}
+
+		//----------
+		void LatencyHistogram::add(const chrono::high_resolution_clock::duration & duration) {
+			auto micros = chrono::duration_cast<chrono::microseconds>(duration);
+			if (micros.count() < 0) {
+				micros = chrono::microseconds(0);
+			}
+			auto binIndex = (size_t)(micros.count() * this->bins.size() / this->range.count());
+			binIndex = min(binIndex, this->bins.size() - 1);
+
+			lock_guard<mutex> lock(this->binsMutex);
+			this->bins[binIndex]++;
+			this->count++;
+			this->total += micros;
+		}
+
+		//----------
+		void LatencyHistogram::clear() {
+			lock_guard<mutex> lock(this->binsMutex);
+			fill(this->bins.begin(), this->bins.end(), 0);
+			this->count = 0;
+			this->total = chrono::microseconds(0);
+		}
+
+		//----------
+		vector<size_t> LatencyHistogram::getBins() const {
+			lock_guard<mutex> lock(this->binsMutex);
+			return this->bins;
+		}
+
+		//----------
+		size_t LatencyHistogram::getCount() const {
+			lock_guard<mutex> lock(this->binsMutex);
+			return this->count;
+		}
+
+		//----------
+		chrono::microseconds LatencyHistogram::getRange() const {
+			return this->range;
+		}
+
+		//----------
+		chrono::microseconds LatencyHistogram::getPercentile(float percentile) const {
+			lock_guard<mutex> lock(this->binsMutex);
+			if (this->count == 0) {
+				return chrono::microseconds(0);
+			}
+
+			auto target = (size_t) ceil(percentile * (float) this->count);
+			size_t accumulated = 0;
+			for (size_t i = 0; i < this->bins.size(); i++) {
+				accumulated += this->bins[i];
+				if (accumulated >= target) {
+					//report the upper edge of the bin
+					return this->range * (i + 1) / this->bins.size();
+				}
+			}
+			return this->range;
+		}
+
+		//----------
+		chrono::microseconds LatencyHistogram::getMean() const {
+			lock_guard<mutex> lock(this->binsMutex);
+			if (this->count == 0) {
+				return chrono::microseconds(0);
+			}
+			return this->total / this->count;
+		}
+
+		//----------
+		ofxCvGui::ElementPtr LatencyHistogram::makeView() const {
+			auto element = make_shared<Element>();
+			element->onDraw += [this](DrawArguments & args) {
+				auto bins = this->getBins();
+				auto maxBin = *max_element(bins.begin(), bins.end());
+
+				ofPushStyle();
+				{
+					ofSetColor(40);
+					ofDrawRectangle(args.localBounds);
+
+					if (maxBin > 0) {
+						ofSetColor(200);
+						auto binWidth = args.localBounds.width / (float) bins.size();
+						for (size_t i = 0; i < bins.size(); i++) {
+							auto height = (args.localBounds.height - 20) * (float) bins[i] / (float) maxBin;
+							ofDrawRectangle(i * binWidth, args.localBounds.height - height, binWidth - 1, height);
+						}
+					}
+				}
+				ofPopStyle();
+
+				stringstream message;
+				message << "Mean " << ofToString((float) this->getMean().count() / 1000.0f, 1) << "ms"
+					<< ", 99% " << ofToString((float) this->getPercentile(0.99f).count() / 1000.0f, 1) << "ms"
+					<< " (range " << (this->range.count() / 1000) << "ms)";
+				ofDrawBitmapString(message.str(), 5, 14);
+			};
+			element->setHeight(100.0f);
+			return element;
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ofxRulr/Utils/Constants.h"
+#include "ofxCvGui/Element.h"
+
+#include <mutex>
+#include <chrono>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Thread safe histogram of durations (e.g. frame latency), with an inspector view.
+		///Values beyond the range are counted in the last bin.
+		class RULR_EXPORTS LatencyHistogram {
+		public:
+			LatencyHistogram(chrono::microseconds range = chrono::milliseconds(100), size_t binCount = 50);
+
+			void add(const chrono::high_resolution_clock::duration &);
+			void clear();
+
+			vector<size_t> getBins() const;
+			size_t getCount() const;
+			chrono::microseconds getRange() const;
+
+			///Approximate (to the bin width), e.g. getPercentile(0.99f)
+			chrono::microseconds getPercentile(float) const;
+			chrono::microseconds getMean() const;
+
+			///Draws the histogram with the mean and 99th percentile
+			ofxCvGui::ElementPtr makeView() const;
+		protected:
+			const chrono::microseconds range;
+			vector<size_t> bins;
+			size_t count = 0;
+			chrono::microseconds total{ 0 };
+			mutable mutex binsMutex;
+		};
+	}
+}
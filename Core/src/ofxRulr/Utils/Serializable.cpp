@@ -1,12 +1,158 @@
 #include "pch_RulrCore.h"
 #include "Serializable.h"
+#include "BinaryJson.h"
 
 #include "../Exception.h"
 
+#include <fstream>
+#include <iomanip>
+
 using namespace std;
 
 namespace ofxRulr {
 	namespace Utils {
+		namespace {
+			//the document which is being saved or loaded on this thread
+			struct DocumentContext {
+				string filename;
+				Serializable::Document * document = nullptr; // whilst saving
+				vector<const Serializable *> objects; // being serialized or deserialized, innermost last
+				set<string> sidecarFilenames; // given out by makeSidecarFilename (or added by addSidecar) in this document
+				set<string> readSidecars; // resolved by getSidecarPath whilst loading
+			};
+			thread_local DocumentContext * currentDocument = nullptr;
+
+			struct ScopedDocument {
+				ScopedDocument(const string & filename)
+				: previous(currentDocument) {
+					this->context.filename = filename;
+					currentDocument = &this->context;
+				}
+				~ScopedDocument() {
+					currentDocument = this->previous;
+				}
+				DocumentContext context;
+				DocumentContext * previous;
+			};
+
+			struct ScopedObject {
+				ScopedObject(const Serializable * object)
+				: document(currentDocument) {
+					if (this->document) {
+						this->document->objects.push_back(object);
+					}
+				}
+				~ScopedObject() {
+					if (this->document) {
+						this->document->objects.pop_back();
+					}
+				}
+				DocumentContext * document;
+			};
+
+			//which object each sidecar path belongs to, so that two objects never write to the same file
+			struct SidecarOwner {
+				const Serializable * object;
+				string extension;
+			};
+			mutex sidecarOwnersMutex;
+			map<string, SidecarOwner> sidecarOwners;
+
+			//----------
+			void claimSidecar(const string & path, const Serializable * object) {
+				const auto extension = ofFilePath::getFileExt(path);
+
+				lock_guard<mutex> lock(sidecarOwnersMutex);
+				auto findOwner = sidecarOwners.find(path);
+				if (findOwner != sidecarOwners.end() && findOwner->second.object != object) {
+					throw(Exception("Sidecar [" + path + "] already belongs to [" + findOwner->second.object->getName() + "]. Objects which save sidecars need unique names."));
+				}
+
+				//an object has one sidecar of each type, so any it had before (e.g. under its old name) are released
+				for (auto it = sidecarOwners.begin(); it != sidecarOwners.end(); ) {
+					if (it->second.object == object && it->second.extension == extension && it->first != path) {
+						it = sidecarOwners.erase(it);
+					}
+					else {
+						it++;
+					}
+				}
+				sidecarOwners[path] = SidecarOwner{ object, extension };
+			}
+
+			//what we last wrote to (or read from) each file, so that unchanged documents aren't written again
+			mutex documentsMutex;
+			map<string, uint64_t> documentHashes;
+
+			//the sidecars (named by addSidecar) which each document refers to, so that ones it stops using can be removed
+			map<string, set<string>> documentSidecars;
+			set<string> staleSidecars; // no longer used, but not yet removed (e.g. still memory mapped on Windows)
+
+			//----------
+			uint64_t hashBytes(const uint8_t * data, size_t size) {
+				//FNV-1a
+				uint64_t hash = 14695981039346656037ULL;
+				for (size_t i = 0; i < size; i++) {
+					hash ^= data[i];
+					hash *= 1099511628211ULL;
+				}
+				return hash;
+			}
+
+			//----------
+			string toHex(uint64_t value) {
+				stringstream stream;
+				stream << hex << setw(16) << setfill('0') << value;
+				return stream.str();
+			}
+
+			//----------
+			bool isAddedSidecar(const string & documentPath, const string & sidecarPath) {
+				//i.e. named by addSidecar : Document[.Object].0123456789abcdef.extension
+				const auto prefix = ofFilePath::getBaseName(documentPath) + ".";
+				const auto name = ofFilePath::getFileName(sidecarPath);
+				if (name.compare(0, prefix.size(), prefix) != 0) {
+					return false;
+				}
+				const auto hashEnd = name.rfind('.');
+				if (hashEnd == string::npos || hashEnd < prefix.size() + 16) {
+					return false;
+				}
+				const auto hashStart = hashEnd - 16;
+				return name[hashStart - 1] == '.'
+					&& all_of(name.begin() + hashStart, name.begin() + hashEnd, [](char c) { return isxdigit((unsigned char) c) != 0; });
+			}
+
+			//----------
+			void replaceDocumentSidecars(const string & documentPath, const set<string> & sidecarPaths) {
+				lock_guard<mutex> lock(documentsMutex);
+
+				auto & previousSidecars = documentSidecars[documentPath];
+				for (const auto & sidecar : previousSidecars) {
+					if (sidecarPaths.find(sidecar) == sidecarPaths.end()) {
+						staleSidecars.insert(sidecar);
+					}
+				}
+				previousSidecars.clear();
+				for (const auto & sidecar : sidecarPaths) {
+					if (isAddedSidecar(documentPath, sidecar)) {
+						previousSidecars.insert(sidecar);
+						staleSidecars.erase(sidecar);
+					}
+				}
+
+				//anything which couldn't be removed before is tried again
+				for (auto it = staleSidecars.begin(); it != staleSidecars.end(); ) {
+					if (!ofFile::doesFileExist(*it, false) || ofFile::removeFile(*it, false)) {
+						it = staleSidecars.erase(it);
+					}
+					else {
+						it++;
+					}
+				}
+			}
+		}
+
 		//----------
 		void Serializable::serialize(Json::Value & json, const ofParameter<string> & parameter) {
 			json[parameter.getName()] = parameter.get();
@@ -179,6 +325,19 @@ namespace ofxRulr {
 			}
 		}
 
+		//----------
+		Serializable::~Serializable() {
+			lock_guard<mutex> lock(sidecarOwnersMutex);
+			for (auto it = sidecarOwners.begin(); it != sidecarOwners.end(); ) {
+				if (it->second.object == this) {
+					it = sidecarOwners.erase(it);
+				}
+				else {
+					it++;
+				}
+			}
+		}
+
 		//----------
 		string Serializable::getName() const {
 			return this->getTypeName();
@@ -186,16 +345,37 @@ namespace ofxRulr {
 
 		//----------
 		void Serializable::serialize(Json::Value & json) {
+			ScopedObject scopedObject(this);
 			this->onSerialize.notifyListeners(json);
 		}
 
 		//----------
 		void Serializable::deserialize(const Json::Value & json) {
+			ScopedObject scopedObject(this);
+
 			this->onDeserialize.notifyListeners(json);
 		}
 
 		//----------
-		void Serializable::save(string filename) {
+		void Serializable::serialize(Json::Value & json, Sidecars & sidecars) {
+			sidecars.clear();
+			if (!currentDocument || !currentDocument->document) {
+				this->serialize(json);
+				return;
+			}
+
+			//sidecar names are unique within a document, so the ones we add are the new names
+			const auto previousSidecars = currentDocument->document->sidecars;
+			this->serialize(json);
+			for (const auto & sidecar : currentDocument->document->sidecars) {
+				if (previousSidecars.find(sidecar.first) == previousSidecars.end()) {
+					sidecars.insert(sidecar);
+				}
+			}
+		}
+
+		//----------
+		void Serializable::save(string filename, Encoding encoding) {
 			if (filename == "") {
 				auto result = ofSystemSaveDialog(this->getDefaultFilename() + ".json", "Save " + this->getTypeName());
 				if (result.bSuccess) {
@@ -204,12 +384,9 @@ namespace ofxRulr {
 			}
 
 			if (filename != "") {
-				Json::Value json;
-				this->serialize(json);
-				Json::StyledWriter writer;
-				ofFile output;
-				output.open(filename, ofFile::WriteOnly, false);
-				output << writer.write(json);
+				Document document;
+				this->serializeDocument(document, filename);
+				writeDocument(document, filename, encoding);
 			}
 		}
 		
@@ -224,25 +401,228 @@ namespace ofxRulr {
 
 			if (filename != "") {
 				try {
-					ofFile input;
-					input.open(ofToDataPath(filename, true), ofFile::ReadOnly, false);
-					string jsonRaw = input.readToBuffer().getText();
-
-					Json::Reader reader;
+					ScopedDocument scopedDocument(ofToDataPath(filename, true));
 					Json::Value json;
-					reader.parse(jsonRaw, json);
+					readDocument(json, filename);
 					this->deserialize(json);
+
+					//so that sidecars the document stops using are removed when it's next written
+					replaceDocumentSidecars(scopedDocument.context.filename, scopedDocument.context.readSidecars);
 				} 
 				RULR_CATCH_ALL_TO_ALERT
 			}
 		}
 
+		//----------
+		void Serializable::serializeDocument(Document & document, const string & filename) {
+			ScopedDocument scopedDocument(ofToDataPath(filename, true));
+			scopedDocument.context.document = &document;
+			this->serialize(document.json);
+		}
+
+		//----------
+		bool Serializable::writeDocument(const Document & document, const string & filename, Encoding encoding) {
+			const auto & json = document.json;
+			const auto path = ofToDataPath(filename, true);
+
+			vector<uint8_t> data;
+			switch (encoding) {
+			case Encoding::Binary:
+				BinaryJson::encode(json, data);
+				break;
+			case Encoding::Text:
+			default:
+			{
+				Json::StyledWriter writer;
+				const auto text = writer.write(json);
+				data.assign(text.begin(), text.end());
+				break;
+			}
+			}
+
+			//a sidecar's name changes with its content, so one which is already there doesn't need writing again
+			vector<pair<string, const vector<uint8_t> *>> files;
+			set<string> sidecarPaths;
+			for (const auto & sidecar : document.sidecars) {
+				sidecarPaths.insert(sidecar.first);
+				if (!ofFile::doesFileExist(sidecar.first, false)) {
+					files.emplace_back(sidecar.first, sidecar.second.get());
+				}
+			}
+
+			const auto hash = hashBytes(data.data(), data.size());
+			{
+				lock_guard<mutex> lock(documentsMutex);
+				auto findHash = documentHashes.find(path);
+				if (findHash == documentHashes.end() || findHash->second != hash || !ofFile::doesFileExist(path, false)) {
+					files.emplace_back(path, &data);
+				}
+			}
+			if (files.empty()) {
+				return false;
+			}
+
+			//write everything alongside and then replace, so that no file is left half written, and the document is
+			// moved last so that it only ever refers to sidecars which are in place
+			size_t movedCount = 0;
+			try {
+				for (const auto & file : files) {
+					const auto temporaryPath = file.first + ".tmp";
+					ofstream output(temporaryPath, ios::binary | ios::trunc);
+					output.write((const char *) file.second->data(), file.second->size());
+					if (!output) {
+						throw(Exception("Couldn't write [" + temporaryPath + "]"));
+					}
+				}
+				for (; movedCount < files.size(); movedCount++) {
+					const auto & filePath = files[movedCount].first;
+					if (!ofFile::moveFromTo(filePath + ".tmp", filePath, false, true)) {
+						throw(Exception("Couldn't replace [" + filePath + "]"));
+					}
+				}
+			}
+			catch (...) {
+				//the document is moved last, so any new sidecars which are already in place aren't referred to by anything
+				for (size_t i = 0; i < files.size(); i++) {
+					const auto leftover = i < movedCount ? files[i].first : files[i].first + ".tmp";
+					if (ofFile::doesFileExist(leftover, false)) {
+						ofFile::removeFile(leftover, false);
+					}
+				}
+				throw;
+			}
+
+			{
+				lock_guard<mutex> lock(documentsMutex);
+				documentHashes[path] = hash;
+			}
+			replaceDocumentSidecars(path, sidecarPaths);
+			return true;
+		}
+
+		//----------
+		void Serializable::readDocument(Json::Value & json, const string & filename) {
+			const auto path = ofToDataPath(filename, true);
+
+			ofFile input;
+			input.open(path, ofFile::ReadOnly, true);
+			auto buffer = input.readToBuffer();
+			auto data = (const uint8_t *) buffer.getData();
+			auto size = buffer.size();
+
+			if (BinaryJson::isBinaryJson(data, size)) {
+				BinaryJson::decode(data, size, json);
+			}
+			else {
+				Json::Reader reader;
+				reader.parse(buffer.getText(), json);
+			}
+
+			if (size > 0) {
+				lock_guard<mutex> lock(documentsMutex);
+				documentHashes[path] = hashBytes(data, size);
+			}
+		}
+
+		//----------
+		void Serializable::markDirty() {
+			this->changeCount++;
+		}
+
+		//----------
+		uint64_t Serializable::getChangeCount() const {
+			return this->changeCount.load();
+		}
+
+		//----------
+		void Serializable::setChangesTracked(bool changesTracked) {
+			this->changesTracked = changesTracked;
+		}
+
+		//----------
+		bool Serializable::getChangesTracked() const {
+			return this->changesTracked;
+		}
+
 		//----------
 		string Serializable::getDefaultFilename() const {
 			auto name = this->getName();
 			std::replace(name.begin(), name.end(), ':', '_');
 			return name;
 		}
+
+		//----------
+		string Serializable::getCurrentFilename() {
+			return currentDocument ? currentDocument->filename : string();
+		}
+
+		//----------
+		string Serializable::makeSidecarFilename(const string & extension) {
+			if (!currentDocument) {
+				return string();
+			}
+
+			// e.g. a node called MyRecorder gives MyRecorder.rulrlog, whether it's saved in MyRecorder.json or Patch.json
+			const auto & objects = currentDocument->objects;
+			const auto name = objects.empty()
+				? ofFilePath::getBaseName(currentDocument->filename)
+				: objects.back()->getDefaultFilename();
+			const auto path = ofFilePath::join(ofFilePath::getEnclosingDirectory(currentDocument->filename, false), name + "." + extension);
+
+			if (!currentDocument->sidecarFilenames.insert(path).second) {
+				throw(Exception("Sidecar [" + path + "] is used twice in [" + currentDocument->filename + "]"));
+			}
+			if (!objects.empty()) {
+				claimSidecar(path, objects.back());
+			}
+			return path;
+		}
+
+		//----------
+		string Serializable::addSidecar(const string & extension, vector<uint8_t> && data) {
+			if (!currentDocument || !currentDocument->document) {
+				return string();
+			}
+
+			// e.g. a node called MyCamera gives Patch.MyCamera.0123456789abcdef.captures in Patch.json,
+			// and MyCamera.0123456789abcdef.captures in MyCamera.json
+			const auto documentName = ofFilePath::getBaseName(currentDocument->filename);
+			auto name = documentName;
+			const auto & objects = currentDocument->objects;
+			if (!objects.empty() && objects.back()->getDefaultFilename() != documentName) {
+				name += "." + objects.back()->getDefaultFilename();
+			}
+			const auto directory = ofFilePath::getEnclosingDirectory(currentDocument->filename, false);
+
+			if (!currentDocument->sidecarFilenames.insert(ofFilePath::join(directory, name + "." + extension)).second) {
+				throw(Exception("[" + name + "] adds more than one " + extension + " sidecar to [" + currentDocument->filename + "]"));
+			}
+
+			const auto filename = name + "." + toHex(hashBytes(data.data(), data.size())) + "." + extension;
+			currentDocument->document->sidecars[ofFilePath::join(directory, filename)] = make_shared<const vector<uint8_t>>(move(data));
+			return filename;
+		}
+
+		//----------
+		void Serializable::addSidecars(const Sidecars & sidecars) {
+			if (currentDocument && currentDocument->document) {
+				currentDocument->document->sidecars.insert(sidecars.begin(), sidecars.end());
+			}
+		}
+
+		//----------
+		string Serializable::getSidecarPath(const string & sidecarFilename) {
+			if (!currentDocument) {
+				return ofToDataPath(sidecarFilename, true);
+			}
+
+			const auto path = ofFilePath::join(ofFilePath::getEnclosingDirectory(currentDocument->filename, false), sidecarFilename);
+			currentDocument->readSidecars.insert(path);
+			if (!currentDocument->objects.empty()) {
+				claimSidecar(path, currentDocument->objects.back());
+			}
+			return path;
+		}
 	}
 }
 
@@ -4,6 +4,7 @@
 #include "ofxLiquidEvent.h"
 
 #include <json/json.h>
+#include <atomic>
 #include <string>
 #include <type_traits>
 
@@ -15,12 +16,20 @@
 	}; \
 	this->onDeserialize += [this](Json::Value const & json) { \
 		this->deserialize(json); \
-	}
+	}; \
+	this->setChangesTracked(false)
 
 namespace ofxRulr {
 	namespace Utils {
 		class RULR_EXPORTS Serializable {
 		public:
+			enum class Encoding {
+				Text, ///< Styled JSON
+				Binary ///< See Utils::BinaryJson. load() reads either.
+			};
+
+			virtual ~Serializable();
+
 			virtual std::string getTypeName() const = 0;
 			virtual std::string getName() const;
 
@@ -29,9 +38,74 @@ namespace ofxRulr {
 			void serialize(Json::Value &);
 			void deserialize(const Json::Value &);
 
-			void save(std::string filename = "");
+			void save(std::string filename = "", Encoding = Encoding::Text);
 			void load(std::string filename = "");
 			std::string getDefaultFilename() const;
+
+			///Content of sidecars added with addSidecar, by path
+			typedef std::map<std::string, std::shared_ptr<const std::vector<uint8_t>>> Sidecars;
+
+			///A serialized document, together with the sidecars which are written with it
+			struct Document {
+				Json::Value json;
+				Sidecars sidecars;
+			};
+
+			///Serialize, also returning the sidecars added whilst doing so (e.g. so that a cache of the json can add
+			/// them to later documents with addSidecars)
+			void serialize(Json::Value &, Sidecars &);
+
+			///Serialize as the document which will be saved to filename (i.e. sidecars are placed next to it)
+			void serializeDocument(Document &, const std::string & filename);
+
+			///Encode and write a document and its sidecars. Sidecars are written before the document which refers to
+			/// them, and each file is replaced atomically (we write temporary files for everything and then rename them).
+			///Sidecars the document referred to when it was last written (or read) and no longer does are then removed.
+			///Returns false if nothing was written because the files already hold exactly this content.
+			///This only touches the document and the files, so it can be called from any thread.
+			static bool writeDocument(const Document &, const std::string & filename, Encoding);
+
+			///Read a text or binary document
+			static void readDocument(Json::Value &, const std::string & filename);
+
+			///Flag that something which is serialized has changed. Safe to call from any thread.
+			void markDirty();
+
+			///Increases every time markDirty() is called. Each consumer of the serialized content (e.g. the patch's
+			/// cache of a node, the node's own file) keeps the count it last saved, and is out of date whilst that
+			/// differs from this.
+			uint64_t getChangeCount() const;
+
+			///True (the default) if markDirty() is called whenever anything which is serialized changes, so that
+			/// saves can skip this object whilst its change count is the one they last saved. RULR_SERIALIZE_LISTENERS sets this to false since
+			/// custom serialization can't be watched (so these objects are always serialized, and only written if
+			/// the content has changed). Set it back to true if you call markDirty() yourself.
+			void setChangesTracked(bool);
+			bool getChangesTracked() const;
+
+			///The file being saved or loaded on this thread (empty outside of save() / load())
+			static std::string getCurrentFilename();
+
+			///A path next to the current file for a sidecar which the object writes itself (e.g. a log which is appended
+			/// to in place), named after the object being serialized (e.g. MyRecorder.rulrlog), so the name doesn't change
+			/// when other objects are added or removed. The same object is given the same path whichever document it's
+			/// saved in.
+			///Throws if the path already belongs to another object (or was already given out in this document).
+			///Returns an empty string outside of save().
+			static std::string makeSidecarFilename(const std::string & extension);
+
+			///Add a sidecar (e.g. binary data) to the document being saved, to be written by writeDocument together with
+			/// the json. The name is made of the document's, the object's and a hash of the content
+			/// (e.g. Patch.MyCamera.0123456789abcdef.captures), so a sidecar which hasn't changed isn't written again and
+			/// one which is in use (e.g. memory mapped by a reader) is never overwritten.
+			///Throws if the object has already added a sidecar of this type to the document.
+			///Returns the filename to store in the json, or an empty string outside of save().
+			static std::string addSidecar(const std::string & extension, std::vector<uint8_t> && data);
+			static void addSidecars(const Sidecars &);
+
+			///Resolves a sidecar filename (as stored in the json) against the current file. Whilst loading, the sidecar
+			/// is claimed by the object being deserialized (throwing if it already belongs to another object).
+			static std::string getSidecarPath(const std::string & sidecarFilename);
 		
 			//////////////////////////////////////////////////////////////////////////
 
@@ -80,6 +154,9 @@ namespace ofxRulr {
 			static void deserialize(const Json::Value &, ofParameter<bool> &);
 			static void deserialize(const Json::Value &, ofParameter<string> &);
 			static void deserialize(const Json::Value &, ofParameterGroup &);
+		protected:
+			std::atomic<uint64_t> changeCount{ 0 };
+			bool changesTracked = true;
 		};
 	}
 }
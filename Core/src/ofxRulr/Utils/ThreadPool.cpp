@@ -3,52 +3,282 @@
 #include "ofxRulr/Exception.h"
 #include "ofxRulr/Utils/Constants.h"
 
+OFXSINGLETON_DEFINE(ofxRulr::Utils::ThreadPool);
+
 namespace ofxRulr {
 	namespace Utils {
+		//the pool (and worker index) which owns the current thread, used to keep nested work local
+		thread_local ThreadPool * currentThreadPool = nullptr;
+		thread_local size_t currentWorkerIndex = 0;
+
+#pragma mark CancellationToken
+		//----------
+		void ThreadPool::CancellationToken::cancel() {
+			this->cancelled.store(true);
+		}
+
+		//----------
+		bool ThreadPool::CancellationToken::isCancelled() const {
+			return this->cancelled.load();
+		}
+
+#pragma mark ThreadPool
+		//----------
+		ThreadPool::ThreadPool()
+		: maxQueueSize(0) {
+			auto poolSize = std::thread::hardware_concurrency();
+			this->startWorkers(poolSize > 1 ? poolSize - 1 : 1);
+		}
+
 		//----------
 		ThreadPool::ThreadPool(size_t poolSize, size_t maxQueueSize)
 		: maxQueueSize(maxQueueSize) {
-			for (size_t i = 0; i < poolSize; i++) {
-				auto thread = make_unique<std::thread>([this]() {
-					std::function<void()> action;
-					while (!this->joining) {
-						if (this->actionQueue.tryReceive(action, 1000)) {
-							try {
-								action();
+			this->startWorkers(poolSize > 0 ? poolSize : 1);
+		}
+
+		//----------
+		ThreadPool::~ThreadPool() {
+			{
+				lock_guard<mutex> lock(this->idleMutex);
+				this->joining.store(true);
+			}
+			this->idleSignal.notify_all();
+
+			for (auto & thread : this->threads) {
+				if (thread.joinable()) {
+					thread.join();
+				}
+			}
+		}
+
+		//----------
+		bool ThreadPool::performAsync(function<void()> function, Priority priority, shared_ptr<CancellationToken> cancellationToken) {
+			if (this->maxQueueSize != 0 && this->queueSize.load() >= this->maxQueueSize) {
+				return false;
+			}
+
+			//tasks submitted from one of our own workers stay on that worker's deque (they're likely to share cache)
+			size_t workerIndex;
+			if (currentThreadPool == this) {
+				workerIndex = currentWorkerIndex;
+			}
+			else {
+				workerIndex = this->nextWorkerForSubmit.fetch_add(1) % this->workers.size();
+			}
+
+			//count the task before it becomes visible so that a thief can never take the counts below zero
+			auto lane = (size_t) priority;
+			this->queueSizePerLane[lane]++;
+			this->queueSize++;
+			{
+				auto & worker = * this->workers[workerIndex];
+				lock_guard<mutex> lock(worker.lanesMutex);
+				worker.lanes[lane].push_back(Task{ move(function), cancellationToken });
+			}
+
+			//take the idle lock so that a worker can't miss the signal between checking the queue and waiting
+			{
+				lock_guard<mutex> lock(this->idleMutex);
+			}
+			this->idleSignal.notify_one();
+
+			return true;
+		}
+
+		//----------
+		void ThreadPool::parallelFor(size_t begin, size_t end, function<void(size_t)> function, size_t grainSize, Priority priority, shared_ptr<CancellationToken> cancellationToken) {
+			if (end <= begin) {
+				return;
+			}
+			if (grainSize == 0) {
+				grainSize = 1;
+			}
+
+			struct State {
+				std::function<void(size_t)> action;
+				shared_ptr<CancellationToken> cancellationToken;
+				size_t end;
+				size_t grainSize;
+				atomic<size_t> nextIndex;
+
+				mutex completeMutex;
+				condition_variable completeSignal;
+				size_t remainingChunks;
+				exception_ptr exception;
+			};
+
+			//helper tasks may start after we return (e.g. if the caller did all the work), so the state is shared
+			auto state = make_shared<State>();
+			state->action = move(function);
+			state->cancellationToken = cancellationToken;
+			state->end = end;
+			state->grainSize = grainSize;
+			state->nextIndex.store(begin);
+			state->remainingChunks = (end - begin + grainSize - 1) / grainSize;
+
+			auto chunkCount = state->remainingChunks;
+
+			auto runChunks = [state]() {
+				while (true) {
+					auto chunkBegin = state->nextIndex.fetch_add(state->grainSize);
+					if (chunkBegin >= state->end) {
+						break;
+					}
+					auto chunkEnd = min(chunkBegin + state->grainSize, state->end);
+
+					bool skip = state->cancellationToken && state->cancellationToken->isCancelled();
+					if (!skip) {
+						unique_lock<mutex> lock(state->completeMutex);
+						skip = (bool) state->exception;
+					}
+
+					if (!skip) {
+						try {
+							for (size_t i = chunkBegin; i < chunkEnd; i++) {
+								state->action(i);
 							}
-							RULR_CATCH_ALL_TO_ERROR;
+						}
+						catch (...) {
+							unique_lock<mutex> lock(state->completeMutex);
+							if (!state->exception) {
+								state->exception = std::current_exception();
+							}
+						}
+					}
+
+					{
+						unique_lock<mutex> lock(state->completeMutex);
+						if (--state->remainingChunks == 0) {
+							state->completeSignal.notify_all();
 						}
 					}
+				}
+			};
+
+			//the calling thread takes one share of the work itself
+			auto helperCount = min(this->getPoolSize(), chunkCount - 1);
+			for (size_t i = 0; i < helperCount; i++) {
+				if (!this->performAsync(runChunks, priority)) {
+					break;
+				}
+			}
+			runChunks();
+
+			{
+				unique_lock<mutex> lock(state->completeMutex);
+				state->completeSignal.wait(lock, [state]() {
+					return state->remainingChunks == 0;
 				});
-				this->threads.insert(move(thread));
+				if (state->exception) {
+					rethrow_exception(state->exception);
+				}
 			}
 		}
 
 		//----------
-		ThreadPool::~ThreadPool() {
-			this->actionQueue.close();
+		size_t ThreadPool::getPoolSize() const {
+			return this->workers.size();
+		}
 
-			this->joining = true;
-			for (auto & thread : this->threads) {
-				if (thread->joinable()) {
-					thread->join();
+		//----------
+		size_t ThreadPool::getQueueSize() const {
+			return this->queueSize.load();
+		}
+
+		//----------
+		size_t ThreadPool::getQueueSize(Priority priority) const {
+			return this->queueSizePerLane[(size_t) priority].load();
+		}
+
+		//----------
+		void ThreadPool::startWorkers(size_t poolSize) {
+			for (auto & laneSize : this->queueSizePerLane) {
+				laneSize.store(0);
+			}
+
+			for (size_t i = 0; i < poolSize; i++) {
+				this->workers.push_back(make_unique<Worker>());
+			}
+
+			//start the threads only once all the workers exist (since they steal from each other)
+			for (size_t i = 0; i < poolSize; i++) {
+				this->threads.emplace_back([this, i]() {
+					this->workerLoop(i);
+				});
+			}
+		}
+
+		//----------
+		void ThreadPool::workerLoop(size_t workerIndex) {
+			currentThreadPool = this;
+			currentWorkerIndex = workerIndex;
+
+			Task task;
+			while (!this->joining.load()) {
+				if (!this->takeTask(workerIndex, task)) {
+					unique_lock<mutex> lock(this->idleMutex);
+					this->idleSignal.wait(lock, [this]() {
+						return this->queueSize.load() > 0 || this->joining.load();
+					});
+					continue;
+				}
+
+				if (!task.cancellationToken || !task.cancellationToken->isCancelled()) {
+					try {
+						task.action();
+					}
+					RULR_CATCH_ALL_TO_ERROR;
 				}
+
+				//release anything captured by the task now rather than when the next task arrives
+				task = Task();
 			}
 		}
 
 		//----------
-		bool ThreadPool::performAsync(function<void()> function) {
-			if (this->actionQueue.size() >= this->maxQueueSize) {
-				return false;
+		bool ThreadPool::takeTask(size_t workerIndex, Task & task) {
+			//higher priority lanes first, anywhere in the pool, before lower priority lanes
+			for (size_t lane = 0; lane < (size_t) Priority::Count; lane++) {
+				if (this->queueSizePerLane[lane].load() == 0) {
+					continue;
+				}
+				if (this->popTask(workerIndex, lane, task) || this->stealTask(workerIndex, lane, task)) {
+					this->queueSizePerLane[lane]--;
+					this->queueSize--;
+					return true;
+				}
 			}
+			return false;
+		}
 
-			this->actionQueue.send(move(function));
+		//----------
+		bool ThreadPool::popTask(size_t workerIndex, size_t lane, Task & task) {
+			//our own work is taken from the front so that frames are processed in the order they arrived
+			auto & worker = * this->workers[workerIndex];
+			lock_guard<mutex> lock(worker.lanesMutex);
+			auto & deque = worker.lanes[lane];
+			if (deque.empty()) {
+				return false;
+			}
+			task = move(deque.front());
+			deque.pop_front();
 			return true;
 		}
 
 		//----------
-		size_t ThreadPool::getQueueSize() const {
-			return this->actionQueue.size();
+		bool ThreadPool::stealTask(size_t thiefIndex, size_t lane, Task & task) {
+			//steal from the back to keep contention with the owner low
+			for (size_t offset = 1; offset < this->workers.size(); offset++) {
+				auto & victim = * this->workers[(thiefIndex + offset) % this->workers.size()];
+				lock_guard<mutex> lock(victim.lanesMutex);
+				auto & deque = victim.lanes[lane];
+				if (!deque.empty()) {
+					task = move(deque.back());
+					deque.pop_back();
+					return true;
+				}
+			}
+			return false;
 		}
 	}
-}
\ No newline at end of file
+}
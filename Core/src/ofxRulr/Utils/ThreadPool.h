@@ -1,53 +1,140 @@
 #pragma once
 
-#include "ofThreadChannel.h"
 #include "ofxRulr/Utils/Constants.h"
+#include "ofxRulr/Exception.h"
+#include "ofxSingleton.h"
+
 #include <thread>
-#include <set>
 #include <future>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 using namespace std;
 
 namespace ofxRulr {
 	namespace Utils {
-		class ThreadPool {
+		///A work-stealing thread pool.
+		///Each worker owns a deque per priority lane. Work submitted from a worker goes onto that worker's
+		/// own deque, work submitted from elsewhere is spread across the workers. Idle workers steal from the
+		/// back of other workers' deques.
+		///Use ThreadPool::X() for the process-wide pool (shared by all nodes) rather than making your own.
+		class RULR_EXPORTS ThreadPool : public ofxSingleton::Singleton<ThreadPool> {
 		public:
-			ThreadPool(size_t poolSize, size_t maxQueueSize);
+			enum class Priority : size_t {
+				NodeUpdate = 0, ///< Node updates which the main thread is waiting on (see Graph::Scheduler)
+				CameraFrame, ///< Live frames which should be processed with minimum latency
+				Default, ///< General work
+				Batch, ///< Long running work (e.g. solvers) which should yield to live frames
+
+				Count
+			};
+
+			///Set cancel() to skip any tasks submitted with this token which haven't started yet.
+			///Running tasks can check isCancelled() to exit early.
+			class RULR_EXPORTS CancellationToken {
+			public:
+				void cancel();
+				bool isCancelled() const;
+			protected:
+				atomic<bool> cancelled{ false };
+			};
+
+			ThreadPool(); ///< Uses all hardware threads except one (left for the main thread)
+			ThreadPool(size_t poolSize, size_t maxQueueSize = 0); ///< maxQueueSize = 0 means unbounded
 			virtual ~ThreadPool();
 
-			bool performAsync(function<void()>);
+			///Returns false if the queue is full
+			bool performAsync(function<void()>
+				, Priority = Priority::Default
+				, shared_ptr<CancellationToken> = nullptr);
 
-			//consider using std::async(std::launch::async, ...) instead
+			///The future throws if the function throws, if the task is cancelled, or if the queue was full
 			template<typename ReturnType>
-			future<exception_ptr> performAsyncWithExceptionHandling(function<void()>) {
-				promise<ReturnType> promise;
-				auto future = promise.get_future();
-				auto wrappedFunction = [function, &promise]() {
+			future<ReturnType> performAsyncWithFuture(function<ReturnType()> function
+				, Priority priority = Priority::Default
+				, shared_ptr<CancellationToken> cancellationToken = nullptr) {
+				//the promise is shared with the task so that it outlives this call
+				auto promise = make_shared<std::promise<ReturnType>>();
+				auto future = promise->get_future();
+
+				//we check the cancellation inside the action so that the promise is always fulfilled
+				auto action = [function, promise, cancellationToken]() {
 					try {
-						promise.set_value(function());
+						if (cancellationToken && cancellationToken->isCancelled()) {
+							throw(ofxRulr::Exception("Task was cancelled"));
+						}
+						setPromise(*promise, function);
 					}
 					catch (...) {
-						promise.set_exception(std::current_exception());
+						promise->set_exception(std::current_exception());
 					}
 				};
-				if (!this->performAsync(function)) {
+
+				if (!this->performAsync(action, priority)) {
 					try {
 						throw(ofxRulr::Exception("Thread pool action queue is full"));
 					}
 					catch (...) {
-						promise.set_exception(std::current_exception());
+						promise->set_exception(std::current_exception());
 					}
 				}
 				return future;
 			}
 
+			///Calls function(i) for i in [begin, end) across the pool, returning once all calls are complete.
+			///The calling thread also takes part, so this is safe to call from inside a pool task.
+			///The first exception thrown by any call is rethrown here.
+			void parallelFor(size_t begin
+				, size_t end
+				, function<void(size_t)>
+				, size_t grainSize = 1
+				, Priority = Priority::Default
+				, shared_ptr<CancellationToken> = nullptr);
+
+			size_t getPoolSize() const;
 			size_t getQueueSize() const;
+			size_t getQueueSize(Priority) const;
 		protected:
-			set<unique_ptr<thread>> threads;
-			ofThreadChannel<std::function<void()>> actionQueue;
+			struct Task {
+				function<void()> action;
+				shared_ptr<CancellationToken> cancellationToken;
+			};
+
+			struct Worker {
+				deque<Task> lanes[(size_t) Priority::Count];
+				mutable mutex lanesMutex;
+			};
+
+			template<typename ReturnType>
+			static void setPromise(std::promise<ReturnType> & promise, const function<ReturnType()> & function) {
+				promise.set_value(function());
+			}
+
+			static void setPromise(std::promise<void> & promise, const function<void()> & function) {
+				function();
+				promise.set_value();
+			}
+
+			void startWorkers(size_t poolSize);
+			void workerLoop(size_t workerIndex);
+			bool takeTask(size_t workerIndex, Task &);
+			bool popTask(size_t workerIndex, size_t lane, Task &);
+			bool stealTask(size_t thiefIndex, size_t lane, Task &);
+
+			vector<unique_ptr<Worker>> workers;
+			vector<thread> threads;
+
 			size_t maxQueueSize;
+			atomic<size_t> queueSize{ 0 };
+			atomic<size_t> queueSizePerLane[(size_t) Priority::Count];
+			atomic<size_t> nextWorkerForSubmit{ 0 };
+
+			mutex idleMutex;
+			condition_variable idleSignal;
 
-			bool joining = false;
+			atomic<bool> joining{ false };
 		};
 	}
-}
\ No newline at end of file
+}
@@ -73,6 +73,16 @@ namespace ofxRulr {
 				return this->type;
 			}
 
+			//----------
+			uint64_t Channel::getVersion() const {
+				return this->version;
+			}
+
+			//----------
+			uint64_t Channel::getHierarchyVersion() const {
+				return this->hierarchyVersion;
+			}
+
 			//----------
 			Channel & Channel::addSubChannel(const string & name) {
 				auto channel = make_shared<Channel>(name);
@@ -82,9 +92,9 @@ namespace ofxRulr {
 				};
 				this->subChannels.insert(inserter);
 				channel->onHeirarchyChange += [this]() {
-					this->onHeirarchyChange.notifyListeners();
+					this->notifyHeirarchyChange();
 				};
-				this->onHeirarchyChange.notifyListeners();
+				this->notifyHeirarchyChange();
 
 				return *channel;
 			}
@@ -94,7 +104,7 @@ namespace ofxRulr {
 				auto findChannel = this->subChannels.find(name);
 				if (findChannel != this->subChannels.end()) {
 					this->subChannels.erase(findChannel);
-					this->onHeirarchyChange.notifyListeners();
+					this->notifyHeirarchyChange();
 				}
 			}
 
@@ -103,13 +113,21 @@ namespace ofxRulr {
 				this->subChannels[channel->getName()] = channel;
 
 				//we always notify because otherwise we have to fully compare channel with what might have been here before
-				this->onHeirarchyChange.notifyListeners();
+				this->notifyHeirarchyChange();
 			}
 
 			//----------
 			void Channel::clear() {
 				this->parameter.reset();
+				this->type = Type::Undefined;
 				this->subChannels.clear();
+				this->version++;
+				this->notifyHeirarchyChange();
+			}
+
+			//----------
+			void Channel::notifyHeirarchyChange() {
+				this->hierarchyVersion++;
 				this->onHeirarchyChange.notifyListeners();
 			}
 		}
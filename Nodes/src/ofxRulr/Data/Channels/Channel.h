@@ -9,6 +9,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <type_traits>
 
 using namespace std;
 
@@ -34,6 +35,23 @@ namespace ofxRulr {
 				};
 
 				typedef map<string, shared_ptr<Channel>> Set;
+
+				///The Type which values of type T are stored as (resolved at compile time)
+				template<typename T>
+				static constexpr Type getTypeOf() {
+					return is_same<T, bool>::value ? Type::Bool
+						: is_same<T, int>::value ? Type::Int
+						: is_same<T, int32_t>::value ? Type::Int32
+						: is_same<T, int64_t>::value ? Type::Int64
+						: is_same<T, uint32_t>::value ? Type::UInt32
+						: is_same<T, uint64_t>::value ? Type::UInt64
+						: is_same<T, float>::value ? Type::Float
+						: is_same<T, string>::value ? Type::String
+						: is_same<T, ofVec3f>::value ? Type::Vec3f
+						: is_same<T, ofVec4f>::value ? Type::Vec4f
+						: is_same<T, vector<int>>::value ? Type::IntVector
+						: Type::Unknown;
+				}
 				
 				Channel(const string & name);
 
@@ -65,6 +83,13 @@ namespace ofxRulr {
 
 				Type getValueType() const;
 
+				///Incremented whenever a value is assigned (or the channel is cleared), so that readers can skip unchanged channels
+				uint64_t getVersion() const;
+
+				///Incremented whenever a channel is added or removed anywhere beneath this channel.
+				///Whilst it is unchanged, references to channels beneath this one remain valid.
+				uint64_t getHierarchyVersion() const;
+
 				Channel & addSubChannel(const string & name);
 				void removeSubChannel(const string & name);
 
@@ -72,61 +97,40 @@ namespace ofxRulr {
 
 				template<typename T>
 				void operator=(T value) {
-					auto parameter = dynamic_pointer_cast<ofParameter<T>>(this->parameter);
-					if (!parameter) {
-						parameter = make_shared<ofParameter<T>>();
-						parameter->setName(this->name);
-						this->parameter = parameter;
-					}
+					const auto type = getTypeOf<T>();
 
-					if (typeid(T) == typeid(bool)) {
-						this->type = Type::Bool;
-					}
-					else if (typeid(T) == typeid(int)) {
-						this->type = Type::Int;
-					}
-					else if (typeid(T) == typeid(int32_t)) {
-						this->type = Type::Int32;
-					}
-					else if (typeid(T) == typeid(int64_t)) {
-						this->type = Type::Int64;
-					}
-					else if (typeid(T) == typeid(uint32_t)) {
-						this->type = Type::UInt32;
-					}
-					else if (typeid(T) == typeid(uint64_t)) {
-						this->type = Type::UInt64;
-					}
-					else if (typeid(T) == typeid(float)) {
-						this->type = Type::Float;
-					}
-					else if (typeid(T) == typeid(string)) {
-						this->type = Type::String;
-					}
-					else if (typeid(T) == typeid(ofVec3f)) {
-						this->type = Type::Vec3f;
-					}
-					else if (typeid(T) == typeid(ofVec4f)) {
-						this->type = Type::Vec4f;
-					}
-					else if (typeid(T) == typeid(vector<int>)) {
-						this->type = Type::IntVector;
+					//if the type is known and matches then the parameter must already be an ofParameter<T>
+					ofParameter<T> * parameter = nullptr;
+					if (type != Type::Unknown && type == this->type && this->parameter) {
+						parameter = static_cast<ofParameter<T> *>(this->parameter.get());
 					}
 					else {
-						this->type = Type::Unknown;
+						auto typedParameter = dynamic_pointer_cast<ofParameter<T>>(this->parameter);
+						if (!typedParameter) {
+							typedParameter = make_shared<ofParameter<T>>();
+							typedParameter->setName(this->name);
+							this->parameter = typedParameter;
+						}
+						parameter = typedParameter.get();
+						this->type = type;
 					}
 
 					parameter->set(value);
+					this->version++;
 				}
 
 				void clear();
 
 				ofxLiquidEvent<void> onHeirarchyChange;
 			protected:
+				void notifyHeirarchyChange();
+
 				const string name;
 				Set subChannels;
 				shared_ptr<ofAbstractParameter> parameter;
 				Type type = Type::Undefined;
+				uint64_t version = 0;
+				uint64_t hierarchyVersion = 0;
 			};
 		}
 	}
@@ -0,0 +1,68 @@
+#include "pch_RulrNodes.h"
+#include "Table.h"
+
+namespace ofxRulr {
+	namespace Data {
+		namespace Channels {
+			//----------
+			bool Table::update(const shared_ptr<Channel> & root) {
+				if (root.get() == this->root
+					&& (!root || root->getHierarchyVersion() == this->rootHierarchyVersion)) {
+					return false;
+				}
+
+				this->entries.clear();
+				this->root = root.get();
+				if (root) {
+					this->rootHierarchyVersion = root->getHierarchyVersion();
+					this->addChildren(*root, NoParent, "", 0);
+				}
+				this->generation++;
+				return true;
+			}
+
+			//----------
+			void Table::clear() {
+				this->entries.clear();
+				this->root = nullptr;
+				this->generation++;
+			}
+
+			//----------
+			const vector<Table::Entry> & Table::getEntries() const {
+				return this->entries;
+			}
+
+			//----------
+			size_t Table::size() const {
+				return this->entries.size();
+			}
+
+			//----------
+			bool Table::empty() const {
+				return this->entries.empty();
+			}
+
+			//----------
+			uint64_t Table::getGeneration() const {
+				return this->generation;
+			}
+
+			//----------
+			void Table::addChildren(const Channel & channel, size_t parentIndex, const string & prefix, size_t depth) {
+				for (const auto & subChannelIt : channel.getSubChannels()) {
+					//nb : take a copy of the address since entries may reallocate whilst adding children
+					const auto index = this->entries.size();
+					const auto address = prefix + "/" + subChannelIt.first;
+					this->entries.push_back({
+						subChannelIt.second
+						, address
+						, parentIndex
+						, depth
+					});
+					this->addChildren(*subChannelIt.second, index, address, depth + 1);
+				}
+			}
+		}
+	}
+}
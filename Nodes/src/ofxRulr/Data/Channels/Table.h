@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Channel.h"
+
+#include <vector>
+
+namespace ofxRulr {
+	namespace Data {
+		namespace Channels {
+			///A flat, depth-first list of every channel beneath a root channel (parents before their children).
+			///It is only rebuilt when the root's hierarchy version changes, so readers which visit every channel each frame
+			/// can walk a contiguous array with pre-built addresses instead of walking the tree and building strings.
+			class Table {
+			public:
+				struct Entry {
+					shared_ptr<Channel> channel;
+					string address; // e.g. "/combined/bodies/count"
+					size_t parentIndex; // NoParent for children of the root
+					size_t depth; // 0 for children of the root
+				};
+
+				static const size_t NoParent = (size_t) -1;
+
+				///Returns true if the table was rebuilt
+				bool update(const shared_ptr<Channel> & root);
+				void clear();
+
+				const vector<Entry> & getEntries() const;
+				size_t size() const;
+				bool empty() const;
+
+				///Incremented whenever the table is rebuilt, so that readers can tell when their own indices are invalid
+				uint64_t getGeneration() const;
+			protected:
+				void addChildren(const Channel &, size_t parentIndex, const string & prefix, size_t depth);
+
+				vector<Entry> entries;
+				const Channel * root = nullptr;
+				uint64_t rootHierarchyVersion = 0;
+				uint64_t generation = 0;
+			};
+		}
+	}
+}
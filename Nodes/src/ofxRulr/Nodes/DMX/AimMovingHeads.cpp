@@ -0,0 +1,257 @@
+#include "pch_RulrNodes.h"
+#include "AimMovingHeads.h"
+
+#include "ofxRulr/Nodes/DMX/MovingHead.h"
+#include "ofxRulr/Nodes/DMX/Transmit.h"
+
+#include "ofxCvGui/Widgets/Title.h"
+#include "ofxCvGui/Widgets/LiveValue.h"
+
+using namespace ofxCvGui;
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace DMX {
+			//----------
+			AimMovingHeads::AimMovingHeads() {
+				RULR_NODE_INIT_LISTENER;
+			}
+
+			//----------
+			string AimMovingHeads::getTypeName() const {
+				return "DMX::AimMovingHeads";
+			}
+
+			//----------
+			void AimMovingHeads::init() {
+				RULR_NODE_UPDATE_LISTENER;
+				RULR_NODE_INSPECTOR_LISTENER;
+				RULR_NODE_SERIALIZATION_LISTENERS;
+
+				this->addInput<Transmit>();
+				for (size_t i = 0; i < NumTargets; i++) {
+					this->targetPins[i] = this->addInput<Item::RigidBody>("Target " + ofToString(i + 1));
+				}
+
+				this->manageParameters(this->parameters);
+
+				this->targetOffsetsGroup.setName("Target offsets");
+				for (size_t i = 0; i < NumTargets; i++) {
+					this->targetOffsets[i].set("Target " + ofToString(i + 1), ofVec3f(), ofVec3f(-1.0f), ofVec3f(1.0f));
+					this->targetOffsetsGroup.add(this->targetOffsets[i]);
+				}
+				this->manageParameters(this->targetOffsetsGroup);
+			}
+
+			//----------
+			void AimMovingHeads::update() {
+				auto transmit = this->getInput<Transmit>();
+				if (!transmit) {
+					if (!this->heads.empty()) {
+						this->rebuildHeads({});
+					}
+					return;
+				}
+
+				auto startTime = chrono::high_resolution_clock::now();
+
+				//the moving heads which are connected to the transmit
+				{
+					vector<MovingHead *> movingHeads;
+					for (auto fixture : transmit->getFixtures()) {
+						auto movingHead = dynamic_cast<MovingHead *>(fixture);
+						if (movingHead) {
+							movingHeads.push_back(movingHead);
+						}
+					}
+
+					bool headsChanged = movingHeads.size() != this->heads.size();
+					for (size_t i = 0; i < movingHeads.size() && !headsChanged; i++) {
+						headsChanged = movingHeads[i] != this->heads[i].movingHead;
+					}
+					if (headsChanged) {
+						this->rebuildHeads(movingHeads);
+					}
+				}
+
+				this->predictTargets(transmit->getOutputPeriod());
+				this->aimHeads();
+
+				this->solveDuration = chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
+			}
+
+			//----------
+			void AimMovingHeads::serialize(Json::Value & json) {
+				auto & jsonHeadTargets = json["headTargets"];
+				for (const auto & headTarget : this->headTargets) {
+					jsonHeadTargets[headTarget.first] = headTarget.second->get();
+				}
+			}
+
+			//----------
+			void AimMovingHeads::deserialize(const Json::Value & json) {
+				const auto & jsonHeadTargets = json["headTargets"];
+				for (const auto & headName : jsonHeadTargets.getMemberNames()) {
+					this->getHeadTarget(headName)->set(jsonHeadTargets[headName].asInt());
+				}
+			}
+
+			//----------
+			void AimMovingHeads::populateInspector(ofxCvGui::InspectArguments & inspectArguments) {
+				auto inspector = inspectArguments.inspector;
+
+				inspector->add(new Widgets::LiveValue<size_t>("Heads", [this]() {
+					return this->heads.size();
+				}));
+				inspector->add(new Widgets::LiveValue<size_t>("Heads out of range", [this]() {
+					return this->failedCount;
+				}));
+				inspector->add(new Widgets::LiveValue<float>("Solve time [us]", [this]() {
+					return this->solveDuration * 1e6f;
+				}));
+				inspector->add(new Widgets::LiveValue<float>("Prediction horizon [ms]", [this]() {
+					return this->meanHorizon * 1000.0f;
+				}));
+
+				inspector->add(new Widgets::Title("Head targets", Widgets::Title::Level::H3));
+				for (const auto & head : this->heads) {
+					inspector->addEditableValue<int>(*this->getHeadTarget(head.movingHead->getName()));
+				}
+			}
+
+			//----------
+			void AimMovingHeads::rebuildHeads(const vector<MovingHead *> & movingHeads) {
+				this->heads.clear();
+				for (auto movingHead : movingHeads) {
+					Head head;
+					head.movingHead = movingHead;
+					this->heads.push_back(head);
+				}
+				ofxCvGui::refreshInspector(this);
+			}
+
+			//----------
+			void AimMovingHeads::predictTargets(const chrono::microseconds & outputPeriod) {
+				const auto & latencyCompensation = this->parameters.latencyCompensation;
+				const auto now = chrono::high_resolution_clock::now();
+
+				//on average the heads receive new values half an output period after we set them
+				const auto outputDelay = chrono::duration<float>(outputPeriod).count() * 0.5f
+					+ latencyCompensation.fixtureLatency.get() / 1000.0f;
+				const auto maximumHorizon = latencyCompensation.maximumHorizon.get() / 1000.0f;
+				const auto trackingTimeout = latencyCompensation.trackingTimeout.get();
+
+				float horizonSum = 0.0f;
+				size_t horizonCount = 0;
+
+				for (size_t i = 0; i < NumTargets; i++) {
+					auto & target = this->targets[i];
+					target.valid = false;
+
+					auto rigidBody = this->targetPins[i]->getConnection();
+					if (!rigidBody) {
+						target.tracking = false;
+						continue;
+					}
+
+					//blank can be an indicator of bad tracking
+					const auto transform = rigidBody->getTransform();
+					if (this->parameters.ignoreBlankTransform && transform.isIdentity()) {
+						target.tracking = false;
+						continue;
+					}
+
+					//the offset is in the target's coordinates
+					const auto measuredPosition = transform.getTranslation() + this->targetOffsets[i].get() * transform.getRotate();
+
+					//alpha-beta filter on new measurements, using the time between measurements (rather than the app frame rate)
+					const auto measurementTime = rigidBody->getTransformTime();
+					if (!target.tracking || measurementTime != target.measurementTime) {
+						const auto dt = chrono::duration<float>(measurementTime - target.measurementTime).count();
+						if (!target.tracking || dt <= 0.0f || dt > trackingTimeout) {
+							target.position = measuredPosition;
+							target.velocity = ofVec3f();
+							target.tracking = true;
+						}
+						else {
+							const auto predictedPosition = target.position + target.velocity * dt;
+							const auto residual = measuredPosition - predictedPosition;
+							target.position = predictedPosition + residual * latencyCompensation.positionGain.get();
+							target.velocity += residual * (latencyCompensation.velocityGain.get() / dt);
+						}
+						target.measurementTime = measurementTime;
+					}
+
+					//predict forwards to when the heads will be there
+					const auto age = chrono::duration<float>(now - target.measurementTime).count();
+					if (latencyCompensation.enabled && age < trackingTimeout) {
+						const auto horizon = ofClamp(age + outputDelay, 0.0f, maximumHorizon);
+						target.aimPosition = target.position + target.velocity * horizon;
+
+						horizonSum += horizon;
+						horizonCount++;
+					}
+					else {
+						target.aimPosition = measuredPosition;
+					}
+					target.valid = true;
+				}
+
+				this->meanHorizon = horizonCount > 0
+					? horizonSum / (float) horizonCount
+					: 0.0f;
+			}
+
+			//----------
+			void AimMovingHeads::aimHeads() {
+				const auto closestPath = this->parameters.closestPath.get();
+				this->failedCount = 0;
+
+				for (auto & head : this->heads) {
+					head.targetIndex = (size_t) this->getHeadTarget(head.movingHead->getName())->get();
+					if (head.targetIndex == 0 || head.targetIndex > NumTargets) {
+						continue;
+					}
+					const auto & target = this->targets[head.targetIndex - 1];
+					if (!target.valid) {
+						continue;
+					}
+
+					const auto transform = head.movingHead->getTransform();
+					if (!head.transformValid || memcmp(transform.getPtr(), head.transform.getPtr(), sizeof(float) * 16) != 0) {
+						head.transform = transform;
+						head.worldToObject = transform.getInverse();
+						head.transformValid = true;
+					}
+
+					const auto objectSpacePoint = target.aimPosition * head.worldToObject;
+					auto panTilt = MovingHead::getPanTiltForTargetInObjectSpace(objectSpacePoint, head.movingHead->getTiltOffset());
+					if (closestPath) {
+						try {
+							panTilt = head.movingHead->getClosestPanTilt(panTilt);
+						}
+						catch (...) {
+							//the target is out of this head's range
+							this->failedCount++;
+							continue;
+						}
+					}
+					head.movingHead->setPanTilt(panTilt);
+				}
+			}
+
+			//----------
+			shared_ptr<ofParameter<int>> AimMovingHeads::getHeadTarget(const string & headName) {
+				auto findHeadTarget = this->headTargets.find(headName);
+				if (findHeadTarget != this->headTargets.end()) {
+					return findHeadTarget->second;
+				}
+
+				//new heads are left alone until the user assigns them a target (they may be aimed by another node)
+				auto headTarget = make_shared<ofParameter<int>>(headName, 0, 0, NumTargets);
+				this->headTargets.emplace(headName, headTarget);
+				return headTarget;
+			}
+		}
+	}
+}
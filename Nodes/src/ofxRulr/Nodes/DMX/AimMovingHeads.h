@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Nodes/Item/RigidBody.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace DMX {
+			class MovingHead;
+
+			///Aims every moving head which is connected to the Transmit at one of the targets, in one pass per frame.
+			///Each target is predicted once (however many heads follow it) from the time its transform was measured,
+			/// forwards to when the heads will have received the DMX (the Transmit's output period plus the fixture latency).
+			///Heads are assigned to targets by name in the inspector (0 to leave a head alone, which is the default).
+			class AimMovingHeads : public Nodes::Base {
+			public:
+				enum : size_t {
+					NumTargets = 8
+				};
+
+				AimMovingHeads();
+				string getTypeName() const override;
+				void init();
+				void update();
+
+				void serialize(Json::Value &);
+				void deserialize(const Json::Value &);
+				void populateInspector(ofxCvGui::InspectArguments &);
+			protected:
+				struct Target {
+					chrono::high_resolution_clock::time_point measurementTime;
+					bool tracking = false;
+					bool valid = false; // we have an aim position this frame
+
+					ofVec3f position; // filtered, at measurementTime
+					ofVec3f velocity;
+					ofVec3f aimPosition;
+				};
+
+				struct Head {
+					MovingHead * movingHead = nullptr;
+					size_t targetIndex = 0;
+
+					//world to object is only inverted again when the head moves
+					ofMatrix4x4 transform;
+					ofMatrix4x4 worldToObject;
+					bool transformValid = false;
+				};
+
+				void rebuildHeads(const vector<MovingHead *> &);
+				void predictTargets(const chrono::microseconds & outputPeriod);
+				void aimHeads();
+				shared_ptr<ofParameter<int>> getHeadTarget(const string & headName);
+
+				struct : ofParameterGroup {
+					ofParameter<bool> ignoreBlankTransform{ "Ignore blank transform", true };
+					ofParameter<bool> closestPath{ "Closest path", false };
+
+					struct : ofParameterGroup {
+						ofParameter<bool> enabled{ "Enabled", true };
+						ofParameter<float> positionGain{ "Position gain", 0.7f, 0.0f, 1.0f };
+						ofParameter<float> velocityGain{ "Velocity gain", 0.2f, 0.0f, 1.0f };
+						ofParameter<float> fixtureLatency{ "Fixture latency [ms]", 40.0f, 0.0f, 500.0f }; // from receiving DMX to moving
+						ofParameter<float> maximumHorizon{ "Maximum horizon [ms]", 250.0f, 0.0f, 1000.0f };
+						ofParameter<float> trackingTimeout{ "Tracking timeout [s]", 0.5f, 0.0f, 5.0f }; // restart the prediction after a gap in measurements
+						PARAM_DECLARE("Latency compensation", enabled, positionGain, velocityGain, fixtureLatency, maximumHorizon, trackingTimeout);
+					} latencyCompensation;
+
+					PARAM_DECLARE("AimMovingHeads", ignoreBlankTransform, closestPath, latencyCompensation);
+				} parameters;
+
+				ofParameter<ofVec3f> targetOffsets[NumTargets]; // in the target's coordinates
+				ofParameterGroup targetOffsetsGroup;
+
+				shared_ptr<Graph::Pin<Item::RigidBody>> targetPins[NumTargets];
+				array<Target, NumTargets> targets;
+				vector<Head> heads;
+				map<string, shared_ptr<ofParameter<int>>> headTargets; // by head name, 0 for none
+
+				//statistics
+				float solveDuration = 0.0f; // [s]
+				float meanHorizon = 0.0f; // [s]
+				size_t failedCount = 0; // heads which couldn't reach their target this frame
+			};
+		}
+	}
+}
@@ -42,13 +42,30 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			Fixture::~Fixture() {
+				auto transmit = this->getInput<DMX::Transmit>();
+				if (transmit) {
+					transmit->removeFixture(this);
+				}
+			}
+
 			//----------
 			void Fixture::init() {
 				RULR_NODE_UPDATE_LISTENER;
 				RULR_NODE_SERIALIZATION_LISTENERS;
 				RULR_NODE_INSPECTOR_LISTENER;
 
-				this->addInput<DMX::Transmit>();
+				//let the transmitter know which fixtures are connected to it (e.g. for aiming groups of heads)
+				auto transmitPin = this->addInput<DMX::Transmit>();
+				transmitPin->onNewConnection += [this](shared_ptr<DMX::Transmit> transmit) {
+					transmit->addFixture(this);
+				};
+				transmitPin->onDeleteConnection += [this](shared_ptr<DMX::Transmit> transmit) {
+					if (transmit) {
+						transmit->removeFixture(this);
+					}
+				};
 
 				this->channelIndex.set("Channel index", 1, 1, 512);
 				this->universeIndex.set("Universe index", 0, 0, 1024);
@@ -18,6 +18,7 @@ namespace ofxRulr {
 					function<DMX::Value()> generateValue;
 				};
 				Fixture();
+				virtual ~Fixture();
 				void init();
 				virtual string getTypeName() const override;
 				void update();
@@ -101,42 +101,52 @@ namespace ofxRulr {
 				auto panTilt = MovingHead::getPanTiltForTargetInObjectSpace(objectSpacePoint, this->parameters.tiltOffset);
 
 				if (navigationEnabled) {
-					//we want to find the fastest route to it, for every 180 degrees of pan there is a valid solution, let's choose the one with the smallest pan always
-					auto halfRotationsMin = ceil(this->parameters.pan.getMin() / 180.0f);
-					auto halfRotationsMax = ceil(this->parameters.pan.getMax() / 180.0f) + 1;
-					map<float, ofVec2f> solutions; // panDistance, (pan,tilt)
-					for (int halfRotation = halfRotationsMin; halfRotation < halfRotationsMax; halfRotation++) {
-						//for each hemisphere, find the solution, check if it's in valid range
-						float searchPan = (halfRotation * 180) + panTilt.x;
-						float searchTilt;
-						if (halfRotation % 2 == 0) {
-							//even, keep tilt
-							searchTilt = panTilt.y;
-						}
-						else {
-							//odd, flip tilt
-							searchTilt = -panTilt.y;
-						}
-						if (searchPan >= this->parameters.pan.getMin() && searchPan <= this->parameters.pan.getMax() && searchTilt >= this->parameters.tilt.getMin() && searchTilt <= this->parameters.tilt.getMax()) {
-							//it's a valid solution
-							auto panDistance = abs(searchPan - this->parameters.pan);
-							pair<float, ofVec2f> solution(panDistance, ofVec2f(searchPan, searchTilt));
-							solutions.insert(solution);
-						}
+					try {
+						return this->getClosestPanTilt(panTilt);
 					}
-
-					if (solutions.empty()) {
+					catch (...) {
 						throw(ofxRulr::Exception("No valid solutions found to aim MovingHead '" + this->getName() + "' at target (" + ofToString(worldSpacePoint) + ")"));
 					}
-
-					auto solution = solutions.begin();
-					return solution->second;
 				}
 				else {
 					return panTilt;
 				}
 			}
 
+			//----------
+			ofVec2f MovingHead::getClosestPanTilt(const ofVec2f & panTilt) const {
+				//we want to find the fastest route to it, for every 180 degrees of pan there is a valid solution, let's choose the one with the smallest pan always
+				auto halfRotationsMin = ceil(this->parameters.pan.getMin() / 180.0f);
+				auto halfRotationsMax = ceil(this->parameters.pan.getMax() / 180.0f) + 1;
+				map<float, ofVec2f> solutions; // panDistance, (pan,tilt)
+				for (int halfRotation = halfRotationsMin; halfRotation < halfRotationsMax; halfRotation++) {
+					//for each hemisphere, find the solution, check if it's in valid range
+					float searchPan = (halfRotation * 180) + panTilt.x;
+					float searchTilt;
+					if (halfRotation % 2 == 0) {
+						//even, keep tilt
+						searchTilt = panTilt.y;
+					}
+					else {
+						//odd, flip tilt
+						searchTilt = -panTilt.y;
+					}
+					if (searchPan >= this->parameters.pan.getMin() && searchPan <= this->parameters.pan.getMax() && searchTilt >= this->parameters.tilt.getMin() && searchTilt <= this->parameters.tilt.getMax()) {
+						//it's a valid solution
+						auto panDistance = abs(searchPan - this->parameters.pan);
+						pair<float, ofVec2f> solution(panDistance, ofVec2f(searchPan, searchTilt));
+						solutions.insert(solution);
+					}
+				}
+
+				if (solutions.empty()) {
+					throw(ofxRulr::Exception("No valid solutions found to aim MovingHead '" + this->getName() + "' at pan/tilt (" + ofToString(panTilt) + ")"));
+				}
+
+				auto solution = solutions.begin();
+				return solution->second;
+			}
+
 			//----------
 			ofVec2f MovingHead::getPanTiltForTargetInObjectSpace(const ofVec3f & objectSpacePoint, float tiltOffset) {
 				auto pan = atan2(objectSpacePoint.z, objectSpacePoint.x) * RAD_TO_DEG - 90.0f;
@@ -186,6 +196,11 @@ namespace ofxRulr {
 				this->parameters.tiltOffset = tiltOffset;
 			}
 
+			//----------
+			float MovingHead::getTiltOffset() const {
+				return this->parameters.tiltOffset;
+			}
+
 			//----------
 			void MovingHead::copyFrom(shared_ptr<MovingHead> other) {
 				this->parameters.pan = other->parameters.pan;
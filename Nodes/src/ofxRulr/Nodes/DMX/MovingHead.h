@@ -20,6 +20,7 @@ namespace ofxRulr {
 				ofVec2f getPanTilt() const;
 				ofVec2f getPanTiltForTarget(const ofVec3f & worldSpacePoint, bool navigationEnabled) const; ///navigationEnabled uses closest path, also throws on impossible target
 				static ofVec2f getPanTiltForTargetInObjectSpace(const ofVec3f & objectSpacePoint, float tiltOffset = 0.0f);
+				ofVec2f getClosestPanTilt(const ofVec2f & panTilt) const; ///the equivalent pan/tilt within range which needs the least pan movement, throws if there isn't one
 				void lookAt(const ofVec3f & worldSpacePoint); /// warning : throws exception if impossible
 				void setPanTilt(const ofVec2f & panTilt);
 
@@ -29,6 +30,7 @@ namespace ofxRulr {
 				void setHome();
 
 				void setTiltOffset(float);
+				float getTiltOffset() const;
 				void copyFrom(shared_ptr<MovingHead>);
 			protected:
 				void populateInspector(ofxCvGui::InspectArguments &);
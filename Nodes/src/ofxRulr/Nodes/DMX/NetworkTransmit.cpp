@@ -0,0 +1,602 @@
+#include "pch_RulrNodes.h"
+#include "NetworkTransmit.h"
+
+#include "ofxCvGui/Widgets/Title.h"
+#include "ofxCvGui/Widgets/EditableValue.h"
+#include "ofxCvGui/Widgets/LiveValue.h"
+#include "ofxCvGui/Widgets/Button.h"
+
+#include "Poco/Net/NetException.h"
+
+#include <random>
+
+using namespace ofxCvGui;
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace DMX {
+			namespace {
+				const uint8_t artNetId[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0 };
+				const uint8_t acnPacketId[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+
+				//ArtDmx
+				const size_t artDmxSequenceOffset = 12;
+				const size_t artDmxDataOffset = 18;
+
+				//E1.31 data packet
+				const size_t sacnSequenceOffset = 111;
+				const size_t sacnDataOffset = 126;
+				const size_t sacnPacketSize = sacnDataOffset + 512;
+
+				//E1.31 universe sync packet
+				const size_t sacnSyncSequenceOffset = 44;
+				const size_t sacnSyncPacketSize = 49;
+
+				//----------
+				void writeUInt16(uint8_t * data, uint16_t value) {
+					data[0] = (uint8_t) (value >> 8);
+					data[1] = (uint8_t) value;
+				}
+
+				//----------
+				void writeUInt32(uint8_t * data, uint32_t value) {
+					writeUInt16(data, (uint16_t) (value >> 16));
+					writeUInt16(data + 2, (uint16_t) value);
+				}
+
+				//----------
+				uint16_t readUInt16(const uint8_t * data) {
+					return (uint16_t) ((data[0] << 8) | data[1]);
+				}
+
+				//----------
+				uint32_t readUInt32(const uint8_t * data) {
+					return ((uint32_t) readUInt16(data) << 16) | readUInt16(data + 2);
+				}
+
+				//----------
+				///ACN 'flags and length' : the length is from the start of this layer to the end of the packet
+				void writeFlagsAndLength(uint8_t * data, size_t length) {
+					writeUInt16(data, (uint16_t) (0x7000 | length));
+				}
+
+				//----------
+				void writeRootLayer(vector<uint8_t> & packet, uint32_t rootVector, const array<uint8_t, 16> & cid) {
+					auto data = packet.data();
+					writeUInt16(data + 0, 0x0010); // preamble size
+					writeUInt16(data + 2, 0x0000); // postamble size
+					memcpy(data + 4, acnPacketId, sizeof(acnPacketId));
+					writeFlagsAndLength(data + 16, packet.size() - 16);
+					writeUInt32(data + 18, rootVector);
+					memcpy(data + 22, cid.data(), cid.size());
+				}
+
+				//----------
+				Poco::Net::SocketAddress makeAddress(const string & text, uint16_t defaultPort) {
+					if (text.find(':') != string::npos) {
+						return Poco::Net::SocketAddress(text);
+					}
+					else {
+						return Poco::Net::SocketAddress(text, defaultPort);
+					}
+				}
+
+				//----------
+				Poco::Net::SocketAddress getMulticastAddress(uint16_t universe) {
+					return Poco::Net::SocketAddress("239.255." + ofToString(universe >> 8) + "." + ofToString(universe & 0xff), NetworkTransmit::sACNPort);
+				}
+			}
+
+			//----------
+			NetworkTransmit::NetworkTransmit() {
+				RULR_NODE_INIT_LISTENER;
+			}
+
+			//----------
+			NetworkTransmit::~NetworkTransmit() {
+				this->stopOutputThread();
+			}
+
+			//----------
+			string NetworkTransmit::getTypeName() const {
+				return "DMX::NetworkTransmit";
+			}
+
+			//----------
+			void NetworkTransmit::init() {
+				//parameters first, so that the universe count is known when we deserialize
+				this->manageParameters(this->parameters);
+
+				RULR_NODE_UPDATE_LISTENER;
+				RULR_NODE_SERIALIZATION_LISTENERS;
+				RULR_NODE_INSPECTOR_LISTENER;
+
+				//a new source identifier for each new node
+				{
+					random_device randomDevice;
+					for (auto & byte : this->cid) {
+						byte = (uint8_t) randomDevice();
+					}
+				}
+
+				this->setDestinationCount(this->getUniverseCount());
+			}
+
+			//----------
+			void NetworkTransmit::update() {
+				if (this->parameters.universeCount.get() != this->getUniverseCount()) {
+					this->setUniverseCount((UniverseIndex) max(this->parameters.universeCount.get(), 1));
+					this->setDestinationCount(this->getUniverseCount());
+					ofxCvGui::InspectController::X().refresh(this);
+				}
+
+				auto outputSettingsKey = this->getOutputSettingsKey();
+				if (outputSettingsKey != this->outputSettingsKey) {
+					this->outputSettingsKey = outputSettingsKey;
+					this->rebuildOutput();
+				}
+			}
+
+			//----------
+			void NetworkTransmit::serialize(Json::Value & json) {
+				auto & jsonDestinations = json["destinations"];
+				for (int i = 0; i < this->destinations.size(); i++) {
+					jsonDestinations[i] = this->destinations[i]->get();
+				}
+
+				string cidText;
+				for (auto byte : this->cid) {
+					cidText += ofToHex(byte);
+				}
+				json["cid"] = cidText;
+			}
+
+			//----------
+			void NetworkTransmit::deserialize(const Json::Value & json) {
+				//the universes are created now (so we read the Transmit settings again to get all of them)
+				this->setUniverseCount((UniverseIndex) max(this->parameters.universeCount.get(), 1));
+				this->setDestinationCount(this->getUniverseCount());
+				this->Transmit::deserialize(json);
+
+				const auto & jsonDestinations = json["destinations"];
+				for (int i = 0; i < this->destinations.size(); i++) {
+					this->destinations[i]->set(jsonDestinations[i].asString());
+				}
+
+				const auto cidText = json["cid"].asString();
+				if (cidText.size() == this->cid.size() * 2) {
+					for (size_t i = 0; i < this->cid.size(); i++) {
+						this->cid[i] = (uint8_t) ofHexToInt(cidText.substr(i * 2, 2));
+					}
+				}
+
+				//rebuild on next update
+				this->outputSettingsKey.clear();
+			}
+
+			//----------
+			void NetworkTransmit::populateInspector(ofxCvGui::InspectArguments & inspectArguments) {
+				auto inspector = inspectArguments.inspector;
+
+				inspector->add(new Widgets::Title("Destinations", Widgets::Title::Level::H3));
+				for (auto destination : this->destinations) {
+					inspector->add(new Widgets::EditableValue<string>(*destination));
+				}
+
+				inspector->add(new Widgets::Title("Network output", Widgets::Title::Level::H3));
+				inspector->add(new Widgets::LiveValue<string>("Status", [this]() {
+					return this->outputError.empty() ? string("OK") : this->outputError;
+				}));
+				inspector->add(new Widgets::LiveValue<size_t>("Packets sent", [this]() {
+					return this->packetCount.load();
+				}));
+				inspector->add(new Widgets::LiveValue<size_t>("Bytes sent", [this]() {
+					return this->byteCount.load();
+				}));
+				inspector->add(new Widgets::LiveValue<size_t>("Send errors", [this]() {
+					return this->errorCount.load();
+				}));
+				inspector->add(new Widgets::LiveValue<string>("Last send error", [this]() {
+					lock_guard<mutex> lock(this->outputMutex);
+					return this->lastSendError;
+				}));
+
+				inspector->add(new Widgets::Button("Test loopback", [this]() {
+					try {
+						auto result = this->testLoopback();
+
+						stringstream message;
+						message << result.matchedCount << " / " << result.sentCount << " universes received intact";
+						if (result.receivedCount != result.matchedCount) {
+							message << " (" << (result.receivedCount - result.matchedCount) << " corrupt)";
+						}
+						if (this->parameters.sendSync) {
+							message << ", sync " << (result.syncReceived ? "received" : "missing");
+						}
+						message << " in " << (result.duration * 1000.0f) << "ms";
+						this->loopbackTestResult = message.str();
+						ofLogNotice("DMX::NetworkTransmit") << "Loopback test : " << this->loopbackTestResult;
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				}));
+				inspector->add(new Widgets::LiveValue<string>("Loopback test result", [this]() {
+					return this->loopbackTestResult;
+				}));
+			}
+
+			//----------
+			NetworkTransmit::LoopbackTestResult NetworkTransmit::testLoopback() {
+				LoopbackTestResult result;
+				auto startTime = chrono::high_resolution_clock::now();
+
+				Poco::Net::DatagramSocket receiver(Poco::Net::SocketAddress("127.0.0.1", 0), true);
+				receiver.setReceiveBufferSize(1 << 20);
+				receiver.setReceiveTimeout(Poco::Timespan(0, 200 * 1000));
+
+				auto output = this->makeOutput(receiver.address().port());
+
+				//test pattern (different in each universe)
+				Frame channels;
+				for (size_t universeIndex = 0; universeIndex < output->universes.size(); universeIndex++) {
+					for (size_t channel = 1; channel < channels.size(); channel++) {
+						channels[channel] = (Value) (channel + universeIndex * 7);
+					}
+					encodeUniverse(output->protocol, output->universes[universeIndex], channels.data());
+				}
+
+				size_t byteCount = 0;
+				string error;
+				result.sentCount = sendPackets(*output, byteCount, error);
+				if (!error.empty()) {
+					throw(Exception("Failed to send : " + error));
+				}
+
+				vector<uint8_t> buffer(2048);
+				while (result.receivedCount < result.sentCount || (output->sync && !result.syncReceived)) {
+					Poco::Net::SocketAddress sender;
+					int size;
+					try {
+						size = receiver.receiveFrom(buffer.data(), (int) buffer.size(), sender);
+					}
+					catch (const Poco::TimeoutException &) {
+						break;
+					}
+
+					if (isSyncPacket(output->protocol, buffer.data(), size)) {
+						result.syncReceived = true;
+						continue;
+					}
+
+					uint16_t universe;
+					const uint8_t * data;
+					size_t dataSize;
+					if (!parseDataPacket(output->protocol, buffer.data(), size, universe, data, dataSize)) {
+						continue;
+					}
+					result.receivedCount++;
+
+					auto universeIndex = (int) universe - this->parameters.firstUniverse.get();
+					if (universeIndex < 0 || universeIndex >= output->universes.size() || dataSize != 512) {
+						continue;
+					}
+					bool matches = true;
+					for (size_t channel = 1; channel <= dataSize; channel++) {
+						if (data[channel - 1] != (uint8_t) (channel + universeIndex * 7)) {
+							matches = false;
+							break;
+						}
+					}
+					if (matches) {
+						result.matchedCount++;
+					}
+				}
+
+				result.duration = chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
+				return result;
+			}
+
+			//----------
+			bool NetworkTransmit::parseDataPacket(NetworkProtocol protocol, const uint8_t * packet, size_t size, uint16_t & universe, const uint8_t * & data, size_t & dataSize) {
+				switch (protocol.get()) {
+				case NetworkProtocol::ArtNet:
+				{
+					if (size < artDmxDataOffset
+						|| memcmp(packet, artNetId, sizeof(artNetId)) != 0
+						|| (packet[8] | (packet[9] << 8)) != 0x5000) {
+						return false;
+					}
+					universe = (uint16_t) (packet[14] | ((packet[15] & 0x7f) << 8));
+					dataSize = readUInt16(packet + 16);
+					data = packet + artDmxDataOffset;
+					return size >= artDmxDataOffset + dataSize;
+				}
+				case NetworkProtocol::sACN:
+				{
+					if (size < sacnDataOffset
+						|| memcmp(packet + 4, acnPacketId, sizeof(acnPacketId)) != 0
+						|| readUInt32(packet + 18) != 0x00000004 // VECTOR_ROOT_E131_DATA
+						|| readUInt32(packet + 40) != 0x00000002 // VECTOR_E131_DATA_PACKET
+						|| packet[117] != 0x02 // VECTOR_DMP_SET_PROPERTY
+						|| packet[125] != 0) { // DMX start code
+						return false;
+					}
+					universe = readUInt16(packet + 113);
+					auto propertyCount = readUInt16(packet + 123);
+					if (propertyCount < 1) {
+						return false;
+					}
+					dataSize = propertyCount - 1;
+					data = packet + sacnDataOffset;
+					return size >= sacnDataOffset + dataSize;
+				}
+				default:
+					return false;
+				}
+			}
+
+			//----------
+			bool NetworkTransmit::isSyncPacket(NetworkProtocol protocol, const uint8_t * packet, size_t size) {
+				switch (protocol.get()) {
+				case NetworkProtocol::ArtNet:
+					return size >= 14
+						&& memcmp(packet, artNetId, sizeof(artNetId)) == 0
+						&& (packet[8] | (packet[9] << 8)) == 0x5200;
+				case NetworkProtocol::sACN:
+					return size >= sacnSyncPacketSize
+						&& memcmp(packet + 4, acnPacketId, sizeof(acnPacketId)) == 0
+						&& readUInt32(packet + 18) == 0x00000008 // VECTOR_ROOT_E131_EXTENDED
+						&& readUInt32(packet + 40) == 0x00000001; // VECTOR_E131_EXTENDED_SYNCHRONIZATION
+				default:
+					return false;
+				}
+			}
+
+			//----------
+			void NetworkTransmit::sendUniverse(UniverseIndex universeIndex, const Value * channels) {
+				if (this->output && universeIndex < this->output->universes.size()) {
+					encodeUniverse(this->output->protocol, this->output->universes[universeIndex], channels);
+				}
+			}
+
+			//----------
+			void NetworkTransmit::flushOutput() {
+				if (this->output) {
+					size_t byteCount = 0;
+					string error;
+					auto sentCount = sendPackets(*this->output, byteCount, error);
+
+					this->packetCount += sentCount;
+					if (this->output->sync && sentCount > 0) {
+						this->packetCount++;
+					}
+					this->byteCount += byteCount;
+					if (!error.empty()) {
+						this->errorCount++;
+						this->lastSendError = error;
+					}
+				}
+			}
+
+			//----------
+			shared_ptr<NetworkTransmit::Output> NetworkTransmit::makeOutput(uint16_t loopbackPort) const {
+				auto output = make_shared<Output>();
+				output->protocol = this->parameters.protocol.get();
+
+				//socket
+				{
+					const auto & localAddress = this->parameters.localAddress.get();
+					output->socket.bind(Poco::Net::SocketAddress(localAddress.empty() ? "0.0.0.0" : localAddress, 0), true);
+					output->socket.setBroadcast(true);
+					output->socket.setSendBufferSize(1 << 20);
+				}
+
+				const auto isArtNet = output->protocol == NetworkProtocol::ArtNet;
+				const auto loopbackAddress = Poco::Net::SocketAddress("127.0.0.1", loopbackPort);
+
+				//universes
+				output->universes.resize(this->getUniverseCount());
+				for (size_t i = 0; i < output->universes.size(); i++) {
+					auto & universe = output->universes[i];
+					const auto networkUniverse = this->parameters.firstUniverse.get() + (int) i;
+
+					//destination
+					const auto & destination = i < this->destinations.size()
+						? this->destinations[i]->get()
+						: string();
+					if (loopbackPort != 0) {
+						universe.destination = loopbackAddress;
+					}
+					else if (!destination.empty()) {
+						universe.destination = makeAddress(destination, isArtNet ? ArtNetPort : sACNPort);
+					}
+					else if (isArtNet) {
+						universe.destination = makeAddress(this->parameters.defaultDestination.get(), ArtNetPort);
+					}
+					else {
+						universe.destination = getMulticastAddress((uint16_t) networkUniverse);
+					}
+
+					//packet template
+					if (isArtNet) {
+						if (networkUniverse < 0 || networkUniverse > 0x7fff) {
+							throw(Exception("Art-Net universe " + ofToString(networkUniverse) + " is out of range (0-32767)"));
+						}
+
+						universe.packet.assign(artDmxDataOffset + 512, 0);
+						auto data = universe.packet.data();
+						memcpy(data, artNetId, sizeof(artNetId));
+						data[8] = 0x00; // OpDmx (little endian)
+						data[9] = 0x50;
+						writeUInt16(data + 10, 14); // protocol version
+						data[14] = (uint8_t) (networkUniverse & 0xff); // SubUni
+						data[15] = (uint8_t) (networkUniverse >> 8); // Net
+						writeUInt16(data + 16, 512);
+
+						universe.sequenceOffset = artDmxSequenceOffset;
+						universe.dataOffset = artDmxDataOffset;
+					}
+					else {
+						if (networkUniverse < 1 || networkUniverse > 63999) {
+							throw(Exception("sACN universe " + ofToString(networkUniverse) + " is out of range (1-63999)"));
+						}
+
+						universe.packet.assign(sacnPacketSize, 0);
+						writeRootLayer(universe.packet, 0x00000004, this->cid); // VECTOR_ROOT_E131_DATA
+
+						//framing layer
+						auto data = universe.packet.data();
+						writeFlagsAndLength(data + 38, sacnPacketSize - 38);
+						writeUInt32(data + 40, 0x00000002); // VECTOR_E131_DATA_PACKET
+						strncpy((char *) data + 44, "Rulr", 63);
+						data[108] = (uint8_t) ofClamp(this->parameters.priority.get(), 0, 200);
+						writeUInt16(data + 109, this->parameters.sendSync.get() ? (uint16_t) this->parameters.syncUniverse.get() : 0);
+						data[112] = 0; // options
+						writeUInt16(data + 113, (uint16_t) networkUniverse);
+
+						//DMP layer
+						writeFlagsAndLength(data + 115, sacnPacketSize - 115);
+						data[117] = 0x02; // VECTOR_DMP_SET_PROPERTY
+						data[118] = 0xa1; // address type and data type
+						writeUInt16(data + 119, 0); // first property address
+						writeUInt16(data + 121, 1); // address increment
+						writeUInt16(data + 123, 513); // property value count (including the start code)
+						data[125] = 0; // DMX start code
+
+						universe.sequenceOffset = sacnSequenceOffset;
+						universe.dataOffset = sacnDataOffset;
+					}
+				}
+
+				//sync
+				output->sync = this->parameters.sendSync.get();
+				if (output->sync) {
+					if (isArtNet) {
+						output->syncPacket.assign(14, 0);
+						auto data = output->syncPacket.data();
+						memcpy(data, artNetId, sizeof(artNetId));
+						data[8] = 0x00; // OpSync (little endian)
+						data[9] = 0x52;
+						writeUInt16(data + 10, 14); // protocol version
+
+						output->syncDestination = makeAddress(this->parameters.defaultDestination.get(), ArtNetPort);
+					}
+					else {
+						const auto syncUniverse = (uint16_t) this->parameters.syncUniverse.get();
+						output->syncPacket.assign(sacnSyncPacketSize, 0);
+						writeRootLayer(output->syncPacket, 0x00000008, this->cid); // VECTOR_ROOT_E131_EXTENDED
+
+						auto data = output->syncPacket.data();
+						writeFlagsAndLength(data + 38, sacnSyncPacketSize - 38);
+						writeUInt32(data + 40, 0x00000001); // VECTOR_E131_EXTENDED_SYNCHRONIZATION
+						writeUInt16(data + 45, syncUniverse);
+						output->syncSequenceOffset = sacnSyncSequenceOffset;
+
+						output->syncDestination = getMulticastAddress(syncUniverse);
+					}
+
+					if (loopbackPort != 0) {
+						output->syncDestination = loopbackAddress;
+					}
+				}
+
+				return output;
+			}
+
+			//----------
+			void NetworkTransmit::encodeUniverse(NetworkProtocol protocol, OutputUniverse & universe, const Value * channels) {
+				//Art-Net uses 0 to mean 'no sequence', sACN uses the whole range
+				universe.sequence++;
+				if (protocol == NetworkProtocol::ArtNet && universe.sequence == 0) {
+					universe.sequence = 1;
+				}
+				universe.packet[universe.sequenceOffset] = universe.sequence;
+
+				memcpy(universe.packet.data() + universe.dataOffset, channels + 1, 512);
+				universe.pending = true;
+			}
+
+			//----------
+			size_t NetworkTransmit::sendPackets(Output & output, size_t & byteCount, string & error) {
+				size_t sentCount = 0;
+
+				for (auto & universe : output.universes) {
+					if (!universe.pending) {
+						continue;
+					}
+					universe.pending = false;
+
+					try {
+						byteCount += output.socket.sendTo(universe.packet.data(), (int) universe.packet.size(), universe.destination);
+						sentCount++;
+					}
+					catch (const Poco::Exception & e) {
+						error = e.displayText();
+					}
+				}
+
+				//the sync packet tells receivers to show what we've just sent
+				if (output.sync && sentCount > 0) {
+					if (output.syncSequenceOffset != 0) {
+						output.syncPacket[output.syncSequenceOffset] = ++output.syncSequence;
+					}
+					try {
+						byteCount += output.socket.sendTo(output.syncPacket.data(), (int) output.syncPacket.size(), output.syncDestination);
+					}
+					catch (const Poco::Exception & e) {
+						error = e.displayText();
+					}
+				}
+
+				return sentCount;
+			}
+
+			//----------
+			void NetworkTransmit::rebuildOutput() {
+				shared_ptr<Output> output;
+				try {
+					output = this->makeOutput();
+					this->outputError.clear();
+				}
+				catch (const Poco::Exception & e) {
+					this->outputError = e.displayText();
+				}
+				catch (const std::exception & e) {
+					this->outputError = e.what();
+				}
+				if (!this->outputError.empty()) {
+					RULR_ERROR << "DMX::NetworkTransmit : " << this->outputError;
+				}
+
+				//the previous output (and its socket) is released after the lock
+				lock_guard<mutex> lock(this->outputMutex);
+				swap(this->output, output);
+			}
+
+			//----------
+			string NetworkTransmit::getOutputSettingsKey() const {
+				stringstream key;
+				key << (int) this->parameters.protocol.get().get()
+					<< "|" << this->getUniverseCount()
+					<< "|" << this->parameters.firstUniverse.get()
+					<< "|" << this->parameters.defaultDestination.get()
+					<< "|" << this->parameters.localAddress.get()
+					<< "|" << this->parameters.sendSync.get()
+					<< "|" << this->parameters.syncUniverse.get()
+					<< "|" << this->parameters.priority.get();
+				for (const auto & destination : this->destinations) {
+					key << "|" << destination->get();
+				}
+				return key.str();
+			}
+
+			//----------
+			void NetworkTransmit::setDestinationCount(size_t count) {
+				while (this->destinations.size() < count) {
+					auto name = "Universe " + ofToString(this->destinations.size());
+					this->destinations.push_back(make_shared<ofParameter<string>>(name, ""));
+				}
+				this->destinations.resize(count);
+			}
+		}
+	}
+}
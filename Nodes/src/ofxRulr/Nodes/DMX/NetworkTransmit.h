@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Transmit.h"
+
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/SocketAddress.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace DMX {
+			MAKE_ENUM(NetworkProtocol
+				, (ArtNet, sACN)
+				, ("Art-Net", "sACN"));
+
+			///Sends universes over UDP as Art-Net (ArtDmx) or sACN (E1.31).
+			///Universe i is sent as network universe 'First universe' + i (sACN universes start at 1).
+			///Each universe goes to its own destination if one is set, otherwise to the default destination
+			/// (for Art-Net the broadcast address, for sACN the universe's multicast group).
+			///The packets of a tick are encoded in place into buffers which are kept between ticks, and are then sent
+			/// together at the end of the tick, followed by a sync packet (ArtSync / E1.31 universe sync) if enabled.
+			class NetworkTransmit : public Transmit {
+			public:
+				struct LoopbackTestResult {
+					size_t sentCount = 0;
+					size_t receivedCount = 0;
+					size_t matchedCount = 0; // universe number and data are what was sent
+					bool syncReceived = false;
+					float duration = 0.0f; // [s]
+				};
+
+				NetworkTransmit();
+				virtual ~NetworkTransmit();
+				string getTypeName() const override;
+				void init();
+				void update();
+
+				void serialize(Json::Value &);
+				void deserialize(const Json::Value &);
+				void populateInspector(ofxCvGui::InspectArguments &);
+
+				///Sends a test pattern in every universe to a socket on this machine and checks what arrives.
+				///This uses its own socket, so the live output isn't interrupted.
+				LoopbackTestResult testLoopback();
+
+				static const uint16_t ArtNetPort = 6454;
+				static const uint16_t sACNPort = 5568;
+
+				///Parses an ArtDmx or E1.31 data packet. Returns false if it isn't one.
+				static bool parseDataPacket(NetworkProtocol, const uint8_t * packet, size_t size, uint16_t & universe, const uint8_t * & data, size_t & dataSize);
+				static bool isSyncPacket(NetworkProtocol, const uint8_t * packet, size_t size);
+			protected:
+				struct OutputUniverse {
+					Poco::Net::SocketAddress destination;
+					vector<uint8_t> packet;
+					size_t dataOffset = 0;
+					size_t sequenceOffset = 0;
+					uint8_t sequence = 0;
+					bool pending = false;
+				};
+
+				///Everything the output thread needs, rebuilt on the main thread when the settings change
+				struct Output {
+					NetworkProtocol protocol;
+					Poco::Net::DatagramSocket socket;
+					vector<OutputUniverse> universes;
+
+					bool sync = false;
+					Poco::Net::SocketAddress syncDestination;
+					vector<uint8_t> syncPacket;
+					size_t syncSequenceOffset = 0;
+					uint8_t syncSequence = 0;
+				};
+
+				void sendUniverse(UniverseIndex, const Value * channels) override;
+				void flushOutput() override;
+
+				///If loopbackPort is set then every packet is sent to that port on this machine
+				shared_ptr<Output> makeOutput(uint16_t loopbackPort = 0) const;
+				static void encodeUniverse(NetworkProtocol, OutputUniverse &, const Value * channels);
+				///Sends the pending universes (then the sync packet). Returns how many universes were sent.
+				static size_t sendPackets(Output &, size_t & byteCount, string & error);
+
+				void rebuildOutput();
+				string getOutputSettingsKey() const;
+				void setDestinationCount(size_t);
+
+				struct : ofParameterGroup {
+					ofParameter<NetworkProtocol> protocol{ "Protocol", NetworkProtocol::ArtNet };
+					ofParameter<int> universeCount{ "Universe count", 1, 1, 512 };
+					ofParameter<int> firstUniverse{ "First universe", 1 };
+					ofParameter<string> defaultDestination{ "Default destination", "255.255.255.255" }; // Art-Net only, sACN uses multicast
+					ofParameter<string> localAddress{ "Local address", "" }; // the interface to send from, empty for any
+					ofParameter<bool> sendSync{ "Send sync", false };
+					ofParameter<int> syncUniverse{ "Sync universe", 63999, 1, 63999 }; // sACN only
+					ofParameter<int> priority{ "Priority", 100, 0, 200 }; // sACN only
+					PARAM_DECLARE("NetworkTransmit", protocol, universeCount, firstUniverse, defaultDestination, localAddress, sendSync, syncUniverse, priority);
+				} parameters;
+
+				vector<shared_ptr<ofParameter<string>>> destinations; // per universe, empty for the default destination
+				array<uint8_t, 16> cid; // sACN source identifier, kept with the project
+
+				shared_ptr<Output> output; // used by the output thread, change whilst holding outputMutex
+				string outputSettingsKey;
+				string outputError;
+
+				//statistics (written on the output thread)
+				atomic<size_t> packetCount{ 0 };
+				atomic<size_t> byteCount{ 0 };
+				atomic<size_t> errorCount{ 0 };
+				string lastSendError; // guarded by outputMutex
+
+				string loopbackTestResult;
+			};
+		}
+	}
+}
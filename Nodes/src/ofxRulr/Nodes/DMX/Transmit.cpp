@@ -4,6 +4,8 @@
 #include "ofxCvGui/Panels/Scroll.h"
 #include "ofxCvGui/Widgets/Title.h"
 #include "ofxCvGui/Widgets/Toggle.h"
+#include "ofxCvGui/Widgets/LiveValue.h"
+#include "ofxCvGui/Widgets/Button.h"
 #include "ofxCvGui/Utils/Utils.h"
 
 using namespace ofxCvGui;
@@ -63,6 +65,13 @@ namespace ofxRulr {
 				this->previewDirty = true;
 			}
 
+			//----------
+			void Transmit::Universe::publish() {
+				auto & frame = this->outputBuffer.getWriteBuffer();
+				memcpy(frame.data(), this->values, 513);
+				this->outputBuffer.publish();
+			}
+
 #pragma mark Transmit
 			//----------
 			Transmit::Transmit() {
@@ -72,11 +81,24 @@ namespace ofxRulr {
 				RULR_NODE_SERIALIZATION_LISTENERS;
 			}
 
+			//----------
+			Transmit::~Transmit() {
+				this->stopOutputThread();
+			}
+
 			//----------
 			void Transmit::init() {
 				this->view = make_shared<Panels::Scroll>();
 				this->setUniverseCount(1);
 				this->firstFrame = true;
+
+				this->manageParameters(this->outputParameters);
+
+				this->outputRates.time = chrono::high_resolution_clock::now();
+				this->outputThreadRunning = true;
+				this->outputThread = thread([this]() {
+					this->outputThreadFunction();
+				});
 			}
 
 			//----------
@@ -90,7 +112,35 @@ namespace ofxRulr {
 						if (this->universes[i]->blackoutEnabled) {
 							this->universes[i]->clearChannels();
 						}
-						this->sendUniverse(i, this->universes[i]);
+						this->universes[i]->publish();
+					}
+				}
+
+				//settings for the output thread
+				{
+					auto refreshRate = max(this->outputParameters.refreshRate.get(), 1.0f);
+					this->outputPeriod = (int64_t) (1e6f / refreshRate);
+					this->resendInterval = (int64_t) (this->outputParameters.resendInterval.get() * 1e6f);
+					this->sendChangesOnly = this->outputParameters.sendChangesOnly.get();
+				}
+
+				//output rates
+				{
+					auto now = chrono::high_resolution_clock::now();
+					auto interval = chrono::duration<float>(now - this->outputRates.time).count();
+					if (interval >= 1.0f) {
+						auto tickCount = this->outputStatistics.tickCount.load();
+						auto sentCount = this->outputStatistics.sentCount.load();
+						auto skippedCount = this->outputStatistics.skippedCount.load();
+
+						this->outputRates.ticksPerSecond = (float)(tickCount - this->outputRates.tickCount) / interval;
+						this->outputRates.sentPerSecond = (float)(sentCount - this->outputRates.sentCount) / interval;
+						this->outputRates.skippedPerSecond = (float)(skippedCount - this->outputRates.skippedCount) / interval;
+
+						this->outputRates.tickCount = tickCount;
+						this->outputRates.sentCount = sentCount;
+						this->outputRates.skippedCount = skippedCount;
+						this->outputRates.time = now;
 					}
 				}
 			}
@@ -130,6 +180,25 @@ namespace ofxRulr {
 					inspector->add(new Widgets::Title("Universe " + ofToString(i)));
 					inspector->add(new Widgets::Toggle(this->universes[i]->blackoutEnabled));
 				}
+
+				inspector->add(new Widgets::Title("Output statistics", Widgets::Title::Level::H3));
+				inspector->add(new Widgets::LiveValue<float>("Output rate [Hz]", [this]() {
+					return this->outputRates.ticksPerSecond;
+				}));
+				inspector->add(new Widgets::LiveValue<float>("Universes sent / s", [this]() {
+					return this->outputRates.sentPerSecond;
+				}));
+				inspector->add(new Widgets::LiveValue<float>("Universes skipped / s", [this]() {
+					return this->outputRates.skippedPerSecond;
+				}));
+				inspector->add(new Widgets::LiveValue<float>("Bytes sent / s", [this]() {
+					return this->outputRates.sentPerSecond * 512.0f;
+				}));
+				inspector->add(new Widgets::Title("Output jitter", Widgets::Title::Level::H3));
+				inspector->add(this->outputStatistics.jitter.makeView());
+				inspector->add(new Widgets::Button("Clear statistics", [this]() {
+					this->outputStatistics.jitter.clear();
+				}));
 			}
 
 			//----------
@@ -154,13 +223,38 @@ namespace ofxRulr {
 			}
 
 			//----------
-			void Transmit::setUniverseCount(UniverseIndex universeCount) {
-				if (this->universes.size() > universeCount) {
-					this->universes.resize(universeCount);
+			const vector<Fixture *> & Transmit::getFixtures() const {
+				return this->fixtures;
+			}
+
+			//----------
+			void Transmit::addFixture(Fixture * fixture) {
+				if (find(this->fixtures.begin(), this->fixtures.end(), fixture) == this->fixtures.end()) {
+					this->fixtures.push_back(fixture);
 				}
-				else {
-					while (universeCount > this->universes.size()) {
-						this->universes.push_back(make_shared<Universe>());
+			}
+
+			//----------
+			void Transmit::removeFixture(Fixture * fixture) {
+				this->fixtures.erase(remove(this->fixtures.begin(), this->fixtures.end(), fixture), this->fixtures.end());
+			}
+
+			//----------
+			chrono::microseconds Transmit::getOutputPeriod() const {
+				return chrono::microseconds(this->outputPeriod.load());
+			}
+
+			//----------
+			void Transmit::setUniverseCount(UniverseIndex universeCount) {
+				{
+					lock_guard<mutex> lock(this->outputMutex);
+					if (this->universes.size() > universeCount) {
+						this->universes.resize(universeCount);
+					}
+					else {
+						while (universeCount > this->universes.size()) {
+							this->universes.push_back(make_shared<Universe>());
+						}
 					}
 				}
 
@@ -183,6 +277,74 @@ namespace ofxRulr {
 					this->view->add(preview);
 				}
 			}
+
+			//----------
+			void Transmit::stopOutputThread() {
+				if (this->outputThread.joinable()) {
+					this->outputThreadRunning = false;
+					this->outputThread.join();
+				}
+			}
+
+			//----------
+			void Transmit::outputThreadFunction() {
+				auto nextTick = chrono::high_resolution_clock::now();
+
+				while (this->outputThreadRunning) {
+					//schedule against the ideal tick times (not the time we woke), so that the rate doesn't drift
+					const auto period = chrono::microseconds(this->outputPeriod.load());
+					nextTick += period;
+					auto now = chrono::high_resolution_clock::now();
+					if (now - nextTick > period) {
+						//we've fallen behind (e.g. a slow send), so start again rather than sending a burst to catch up
+						nextTick = now;
+					}
+					this_thread::sleep_until(nextTick);
+
+					now = chrono::high_resolution_clock::now();
+					this->outputStatistics.jitter.add(now - nextTick);
+					this->outputStatistics.tickCount++;
+
+					const auto resendInterval = chrono::microseconds(this->resendInterval.load());
+					const bool sendChangesOnly = this->sendChangesOnly;
+
+					lock_guard<mutex> lock(this->outputMutex);
+					for (size_t i = 0; i < this->universes.size(); i++) {
+						auto & universe = *this->universes[i];
+
+						auto fresh = universe.outputBuffer.fetch();
+						if (fresh) {
+							universe.published = true;
+						}
+						else if (!universe.published) {
+							//nothing to send yet
+							continue;
+						}
+
+						const auto & frame = universe.outputBuffer.getReadBuffer();
+						auto changed = fresh && frame != universe.lastSent;
+						auto due = now - universe.lastSendTime >= resendInterval;
+
+						if (changed || due || !sendChangesOnly) {
+							try {
+								this->sendUniverse((UniverseIndex) i, frame.data());
+							}
+							RULR_CATCH_ALL_TO_ERROR;
+							universe.lastSent = frame;
+							universe.lastSendTime = now;
+							this->outputStatistics.sentCount++;
+						}
+						else {
+							this->outputStatistics.skippedCount++;
+						}
+					}
+
+					try {
+						this->flushOutput();
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+				}
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -1,15 +1,32 @@
 #pragma once
 
 #include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Utils/TripleBuffer.h"
+#include "ofxRulr/Utils/LatencyHistogram.h"
 #include "ofxCvGui/Panels/Scroll.h"
 
 #include "Base.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 namespace ofxRulr {
 	namespace Nodes {
 		namespace DMX {
+			class Fixture;
+
+			///Universes are written by nodes during update, and published once per frame to an output thread which sends
+			/// them at the refresh rate (independent of the app's frame rate). Universes which haven't changed are only
+			/// resent at the resend interval (unless 'Send changes only' is off).
+			///Subclasses implement sendUniverse (which is called on the output thread), and must call stopOutputThread()
+			/// in their destructor.
 			class Transmit : public DMX::Base {
 			public:
+				typedef array<Value, 513> Frame; // 0th channel is unused
+
 				class Universe {
 				public:
 					Universe();
@@ -20,12 +37,24 @@ namespace ofxRulr {
 					void clearChannels();
 					ofParameter<bool> blackoutEnabled;
 				protected:
+					friend Transmit;
+
+					///Hand the current values to the output thread
+					void publish();
+
 					Value values[513]; // 0th channel is unused
 					ofTexture preview;
 					bool previewDirty;
+
+					//output
+					Utils::TripleBuffer<Frame> outputBuffer;
+					bool published = false; // only the output thread's copy
+					Frame lastSent{};
+					chrono::high_resolution_clock::time_point lastSendTime;
 				};
 
 				Transmit();
+				virtual ~Transmit();
 				void init();
 				void update();
 				virtual string getTypeName() const override;
@@ -38,14 +67,65 @@ namespace ofxRulr {
 				UniverseIndex getUniverseCount() const;
 				const vector<shared_ptr<Universe>> & getUniverses() const;
 				shared_ptr<Universe> getUniverse(UniverseIndex universeIndex) const;
+
+				///Fixtures which are connected to this transmitter, in the order they were connected
+				const vector<Fixture *> & getFixtures() const;
+				void addFixture(Fixture *);
+				void removeFixture(Fixture *);
+
+				///The time between universes being sent
+				chrono::microseconds getOutputPeriod() const;
 			protected:
 				void setUniverseCount(UniverseIndex);
-				virtual void sendUniverse(UniverseIndex, shared_ptr<Universe>) { }
+
+				///Called on the output thread whilst outputMutex is locked. channels[1..512] are the DMX channels.
+				virtual void sendUniverse(UniverseIndex, const Value * channels) { }
+
+				///Called on the output thread after the universes of each tick have been sent (e.g. to send a batch of packets)
+				virtual void flushOutput() { }
+
+				void stopOutputThread();
+				void outputThreadFunction();
+
 				shared_ptr<ofxCvGui::Panels::Scroll> view;
 
 				vector<shared_ptr<Universe>> universes;
+				vector<Fixture *> fixtures;
 
 				bool firstFrame;
+
+				struct : ofParameterGroup {
+					ofParameter<float> refreshRate{ "Refresh rate [Hz]", 40, 1, 200 };
+					ofParameter<bool> sendChangesOnly{ "Send changes only", true };
+					ofParameter<float> resendInterval{ "Resend interval [s]", 1.0f, 0.0f, 10.0f };
+					PARAM_DECLARE("Output", refreshRate, sendChangesOnly, resendInterval);
+				} outputParameters;
+
+				//output thread
+				thread outputThread;
+				atomic<bool> outputThreadRunning{ false };
+				mutex outputMutex; // held whilst sending, and whilst the universes or the sender are changed
+				atomic<int64_t> outputPeriod{ 25000 }; // [us]
+				atomic<int64_t> resendInterval{ 1000000 }; // [us]
+				atomic<bool> sendChangesOnly{ true };
+
+				//statistics
+				struct Statistics {
+					atomic<size_t> tickCount{ 0 };
+					atomic<size_t> sentCount{ 0 };
+					atomic<size_t> skippedCount{ 0 };
+					Utils::LatencyHistogram jitter{ chrono::milliseconds(10), 50 };
+				} outputStatistics;
+
+				struct {
+					chrono::high_resolution_clock::time_point time;
+					size_t tickCount = 0;
+					size_t sentCount = 0;
+					size_t skippedCount = 0;
+					float ticksPerSecond = 0.0f;
+					float sentPerSecond = 0.0f;
+					float skippedPerSecond = 0.0f;
+				} outputRates;
 			};
 		}
 	}
@@ -51,16 +51,23 @@ namespace ofxRulr {
 						this->needsRebuild = false;
 					}
 					for (auto it = this->generators.begin(); it != this->generators.end(); ) {
-						if (it->expired()) {
+						auto generator = it->generator.lock();
+						if (!generator) {
 							it = this->generators.erase(it);
 							continue;
 						}
 						else {
-							auto generator = it->lock();
-							const auto address = generator->getAddress();
+							//resolve the address if it (or the hierarchy) has changed since last time
+							const auto & address = generator->getAddress();
+							if (!it->channel
+								|| it->hierarchyVersion != this->rootChannel->getHierarchyVersion()
+								|| it->address != address) {
+								it->channel = &(*this->rootChannel)[address];
+								it->address = address;
+								it->hierarchyVersion = this->rootChannel->getHierarchyVersion();
+							}
 
-							auto & channel = (*this->rootChannel)[address];
-							generator->populateData(channel);
+							generator->populateData(*it->channel);
 
 							it++;
 						}
@@ -72,6 +79,8 @@ namespace ofxRulr {
 					}
 
 					this->onPopulateData(*this->rootChannel);
+
+					this->channelTable.update(this->rootChannel);
 				}
 
 				//----------
@@ -93,6 +102,12 @@ namespace ofxRulr {
 					return this->rootChannel;
 				}
 
+				//----------
+				const Table & Database::getChannelTable() {
+					this->channelTable.update(this->rootChannel);
+					return this->channelTable;
+				}
+
 				//----------
 				void Database::clear() {
 					this->rootChannel->clear();
@@ -100,13 +115,15 @@ namespace ofxRulr {
 
 				//----------
 				void Database::addGenerator(shared_ptr<Nodes::Data::Channels::Generator::Base> provider) {
-					this->generators.push_back(provider);
+					GeneratorBinding generatorBinding;
+					generatorBinding.generator = provider;
+					this->generators.push_back(generatorBinding);
 				}
 
 				//----------
 				void Database::removeGenerator(Nodes::Data::Channels::Generator::Base * provider) {
 					for (auto it = this->generators.begin(); it != this->generators.end(); it++) {
-						auto haystack = it->lock();
+						auto haystack = it->generator.lock();
 						if (haystack.get() == provider) {
 							this->generators.erase(it);
 							break;
@@ -119,7 +136,22 @@ namespace ofxRulr {
 					auto rootBranch = this->treeView->getRootBranch();
 					rootBranch->clear();
 					rootBranch->setCaption(this->rootChannel->getName());
-					this->addGenerationToGui(rootBranch, *this->getRootChannel());
+
+					//parents come before their children in the table, so each branch's parent already exists
+					const auto & entries = this->getChannelTable().getEntries();
+					vector<shared_ptr<Panels::Tree::Branch>> branches;
+					branches.reserve(entries.size());
+					for (const auto & entry : entries) {
+						auto branch = make_shared<Panels::Tree::Branch>();
+						branch->setCaption(entry.channel->getName());
+						this->addBranchToGui(branch, entry.channel);
+
+						auto parentBranch = entry.parentIndex == Table::NoParent
+							? rootBranch
+							: branches[entry.parentIndex];
+						parentBranch->addBranch(branch);
+						branches.push_back(branch);
+					}
 
 					//check if we lost the active channel
 					if (!this->selectedChannel.lock()) {
@@ -246,33 +278,24 @@ namespace ofxRulr {
 				}
 
 				//----------
-				void Database::addGenerationToGui(shared_ptr<Panels::Tree::Branch> guiBranch, const Channel & channel) {
-					const auto & subChannels = channel.getSubChannels();
-					for (const auto & subChannel : subChannels) {
-						auto subBranch = make_shared<Panels::Tree::Branch>();
-						subBranch->setCaption(subChannel.second->getName());
-						this->addGenerationToGui(subBranch, *subChannel.second);
-						guiBranch->addBranch(subBranch);
-
-						weak_ptr<Channel> weakChannel = subChannel.second;
-						subBranch->onMouseReleased += [this, weakChannel](MouseArguments & args) {
-							this->selectChannel(weakChannel);
-						};
-
-						subBranch->onDraw.addListener([this, weakChannel](DrawArguments & args) {
-							auto selectedChannel = this->selectedChannel.lock();
-							auto thisChannel = weakChannel.lock();
-							auto isSelected = thisChannel == selectedChannel;
-							ofPushStyle();
-							{
-								ofFill();
-								ofSetLineWidth(0);
-								ofSetColor(isSelected ? 100 : 50, 100);
-								ofDrawRectangle(args.localBounds);
-							}
-							ofPopStyle();
-						}, this, -100);
-					}
+				void Database::addBranchToGui(shared_ptr<Panels::Tree::Branch> branch, weak_ptr<Channel> weakChannel) {
+					branch->onMouseReleased += [this, weakChannel](MouseArguments & args) {
+						this->selectChannel(weakChannel);
+					};
+
+					branch->onDraw.addListener([this, weakChannel](DrawArguments & args) {
+						auto selectedChannel = this->selectedChannel.lock();
+						auto thisChannel = weakChannel.lock();
+						auto isSelected = thisChannel == selectedChannel;
+						ofPushStyle();
+						{
+							ofFill();
+							ofSetLineWidth(0);
+							ofSetColor(isSelected ? 100 : 50, 100);
+							ofDrawRectangle(args.localBounds);
+						}
+						ofPopStyle();
+					}, this, -100);
 				}
 
 				//----------
@@ -2,6 +2,7 @@
 
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Data/Channels/Channel.h"
+#include "ofxRulr/Data/Channels/Table.h"
 
 #include "ofxCvGui/Panels/Tree.h"
 #include "ofxCvGui/Panels/Widgets.h"
@@ -29,6 +30,9 @@ namespace ofxRulr {
 					ofxCvGui::PanelPtr getPanel();
 
 					shared_ptr<Channel> getRootChannel();
+
+					///Flat list of all channels, brought up to date with the hierarchy when called
+					const Table & getChannelTable();
 					void clear();
 
 					void addGenerator(shared_ptr<Nodes::Data::Channels::Generator::Base>);
@@ -38,9 +42,17 @@ namespace ofxRulr {
 				protected:
 					void rebuildTree();
 					void rebuildDetailView();
-					void addGenerationToGui(shared_ptr<ofxCvGui::Panels::Tree::Branch>, const Channel &);
+					void addBranchToGui(shared_ptr<ofxCvGui::Panels::Tree::Branch>, weak_ptr<Channel>);
 					void selectChannel(weak_ptr<Channel>);
 
+					///A generator's address is resolved to its channel once, and again only when the hierarchy changes
+					struct GeneratorBinding {
+						weak_ptr<Nodes::Data::Channels::Generator::Base> generator;
+						Address address;
+						Channel * channel = nullptr;
+						uint64_t hierarchyVersion = 0;
+					};
+
 					struct : ofParameterGroup {
 						ofParameter<bool> collapseByDefault{ "Collapse by default", false };
 						PARAM_DECLARE("Database", collapseByDefault);
@@ -54,7 +66,8 @@ namespace ofxRulr {
 
 					bool needsRebuild = true;
 
-					vector<weak_ptr<Nodes::Data::Channels::Generator::Base>> generators;
+					vector<GeneratorBinding> generators;
+					Table channelTable;
 
 					weak_ptr<Channel> selectedChannel;
 
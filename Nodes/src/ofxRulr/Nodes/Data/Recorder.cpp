@@ -10,6 +10,10 @@
 
 #include "ofAppRunner.h"
 
+#include "ofxRulr/Utils/ThreadPool.h"
+
+#include "Poco/File.h"
+
 using namespace ofxCvGui;
 using namespace std::chrono;
 
@@ -62,6 +66,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			Recorder::~Recorder() {
+				this->close();
+			}
+
 			//----------
 			string Recorder::getTypeName() const {
 				return "Recorder";
@@ -95,7 +104,7 @@ namespace ofxRulr {
 				this->trackView->setBounds(ofRectangle(0, 0, 100, 70));
 				this->trackView->onDraw += [this](DrawArguments & args) {
 					ofDrawBitmapString(this->getName(), 10, 20);
-					ofDrawBitmapString("Frame count : " + ofToString(this->frames.size()), 10, 30);
+					ofDrawBitmapString("Frame count : " + ofToString(this->getFrameCount()), 10, 30);
 					ofDrawBitmapString("Duration : " + Recorder::formatTime(this->getDuration()), 10, 40);
 					ofDrawBitmapString("First frame : " + Recorder::formatTime(this->getFirstFrameTime()), 10, 50);
 					ofDrawBitmapString("Playback head : " + Recorder::formatTime(this->getPlaybackHeadPosition()), 10, 60);
@@ -161,26 +170,62 @@ namespace ofxRulr {
 
 			//----------
 			void Recorder::serialize(Json::Value & json) {
-				auto & jsonFrames = json["frames"];
-				for (auto frame : this->frames) {
-					frame.second->serialize(jsonFrames[ofToString(frame.first.count())]);
+				if (!this->frameLog.isOpen() || this->frameLog.empty()) {
+					return;
+				}
+
+				//keep the log next to the project file (copying it there if it's elsewhere)
+				auto sidecarFilename = Utils::Serializable::makeSidecarFilename("rulrlog");
+				if (sidecarFilename.empty()) {
+					this->frameLog.flush();
+					json["frameLog"] = this->frameLog.getFilename();
+					return;
 				}
+
+				//the log is appended in place by its writer thread, so it's only copied when it moves (e.g. the first time
+				// it's saved, or when the node is renamed). The json only names the log, so we don't wait for its writes.
+				if (ofFilePath::getAbsolutePath(sidecarFilename, false) != ofFilePath::getAbsolutePath(this->frameLog.getFilename(), false)) {
+					this->clearDecodedChunks();
+					auto previousFilename = this->frameLog.getFilename();
+					this->frameLog.copyTo(sidecarFilename);
+					this->frameLog.open(sidecarFilename);
+					if (this->frameLogIsWorkingFile) {
+						Poco::File(previousFilename).remove();
+						this->frameLogIsWorkingFile = false;
+					}
+				}
+				json["frameLog"] = ofFilePath::getFileName(sidecarFilename);
 			}
 
 			//----------
 			void Recorder::deserialize(const Json::Value & json) {
-				this->clear();
-				const auto & jsonFrames = json["frames"];
-				for (auto frameTimeString : jsonFrames.getMemberNames()) {
+				this->stop();
+				this->clearDecodedChunks();
+				this->frameLog.close();
+				this->frameLogIsWorkingFile = false;
+
+				if (json["frameLog"].isString()) {
 					try {
-						auto frameTime = ofToInt64(frameTimeString);
-						auto frame = this->deserializeFrame(jsonFrames[frameTimeString]);
-						if (!frame) {
-							throw(ofxRulr::Exception("Couldn't load frame [" + frameTimeString + "]"));
+						this->frameLog.open(Utils::Serializable::getSidecarPath(json["frameLog"].asString()));
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+				}
+				else if (json["frames"].isObject()) {
+					//frames from older versions are stored in the json, move them into a log
+					const auto & jsonFrames = json["frames"];
+					map<chrono::microseconds, string> frames;
+					Json::FastWriter writer;
+					for (const auto & frameTimeString : jsonFrames.getMemberNames()) {
+						auto frameTime = chrono::microseconds(ofToInt64(frameTimeString));
+						frames[frameTime] = writer.write(jsonFrames[frameTimeString]);
+					}
+
+					try {
+						this->openFrameLog();
+						for (auto & frame : frames) {
+							this->frameLog.append(frame.first, move(frame.second));
 						}
-						auto frameTimeMicroseconds = chrono::microseconds(frameTime);
-						auto frameInserter = FrameInserter(frameTimeMicroseconds, frame);
-						this->frames.insert(frameInserter);
+						this->frameLog.flush();
 					}
 					RULR_CATCH_ALL_TO_ERROR;
 				}
@@ -190,6 +235,12 @@ namespace ofxRulr {
 			void Recorder::populateInspector(ofxCvGui::InspectArguments & inspectArguments) {
 				auto inspector = inspectArguments.inspector;
 				
+				inspector->addLiveValue<string>("Frame log errors", [this]() {
+					auto writeError = this->frameLog.getWriteError();
+					return writeError.empty()
+						? string("None")
+						: ofToString(this->frameLog.getDroppedFrameCount()) + " frames dropped : " + writeError;
+				});
 				inspector->add(new Widgets::Toggle(this->loopPlayback));
 				inspector->add(new Widgets::Button("Erase blank before first frame", [this]() {
 					try {
@@ -213,21 +264,34 @@ namespace ofxRulr {
 
 			//----------
 			void Recorder::record() {
-				if (this->frames.empty()) {
+				try {
+					this->openFrameLog();
+				}
+				RULR_CATCH_ALL_TO_ALERT;
+				if (!this->frameLog.isOpen()) {
+					return;
+				}
+
+				this->clearDecodedChunks();
+				if (this->frameLog.empty()) {
 					this->recordStartTrackTime = Recorder::getAppTime();
 				}
 				else {
-					auto lastFrame = this->frames.end();
-					lastFrame--;
-					this->recordStartTrackTime = lastFrame->first;
+					this->recordStartTrackTime = this->frameLog.getLastTime();
 				}
+				this->recordStartAppTime = Recorder::getAppTime();
 				this->state = State::Recording;
 				this->paused = false;
 			}
 
 			//----------
 			void Recorder::play() {
-				if (!this->frames.empty()) {
+				if (!this->empty()) {
+					//make sure everything we've recorded can be read
+					try {
+						this->frameLog.flush();
+					}
+					RULR_CATCH_ALL_TO_ERROR;
 					this->state = State::Playing;
 				}
 				else {
@@ -238,6 +302,12 @@ namespace ofxRulr {
 
 			//----------
 			void Recorder::stop() {
+				if (this->state == State::Recording) {
+					try {
+						this->frameLog.flush();
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+				}
 				this->state = State::Stopped;
 				this->playHeadPosition = chrono::microseconds(0);
 				this->paused = false;
@@ -252,7 +322,13 @@ namespace ofxRulr {
 
 			//----------
 			void Recorder::clear() {
-				this->frames.clear();
+				this->clearDecodedChunks();
+				if (this->frameLog.isOpen()) {
+					try {
+						this->frameLog.clear();
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+				}
 			}
 
 			//----------
@@ -262,9 +338,25 @@ namespace ofxRulr {
 
 			//----------
 			shared_ptr<Recorder::AbstractFrame> Recorder::getFrameAtTime(const microseconds & time) const {
-				auto findFrame = this->frames.lower_bound(time);
-				if (findFrame != this->frames.end()) {
-					return findFrame->second;
+				if (!this->frameLog.isOpen()) {
+					return shared_ptr<Recorder::AbstractFrame>();
+				}
+
+				//find the first frame at or after this time : first the chunk, then the frame within it
+				auto chunkIndex = this->frameLog.findChunk(time);
+				if (chunkIndex >= this->frameLog.getChunkCount()) {
+					return shared_ptr<Recorder::AbstractFrame>();
+				}
+
+				auto decodedChunk = this->getDecodedChunk(chunkIndex);
+				this->prefetchChunk(chunkIndex + 1);
+				if (!decodedChunk) {
+					return shared_ptr<Recorder::AbstractFrame>();
+				}
+
+				auto findFrame = lower_bound(decodedChunk->times.begin(), decodedChunk->times.end(), time);
+				if (findFrame != decodedChunk->times.end()) {
+					return decodedChunk->frames[findFrame - decodedChunk->times.begin()];
 				}
 				else {
 					return shared_ptr<Recorder::AbstractFrame>();
@@ -283,36 +375,23 @@ namespace ofxRulr {
 
 			//----------
 			size_t Recorder::getFrameCount() const {
-				return this->frames.size();
+				return this->frameLog.isOpen() ? this->frameLog.getFrameCount() : 0;
 			}
 
 			//----------
 			bool Recorder::empty() const {
-				return this->frames.empty();
+				return this->getFrameCount() == 0;
 			}
 
 			//----------
 			microseconds Recorder::getFirstFrameTime() const {
-				if (this->frames.empty()) {
-					// we return start and end as being at 0 in this case
-					return chrono::microseconds(0);
-				}
-				else {
-					return this->frames.begin()->first;
-				}
+				// we return start and end as being at 0 if there are no frames
+				return this->frameLog.isOpen() ? this->frameLog.getFirstTime() : chrono::microseconds(0);
 			}
 
 			//----------
 			microseconds Recorder::getLastFrameTime() const {
-				if (this->frames.empty()) {
-					// we return start and end as being at 0 in this case
-					return chrono::microseconds(0);
-				}
-				else {
-					auto lastFrame = this->frames.end();
-					lastFrame--;
-					return lastFrame->first;
-				}
+				return this->frameLog.isOpen() ? this->frameLog.getLastTime() : chrono::microseconds(0);
 			}
 
 			//----------
@@ -322,23 +401,23 @@ namespace ofxRulr {
 
 			//----------
 			void Recorder::erase(chrono::microseconds start, chrono::microseconds end) {
-				//delete all frames with timestamp >= start && timestamp < end
-				{
-					auto startIt = this->frames.lower_bound(start);
-					auto endIt = this->frames.lower_bound(end); //stop when = to end
-					this->frames.erase(startIt, endIt);
+				if (!this->frameLog.isOpen()) {
+					return;
 				}
-				
-				//also move the timestamp of all frames after end back by (end - start)
-				{
-					auto eraseDuration = end - start;
-					auto it = this->frames.lower_bound(end);
-					while (it != this->frames.end()) {
-						auto newTimestamp = it->first - eraseDuration;
-						swap(this->frames[newTimestamp], it->second);
-						this->frames.erase(it++);
+
+				//delete all frames with timestamp >= start && timestamp < end
+				//and move the timestamp of all frames after end back by (end - start)
+				const auto eraseDuration = end - start;
+				this->clearDecodedChunks();
+				this->frameLog.rewrite([&](chrono::microseconds & time) {
+					if (time >= start && time < end) {
+						return false;
 					}
-				}
+					if (time >= end) {
+						time -= eraseDuration;
+					}
+					return true;
+				});
 			}
 
 			//----------
@@ -362,17 +441,16 @@ namespace ofxRulr {
 					errorMessage << "Recorder : Cannot stretch by a factor of " << factor;
 					throw(ofxRulr::Exception(errorMessage.str()));
 				}
-				//completely reallocate frame holders
-				Frames newFrames;
-
-				for (const auto & frame : this->frames) {
-					auto newFrameTimeRaw = (double)frame.first.count() * factor;
-					microseconds newFrameTime((uint64_t)newFrameTimeRaw);
-					auto inserter = FrameInserter(newFrameTime, frame.second);
-					newFrames.insert(inserter);
+				if (!this->frameLog.isOpen()) {
+					return;
 				}
 
-				swap(this->frames, newFrames);
+				this->clearDecodedChunks();
+				this->frameLog.rewrite([factor](chrono::microseconds & time) {
+					auto newFrameTimeRaw = (double)time.count() * factor;
+					time = microseconds((uint64_t)newFrameTimeRaw);
+					return true;
+				});
 			}
 
 #pragma mark protected
@@ -478,9 +556,156 @@ namespace ofxRulr {
 				//if our current frame isn't blank then store it
 				if (this->currentFrame) {
 					auto recordTrackTime = Recorder::getAppTime() - recordStartAppTime + recordStartTrackTime;
-					const auto inserter = FrameInserter(recordTrackTime, this->currentFrame);
-					this->frames.insert(inserter);
+
+					Json::Value json;
+					this->currentFrame->serialize(json);
+					Json::FastWriter writer;
+					this->frameLog.append(recordTrackTime, writer.write(json));
+				}
+			}
+
+			//----------
+			void Recorder::openFrameLog() {
+				if (this->frameLog.isOpen()) {
+					return;
+				}
+
+				//until the project is saved, recordings are written into the recordings folder
+				auto directory = ofToDataPath("Recordings", true);
+				ofDirectory::createDirectory(directory, false, true);
+				auto name = this->getName();
+				ofStringReplace(name, ":", "_");
+				auto filename = ofFilePath::join(directory, name + "-" + ofGetTimestampString("%Y%m%d-%H%M%S-%i") + ".rulrlog");
+				this->frameLog.open(filename);
+				this->frameLogIsWorkingFile = true;
+			}
+
+			//----------
+			shared_ptr<const Recorder::DecodedChunk> Recorder::getDecodedChunk(size_t chunkIndex) const {
+				uint64_t generation;
+				{
+					lock_guard<mutex> lock(this->decodedChunksMutex);
+					auto findChunk = this->decodedChunks.find(chunkIndex);
+					if (findChunk != this->decodedChunks.end()) {
+						return findChunk->second;
+					}
+					generation = this->decodedChunksGeneration;
+				}
+
+				//decode on this thread (e.g. after seeking)
+				shared_ptr<DecodedChunk> decodedChunk;
+				try {
+					decodedChunk = this->decodeChunk(chunkIndex);
+				}
+				RULR_CATCH_ALL_TO_ERROR;
+
+				lock_guard<mutex> lock(this->decodedChunksMutex);
+				if (decodedChunk && generation == this->decodedChunksGeneration) {
+					this->decodedChunks[chunkIndex] = decodedChunk;
+
+					//only keep chunks near this one, so memory use doesn't depend on the length of the recording
+					const size_t maxDistance = 2;
+					for (auto it = this->decodedChunks.begin(); it != this->decodedChunks.end(); ) {
+						auto distance = it->first > chunkIndex ? it->first - chunkIndex : chunkIndex - it->first;
+						if (distance > maxDistance) {
+							it = this->decodedChunks.erase(it);
+						}
+						else {
+							it++;
+						}
+					}
+				}
+				return decodedChunk;
+			}
+
+			//----------
+			shared_ptr<Recorder::DecodedChunk> Recorder::decodeChunk(size_t chunkIndex) const {
+				vector<chrono::microseconds> times;
+				vector<string> payloads;
+				this->frameLog.readChunk(chunkIndex, times, payloads);
+
+				auto decodedChunk = make_shared<DecodedChunk>();
+				decodedChunk->times = move(times);
+				decodedChunk->frames.resize(payloads.size());
+
+				Json::Reader reader;
+				for (size_t i = 0; i < payloads.size(); i++) {
+					Json::Value json;
+					if (!reader.parse(payloads[i], json)) {
+						throw(ofxRulr::Exception("Couldn't parse recorded frame at " + Recorder::formatTime(decodedChunk->times[i])));
+					}
+					decodedChunk->frames[i] = this->deserializeFrame(json);
+				}
+				return decodedChunk;
+			}
+
+			//----------
+			void Recorder::close() {
+				this->closed = true;
+
+				//prefetches run on the shared thread pool, so wait for any which still reference us
+				while (this->prefetchCount.load() > 0) {
+					this_thread::sleep_for(chrono::milliseconds(1));
+				}
+			}
+
+			//----------
+			void Recorder::prefetchChunk(size_t chunkIndex) const {
+				if (chunkIndex >= this->frameLog.getChunkCount()) {
+					return;
+				}
+
+				uint64_t generation;
+				{
+					lock_guard<mutex> lock(this->decodedChunksMutex);
+					if (this->decodedChunks.find(chunkIndex) != this->decodedChunks.end()
+						|| this->prefetchingChunks.find(chunkIndex) != this->prefetchingChunks.end()) {
+						return;
+					}
+					this->prefetchingChunks.insert(chunkIndex);
+					generation = this->decodedChunksGeneration;
 				}
+
+				//count the prefetch before checking closed, so that close() either stops it here or waits for it
+				this->prefetchCount++;
+				if (this->closed) {
+					lock_guard<mutex> lock(this->decodedChunksMutex);
+					this->prefetchingChunks.erase(chunkIndex);
+					this->prefetchCount--;
+					return;
+				}
+
+				auto action = [this, chunkIndex, generation]() {
+					shared_ptr<DecodedChunk> decodedChunk;
+					if (!this->closed) {
+						try {
+							decodedChunk = this->decodeChunk(chunkIndex);
+						}
+						RULR_CATCH_ALL_TO_ERROR;
+					}
+
+					{
+						lock_guard<mutex> lock(this->decodedChunksMutex);
+						this->prefetchingChunks.erase(chunkIndex);
+						if (decodedChunk && generation == this->decodedChunksGeneration) {
+							this->decodedChunks[chunkIndex] = decodedChunk;
+						}
+					}
+					this->prefetchCount--;
+				};
+				if (!Utils::ThreadPool::X().performAsync(action, Utils::ThreadPool::Priority::Batch)) {
+					lock_guard<mutex> lock(this->decodedChunksMutex);
+					this->prefetchingChunks.erase(chunkIndex);
+					this->prefetchCount--;
+				}
+			}
+
+			//----------
+			void Recorder::clearDecodedChunks() {
+				lock_guard<mutex> lock(this->decodedChunksMutex);
+				this->decodedChunks.clear();
+				this->prefetchingChunks.clear();
+				this->decodedChunksGeneration++;
 			}
 		}
 	}
@@ -2,9 +2,11 @@
 
 #include "ofxRulr/Utils/Serializable.h"
 #include "ofxRulr/Nodes/Base.h"
+#include "ofxRulr/Utils/FrameLog.h"
 
 #include "ofxCvGui/Panels/Scroll.h"
 
+#include <atomic>
 #include <chrono>
 
 namespace ofxRulr {
@@ -17,6 +19,9 @@ namespace ofxRulr {
 			* Implement getNewSourceFrame()
 			* Implement deserializeFrame(const Json::Value &)
 			* Probably inherit another class which provides data of your type to output the recording
+			Frames are kept on disk in a FrameLog (next to the project file once saved), and are decoded a chunk
+			at a time around the play head. deserializeFrame may be called from a worker thread, so if you override it
+			then call close() from your destructor.
 			**/
 			class Recorder : virtual public ofxRulr::Nodes::Base {
 			public:
@@ -36,6 +41,7 @@ namespace ofxRulr {
 				static string formatTime(const chrono::microseconds &);
 
 				Recorder();
+				virtual ~Recorder();
 				virtual string getTypeName() const override;
 				void init();
 				void update();
@@ -89,8 +95,24 @@ namespace ofxRulr {
 
 				void recordFrame();
 
+				///Opens a log in the recordings folder if we don't have one yet
+				void openFrameLog();
+
+				///Stops prefetching and waits for any prefetches in flight (which call deserializeFrame on worker threads)
+				void close();
+
+				struct DecodedChunk {
+					vector<chrono::microseconds> times;
+					vector<shared_ptr<AbstractFrame>> frames;
+				};
+				shared_ptr<const DecodedChunk> getDecodedChunk(size_t chunkIndex) const;
+				shared_ptr<DecodedChunk> decodeChunk(size_t chunkIndex) const;
+				void prefetchChunk(size_t chunkIndex) const;
+				void clearDecodedChunks();
+
 				State state;
-				Frames frames;
+				Utils::FrameLog frameLog;
+				bool frameLogIsWorkingFile = false; // i.e. it's in the recordings folder rather than next to the project
 				chrono::microseconds recordStartAppTime;
 				chrono::microseconds recordStartTrackTime;
 				bool paused;
@@ -102,6 +124,14 @@ namespace ofxRulr {
 				shared_ptr<AbstractFrame> currentFrame;
 				set<Recorder *> slaves;
 
+				//decoded chunks around the play head
+				mutable map<size_t, shared_ptr<const DecodedChunk>> decodedChunks;
+				mutable set<size_t> prefetchingChunks;
+				mutable uint64_t decodedChunksGeneration = 0; // incremented when the log changes so that old prefetches are ignored
+				mutable mutex decodedChunksMutex;
+				mutable atomic<size_t> prefetchCount{ 0 };
+				atomic<bool> closed{ false };
+
 				shared_ptr<ofxCvGui::Panels::Scroll> view;
 				ofxCvGui::ElementPtr trackView;
 			};
@@ -116,6 +146,10 @@ namespace ofxRulr {
 			template<typename DataType>
 			class StructRecorder : public Recorder {
 			public:
+				virtual ~StructRecorder() {
+					this->close();
+				}
+
 				class Frame : public AbstractFrame {
 				public:
 					///----------
@@ -11,8 +11,10 @@
 #include "ofxRulr/Nodes/Data/Mesh.h"
 #include "ofxRulr/Nodes/Data/Recorder.h"
 
+#include "ofxRulr/Nodes/DMX/NetworkTransmit.h"
 #include "ofxRulr/Nodes/DMX/Sharpy.h"
 #include "ofxRulr/Nodes/DMX/AimMovingHeadAt.h"
+#include "ofxRulr/Nodes/DMX/AimMovingHeads.h"
 
 #include "ofxRulr/Nodes/Item/Board.h"
 #include "ofxRulr/Nodes/Item/Camera.h"
@@ -61,8 +63,10 @@ namespace ofxRulr {
 			RULR_DECLARE_NODE(Data::Mesh);
 			RULR_DECLARE_NODE(Data::Recorder);
 
+			RULR_DECLARE_NODE(DMX::NetworkTransmit);
 			RULR_DECLARE_NODE(DMX::Sharpy);
 			RULR_DECLARE_NODE(DMX::AimMovingHeadAt);
+			RULR_DECLARE_NODE(DMX::AimMovingHeads);
 
 			RULR_DECLARE_NODE(Item::Board);
 			RULR_DECLARE_NODE(Item::Camera);
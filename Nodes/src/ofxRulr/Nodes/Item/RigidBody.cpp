@@ -282,6 +282,11 @@ namespace ofxRulr {
 
 			//---------
 			void RigidBody::setTransform(const ofMatrix4x4 & transform) {
+				this->setTransform(transform, chrono::high_resolution_clock::now());
+			}
+
+			//---------
+			void RigidBody::setTransform(const ofMatrix4x4 & transform, const chrono::high_resolution_clock::time_point & measurementTime) {
 				auto translation = ((ofVec4f*)&transform)[3]; //last row is translation. rip it out;
 
 				//first 3x3 is rotation, rip it out and convert it
@@ -297,6 +302,7 @@ namespace ofxRulr {
 					this->translation[i] = translation[i];
 					this->rotationEuler[i] = rotationEuler[i];
 				}
+				this->transformTime = measurementTime;
 
 				this->onTransformChange.notifyListeners();
 			}
@@ -306,6 +312,7 @@ namespace ofxRulr {
 				for (int i = 0; i < 3; i++) {
 					this->translation[i] = position[i];
 				}
+				this->transformTime = chrono::high_resolution_clock::now();
 				this->onTransformChange.notifyListeners();
 			}
 
@@ -314,6 +321,7 @@ namespace ofxRulr {
 				for (int i = 0; i < 3; i++) {
 					this->rotationEuler[i] = rotationEuler[i];
 				}
+				this->transformTime = chrono::high_resolution_clock::now();
 				this->onTransformChange.notifyListeners();
 			}
 
@@ -344,9 +352,15 @@ namespace ofxRulr {
 					this->translation[i] = 0.0f;
 					this->rotationEuler[i] = 0.0f;
 				}
+				this->transformTime = chrono::high_resolution_clock::now();
 				this->onTransformChange.notifyListeners();
 			}
 
+			//----------
+			chrono::high_resolution_clock::time_point RigidBody::getTransformTime() const {
+				return this->transformTime;
+			}
+
 			//----------
 			void RigidBody::exportRigidBodyMatrix() {
 				const auto matrix = this->getTransform();
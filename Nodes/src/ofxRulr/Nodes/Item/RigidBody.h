@@ -28,12 +28,17 @@ namespace ofxRulr {
 				ofVec3f getRotationEuler() const;
 
 				void setTransform(const ofMatrix4x4 &);
+				///measurementTime is when the transform was true (e.g. when the tracking camera's frame arrived)
+				void setTransform(const ofMatrix4x4 &, const chrono::high_resolution_clock::time_point & measurementTime);
 				void setPosition(const ofVec3f &);
 				void setRotationEuler(const ofVec3f &);
 				void setExtrinsics(cv::Mat rotationVector, cv::Mat translation, bool inverse = false);
 				void getExtrinsics(cv::Mat & rotationVector, cv::Mat & translation, bool inverse = false);
 				void clearTransform();
 
+				///When the current transform was measured (for latency compensation). Transforms set without a time are stamped with the time they were set.
+				chrono::high_resolution_clock::time_point getTransformTime() const;
+
 				ofxLiquidEvent<void> onDrawObject;
 				ofxLiquidEvent<void> onTransformChange;
 			protected:
@@ -42,6 +47,8 @@ namespace ofxRulr {
 				ofParameter<float> translation[3];
 				ofParameter<float> rotationEuler[3];
 				ofParameter<float> movementSpeed{ "Movement speed [m/s]", 0.1, 0, 10 };
+
+				chrono::high_resolution_clock::time_point transformTime = chrono::high_resolution_clock::now();
 			private:
 			};
 
@@ -242,10 +242,14 @@ namespace ofxRulr {
 						this->currentCorners.clear();
 						this->currentObjectPoints.clear();
 
-						if (!board->findBoard(toCv(this->grayscalePreview)
+						Utils::BoardFinder::Settings boardFinderSettings;
+						boardFinderSettings.findBoardMode = this->parameters.capture.findBoardMode.get();
+						boardFinderSettings.detectionWidth = 0; // a single capture, so search at full resolution
+						if (!this->boardFinder.find(*board
+							, toCv(this->grayscalePreview)
 							, toCv(this->currentCorners)
 							, toCv(this->currentObjectPoints)
-							, this->parameters.capture.findBoardMode.get()
+							, boardFinderSettings
 							, camera->getCameraMatrix()
 							, camera->getDistortionCoefficients())) {
 							throw(Exception("Board not found in image"));
@@ -4,6 +4,7 @@
 #include "ofxCvMin.h"
 
 #include "ofxRulr/Nodes/Item/AbstractBoard.h"
+#include "ofxRulr/Utils/BoardFinder.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -35,6 +36,7 @@ namespace ofxRulr {
 
 					vector<ofVec2f> currentCorners;
 					vector<ofVec3f> currentObjectPoints;
+					Utils::BoardFinder boardFinder;
 
 					struct : ofParameterGroup {
 						struct : ofParameterGroup {
@@ -57,8 +57,8 @@ namespace ofxRulr {
 					json << this->extrsinsics;
 					json << this->reprojectionError;
 
-					json["pointsImageSpace"] << this->pointsImageSpace;
-					json["pointsObjectSpace"] << this->pointsObjectSpace;
+					Utils::CaptureStore::serialize(json, "pointsImageSpace", this->pointsImageSpace);
+					Utils::CaptureStore::serialize(json, "pointsObjectSpace", this->pointsObjectSpace);
 				}
 
 				//----------
@@ -68,8 +68,8 @@ namespace ofxRulr {
 					json >> this->extrsinsics;
 					json >> this->reprojectionError;
 
-					json["pointsImageSpace"] >> this->pointsImageSpace;
-					json["pointsObjectSpace"] >> this->pointsObjectSpace;
+					Utils::CaptureStore::deserialize(json, "pointsImageSpace", this->pointsImageSpace);
+					Utils::CaptureStore::deserialize(json, "pointsObjectSpace", this->pointsObjectSpace);
 				}
 
 #pragma mark CameraIntrinsics
@@ -143,20 +143,30 @@ namespace ofxRulr {
 							if (grabber->isFrameNew()) {
 								if (this->parameters.capture.checkAllIncomingFrames) {
 									try {
-										this->findBoard();
+										this->findBoardAsync();
+									}
+									RULR_CATCH_ALL_TO_ERROR;
+								}
+							}
 
-										//we need at least 4 found points for calibrateCamera to be happy to use this board find
-										if (!this->currentImagePoints.size() >= 4) {
-											this->isFrameNew = true;
-										}
-										if (this->isFrameNew
-											&& this->parameters.capture.tetheredShootEnabled
-											&& !grabber->getDeviceSpecification().supports(ofxMachineVision::CaptureSequenceType::Continuous)
-											&& grabber->getDeviceSpecification().supports(ofxMachineVision::CaptureSequenceType::OneShot)) {
-											Utils::ScopedProcess scopedProcessTethered("Tethered shoot find board");
-											this->addCapture(true);
-											scopedProcessTethered.end();
-										}
+							//collect the result of the search (which may be from an earlier frame)
+							Utils::BoardFinder::Result result;
+							if (this->boardFinder.getResult(result)) {
+								this->currentImagePoints = toOf(result.imagePoints);
+								this->currentObjectPoints = toOf(result.objectPoints);
+
+								//we need at least 4 found points for calibrateCamera to be happy to use this board find
+								if (this->currentImagePoints.size() >= 4) {
+									this->isFrameNew = true;
+								}
+								if (this->isFrameNew
+									&& this->parameters.capture.tetheredShootEnabled
+									&& !grabber->getDeviceSpecification().supports(ofxMachineVision::CaptureSequenceType::Continuous)
+									&& grabber->getDeviceSpecification().supports(ofxMachineVision::CaptureSequenceType::OneShot)) {
+									try {
+										Utils::ScopedProcess scopedProcessTethered("Tethered shoot find board");
+										this->addCapture(true);
+										scopedProcessTethered.end();
 									}
 									RULR_CATCH_ALL_TO_ERROR;
 								}
@@ -335,13 +345,48 @@ namespace ofxRulr {
 
 					this->currentImagePoints.clear();
 					this->currentObjectPoints.clear();
-					board->findBoard(toCv(pixels)
+					this->boardFinder.find(*board
+						, toCv(pixels)
 						, toCv(this->currentImagePoints)
 						, toCv(this->currentObjectPoints)
-						, this->parameters.capture.findBoardMode
+						, this->getBoardFinderSettings()
 						, camera->getCameraMatrix()
 						, camera->getDistortionCoefficients());
 				}
+
+				//----------
+				void CameraIntrinsics::findBoardAsync() {
+					this->throwIfMissingAnyConnection();
+
+					auto camera = this->getInput<Item::Camera>();
+					auto board = this->getInput<Item::AbstractBoard>();
+
+					auto frame = camera->getGrabber()->getFrame();
+					if (!frame) {
+						throw(Exception("No camera frame available"));
+					}
+					auto & pixels = frame->getPixels();
+					if (!pixels.isAllocated()) {
+						throw(Exception("Camera pixels are not allocated. Perhaps we need to wait for a frame?"));
+					}
+					this->preview.loadData(pixels);
+
+					//if the finder is still busy with an earlier frame then this one replaces any frame waiting behind it
+					this->boardFinder.push(board
+						, toCv(pixels)
+						, this->getBoardFinderSettings()
+						, camera->getCameraMatrix()
+						, camera->getDistortionCoefficients());
+				}
+
+				//----------
+				Utils::BoardFinder::Settings CameraIntrinsics::getBoardFinderSettings() const {
+					Utils::BoardFinder::Settings settings;
+					settings.findBoardMode = this->parameters.capture.findBoardMode.get();
+					settings.detectionWidth = this->parameters.capture.detectionWidth;
+					settings.trackRoi = this->parameters.capture.trackBoard;
+					return settings;
+				}
 				
 				//----------
 				void CameraIntrinsics::calibrate() {
@@ -4,6 +4,7 @@
 #include "ofxCvMin.h"
 #include "ofxRulr/Nodes/Item/Board.h"
 #include "ofxRulr/Utils/CaptureSet.h"
+#include "ofxRulr/Utils/BoardFinder.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -48,12 +49,15 @@ namespace ofxRulr {
 					void populateInspector(ofxCvGui::InspectArguments &);
 					void addCapture(bool triggeredFromTetheredCapture);
 					void findBoard();
+					void findBoardAsync();
+					Utils::BoardFinder::Settings getBoardFinderSettings() const;
 					void calibrate();
 
 					shared_ptr<ofxCvGui::Panels::BaseImage> view;
 					ofTexture preview;
 
 					Utils::CaptureSet<Capture> captures;
+					Utils::BoardFinder boardFinder;
 
 					vector<ofVec2f> currentImagePoints;
 					vector<ofVec3f> currentObjectPoints;
@@ -66,8 +70,10 @@ namespace ofxRulr {
 							ofParameter<bool> checkAllIncomingFrames{ "Check all incoming frames", true };
 							ofParameter<bool> tetheredShootEnabled{ "Tethered shoot enabled", true };
 							ofParameter<FindBoardMode> findBoardMode{ "Mode", FindBoardMode::Optimized };
+							ofParameter<int> detectionWidth{ "Detection width [px]", 1024 };
+							ofParameter<bool> trackBoard{ "Track board", true };
 
-							PARAM_DECLARE("Capture", checkAllIncomingFrames, tetheredShootEnabled, findBoardMode);
+							PARAM_DECLARE("Capture", checkAllIncomingFrames, tetheredShootEnabled, findBoardMode, detectionWidth, trackBoard);
 						} capture;
 						PARAM_DECLARE("CameraIntrinsics", drawBoards, capture);
 					} parameters;
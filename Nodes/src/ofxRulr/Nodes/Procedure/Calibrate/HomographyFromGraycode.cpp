@@ -5,10 +5,12 @@
 
 #include "../Scan/Graycode.h"
 #include "../../Item/Camera.h"
+#include "ofxRulr/Utils/RobustHomography.h"
 #include "ofxCvMin.h"
 
 #include "ofxCvGui/Panels/Image.h"
 #include "ofxCvGui/Widgets/Button.h"
+#include "ofxCvGui/Widgets/LiveValue.h"
 
 #include "ofxNonLinearFit.h"
 
@@ -70,6 +72,16 @@ namespace ofxRulr {
 					this->doubleExportSize.set("Double size of exported images", false);
 				}
 
+				//----------
+				Utils::RobustHomography::Settings getEstimatorSettings(float inlierThreshold, int gridSize, int samplesPerCell, float confidence) {
+					Utils::RobustHomography::Settings settings;
+					settings.inlierThreshold = inlierThreshold;
+					settings.gridSize = gridSize;
+					settings.samplesPerCell = samplesPerCell;
+					settings.confidence = confidence;
+					return settings;
+				}
+
 				//----------
 				string HomographyFromGraycode::getTypeName() const {
 					return "Procedure::Calibrate::HomographyFromGraycode";
@@ -134,6 +146,7 @@ namespace ofxRulr {
 
 					Utils::Serializable::serialize(json, this->undistortFirst);
 					Utils::Serializable::serialize(json, this->doubleExportSize);
+					Utils::Serializable::serialize(json, this->estimator);
 				}
 
 				//----------
@@ -148,6 +161,7 @@ namespace ofxRulr {
 
 					Utils::Serializable::deserialize(json, this->undistortFirst);
 					Utils::Serializable::deserialize(json, this->doubleExportSize);
+					Utils::Serializable::deserialize(json, this->estimator);
 				}
 
 				//----------
@@ -160,23 +174,41 @@ namespace ofxRulr {
 						throw(ofxRulr::Exception("No data loaded for [ofxGraycode::DataSet]"));
 					}
 
-					vector<ofVec2f> camera;
-					vector<ofVec2f> projector;
+					auto startTime = chrono::high_resolution_clock::now();
 
+					//correspondences are sampled as we go, so we never hold all of them
+					Utils::RobustHomography robustHomography(cv::Size(dataSet.getWidth(), dataSet.getHeight())
+						, getEstimatorSettings(this->estimator.inlierThreshold
+							, this->estimator.gridSize
+							, this->estimator.samplesPerCell
+							, this->estimator.confidence));
 					for (const auto & pixel : dataSet) {
 						if (pixel.active) {
-							camera.push_back(pixel.getCameraXY());
-							projector.push_back(pixel.getProjectorXY());
+							robustHomography.add(toCv(pixel.getCameraXY()), toCv(pixel.getProjectorXY()));
 						}
 					}
 
+					//only the samples need undistorting
 					if (this->undistortFirst) {
 						this->throwIfMissingAConnection<Item::Camera>();
 						auto cameraNode = this->getInput<Item::Camera>();
-						camera = toOf(ofxCv::undistortPixelCoordinates(toCv(camera), cameraNode->getCameraMatrix(), cameraNode->getDistortionCoefficients()));
+						robustHomography.transformSources([cameraNode](vector<cv::Point2f> & sources) {
+							sources = ofxCv::undistortPixelCoordinates(sources, cameraNode->getCameraMatrix(), cameraNode->getDistortionCoefficients());
+						});
 					}
 
-					auto result = cv::findHomography(ofxCv::toCv(camera), ofxCv::toCv(projector), CV_LMEDS, 5.0);
+					auto estimate = robustHomography.find();
+					const auto & result = estimate.homography;
+
+					{
+						stringstream message;
+						message << estimate.inlierCount << " / " << estimate.sampleCount << " samples are inliers (from "
+							<< estimate.correspondenceCount << " correspondences)" << endl
+							<< "RMS error : " << estimate.rmsError << "px" << endl
+							<< "Hypotheses : " << estimate.iterations << endl
+							<< "Duration : " << chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count() << "s";
+						this->estimateResult = message.str();
+					}
 
 					this->cameraToProjector.set(
 						result.at<double>(0, 0), result.at<double>(1, 0), 0.0, result.at<double>(2, 0),
@@ -185,6 +217,126 @@ namespace ofxRulr {
 						result.at<double>(0, 2), result.at<double>(1, 2), 0.0, result.at<double>(2, 2));
 				}
 
+				//----------
+				void HomographyFromGraycode::benchmarkEstimators(string folder) {
+					if (folder == "") {
+						auto result = ofSystemLoadDialog("Select folder of graycode scans (.sl)", true);
+						if (!result.bSuccess) {
+							return;
+						}
+						folder = result.filePath;
+					}
+
+					ofDirectory directory;
+					directory.allowExt("sl");
+					directory.listDir(folder);
+					if (directory.size() == 0) {
+						throw(ofxRulr::Exception("No .sl files found in [" + folder + "]"));
+					}
+
+					//LMedS is O(N) per hypothesis with a full sort, so it gets a strided subset of each scan
+					const size_t lmedsMaximumCount = 200000;
+					const auto inlierThreshold = this->estimator.inlierThreshold.get();
+					const auto settings = getEstimatorSettings(inlierThreshold
+						, this->estimator.gridSize
+						, this->estimator.samplesPerCell
+						, this->estimator.confidence);
+
+					struct Evaluation {
+						size_t inlierCount;
+						float rmsError;
+						float medianError;
+					};
+					auto evaluate = [inlierThreshold](const cv::Mat & homography, const vector<cv::Point2f> & sources, const vector<cv::Point2f> & targets) {
+						auto errors = Utils::RobustHomography::getTransferErrors(homography, sources, targets);
+						Evaluation evaluation{ 0, 0.0f, 0.0f };
+						double sumSquared = 0.0;
+						for (auto error : errors) {
+							if (error < inlierThreshold) {
+								evaluation.inlierCount++;
+								sumSquared += error * error;
+							}
+						}
+						if (evaluation.inlierCount > 0) {
+							evaluation.rmsError = sqrt(sumSquared / (double) evaluation.inlierCount);
+						}
+						if (!errors.empty()) {
+							auto median = errors.begin() + errors.size() / 2;
+							nth_element(errors.begin(), median, errors.end());
+							evaluation.medianError = *median;
+						}
+						return evaluation;
+					};
+
+					stringstream report;
+					report << "Inliers, RMS and median are over all correspondences, threshold " << inlierThreshold << "px" << endl
+						<< "LMedS uses at most " << lmedsMaximumCount << " correspondences per scan" << endl;
+
+					for (size_t i = 0; i < directory.size(); i++) {
+						Utils::ScopedProcess scopedProcess("Benchmarking [" + directory.getName(i) + "]", false);
+
+						ofxGraycode::DataSet dataSet;
+						dataSet.load(directory.getPath(i));
+
+						vector<cv::Point2f> sources;
+						vector<cv::Point2f> targets;
+						Utils::RobustHomography robustHomography(cv::Size(dataSet.getWidth(), dataSet.getHeight()), settings);
+						for (const auto & pixel : dataSet) {
+							if (pixel.active) {
+								sources.push_back(toCv(pixel.getCameraXY()));
+								targets.push_back(toCv(pixel.getProjectorXY()));
+								robustHomography.add(sources.back(), targets.back());
+							}
+						}
+						if (sources.size() < 4) {
+							report << directory.getName(i) << " : not enough active pixels" << endl;
+							continue;
+						}
+
+						//LMedS baseline
+						chrono::duration<float> lmedsDuration;
+						cv::Mat lmedsHomography;
+						{
+							const auto stride = max<size_t>(1, sources.size() / lmedsMaximumCount);
+							vector<cv::Point2f> subsetSources, subsetTargets;
+							for (size_t j = 0; j < sources.size(); j += stride) {
+								subsetSources.push_back(sources[j]);
+								subsetTargets.push_back(targets[j]);
+							}
+							auto startTime = chrono::high_resolution_clock::now();
+							lmedsHomography = cv::findHomography(subsetSources, subsetTargets, CV_LMEDS, 5.0);
+							lmedsDuration = chrono::high_resolution_clock::now() - startTime;
+						}
+
+						//stratified MSAC (the sampling happened as we gathered the correspondences above)
+						chrono::duration<float> robustDuration;
+						cv::Mat robustHomographyResult;
+						{
+							auto startTime = chrono::high_resolution_clock::now();
+							robustHomographyResult = robustHomography.find().homography;
+							robustDuration = chrono::high_resolution_clock::now() - startTime;
+						}
+
+						report << directory.getName(i) << " (" << sources.size() << " correspondences)" << endl;
+						auto reportEstimator = [&](const string & name, const cv::Mat & homography, const chrono::duration<float> & duration) {
+							report << "\t" << name << " : " << duration.count() * 1000.0f << "ms";
+							if (homography.empty()) {
+								report << ", failed" << endl;
+								return;
+							}
+							auto evaluation = evaluate(homography, sources, targets);
+							report << ", inliers " << (100.0f * evaluation.inlierCount / sources.size()) << "%"
+								<< ", RMS " << evaluation.rmsError << "px"
+								<< ", median " << evaluation.medianError << "px" << endl;
+						};
+						reportEstimator("LMedS", lmedsHomography, lmedsDuration);
+						reportEstimator("Stratified MSAC", robustHomographyResult, robustDuration);
+					}
+
+					this->benchmarkResult = report.str();
+					ofLogNotice("HomographyFromGraycode") << "Estimator benchmark" << endl << this->benchmarkResult;
+				}
+
 				//----------
 				void HomographyFromGraycode::findDistortionCoefficients() {
 
@@ -314,6 +466,20 @@ namespace ofxRulr {
 
 					inspector->add(MAKE(ofxCvGui::Widgets::Toggle, this->undistortFirst));
 					inspector->add(MAKE(ofxCvGui::Widgets::Toggle, this->doubleExportSize));
+
+					inspector->addParameterGroup(this->estimator);
+					inspector->add(new Widgets::LiveValue<string>("Estimate result", [this]() {
+						return this->estimateResult;
+					}));
+					inspector->add(MAKE(ofxCvGui::Widgets::Button, "Benchmark estimators on scans...", [this]() {
+						try {
+							this->benchmarkEstimators();
+						}
+						RULR_CATCH_ALL_TO_ALERT
+					}));
+					inspector->add(new Widgets::LiveValue<string>("Benchmark result", [this]() {
+						return this->benchmarkResult;
+					}));
 				}
 			}
 		}
@@ -22,6 +22,9 @@ namespace ofxRulr {
 					void findHomography();
 					void findDistortionCoefficients();
 					void exportMappingImage(string filename = "") const;
+
+					///Compare the robust estimator against cv::findHomography (LMedS) on every scan (.sl) in a folder
+					void benchmarkEstimators(string folder = "");
 				protected:
 					void populateInspector(ofxCvGui::InspectArguments &);
 
@@ -33,6 +36,17 @@ namespace ofxRulr {
 
 					ofParameter<bool> undistortFirst;
 					ofParameter<bool> doubleExportSize;
+
+					struct : ofParameterGroup {
+						ofParameter<float> inlierThreshold{ "Inlier threshold [px]", 2.0f, 0.1f, 20.0f };
+						ofParameter<int> gridSize{ "Grid size", 32, 2, 256 }; // cells along each side of the camera image
+						ofParameter<int> samplesPerCell{ "Samples per cell", 16, 1, 1024 };
+						ofParameter<float> confidence{ "Confidence", 0.999f, 0.5f, 0.999999f };
+						PARAM_DECLARE("Estimator", inlierThreshold, gridSize, samplesPerCell, confidence);
+					} estimator;
+
+					string estimateResult;
+					string benchmarkResult;
 				};
 			}
 		}
@@ -4,7 +4,7 @@
 #include "ofxRulr/Nodes/Procedure/Scan/Graycode.h"
 #include "ofxRulr/Nodes/Data/Mesh.h"
 
-#include "ofxTriangle.h"
+#include "ofxRulr/Utils/ThreadPool.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -25,6 +25,8 @@ namespace ofxRulr {
 					RULR_NODE_INSPECTOR_LISTENER;
 					RULR_NODE_SERIALIZATION_LISTENERS;
 
+					this->manageParameters(this->parameters);
+
 					auto graycodeInput = this->addInput<Scan::Graycode>();
 					auto meshInput = this->addInput<Data::Mesh>();
 
@@ -59,6 +61,12 @@ namespace ofxRulr {
 						}
 						RULR_CATCH_ALL_TO_ALERT;
 					});
+					inspector->addLiveValue<size_t>("Cells", [this]() {
+						return this->cellCount;
+					});
+					inspector->addLiveValue<float>("Triangulate duration [s]", [this]() {
+						return this->triangulateDuration;
+					});
 				}
 
 				//----------
@@ -104,7 +112,9 @@ namespace ofxRulr {
 				void Mesh2DFromGraycode::triangulate() {
 					this->throwIfMissingAnyConnection();
 
-					auto dataSet = this->getInput<Scan::Graycode>()->getDataSet();
+					auto startTime = chrono::high_resolution_clock::now();
+
+					const auto & dataSet = this->getInput<Scan::Graycode>()->getDataSet();
 					if (!dataSet.getHasData()) {
 						throw(Exception("No scan data available"));
 					}
@@ -113,56 +123,222 @@ namespace ofxRulr {
 					const auto & cameraInProjector = dataSet.getDataInverse();
 					const auto & active = dataSet.getActive();
 
-					const auto projectorWidth = cameraInProjector.getWidth();
-					const auto projectorHeight = cameraInProjector.getHeight();
-
-					const auto cameraWidth = active.getWidth();
+					const int projectorWidth = cameraInProjector.getWidth();
+					const int projectorHeight = cameraInProjector.getHeight();
+					const int cameraWidth = active.getWidth();
+					const auto cameraInProjectorData = cameraInProjector.getData();
+					const auto activeData = active.getData();
 
-					auto getCameraPixelPosition = [&cameraInProjector, projectorWidth, cameraWidth](int i, int j) {
-						const auto cameraPixelIndex = cameraInProjector.getData()[i + j * projectorWidth];
+					auto isActive = [&](int i, int j) {
+						if (i >= projectorWidth || j >= projectorHeight) {
+							return false;
+						}
+						return activeData[cameraInProjectorData[i + j * projectorWidth]] != 0;
+					};
+					auto getCameraPixelPosition = [&](int i, int j) {
+						const auto cameraPixelIndex = cameraInProjectorData[i + j * projectorWidth];
 						return ofVec2f(cameraPixelIndex % cameraWidth, cameraPixelIndex / cameraWidth);
 					};
-					auto isActive = [& cameraInProjector, &active, projectorWidth](int i, int j) {
-						const auto cameraPixelIndex = cameraInProjector.getData()[i + j * projectorWidth];
-						const auto isActive = active.getData()[cameraPixelIndex];
-						return isActive;
+
+					//cell sizes are powers of 2 so that cells split evenly down to the minimum size
+					auto floorPowerOf2 = [](int value) {
+						int powerOf2 = 1;
+						while (powerOf2 * 2 <= value) {
+							powerOf2 *= 2;
+						}
+						return powerOf2;
 					};
+					const auto maximumCellSize = floorPowerOf2(max(this->parameters.maximumCellSize.get(), 1));
+					const auto minimumCellSize = min(floorPowerOf2(max(this->parameters.minimumCellSize.get(), 1)), maximumCellSize);
+					const auto tolerance = this->parameters.tolerance.get();
 
-					vector<ofPoint> projectorSpaceActivePoints;
+					//find the cells, each row of top level cells (a band) on its own thread
+					const int bandCount = (projectorHeight + maximumCellSize - 1) / maximumCellSize;
+					const int topLevelCellsPerBand = (projectorWidth + maximumCellSize - 1) / maximumCellSize;
+					vector<vector<Cell>> cellsPerBand(bandCount);
+					{
+						//a cell is kept if its samples are active and the camera coords at its centre and edge midpoints are
+						// where we'd interpolate them from the corners, otherwise it's split
+						function<void(int, int, int, vector<Cell> &)> findCells = [&](int x, int y, int size, vector<Cell> & cells) {
+							const bool cornersActive = isActive(x, y)
+								&& isActive(x + size, y)
+								&& isActive(x, y + size)
+								&& isActive(x + size, y + size);
 
-					//find all active pixels
-					for (int j = 0; j < projectorHeight; j++) {
-						for (int i = 0; i < projectorWidth; i++) {
-							if (isActive(i, j)) {
-								projectorSpaceActivePoints.emplace_back(ofVec2f(i, j));
+							if (size <= minimumCellSize) {
+								if (cornersActive) {
+									cells.push_back({ x, y, size });
+								}
+								return;
 							}
+
+							if (cornersActive) {
+								const auto half = size / 2;
+								const ofVec2f corners[4] = {
+									getCameraPixelPosition(x, y)
+									, getCameraPixelPosition(x + size, y)
+									, getCameraPixelPosition(x, y + size)
+									, getCameraPixelPosition(x + size, y + size)
+								};
+								const struct {
+									int i;
+									int j;
+									ofVec2f interpolated;
+								} samples[5] = {
+									{ x + half, y, (corners[0] + corners[1]) / 2.0f }
+									, { x, y + half, (corners[0] + corners[2]) / 2.0f }
+									, { x + size, y + half, (corners[1] + corners[3]) / 2.0f }
+									, { x + half, y + size, (corners[2] + corners[3]) / 2.0f }
+									, { x + half, y + half, (corners[0] + corners[1] + corners[2] + corners[3]) / 4.0f }
+								};
+
+								bool flat = true;
+								for (const auto & sample : samples) {
+									if (!isActive(sample.i, sample.j)
+										|| getCameraPixelPosition(sample.i, sample.j).distance(sample.interpolated) > tolerance) {
+										flat = false;
+										break;
+									}
+								}
+								if (flat) {
+									cells.push_back({ x, y, size });
+									return;
+								}
+							}
+
+							const auto half = size / 2;
+							findCells(x, y, half, cells);
+							findCells(x + half, y, half, cells);
+							findCells(x, y + half, half, cells);
+							findCells(x + half, y + half, half, cells);
+						};
+
+						Utils::ThreadPool::X().parallelFor(0, bandCount, [&](size_t bandIndex) {
+							auto & cells = cellsPerBand[bandIndex];
+							const int y = (int) bandIndex * maximumCellSize;
+							for (int topLevelCellIndex = 0; topLevelCellIndex < topLevelCellsPerBand; topLevelCellIndex++) {
+								findCells(topLevelCellIndex * maximumCellSize, y, maximumCellSize, cells);
+							}
+						}, 1, Utils::ThreadPool::Priority::Batch);
+					}
+
+					//vertices live on a lattice with the minimum cell size as the step, we index them in row major order
+					const int latticeWidth = (projectorWidth - 1) / minimumCellSize + 1;
+					const int latticeHeight = (projectorHeight - 1) / minimumCellSize + 1;
+					vector<int32_t> vertexIndices(latticeWidth * latticeHeight, -1);
+					const int32_t Used = -2;
+					auto getVertexIndex = [&](int i, int j) -> int32_t & {
+						return vertexIndices[i / minimumCellSize + (j / minimumCellSize) * latticeWidth];
+					};
+
+					//mark the corners of all cells, then the centres of cells which border smaller cells (these will be fanned)
+					size_t totalCellCount = 0;
+					for (const auto & cells : cellsPerBand) {
+						for (const auto & cell : cells) {
+							getVertexIndex(cell.x, cell.y) = Used;
+							getVertexIndex(cell.x + cell.size, cell.y) = Used;
+							getVertexIndex(cell.x, cell.y + cell.size) = Used;
+							getVertexIndex(cell.x + cell.size, cell.y + cell.size) = Used;
 						}
+						totalCellCount += cells.size();
+					}
+					auto hasEdgeVertices = [&](const Cell & cell) {
+						for (int offset = minimumCellSize; offset < cell.size; offset += minimumCellSize) {
+							if (getVertexIndex(cell.x + offset, cell.y) != -1
+								|| getVertexIndex(cell.x + offset, cell.y + cell.size) != -1
+								|| getVertexIndex(cell.x, cell.y + offset) != -1
+								|| getVertexIndex(cell.x + cell.size, cell.y + offset) != -1) {
+								return true;
+							}
+						}
+						return false;
+					};
+					vector<Cell> fannedCells;
+					for (const auto & cells : cellsPerBand) {
+						for (const auto & cell : cells) {
+							if (cell.size > minimumCellSize && hasEdgeVertices(cell)) {
+								fannedCells.push_back(cell);
+							}
+						}
+					}
+					for (const auto & cell : fannedCells) {
+						getVertexIndex(cell.x + cell.size / 2, cell.y + cell.size / 2) = Used;
 					}
 
-					//triangulate
 					ofMesh mesh;
+					mesh.setMode(OF_PRIMITIVE_TRIANGLES);
 					{
-						//make vertices and tex coords
-						Delaunay::Point tempP;
-						vector<Delaunay::Point> delauneyPoints;
-						for (const auto & projectorSpaceActivePoint : projectorSpaceActivePoints) {
-							delauneyPoints.emplace_back(projectorSpaceActivePoint.x, projectorSpaceActivePoint.y);
-							mesh.addVertex(projectorSpaceActivePoint);
-							mesh.addTexCoord(getCameraPixelPosition(projectorSpaceActivePoint.x, projectorSpaceActivePoint.y));
+						auto & vertices = mesh.getVertices();
+						auto & texCoords = mesh.getTexCoords();
+						int32_t vertexCount = 0;
+						for (int j = 0; j < latticeHeight; j++) {
+							for (int i = 0; i < latticeWidth; i++) {
+								auto & vertexIndex = vertexIndices[i + j * latticeWidth];
+								if (vertexIndex == Used) {
+									vertexIndex = vertexCount++;
+									vertices.emplace_back(i * minimumCellSize, j * minimumCellSize, 0.0f);
+									texCoords.push_back(getCameraPixelPosition(i * minimumCellSize, j * minimumCellSize));
+								}
+							}
 						}
+					}
+
+					//make the triangles per band (again in parallel), then join them in band order
+					vector<vector<ofIndexType>> indicesPerBand(bandCount);
+					Utils::ThreadPool::X().parallelFor(0, bandCount, [&](size_t bandIndex) {
+						auto & indices = indicesPerBand[bandIndex];
+						vector<ofIndexType> outline;
+						for (const auto & cell : cellsPerBand[bandIndex]) {
+							//walk the outline of the cell, picking up the corners of any smaller neighbours
+							outline.clear();
+							const auto size = cell.size;
+							for (int offset = 0; offset < size; offset += minimumCellSize) {
+								auto vertexIndex = getVertexIndex(cell.x + offset, cell.y);
+								if (vertexIndex >= 0) outline.push_back(vertexIndex);
+							}
+							for (int offset = 0; offset < size; offset += minimumCellSize) {
+								auto vertexIndex = getVertexIndex(cell.x + size, cell.y + offset);
+								if (vertexIndex >= 0) outline.push_back(vertexIndex);
+							}
+							for (int offset = size; offset > 0; offset -= minimumCellSize) {
+								auto vertexIndex = getVertexIndex(cell.x + offset, cell.y + size);
+								if (vertexIndex >= 0) outline.push_back(vertexIndex);
+							}
+							for (int offset = size; offset > 0; offset -= minimumCellSize) {
+								auto vertexIndex = getVertexIndex(cell.x, cell.y + offset);
+								if (vertexIndex >= 0) outline.push_back(vertexIndex);
+							}
 
-						//triangulate
-						auto delauney = make_shared<Delaunay>(delauneyPoints);
-						delauney->Triangulate();
+							if (outline.size() == 4) {
+								//a plain quad : top left, top right, bottom right, bottom left
+								indices.insert(indices.end(), { outline[0], outline[1], outline[2] });
+								indices.insert(indices.end(), { outline[0], outline[2], outline[3] });
+							}
+							else {
+								const ofIndexType centre = getVertexIndex(cell.x + size / 2, cell.y + size / 2);
+								for (size_t i = 0; i < outline.size(); i++) {
+									indices.insert(indices.end(), { centre, outline[i], outline[(i + 1) % outline.size()] });
+								}
+							}
+						}
+					}, 1, Utils::ThreadPool::Priority::Batch);
 
-						//apply indices
-						for (auto it = delauney->fbegin(); it != delauney->fend(); ++it) {
-							mesh.addIndex(delauney->Org(it));
-							mesh.addIndex(delauney->Dest(it));
-							mesh.addIndex(delauney->Apex(it));
+					{
+						auto & indices = mesh.getIndices();
+						size_t indexCount = 0;
+						for (const auto & bandIndices : indicesPerBand) {
+							indexCount += bandIndices.size();
+						}
+						indices.reserve(indexCount);
+						for (const auto & bandIndices : indicesPerBand) {
+							indices.insert(indices.end(), bandIndices.begin(), bandIndices.end());
 						}
 					}
+
 					swap(this->getInput<Data::Mesh>()->getMesh(), mesh);
+
+					this->cellCount = totalCellCount;
+					this->triangulateDuration = chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
 				}
 			}
 		}
@@ -6,6 +6,12 @@ namespace ofxRulr {
 	namespace Nodes {
 		namespace Procedure {
 			namespace Calibrate {
+				///Builds a mesh in projector space (vertices are projector pixels, tex coords are camera pixels) from a graycode scan.
+				///Since the scan is already on the projector's pixel lattice, we mesh that lattice directly as a quadtree of cells.
+				///A cell is split whilst the camera coordinates inside it can't be interpolated from its corners to within
+				/// the tolerance (i.e. where the mapping curves), or whilst any of its samples are inactive.
+				///Rows of top level cells are built in parallel. Vertices are shared between cells, and cells which
+				/// border smaller cells are fanned around their centre so that the mesh has no cracks.
 				class Mesh2DFromGraycode : public Nodes::Base {
 				public:
 					Mesh2DFromGraycode();
@@ -20,7 +26,23 @@ namespace ofxRulr {
 
 					void triangulate();
 				protected:
+					struct Cell {
+						int x;
+						int y;
+						int size;
+					};
+
 					ofxCvGui::PanelPtr view;
+
+					struct : ofParameterGroup {
+						ofParameter<int> maximumCellSize{ "Maximum cell size [px]", 32, 1, 512 }; // rounded down to a power of 2
+						ofParameter<int> minimumCellSize{ "Minimum cell size [px]", 2, 1, 512 }; // rounded down to a power of 2
+						ofParameter<float> tolerance{ "Tolerance [px]", 0.5f, 0.0f, 20.0f }; // in camera pixels
+						PARAM_DECLARE("Mesh2DFromGraycode", maximumCellSize, minimumCellSize, tolerance);
+					} parameters;
+
+					size_t cellCount = 0;
+					float triangulateDuration = 0.0f; // [s]
 				};
 			}
 		}
@@ -6,7 +6,7 @@
 #include "ofxRulr/Nodes/Item/Projector.h"
 #include "ofxRulr/Nodes/Item/AbstractBoard.h"
 
-#include "ofxTriangle.h"
+#include "ofxRulr/Utils/CorrespondenceLookup.h"
 
 using namespace ofxCv;
 
@@ -94,17 +94,6 @@ namespace ofxRulr {
 					Utils::Graphics::popPointSize();
 				}
 
-				//----------
-				//from http://stackoverflow.com/questions/13299409/how-to-get-the-image-pixel-at-real-locations-in-opencv#
-				template<typename Type> // Type could be Vec3b for RGB8
-				Type getColorSubpix(const cv::Mat& img, cv::Point2f pt)
-				{
-					cv::Mat patch;
-					cv::remap(img, patch, cv::Mat(1, 1, CV_32FC2, &pt), cv::noArray(),
-						cv::INTER_LINEAR, cv::BORDER_REFLECT_101);
-					return patch.at<Type>(0, 0);
-				}
-
 				//----------
 				void ProjectorFromGraycode::addCapture() {
 					Utils::ScopedProcess scopedProcess("Add capture");
@@ -134,6 +123,12 @@ namespace ofxRulr {
 						Utils::ScopedProcess scopedProcessFindBoard("Find board in camera image", false);
 						const auto & median = dataSet.getMedian();
 
+						//the board moves between captures, so there's no region to track
+						Utils::BoardFinder::Settings boardFinderSettings;
+						boardFinderSettings.findBoardMode = this->parameters.capture.findBoardMode;
+						boardFinderSettings.trackRoi = false;
+						boardFinderSettings.detectionWidth = 0; // the board can be small in the median, so don't downscale
+
 						ofPixels medianCopy(median);
 						auto medianCopyMat = toCv(medianCopy);
 
@@ -175,10 +170,11 @@ namespace ofxRulr {
 							this->preview.update();
 
 							//find checkerboard in cropped image
-							if (!boardNode->findBoard(croppedImage
+							if (!this->boardFinder.find(*boardNode
+								, croppedImage
 								, pointsInCameraImage
 								, boardObjectPoints
-								, this->parameters.capture.findBoardMode
+								, boardFinderSettings
 								, cameraNode->getCameraMatrix()
 								, cameraNode->getDistortionCoefficients())) {
 								throw(ofxRulr::Exception("Board not found in camera image"));
@@ -194,10 +190,11 @@ namespace ofxRulr {
 							ofxCv::copy(medianCopyMat, this->preview.getPixels());
 							this->preview.update();
 
-							if (!boardNode->findBoard(medianCopyMat
+							if (!this->boardFinder.find(*boardNode
+								, medianCopyMat
 								, pointsInCameraImage
 								, boardObjectPoints
-								, this->parameters.capture.findBoardMode
+								, boardFinderSettings
 								, cameraNode->getCameraMatrix()
 								, cameraNode->getDistortionCoefficients())) {
 								throw(ofxRulr::Exception("Board not found in camera image"));
@@ -241,16 +238,17 @@ namespace ofxRulr {
 						}
 					}
 
-					//build a look up mesh for projector coords within camera image
-					ofMesh projectorInCameraMesh;
+					//look up the projector coordinates of the board corners from the graycode correspondences around them
+					Capture capture;
 					{
-						Utils::ScopedProcess scopedProcessBuildMesh("Build delauney mesh", false);
+						Utils::ScopedProcess scopedProcessLookup("Look up corners in projector", false);
 						auto & projectorInCameraPreview = graycodeNode->getDecoder().getProjectorInCamera().getPixels();
 
+						auto boardBounds = cv::boundingRect(Mat(pointsInCameraImage));
+
 						auto activeEroded = dataSet.getActive();
 						auto activeErodedMat = toCv(activeEroded);
 						{
-							auto boardBounds = cv::boundingRect(Mat(pointsInCameraImage));
 							ofVec2f boardSizeInCamera(boardBounds.width, boardBounds.height);
 							float erosionSize = boardSizeInCamera.length() * this->parameters.capture.erosion;
 							cv::erode(activeErodedMat, activeErodedMat, cv::Mat(), cv::Point(-1, -1), (int)erosionSize);
@@ -263,88 +261,48 @@ namespace ofxRulr {
 							ofxCv::copy(copy, this->preview.getPixels());
 							this->preview.update();
 						}
-						
 
+						//only the correspondences within a window of the board corners are needed
+						auto windowRadius = this->parameters.capture.lookupWindowRadius.get();
+						auto searchBounds = cv::Rect(boardBounds.x - windowRadius - 1
+							, boardBounds.y - windowRadius - 1
+							, boardBounds.width + 2 * windowRadius + 2
+							, boardBounds.height + 2 * windowRadius + 2);
 
-						//make vertices and tex coords
-						Delaunay::Point tempP;
-						vector<Delaunay::Point> delauneyPoints;
-						auto activeErodedPixel = activeEroded.getData();
-						for (auto & pixel : dataSet) {
-							if (!*activeErodedPixel++) {
-								continue;
-							}
-
-							auto projectorXY = pixel.getProjectorXY();
-							auto cameraXY = pixel.getCameraXY();
-
-							delauneyPoints.emplace_back(cameraXY.x, cameraXY.y);
-							projectorInCameraMesh.addVertex(cameraXY);
-							projectorInCameraMesh.addColor(ofFloatColor(projectorXY.x, projectorXY.y, 0));
-						}
+						Utils::CorrespondenceLookup lookup;
+						{
+							auto activeErodedPixel = activeEroded.getData();
+							for (auto & pixel : dataSet) {
+								if (!*activeErodedPixel++) {
+									continue;
+								}
 
-						//triangulate
-						auto delauney = make_shared<Delaunay>(delauneyPoints);
-						delauney->Triangulate();
+								auto cameraXY = pixel.getCameraXY();
+								if (!searchBounds.contains(cv::Point(cameraXY.x, cameraXY.y))) {
+									continue;
+								}
 
-						//apply indices
-						for (auto it = delauney->fbegin(); it != delauney->fend(); ++it) {
-							//cut off big triangles
-							if (delauney->area(it) > this->parameters.capture.maxTriangleArea) {
-								continue;
+								auto projectorXY = pixel.getProjectorXY();
+								lookup.add(cv::Point2f(cameraXY.x, cameraXY.y), cv::Point2f(projectorXY.x, projectorXY.y));
 							}
-							projectorInCameraMesh.addIndex(delauney->Org(it));
-							projectorInCameraMesh.addIndex(delauney->Dest(it));
-							projectorInCameraMesh.addIndex(delauney->Apex(it));
+							lookup.build();
 						}
-					}
 
-					//draw the look up mesh into an fbo
-					ofFbo projectorInCameraFbo;
-					{
-						Utils::ScopedProcess scopedProcessBuildFbo("Build fbo", false);
-
-						{
-							ofFbo::Settings fboSettings;
-							fboSettings.width = cameraNode->getWidth();
-							fboSettings.height = cameraNode->getHeight();
-							fboSettings.internalformat = GL_RGBA32F;
-							projectorInCameraFbo.allocate(fboSettings);
-						}
-
-						projectorInCameraFbo.begin();
-						{
-							ofClear(0, 255);
-							projectorInCameraMesh.draw();
-						}
-						projectorInCameraFbo.end();
-					}
+						Utils::CorrespondenceLookup::Settings lookupSettings;
+						lookupSettings.windowRadius = windowRadius;
+						lookupSettings.minimumCount = this->parameters.capture.lookupMinimumCount;
+						lookupSettings.outlierThreshold = this->parameters.capture.lookupOutlierThreshold;
 
-					//read back to pixels;
-					ofFloatPixels projectorInCameraPixels;
-					{
-						//pre-allocate to dodge memory error
-						projectorInCameraPixels.allocate(cameraNode->getWidth(), cameraNode->getHeight(), ofPixelFormat::OF_PIXELS_RGBA);
-
-						Utils::ScopedProcess scopedProcessBuildFbo("Read back fbo", false);
-						projectorInCameraFbo.readToPixels(projectorInCameraPixels);
-					}
-
-					//read all projector pixel positions and add working points into capture
-					Capture capture;
-					{
 						auto worldPoint = boardPointsInWorldSpace.begin();
-
 						for (auto & cameraPoint : pointsInCameraImage) {
-							auto projectorPoint = getColorSubpix<cv::Vec2f>(toCv(projectorInCameraPixels), cameraPoint);
-
-							if (projectorPoint[0] == 0 && projectorPoint[1] == 0) {
+							cv::Point2f projectorPoint;
+							if (!lookup.lookup(cameraPoint, projectorPoint, lookupSettings)) {
 								//skip projector and world points if we can't find the proj coord for this corner
 								worldPoint++;
 								continue;
 							}
 
-							capture.projectorImagePoints.push_back(toOf((cv::Point2f) projectorPoint));
+							capture.projectorImagePoints.push_back(toOf(projectorPoint));
 							capture.worldPoints.push_back(*worldPoint++);
 						}
 					}
@@ -2,6 +2,7 @@
 
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Nodes/Item/AbstractBoard.h"
+#include "ofxRulr/Utils/BoardFinder.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -43,14 +44,17 @@ namespace ofxRulr {
 							ofParameter<FindBoardMode> findBoardMode{ "Find board mode", FindBoardMode::Optimized };
 							ofParameter<bool> useRansacForSolvePnp{ "Use RANSAC for SolvePNP", true };
 							ofParameter<float> erosion{ "Erosion (/Board size)", 0.02f, 0.0f, 0.1f };
-							ofParameter<int> maxTriangleArea{ "Max triangle area", 100*100 };
-							PARAM_DECLARE("Capture", autoScan, searchBrightArea, brightAreaThreshold, findBoardMode, erosion, maxTriangleArea);
+							ofParameter<int> lookupWindowRadius{ "Lookup window radius [px]", 8, 1, 64 };
+							ofParameter<int> lookupMinimumCount{ "Lookup minimum count", 8 };
+							ofParameter<float> lookupOutlierThreshold{ "Lookup outlier threshold [px]", 2.0f };
+							PARAM_DECLARE("Capture", autoScan, searchBrightArea, brightAreaThreshold, findBoardMode, erosion, lookupWindowRadius, lookupMinimumCount, lookupOutlierThreshold);
 						} capture;
 						ofParameter<string> selection{ "Selection", "" };
 						PARAM_DECLARE("ProjectorFromGraycode", capture, selection);
 					} parameters;
 
 					vector<Capture> captures;
+					Utils::BoardFinder boardFinder;
 					ofFloatImage preview;
 					float error = 0.0f;
 				};
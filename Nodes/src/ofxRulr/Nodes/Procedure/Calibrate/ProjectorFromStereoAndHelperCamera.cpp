@@ -6,7 +6,6 @@
 #include "ofxRulr/Nodes/Item/Camera.h"
 #include "ofxRulr/Nodes/Item/Projector.h"
 #include "ofxRulr/Nodes/Item/AbstractBoard.h"
-#include "ofxRulr/Utils/ThreadPool.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -21,16 +20,16 @@ namespace ofxRulr {
 
 				//----------
 				void ProjectorFromStereoAndHelperCamera::Capture::serialize(Json::Value & json) {
-					json["worldSpacePoints"] << this->worldSpacePoints;
-					json["imageSpacePoints"] << this->imageSpacePoints;
-					json["reprojectedImageSpacePoints"] << this->reprojectedImageSpacePoints;
+					Utils::CaptureStore::serialize(json, "worldSpacePoints", this->worldSpacePoints);
+					Utils::CaptureStore::serialize(json, "imageSpacePoints", this->imageSpacePoints);
+					Utils::CaptureStore::serialize(json, "reprojectedImageSpacePoints", this->reprojectedImageSpacePoints);
 				}
 
 				//----------
 				void ProjectorFromStereoAndHelperCamera::Capture::deserialize(const Json::Value & json) {
-					json["worldSpacePoints"] >> this->worldSpacePoints;
-					json["imageSpacePoints"] >> this->imageSpacePoints;
-					json["reprojectedImageSpacePoints"] >> this->reprojectedImageSpacePoints;
+					Utils::CaptureStore::deserialize(json, "worldSpacePoints", this->worldSpacePoints);
+					Utils::CaptureStore::deserialize(json, "imageSpacePoints", this->imageSpacePoints);
+					Utils::CaptureStore::deserialize(json, "reprojectedImageSpacePoints", this->reprojectedImageSpacePoints);
 				}
 
 				//----------
@@ -89,8 +88,6 @@ namespace ofxRulr {
 					auto graycodeNode = this->getInput<Scan::Graycode>();
 					auto boardNode = this->getInput<Item::AbstractBoard>();
 
-					Utils::ThreadPool threadPool(2, 5);
-
 					//find the checkerboard corners in stereo space
 					// (this would ideally use a stereoSolvePnP, but for now we triangulate
 					vector<ofVec3f> worldPointsFromStereo;
@@ -2,6 +2,7 @@
 #include "StereoCalibrate.h"
 
 #include "ofxRulr/Nodes/Item/Camera.h"
+#include "ofxRulr/Utils/BundleAdjustment.h"
 #include <future>
 
 #include "ofxNonLinearFit.h"
@@ -41,18 +42,18 @@ namespace ofxRulr {
 
 				//----------
 				void StereoCalibrate::Capture::serialize(Json::Value & json) {
-					json["pointsImageSpaceA"] << this->pointsImageSpaceA;
-					json["pointsImageSpaceB"] << this->pointsImageSpaceB;
-					json["pointsObjectSpace"] << this->pointsObjectSpace;
-					json["pointsWorldSpace"] << this->pointsWorldSpace;
+					Utils::CaptureStore::serialize(json, "pointsImageSpaceA", this->pointsImageSpaceA);
+					Utils::CaptureStore::serialize(json, "pointsImageSpaceB", this->pointsImageSpaceB);
+					Utils::CaptureStore::serialize(json, "pointsObjectSpace", this->pointsObjectSpace);
+					Utils::CaptureStore::serialize(json, "pointsWorldSpace", this->pointsWorldSpace);
 				}
 
 				//----------
 				void StereoCalibrate::Capture::deserialize(const Json::Value & json) {
-					json["pointsImageSpaceA"] >> this->pointsImageSpaceA;
-					json["pointsImageSpaceB"] >> this->pointsImageSpaceB;
-					json["pointsObjectSpace"] >> this->pointsObjectSpace;
-					json["pointsWorldSpace"] >> this->pointsWorldSpace;
+					Utils::CaptureStore::deserialize(json, "pointsImageSpaceA", this->pointsImageSpaceA);
+					Utils::CaptureStore::deserialize(json, "pointsImageSpaceB", this->pointsImageSpaceB);
+					Utils::CaptureStore::deserialize(json, "pointsObjectSpace", this->pointsObjectSpace);
+					Utils::CaptureStore::deserialize(json, "pointsWorldSpace", this->pointsWorldSpace);
 				}
 
 #pragma mark StereoCalibrate
@@ -436,20 +437,24 @@ namespace ofxRulr {
 
 						//find the board in both cameras
 						{
-							auto findBoardMode = this->parameters.capture.findBoardMode.get();
+							Utils::BoardFinder::Settings boardFinderSettings;
+							boardFinderSettings.findBoardMode = this->parameters.capture.findBoardMode.get();
+							boardFinderSettings.detectionWidth = 0; // full resolution (distant boards are lost when downscaled)
 							auto futureA = std::async(std::launch::async, [&] {
-								return boardNode->findBoard(imageA
+								return this->boardFinderA.find(*boardNode
+									, imageA
 									, imagePointsA
 									, objectPointsA
-									, findBoardMode
+									, boardFinderSettings
 									, cameraNodeA->getCameraMatrix()
 									, cameraNodeA->getDistortionCoefficients());
 							});
 							auto futureB = std::async(std::launch::async, [&] {
-								return boardNode->findBoard(imageB
+								return this->boardFinderB.find(*boardNode
+									, imageB
 									, imagePointsB
 									, objectPointsB
-									, findBoardMode
+									, boardFinderSettings
 									, cameraNodeB->getCameraMatrix()
 									, cameraNodeB->getDistortionCoefficients());
 							});
@@ -532,6 +537,29 @@ namespace ofxRulr {
 						, fundamental
 						, flags);
 
+					//cv::stereoCalibrate is a plain least squares fit, so we refine with a robust loss to reject bad corners
+					if (this->parameters.calibration.bundleAdjustment) {
+						this->reprojectionError = this->refineWithBundleAdjustment(objectPoints
+							, imagePointsA
+							, imagePointsB
+							, cameraMatrixA
+							, distortionCoefficientsA
+							, cameraMatrixB
+							, distortionCoefficientsB
+							, rotation3x3
+							, translation);
+
+						//essential and fundamental follow from the refined pose
+						const auto & t = translation;
+						cv::Mat translationCross = (cv::Mat_<double>(3, 3) <<
+							0, -t.at<double>(2), t.at<double>(1),
+							t.at<double>(2), 0, -t.at<double>(0),
+							-t.at<double>(1), t.at<double>(0), 0);
+						essential = translationCross * rotation3x3;
+						fundamental = cameraMatrixB.inv().t() * essential * cameraMatrixA.inv();
+						fundamental /= fundamental.at<double>(2, 2);
+					}
+
 					if (!this->parameters.calibration.fixIntrinsics) {
 						cameraNodeA->setIntrinsics(cameraMatrixA, distortionCoefficientsA);
 						cameraNodeB->setIntrinsics(cameraMatrixB, distortionCoefficientsB);
@@ -584,6 +612,78 @@ namespace ofxRulr {
 						capture->pointsWorldSpace = this->triangulate(capture->pointsImageSpaceA, capture->pointsImageSpaceB, false);
 					}
 				}
+
+				//----------
+				float StereoCalibrate::refineWithBundleAdjustment(const vector<vector<cv::Point3f>> & objectPoints
+					, const vector<vector<cv::Point2f>> & imagePointsA
+					, const vector<vector<cv::Point2f>> & imagePointsB
+					, cv::Mat & cameraMatrixA
+					, cv::Mat & distortionCoefficientsA
+					, cv::Mat & cameraMatrixB
+					, cv::Mat & distortionCoefficientsB
+					, cv::Mat & rotation3x3
+					, cv::Mat & translation) {
+					Utils::BundleAdjustment bundleAdjustment;
+					auto fixIntrinsics = this->parameters.calibration.fixIntrinsics.get();
+
+					//camera A defines the space (so its pose is fixed at identity), camera B is the stereo transform
+					Utils::BundleAdjustment::View viewA;
+					viewA.setIntrinsics(cameraMatrixA, distortionCoefficientsA);
+					viewA.fixPose = true;
+					viewA.fixFocalLength = viewA.fixPrincipalPoint = viewA.fixDistortion = fixIntrinsics;
+					bundleAdjustment.addView(viewA);
+
+					Utils::BundleAdjustment::View viewB;
+					viewB.setIntrinsics(cameraMatrixB, distortionCoefficientsB);
+					{
+						cv::Mat rotationVector;
+						cv::Rodrigues(rotation3x3, rotationVector);
+						viewB.setExtrinsics(rotationVector, translation);
+					}
+					viewB.fixFocalLength = viewB.fixPrincipalPoint = viewB.fixDistortion = fixIntrinsics;
+					bundleAdjustment.addView(viewB);
+
+					//each capture is a board whose pose (in camera A's space) is solved alongside
+					for (size_t i = 0; i < objectPoints.size(); i++) {
+						Utils::BundleAdjustment::Object board;
+						board.points = objectPoints[i];
+						{
+							cv::Mat rotationVector, translation;
+							cv::solvePnP(objectPoints[i], imagePointsA[i], cameraMatrixA, distortionCoefficientsA, rotationVector, translation);
+							board.setPose(rotationVector, translation);
+						}
+						auto boardIndex = bundleAdjustment.addObject(board);
+
+						for (size_t j = 0; j < objectPoints[i].size(); j++) {
+							bundleAdjustment.addObjectObservation(0, boardIndex, j, imagePointsA[i][j]);
+							bundleAdjustment.addObjectObservation(1, boardIndex, j, imagePointsB[i][j]);
+						}
+					}
+
+					Utils::BundleAdjustment::Settings settings;
+					settings.loss = Utils::BundleAdjustment::Loss::Huber;
+					settings.lossScale = this->parameters.calibration.robustLossScale.get();
+					auto result = bundleAdjustment.solve(settings);
+					if (!result.success) {
+						throw(ofxRulr::Exception("Bundle adjustment failed to improve on the stereo calibration"));
+					}
+
+					const auto & solvedViewA = bundleAdjustment.getViews()[0];
+					const auto & solvedViewB = bundleAdjustment.getViews()[1];
+					if (!fixIntrinsics) {
+						cameraMatrixA = solvedViewA.getCameraMatrix();
+						distortionCoefficientsA = solvedViewA.getDistortionCoefficients((int) distortionCoefficientsA.total());
+						cameraMatrixB = solvedViewB.getCameraMatrix();
+						distortionCoefficientsB = solvedViewB.getDistortionCoefficients((int) distortionCoefficientsB.total());
+					}
+					{
+						cv::Mat rotationVector;
+						solvedViewB.getExtrinsics(rotationVector, translation);
+						cv::Rodrigues(rotationVector, rotation3x3);
+					}
+
+					return (float) result.reprojectionError;
+				}
 			}
 		}
 	}
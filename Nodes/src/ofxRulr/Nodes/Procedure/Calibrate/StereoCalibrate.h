@@ -4,6 +4,7 @@
 #include "ofxCvMin.h"
 #include "ofxRulr/Nodes/Item/AbstractBoard.h"
 #include "ofxRulr/Utils/CaptureSet.h"
+#include "ofxRulr/Utils/BoardFinder.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -67,6 +68,15 @@ namespace ofxRulr {
 					void populateInspector(ofxCvGui::InspectArguments &);
 					void addCapture();
 					void calibrate();
+					float refineWithBundleAdjustment(const vector<vector<cv::Point3f>> & objectPoints
+						, const vector<vector<cv::Point2f>> & imagePointsA
+						, const vector<vector<cv::Point2f>> & imagePointsB
+						, cv::Mat & cameraMatrixA
+						, cv::Mat & distortionCoefficientsA
+						, cv::Mat & cameraMatrixB
+						, cv::Mat & distortionCoefficientsB
+						, cv::Mat & rotation3x3
+						, cv::Mat & translation);
 
 					ofxCvGui::PanelPtr view;
 					ofTexture previewA, previewB;
@@ -86,7 +96,9 @@ namespace ofxRulr {
 
 						struct : ofParameterGroup {
 							ofParameter<bool> fixIntrinsics{ "Fix intrinsics", true };
-							PARAM_DECLARE("Calibrate", fixIntrinsics);
+							ofParameter<bool> bundleAdjustment{ "Bundle adjustment", false };
+							ofParameter<float> robustLossScale{ "Robust loss scale [px]", 2.0f };
+							PARAM_DECLARE("Calibrate", fixIntrinsics, bundleAdjustment, robustLossScale);
 						} calibration;
 
 						struct : ofParameterGroup {
@@ -104,6 +116,9 @@ namespace ofxRulr {
 						chrono::system_clock::time_point lastFailureA = chrono::system_clock::now() - chrono::minutes(1);
 						chrono::system_clock::time_point lastFailureB = chrono::system_clock::now() - chrono::minutes(1);
 					} lastFailures;
+
+					Utils::BoardFinder boardFinderA;
+					Utils::BoardFinder boardFinderB;
 				};
 			}
 		}
@@ -46,6 +46,9 @@ namespace ofxRulr {
 						}
 						case VideoOutputMode::Data:
 						{
+							if (this->previewDirty) {
+								this->updatePreview();
+							}
 							if (this->preview.isAllocated()) {
 								this->preview.draw(bounds);
 							}
@@ -71,6 +74,13 @@ namespace ofxRulr {
 					};
 
 					this->view = ofxCvGui::Panels::makeTexture(this->preview);
+
+					//previews are only built when something is drawing them
+					this->view->onDraw += [this](ofxCvGui::DrawArguments &) {
+						if (this->previewDirty) {
+							this->updatePreview();
+						}
+					};
 				}
 
 				//----------
@@ -85,10 +95,6 @@ namespace ofxRulr {
 
 				//----------
 				void Graycode::update() {
-					if(this->previewDirty) {
-						this->updatePreview();
-					}
-					
 					//check if suite has been invalidated
 					if (!this->suite) {
 						//check if we're eligible to make a suite
@@ -112,7 +118,8 @@ namespace ofxRulr {
 							this->updateTestPattern();
 						}
 
-						if (this->suite->decoder.getThreshold() != this->parameters.processing.threshold) {
+						//a deferred data set takes the threshold when it's loaded
+						if (!this->dataSetDeferred && this->suite->decoder.getThreshold() != this->parameters.processing.threshold) {
 							this->suite->decoder.setThreshold(this->parameters.processing.threshold);
 							this->previewDirty = true;
 						}
@@ -130,9 +137,16 @@ namespace ofxRulr {
 						jsonPayload["width"] = (int) this->suite->payload.getWidth();
 						jsonPayload["height"] = (int) this->suite->payload.getHeight();
 
+						//only rewrite the data set if it has changed since it was last saved or loaded
 						auto filename = this->getDefaultFilename() + ".sl";
-						this->suite->decoder.saveDataSet(filename);
+						if (this->dataSetChanged || filename != this->dataSetFilename) {
+							this->loadDeferredDataSet();
+							this->suite->decoder.saveDataSet(filename);
+							this->dataSetFilename = filename;
+							this->dataSetChanged = false;
+						}
 						json["filename"] = filename;
+						json["decoderHasData"] = this->hasData();
 					}
 					else {
 						json["hasData"] = false;
@@ -156,15 +170,18 @@ namespace ofxRulr {
 							suite->decoder.init(suite->payload);
 							suite->encoder.init(suite->payload);
 
-							auto filename =  json["filename"].asString();
-							suite->decoder.loadDataSet(filename);
-
 							this->suite = move(suite);
+
+							//the data set is loaded when it is first needed (e.g. by a downstream node or the preview)
+							this->dataSetFilename = json["filename"].asString();
+							this->dataSetDeferred = true;
+							this->deferredHasData = json.isMember("decoderHasData") ? json["decoderHasData"].asBool() : true;
+							this->dataSetChanged = false;
 						}
 					}
 
 					//deal with parameters
-					if (this->suite) {
+					if (this->suite && !this->dataSetDeferred) {
 						this->suite->decoder.setThreshold(this->parameters.processing.threshold);
 					}
 					
@@ -202,6 +219,8 @@ namespace ofxRulr {
 						suite->decoder.init(suite->payload);
 						this->suite = move(suite);
 					}
+					this->dataSetDeferred = false;
+					this->markDataSetChanged();
 
 					this->suite->decoder.setThreshold(this->parameters.processing.threshold);
 
@@ -281,7 +300,10 @@ namespace ofxRulr {
 
 				//----------
 				bool Graycode::hasData() const {
-					if (this->suite) {
+					if (this->suite && this->dataSetDeferred) {
+						return this->deferredHasData;
+					}
+					else if (this->suite) {
 						return this->suite->decoder.hasData();
 					}
 					else {
@@ -302,6 +324,7 @@ namespace ofxRulr {
 				//----------
 				ofxGraycode::Decoder & Graycode::getDecoder() const {
 					if (this->suite) {
+						this->loadDeferredDataSet();
 						return this->suite->decoder;
 					}
 					else {
@@ -320,12 +343,46 @@ namespace ofxRulr {
 				void Graycode::setDataSet(const ofxGraycode::DataSet & dataSet) {
 					//will throw if needs be
 					this->getDecoder().setDataSet(dataSet);
-					this->previewDirty = true;
+					this->markDataSetChanged();
 				}
 
 				//----------
 				void Graycode::invalidateSuite() {
 					this->suite.reset();
+					this->dataSetDeferred = false;
+					this->dataSetFilename.clear();
+					this->previewDirty = true;
+				}
+
+				//----------
+				void Graycode::loadDeferredDataSet() const {
+					if (!this->dataSetDeferred) {
+						return;
+					}
+
+					//anyone else asking for the data set whilst we load it waits here until it's complete
+					lock_guard<mutex> lock(this->deferredLoadMutex);
+					if (!this->suite || !this->dataSetDeferred) {
+						return;
+					}
+
+					try {
+						Utils::ScopedProcess scopedProcess("Loading graycode data set [" + this->dataSetFilename + "]", false);
+						this->suite->decoder.loadDataSet(this->dataSetFilename);
+						this->suite->decoder.setThreshold(this->parameters.processing.threshold);
+						scopedProcess.end();
+					}
+					catch (...) {
+						//don't retry a failed load on every call
+						this->dataSetDeferred = false;
+						throw;
+					}
+					this->dataSetDeferred = false;
+				}
+
+				//----------
+				void Graycode::markDataSetChanged() {
+					this->dataSetChanged = true;
 					this->previewDirty = true;
 				}
 
@@ -356,6 +413,7 @@ namespace ofxRulr {
 						}));
 						inspector->add(new Widgets::Button("Save ofxGraycode::DataSet...", [this]() {
 							if (this->suite) {
+								this->loadDeferredDataSet();
 								this->suite->decoder.saveDataSet();
 								this->suite->decoder.savePreviews();
 							}
@@ -365,7 +423,14 @@ namespace ofxRulr {
 						}));
 						inspector->add(new Widgets::Button("Load ofxGraycode::DataSet...", [this]() {
 							try {
-								this->getDecoder().loadDataSet();
+								if (!this->suite) {
+									throw(ofxRulr::Exception("Decoder has not been allocated."));
+								}
+								//replaces any deferred data set, so don't load that first
+								this->dataSetDeferred = false;
+								this->suite->decoder.loadDataSet();
+								this->suite->decoder.setThreshold(this->parameters.processing.threshold);
+								this->markDataSetChanged();
 							}
 							RULR_CATCH_ALL_TO_ALERT;
 						}));
@@ -6,6 +6,9 @@
 #include "ofxCvGui/Panels/Image.h"
 #include "ofxRulr/Utils/VideoOutputListener.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace ofxRulr {
 	namespace Nodes {
 		namespace Procedure {
@@ -46,6 +49,8 @@ namespace ofxRulr {
 					};
 
 					void invalidateSuite();
+					void loadDeferredDataSet() const;
+					void markDataSetChanged();
 					void drawPreviewOnVideoOutput(const ofRectangle &);
 					void populateInspector(ofxCvGui::InspectArguments &);
 					void updatePreview();
@@ -87,6 +92,15 @@ namespace ofxRulr {
 					bool previewDirty = true;
 					bool shouldLoadWhenReady = false;
 
+					//the data set is loaded from file when first needed, and only saved when it has changed
+					//readers may be on worker threads, so the load is done once under deferredLoadMutex and
+					// dataSetDeferred is only cleared once the data set is complete
+					string dataSetFilename;
+					mutable atomic<bool> dataSetDeferred{ false };
+					mutable mutex deferredLoadMutex;
+					bool deferredHasData = false;
+					bool dataSetChanged = false;
+
 					void callbackChangePreviewMode(PreviewMode &);
 
 					unique_ptr<Utils::VideoOutputListener> videoOutputListener;
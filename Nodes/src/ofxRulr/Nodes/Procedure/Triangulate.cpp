@@ -5,7 +5,10 @@
 #include "../Item/Projector.h"
 #include "./Scan/Graycode.h"
 
-#include "ofxTriangulate.h"
+#include "ofxRulr/Exception.h"
+
+#include "ofxRulr/Utils/Triangulator.h"
+#include "ofxRulr/Utils/PointCloudWriter.h"
 #include "ofxCvGui.h"
 
 using namespace ofxRulr::Nodes;
@@ -33,10 +36,7 @@ namespace ofxRulr {
 				this->addInput(projectorPin);
 				this->addInput(graycodePin);
 
-				this->maxLength.set("Maximum length disparity [m]", 0.05f, 0.0f, 10.0f);
-				this->giveColor.set("Give color", true);
-				this->giveTexCoords.set("Give texture coordinates", true);
-				this->drawPointSize.set("Point size for draw", 1.0f, 1.0f, 10.0f);
+				this->manageParameters(this->parameters);
 			}
 
 			//----------
@@ -55,7 +55,7 @@ namespace ofxRulr {
 			}
 
 			//----------
-			void Triangulate::triangulate() {
+			void Triangulate::triangulate(const string & filename) {
 				this->throwIfMissingAnyConnection();
 
 				auto camera = this->getInput<Item::Camera>();
@@ -63,10 +63,64 @@ namespace ofxRulr {
 				auto graycode = this->getInput<Scan::Graycode>();
 
 				const auto & dataSet = graycode->getDataSet();
+				if (!dataSet.getHasData()) {
+					throw(ofxRulr::Exception("No data loaded for [ofxGraycode::DataSet]"));
+				}
 
 				Utils::ScopedProcess scopedProcess("Triangulating");
-				ofxTriangulate::Triangulate(dataSet, camera->getViewInWorldSpace(), projector->getViewInWorldSpace(), this->mesh, this->maxLength, this->giveColor, this->giveTexCoords);
-				if (this->mesh.getNumVertices() > 0) {
+				auto startTime = chrono::high_resolution_clock::now();
+
+				Utils::Triangulator::Settings settings;
+				settings.maxLength = this->parameters.maxLength;
+				settings.giveColor = this->parameters.giveColor;
+				settings.giveTexCoords = this->parameters.giveTexCoords;
+
+				unique_ptr<Utils::PointCloudWriter> writer;
+				if (!filename.empty()) {
+					writer = make_unique<Utils::PointCloudWriter>(filename
+						, Utils::PointCloudWriter::getFormatForFilename(filename)
+						, settings.giveTexCoords
+						, settings.giveColor);
+				}
+
+				//every nth point goes into the preview
+				const auto maximumPreviewPoints = (size_t) max(this->parameters.maximumPreviewPoints.get(), 1);
+				const auto previewStride = max<size_t>((Utils::Triangulator::getActiveCount(dataSet) + maximumPreviewPoints - 1) / maximumPreviewPoints, 1);
+
+				this->mesh.clear();
+				this->mesh.setMode(OF_PRIMITIVE_POINTS);
+
+				size_t pointIndex = 0;
+				Utils::Triangulator triangulator(camera->getViewInWorldSpace()
+					, projector->getViewInWorldSpace()
+					, camera->getCameraMatrix()
+					, camera->getDistortionCoefficients());
+				this->pointCount = triangulator.triangulate(dataSet, settings, [&](const Utils::Triangulator::Tile & tile) {
+					if (writer) {
+						writer->write(tile.positions.data()
+							, tile.texCoords.data()
+							, tile.luminances.data()
+							, tile.size());
+					}
+
+					for (auto i = (previewStride - pointIndex % previewStride) % previewStride; i < tile.size(); i += previewStride) {
+						this->mesh.addVertex(tile.positions[i]);
+						if (settings.giveTexCoords) {
+							this->mesh.addTexCoord(tile.texCoords[i]);
+						}
+						if (settings.giveColor) {
+							this->mesh.addColor(ofFloatColor(tile.luminances[i] / 255.0f));
+						}
+					}
+					pointIndex += tile.size();
+				});
+
+				if (writer) {
+					writer->close();
+				}
+
+				this->triangulateDuration = chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
+				if (this->pointCount > 0) {
 					scopedProcess.end();
 				}
 			}
@@ -87,47 +141,38 @@ namespace ofxRulr {
 				inspector->add(triangulateButton);
 
 				inspector->addLiveValue<size_t>("Point count", [this]() {
+					return this->pointCount;
+				});
+				inspector->addLiveValue<size_t>("Preview point count", [this]() {
 					return this->mesh.getNumVertices();
 				});
+				inspector->addLiveValue<float>("Triangulate duration [s]", [this]() {
+					return this->triangulateDuration;
+				});
 
-				inspector->add(new Widgets::Slider(this->maxLength));
-				inspector->add(new Widgets::Toggle(this->giveColor));
-				inspector->add(new Widgets::Toggle(this->giveTexCoords));
-				inspector->add(new Widgets::Slider(this->drawPointSize));
-				inspector->add(new Widgets::Button("Save ofMesh...", [this]() {
-					auto result = ofSystemSaveDialog("mesh.ply", "Save mesh as PLY");
-					if (result.bSuccess) {
-						this->mesh.save(result.filePath);
+				inspector->add(new Widgets::Button("Triangulate to PLY...", [this]() {
+					try {
+						auto result = ofSystemSaveDialog("mesh.ply", "Triangulate to binary PLY");
+						if (result.bSuccess) {
+							this->triangulate(result.filePath);
+						}
 					}
+					RULR_CATCH_ALL_TO_ALERT;
 				}));
-				inspector->add(new Widgets::Button("Save binary mesh...", [this]() {
-					auto result = ofSystemSaveDialog("mesh.bin", "Save mesh as PLY");
-					if (result.bSuccess) {
-						ofstream save(ofToDataPath(result.filePath).c_str(), ios::binary);
-						if (!save.is_open()) {
-							ofLogError("ofxRulr::Triangulate") << "save failed to open file " << result.fileName;
-							return;
+				inspector->add(new Widgets::Button("Triangulate to chunked binary...", [this]() {
+					try {
+						auto result = ofSystemSaveDialog("mesh.bin", "Triangulate to chunked binary point cloud");
+						if (result.bSuccess) {
+							this->triangulate(result.filePath);
 						}
-						auto numVertices = (uint32_t) this->mesh.getNumVertices();
-						save.write((char *)& numVertices, sizeof(numVertices));
-						save.write((char *) this->mesh.getVerticesPointer(), sizeof(ofVec3f)* numVertices);
-
-						auto numTexCoords = (uint32_t) this->mesh.getNumTexCoords();
-						save.write((char *)& numTexCoords, sizeof(numTexCoords));
-						save.write((char *) this->mesh.getTexCoordsPointer(), sizeof(ofVec2f)* numTexCoords);
-
-						auto numColors = (uint32_t) this->mesh.getNumColors();
-						save.write((char *)& numColors, sizeof(numColors));
-						save.write((char *) this->mesh.getColorsPointer(), sizeof(ofFloatColor)* numColors);
-
-						save.close();
 					}
+					RULR_CATCH_ALL_TO_ALERT;
 				}));
 			}
 
 			//----------
 			void Triangulate::drawWorld() {
-				Utils::Graphics::pushPointSize(this->drawPointSize);
+				Utils::Graphics::pushPointSize(this->parameters.drawPointSize);
 				{
 					this->mesh.drawVertices();
 				}
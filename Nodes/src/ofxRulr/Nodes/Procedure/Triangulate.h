@@ -9,6 +9,9 @@
 namespace ofxRulr {
 	namespace Nodes {
 		namespace Procedure {
+			///Triangulates the Graycode scan between a camera and a projector into a point cloud (see Utils::Triangulator).
+			///Only a subsample of the points is kept in memory for preview. Triangulating to a file streams every point
+			/// to disk as it's found (.ply is binary PLY, anything else is the chunked format of Utils::PointCloudWriter).
 			class Triangulate : public Base {
 			public:
 				Triangulate();
@@ -18,17 +21,25 @@ namespace ofxRulr {
 				void serialize(Json::Value &);
 				void deserialize(const Json::Value &);
 
-				void triangulate();
+				///If filename is set, all the points are also written to that file
+				void triangulate(const string & filename = "");
 			protected:
 				void populateInspector(ofxCvGui::InspectArguments &);
 				void drawWorld();
 
-				ofMesh mesh;
+				ofMesh mesh; // preview
 
-				ofParameter<float> maxLength;
-				ofParameter<bool> giveColor;
-				ofParameter<bool> giveTexCoords;
-				ofParameter<float> drawPointSize;
+				struct : ofParameterGroup {
+					ofParameter<float> maxLength{ "Maximum length disparity [m]", 0.05f, 0.0f, 10.0f };
+					ofParameter<bool> giveColor{ "Give color", true };
+					ofParameter<bool> giveTexCoords{ "Give texture coordinates", true };
+					ofParameter<int> maximumPreviewPoints{ "Maximum preview points", 1000000, 1000, 100000000 };
+					ofParameter<float> drawPointSize{ "Point size for draw", 1.0f, 1.0f, 10.0f };
+					PARAM_DECLARE("Triangulate", maxLength, giveColor, giveTexCoords, maximumPreviewPoints, drawPointSize);
+				} parameters;
+
+				size_t pointCount = 0;
+				float triangulateDuration = 0.0f; // [s]
 			};
 		}
 	}
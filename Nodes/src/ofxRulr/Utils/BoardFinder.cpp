@@ -0,0 +1,256 @@
+#include "pch_RulrNodes.h"
+#include "BoardFinder.h"
+
+#include "ofxRulr/Utils/ThreadPool.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		//----------
+		BoardFinder::BoardFinder() {
+
+		}
+
+		//----------
+		BoardFinder::~BoardFinder() {
+			//searches run on the shared thread pool, so wait for any which still reference us
+			this->closing.store(true);
+			while (this->isBusy()) {
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+		}
+
+		//----------
+		bool BoardFinder::find(const Nodes::Item::AbstractBoard & board
+			, const cv::Mat & image
+			, vector<cv::Point2f> & imagePoints
+			, vector<cv::Point3f> & objectPoints
+			, const Settings & settings
+			, const cv::Mat & cameraMatrix
+			, const cv::Mat & distortionCoefficients) {
+
+			imagePoints.clear();
+			objectPoints.clear();
+
+			if (settings.findBoardMode == FindBoardMode::Assistant) {
+				return board.findBoard(image
+					, imagePoints
+					, objectPoints
+					, settings.findBoardMode
+					, cameraMatrix
+					, distortionCoefficients);
+			}
+
+			const cv::Rect imageBounds(0, 0, image.cols, image.rows);
+			auto getRegionAround = [&settings, &imageBounds](const vector<cv::Point2f> & points) {
+				auto bounds = cv::boundingRect(points);
+				auto padding = (int) (max(bounds.width, bounds.height) * settings.roiPadding) + 8;
+				return cv::Rect(bounds.x - padding
+					, bounds.y - padding
+					, bounds.width + 2 * padding
+					, bounds.height + 2 * padding) & imageBounds;
+			};
+			auto setTrackedRoi = [this](const cv::Rect & roi) {
+				lock_guard<mutex> lock(this->roiMutex);
+				this->trackedRoi = roi;
+			};
+
+			//first look where we found it last time
+			if (settings.trackRoi) {
+				cv::Rect roi;
+				{
+					lock_guard<mutex> lock(this->roiMutex);
+					roi = this->trackedRoi & imageBounds;
+				}
+				if (roi.area() > 0) {
+					if (this->findInRegion(board, image, roi, 1.0f, imagePoints, objectPoints, settings, cameraMatrix, distortionCoefficients)) {
+						setTrackedRoi(getRegionAround(imagePoints));
+						return true;
+					}
+				}
+			}
+
+			//then search the whole image, downscaled if it's large
+			auto scale = 1.0f;
+			if (settings.detectionWidth > 0 && image.cols > settings.detectionWidth) {
+				scale = (float) settings.detectionWidth / (float) image.cols;
+			}
+
+			auto found = false;
+			if (scale < 1.0f) {
+				vector<cv::Point2f> coarseImagePoints;
+				vector<cv::Point3f> coarseObjectPoints;
+				if (this->findInRegion(board, image, imageBounds, scale, coarseImagePoints, coarseObjectPoints, settings, cameraMatrix, distortionCoefficients)) {
+					//find again at full resolution around the coarse result
+					found = this->findInRegion(board, image, getRegionAround(coarseImagePoints), 1.0f, imagePoints, objectPoints, settings, cameraMatrix, distortionCoefficients)
+						|| this->findInRegion(board, image, imageBounds, 1.0f, imagePoints, objectPoints, settings, cameraMatrix, distortionCoefficients);
+				}
+			}
+			else {
+				found = this->findInRegion(board, image, imageBounds, 1.0f, imagePoints, objectPoints, settings, cameraMatrix, distortionCoefficients);
+			}
+
+			setTrackedRoi(found ? getRegionAround(imagePoints) : cv::Rect());
+			return found;
+		}
+
+		//----------
+		bool BoardFinder::push(shared_ptr<Nodes::Item::AbstractBoard> board
+			, const cv::Mat & image
+			, const Settings & settings
+			, const cv::Mat & cameraMatrix
+			, const cv::Mat & distortionCoefficients) {
+
+			if (settings.findBoardMode == FindBoardMode::Assistant) {
+				auto result = make_unique<Result>();
+				auto startTime = chrono::high_resolution_clock::now();
+				result->found = this->find(*board, image, result->imagePoints, result->objectPoints, settings, cameraMatrix, distortionCoefficients);
+				result->duration = chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
+
+				lock_guard<mutex> lock(this->jobMutex);
+				this->result = move(result);
+				return true;
+			}
+
+			auto job = make_unique<Job>();
+			job->board = board;
+			image.copyTo(job->image);
+			job->settings = settings;
+			job->cameraMatrix = cameraMatrix.clone();
+			job->distortionCoefficients = distortionCoefficients.clone();
+
+			lock_guard<mutex> lock(this->jobMutex);
+			auto replaced = (bool) this->waitingJob;
+			if (replaced) {
+				this->droppedCount++;
+			}
+			this->waitingJob = move(job);
+
+			if (!this->busy) {
+				this->busy = true;
+				if (!ThreadPool::X().performAsync([this]() {
+					this->processJobs();
+				}, ThreadPool::Priority::CameraFrame)) {
+					//queue is full, the waiting job will be picked up on the next push
+					this->busy = false;
+				}
+			}
+
+			return !replaced;
+		}
+
+		//----------
+		bool BoardFinder::getResult(Result & result) {
+			lock_guard<mutex> lock(this->jobMutex);
+			if (!this->result) {
+				return false;
+			}
+			result = move(*this->result);
+			this->result.reset();
+			return true;
+		}
+
+		//----------
+		bool BoardFinder::isBusy() const {
+			lock_guard<mutex> lock(this->jobMutex);
+			return this->busy;
+		}
+
+		//----------
+		size_t BoardFinder::getDroppedCount() const {
+			lock_guard<mutex> lock(this->jobMutex);
+			return this->droppedCount;
+		}
+
+		//----------
+		void BoardFinder::resetTracking() {
+			lock_guard<mutex> lock(this->roiMutex);
+			this->trackedRoi = cv::Rect();
+		}
+
+		//----------
+		bool BoardFinder::findInRegion(const Nodes::Item::AbstractBoard & board
+			, const cv::Mat & image
+			, const cv::Rect & region
+			, float scale
+			, vector<cv::Point2f> & imagePoints
+			, vector<cv::Point3f> & objectPoints
+			, const Settings & settings
+			, const cv::Mat & cameraMatrix
+			, const cv::Mat & distortionCoefficients) const {
+
+			imagePoints.clear();
+			objectPoints.clear();
+
+			cv::Mat searchImage = image(region);
+			if (scale != 1.0f) {
+				cv::resize(searchImage, searchImage, cv::Size(), scale, scale, cv::INTER_AREA);
+			}
+
+			//the camera matrix has to follow the crop and scale
+			cv::Mat searchCameraMatrix;
+			if (!cameraMatrix.empty()) {
+				cameraMatrix.convertTo(searchCameraMatrix, CV_64F);
+				searchCameraMatrix.at<double>(0, 2) -= region.x;
+				searchCameraMatrix.at<double>(1, 2) -= region.y;
+				for (int row = 0; row < 2; row++) {
+					for (int column = 0; column < 3; column++) {
+						searchCameraMatrix.at<double>(row, column) *= scale;
+					}
+				}
+			}
+
+			if (!board.findBoard(searchImage
+				, imagePoints
+				, objectPoints
+				, settings.findBoardMode
+				, searchCameraMatrix
+				, distortionCoefficients)) {
+				return false;
+			}
+
+			for (auto & imagePoint : imagePoints) {
+				imagePoint.x = imagePoint.x / scale + region.x;
+				imagePoint.y = imagePoint.y / scale + region.y;
+			}
+			return true;
+		}
+
+		//----------
+		void BoardFinder::processJobs() {
+			while (true) {
+				unique_ptr<Job> job;
+				{
+					lock_guard<mutex> lock(this->jobMutex);
+					if (!this->waitingJob || this->closing.load()) {
+						this->busy = false;
+						return;
+					}
+					job = move(this->waitingJob);
+				}
+
+				auto result = make_unique<Result>();
+				auto startTime = chrono::high_resolution_clock::now();
+				try {
+					result->found = this->find(*job->board
+						, job->image
+						, result->imagePoints
+						, result->objectPoints
+						, job->settings
+						, job->cameraMatrix
+						, job->distortionCoefficients);
+				}
+				catch (...) {
+					result->found = false;
+				}
+				result->duration = chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
+				{
+					lock_guard<mutex> lock(this->roiMutex);
+					result->roi = this->trackedRoi;
+				}
+
+				lock_guard<mutex> lock(this->jobMutex);
+				this->result = move(result);
+			}
+		}
+	}
+}
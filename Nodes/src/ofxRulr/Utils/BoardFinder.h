@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ofxRulr/Nodes/Item/AbstractBoard.h"
+
+#include <mutex>
+#include <atomic>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Finds a board in camera images, either on the calling thread (find) or on the thread pool (push / getResult).
+		///The board is first searched for at full resolution within the region where it was last found. If it isn't there,
+		/// it is searched for in a downscaled copy of the whole image, and then found again at full resolution within the
+		/// region around that result (so the corners have full resolution accuracy).
+		///Images pushed whilst a search is running replace any image which is still waiting, so the newest image is always
+		/// the next one to be searched and stale images are dropped.
+		///Assistant mode needs the main thread, so it is always performed on the full image by the calling thread.
+		class BoardFinder {
+		public:
+			struct Settings {
+				FindBoardMode findBoardMode = FindBoardMode::Optimized;
+				int detectionWidth = 1024; // [px] width of the downscaled search image, 0 to search at full resolution
+				float roiPadding = 0.2f; // region around the board, as a fraction of the board's size in the image
+				bool trackRoi = true;
+			};
+
+			struct Result {
+				bool found = false;
+				vector<cv::Point2f> imagePoints;
+				vector<cv::Point3f> objectPoints;
+				cv::Rect roi;
+				float duration = 0.0f; // [s]
+			};
+
+			BoardFinder();
+			~BoardFinder();
+
+			bool find(const Nodes::Item::AbstractBoard &
+				, const cv::Mat & image
+				, vector<cv::Point2f> & imagePoints
+				, vector<cv::Point3f> & objectPoints
+				, const Settings &
+				, const cv::Mat & cameraMatrix = cv::Mat()
+				, const cv::Mat & distortionCoefficients = cv::Mat());
+
+			///The image is copied. Returns false if the image replaced one which was still waiting.
+			bool push(shared_ptr<Nodes::Item::AbstractBoard>
+				, const cv::Mat & image
+				, const Settings &
+				, const cv::Mat & cameraMatrix = cv::Mat()
+				, const cv::Mat & distortionCoefficients = cv::Mat());
+
+			///Returns true if there's a result which hasn't been collected yet
+			bool getResult(Result &);
+
+			bool isBusy() const;
+			size_t getDroppedCount() const;
+			void resetTracking();
+		protected:
+			struct Job {
+				shared_ptr<Nodes::Item::AbstractBoard> board;
+				cv::Mat image;
+				Settings settings;
+				cv::Mat cameraMatrix;
+				cv::Mat distortionCoefficients;
+			};
+
+			bool findInRegion(const Nodes::Item::AbstractBoard &
+				, const cv::Mat & image
+				, const cv::Rect & region
+				, float scale
+				, vector<cv::Point2f> & imagePoints
+				, vector<cv::Point3f> & objectPoints
+				, const Settings &
+				, const cv::Mat & cameraMatrix
+				, const cv::Mat & distortionCoefficients) const;
+			void processJobs();
+
+			mutable mutex jobMutex;
+			unique_ptr<Job> waitingJob;
+			unique_ptr<Result> result;
+			bool busy = false;
+			size_t droppedCount = 0;
+
+			mutex roiMutex;
+			cv::Rect trackedRoi;
+
+			atomic<bool> closing{ false };
+		};
+	}
+}
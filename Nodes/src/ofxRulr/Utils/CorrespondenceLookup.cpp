@@ -0,0 +1,246 @@
+#include "pch_RulrNodes.h"
+#include "CorrespondenceLookup.h"
+
+#include "ofxRulr/Exception.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			struct Sample {
+				double dx, dy; // source relative to the query point
+				double tx, ty; // target
+				double weight;
+				bool inlier;
+			};
+
+			struct AffineFit {
+				double x[3]; // target.x = x[0] * dx + x[1] * dy + x[2]
+				double y[3];
+
+				cv::Point2d evaluate(double dx, double dy) const {
+					return cv::Point2d(x[0] * dx + x[1] * dy + x[2]
+						, y[0] * dx + y[1] * dy + y[2]);
+				}
+			};
+
+			//----------
+			//weighted least squares on the inliers, solving the (symmetric 3x3) normal equations by Cramer's rule
+			bool fitAffine(const vector<Sample> & samples, AffineFit & fit) {
+				double sxx = 0, sxy = 0, sx = 0, syy = 0, sy = 0, s = 0;
+				double bx[3] = { 0, 0, 0 };
+				double by[3] = { 0, 0, 0 };
+				for (const auto & sample : samples) {
+					if (!sample.inlier) {
+						continue;
+					}
+					const auto w = sample.weight;
+					sxx += w * sample.dx * sample.dx;
+					sxy += w * sample.dx * sample.dy;
+					sx += w * sample.dx;
+					syy += w * sample.dy * sample.dy;
+					sy += w * sample.dy;
+					s += w;
+
+					bx[0] += w * sample.dx * sample.tx;
+					bx[1] += w * sample.dy * sample.tx;
+					bx[2] += w * sample.tx;
+					by[0] += w * sample.dx * sample.ty;
+					by[1] += w * sample.dy * sample.ty;
+					by[2] += w * sample.ty;
+				}
+
+				//cofactors of [sxx sxy sx; sxy syy sy; sx sy s]
+				const double c00 = syy * s - sy * sy;
+				const double c01 = sx * sy - sxy * s;
+				const double c02 = sxy * sy - syy * sx;
+				const double c11 = sxx * s - sx * sx;
+				const double c12 = sxy * sx - sxx * sy;
+				const double c22 = sxx * syy - sxy * sxy;
+				const double determinant = sxx * c00 + sxy * c01 + sx * c02;
+
+				//degenerate (e.g. collinear) neighbourhoods can't define an affine map
+				const double scale = sxx * syy * s;
+				if (!(scale > 0.0) || abs(determinant) <= scale * 1e-9) {
+					return false;
+				}
+
+				const double inverse = 1.0 / determinant;
+				auto solve = [&](const double * b, double * result) {
+					result[0] = (c00 * b[0] + c01 * b[1] + c02 * b[2]) * inverse;
+					result[1] = (c01 * b[0] + c11 * b[1] + c12 * b[2]) * inverse;
+					result[2] = (c02 * b[0] + c12 * b[1] + c22 * b[2]) * inverse;
+				};
+				solve(bx, fit.x);
+				solve(by, fit.y);
+				return true;
+			}
+		}
+
+		//----------
+		void CorrespondenceLookup::clear() {
+			this->correspondences.clear();
+			this->tileStarts.clear();
+			this->tilesX = 0;
+			this->tilesY = 0;
+			this->built = false;
+		}
+
+		//----------
+		void CorrespondenceLookup::reserve(size_t count) {
+			this->correspondences.reserve(count);
+		}
+
+		//----------
+		void CorrespondenceLookup::add(const cv::Point2f & source, const cv::Point2f & target) {
+			this->correspondences.push_back({ source, target });
+			this->built = false;
+		}
+
+		//----------
+		void CorrespondenceLookup::build(float tileSize) {
+			this->tileSize = tileSize;
+			this->tileStarts.clear();
+
+			if (this->correspondences.empty()) {
+				this->tilesX = 0;
+				this->tilesY = 0;
+				this->built = true;
+				return;
+			}
+
+			//bounds of the sources
+			auto minimum = this->correspondences.front().source;
+			auto maximum = minimum;
+			for (const auto & correspondence : this->correspondences) {
+				minimum.x = min(minimum.x, correspondence.source.x);
+				minimum.y = min(minimum.y, correspondence.source.y);
+				maximum.x = max(maximum.x, correspondence.source.x);
+				maximum.y = max(maximum.y, correspondence.source.y);
+			}
+			this->origin = minimum;
+			this->tilesX = (int)((maximum.x - minimum.x) / tileSize) + 1;
+			this->tilesY = (int)((maximum.y - minimum.y) / tileSize) + 1;
+
+			auto getTile = [this](const cv::Point2f & source) {
+				auto i = min((int)((source.x - this->origin.x) / this->tileSize), this->tilesX - 1);
+				auto j = min((int)((source.y - this->origin.y) / this->tileSize), this->tilesY - 1);
+				return j * this->tilesX + i;
+			};
+
+			//counting sort into tiles
+			this->tileStarts.assign(this->tilesX * this->tilesY + 1, 0);
+			for (const auto & correspondence : this->correspondences) {
+				this->tileStarts[getTile(correspondence.source) + 1]++;
+			}
+			for (size_t i = 1; i < this->tileStarts.size(); i++) {
+				this->tileStarts[i] += this->tileStarts[i - 1];
+			}
+
+			vector<Correspondence> sorted(this->correspondences.size());
+			{
+				auto next = this->tileStarts;
+				for (const auto & correspondence : this->correspondences) {
+					sorted[next[getTile(correspondence.source)]++] = correspondence;
+				}
+			}
+			this->correspondences = move(sorted);
+			this->built = true;
+		}
+
+		//----------
+		size_t CorrespondenceLookup::size() const {
+			return this->correspondences.size();
+		}
+
+		//----------
+		bool CorrespondenceLookup::lookup(const cv::Point2f & source, cv::Point2f & target, const Settings & settings) const {
+			if (!this->built) {
+				throw(ofxRulr::Exception("CorrespondenceLookup::build() must be called before lookup()"));
+			}
+			if (this->correspondences.empty()) {
+				return false;
+			}
+
+			const auto radius = settings.windowRadius;
+			const auto radiusSquared = radius * radius;
+
+			//gaussian weighting which falls to ~0.14 at the edge of the window
+			const auto sigma = max(radius / 2.0, 1e-3);
+			const auto weightFactor = -1.0 / (2.0 * sigma * sigma);
+
+			//gather the correspondences within the window
+			vector<Sample> samples;
+			{
+				auto iMin = max((int)floor((source.x - radius - this->origin.x) / this->tileSize), 0);
+				auto iMax = min((int)floor((source.x + radius - this->origin.x) / this->tileSize), this->tilesX - 1);
+				auto jMin = max((int)floor((source.y - radius - this->origin.y) / this->tileSize), 0);
+				auto jMax = min((int)floor((source.y + radius - this->origin.y) / this->tileSize), this->tilesY - 1);
+
+				for (int j = jMin; j <= jMax; j++) {
+					for (int i = iMin; i <= iMax; i++) {
+						const auto tile = j * this->tilesX + i;
+						for (auto index = this->tileStarts[tile]; index < this->tileStarts[tile + 1]; index++) {
+							const auto & correspondence = this->correspondences[index];
+							const double dx = correspondence.source.x - source.x;
+							const double dy = correspondence.source.y - source.y;
+							const auto distanceSquared = dx * dx + dy * dy;
+							if (distanceSquared > radiusSquared) {
+								continue;
+							}
+							samples.push_back({ dx, dy
+								, correspondence.target.x, correspondence.target.y
+								, exp(distanceSquared * weightFactor)
+								, true });
+						}
+					}
+				}
+			}
+			if (samples.size() < (size_t)max(settings.minimumCount, 3)) {
+				return false;
+			}
+
+			AffineFit fit;
+			if (!fitAffine(samples, fit)) {
+				return false;
+			}
+
+			//reject outliers, first loosely (the initial fit is pulled by the outliers) then at the threshold
+			if (settings.outlierThreshold > 0.0f) {
+				vector<double> residuals(samples.size());
+				for (int pass = 0; pass < 2; pass++) {
+					for (size_t i = 0; i < samples.size(); i++) {
+						const auto & sample = samples[i];
+						const auto fitted = fit.evaluate(sample.dx, sample.dy);
+						residuals[i] = sqrt((fitted.x - sample.tx) * (fitted.x - sample.tx) + (fitted.y - sample.ty) * (fitted.y - sample.ty));
+					}
+
+					double threshold = settings.outlierThreshold;
+					if (pass == 0) {
+						auto sortedResiduals = residuals;
+						auto median = sortedResiduals.begin() + sortedResiduals.size() / 2;
+						nth_element(sortedResiduals.begin(), median, sortedResiduals.end());
+						threshold = max(threshold, *median * 3.0);
+					}
+
+					int inlierCount = 0;
+					for (size_t i = 0; i < samples.size(); i++) {
+						samples[i].inlier = residuals[i] <= threshold;
+						if (samples[i].inlier) {
+							inlierCount++;
+						}
+					}
+					if (inlierCount < max(settings.minimumCount, 3)) {
+						return false;
+					}
+					if (!fitAffine(samples, fit)) {
+						return false;
+					}
+				}
+			}
+
+			//the samples are relative to the query point, so the fit's constant term is the result
+			target = cv::Point2f((float)fit.x[2], (float)fit.y[2]);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Looks up where a point in a source image lands in a target image, given a dense set of point correspondences
+		/// between the two (e.g. the camera -> projector pixels of a structured light scan).
+		///Correspondences are bucketed into square tiles. Each lookup gathers the correspondences within a window around the
+		/// query point and fits a distance weighted affine map to them (first order moving least squares), rejecting outliers
+		/// (e.g. bad decodes) before refitting. The map is then evaluated at the query point, so results are sub-pixel.
+		class CorrespondenceLookup {
+		public:
+			struct Settings {
+				float windowRadius = 8.0f; // [px] in the source image
+				int minimumCount = 8; // correspondences needed within the window (after outlier rejection)
+				float outlierThreshold = 2.0f; // [px] in the target image, 0 to disable outlier rejection
+			};
+
+			void clear();
+			void reserve(size_t);
+			void add(const cv::Point2f & source, const cv::Point2f & target);
+
+			///Must be called after adding correspondences and before lookup
+			void build(float tileSize = 16.0f);
+
+			size_t size() const;
+			bool lookup(const cv::Point2f & source, cv::Point2f & target, const Settings &) const;
+		protected:
+			struct Correspondence {
+				cv::Point2f source;
+				cv::Point2f target;
+			};
+
+			std::vector<Correspondence> correspondences; // sorted by tile after build()
+			std::vector<uint32_t> tileStarts; // index of the first correspondence in each tile (plus one past the end)
+			cv::Point2f origin;
+			float tileSize = 16.0f;
+			int tilesX = 0;
+			int tilesY = 0;
+			bool built = false;
+		};
+	}
+}
@@ -0,0 +1,546 @@
+#include "pch_RulrNodes.h"
+#include "FrameLog.h"
+
+#include "ofxRulr/Exception.h"
+
+#include "Poco/File.h"
+#include "Poco/SharedMemory.h"
+
+#include <fstream>
+
+using namespace std;
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			const char magic[8] = { 'R', 'U', 'L', 'R', 'F', 'L', 'O', 'G' };
+			const uint32_t version = 1;
+			const uint32_t chunkMarker = 0x4B4E4843; // 'CHNK'
+			const size_t preambleSize = sizeof(magic) + sizeof(uint32_t);
+
+			struct ChunkHeader {
+				uint32_t marker;
+				uint32_t frameCount;
+				uint64_t payloadBytes;
+			};
+
+			struct FrameEntry {
+				int64_t time;
+				uint32_t offset;
+				uint32_t size;
+			};
+
+			static_assert(sizeof(ChunkHeader) == 16 && sizeof(FrameEntry) == 16, "Frame log structures must be packed");
+
+			//----------
+			size_t getChunkSize(size_t frameCount, size_t payloadBytes) {
+				return sizeof(ChunkHeader) + frameCount * sizeof(FrameEntry) + payloadBytes;
+			}
+		}
+
+		//----------
+		FrameLog::FrameLog() {
+
+		}
+
+		//----------
+		FrameLog::~FrameLog() {
+			try {
+				this->close();
+			}
+			catch (const ofxRulr::Exception & e) {
+				ofLogError("FrameLog") << e.what();
+			}
+		}
+
+		//----------
+		void FrameLog::open(const string & filename) {
+			this->close();
+
+			{
+				Poco::File file(filename);
+				if (!file.exists() || file.getSize() == 0) {
+					ofstream stream(filename, ios::binary | ios::out | ios::trunc);
+					if (!stream.is_open()) {
+						throw(ofxRulr::Exception("Couldn't create frame log [" + filename + "]"));
+					}
+					stream.write(magic, sizeof(magic));
+					stream.write((const char *) &version, sizeof(version));
+				}
+			}
+
+			this->filename = filename;
+			try {
+				this->scan();
+			}
+			catch (...) {
+				this->filename.clear();
+				this->chunks.clear();
+				this->frameCount = 0;
+				throw;
+			}
+
+			this->writerThreadRunning = true;
+			this->writerThread = thread([this]() {
+				this->writerThreadFunction();
+			});
+		}
+
+		//----------
+		void FrameLog::close() {
+			if (!this->isOpen()) {
+				return;
+			}
+
+			this->flush();
+
+			{
+				lock_guard<mutex> lock(this->indexMutex);
+				this->writerThreadRunning = false;
+			}
+			this->writeQueueChanged.notify_all();
+			this->writerThread.join();
+
+			{
+				lock_guard<mutex> lock(this->fileMutex);
+				this->memory.reset();
+			}
+
+			this->filename.clear();
+			this->chunks.clear();
+			this->currentChunk = PendingChunk();
+			this->writeQueue.clear();
+			this->writeError.clear();
+			this->droppedFrameCount = 0;
+			this->fileSize = 0;
+			this->frameCount = 0;
+			this->writtenChunkCount = 0;
+		}
+
+		//----------
+		bool FrameLog::isOpen() const {
+			return !this->filename.empty();
+		}
+
+		//----------
+		const string & FrameLog::getFilename() const {
+			return this->filename;
+		}
+
+		//----------
+		void FrameLog::append(const Time & time, string && payload) {
+			if (!this->isOpen()) {
+				throw(ofxRulr::Exception("Frame log is not open"));
+			}
+
+			lock_guard<mutex> lock(this->indexMutex);
+			if (this->frameCount > 0) {
+				const auto lastTime = this->currentChunk.times.empty()
+					? this->chunks.back().lastTime
+					: this->currentChunk.times.back();
+				if (time < lastTime) {
+					throw(ofxRulr::Exception("Frames must be appended to a frame log in time order"));
+				}
+			}
+
+			this->currentChunk.times.push_back(time);
+			this->currentChunk.payloadBytes += payload.size();
+			this->currentChunk.payloads.push_back(move(payload));
+			this->frameCount++;
+
+			if (this->currentChunk.times.size() >= this->maxChunkFrames
+				|| this->currentChunk.payloadBytes >= this->maxChunkBytes) {
+				this->queueCurrentChunk();
+			}
+		}
+
+		//----------
+		void FrameLog::flush() {
+			unique_lock<mutex> lock(this->indexMutex);
+			this->queueCurrentChunk();
+			this->writeQueueChanged.wait(lock, [this]() {
+				return this->writtenChunkCount == this->chunks.size();
+			});
+		}
+
+		//----------
+		string FrameLog::getWriteError() const {
+			lock_guard<mutex> lock(this->indexMutex);
+			return this->writeError;
+		}
+
+		//----------
+		size_t FrameLog::getDroppedFrameCount() const {
+			lock_guard<mutex> lock(this->indexMutex);
+			return this->droppedFrameCount;
+		}
+
+		//----------
+		size_t FrameLog::getFrameCount() const {
+			lock_guard<mutex> lock(this->indexMutex);
+			return this->frameCount;
+		}
+
+		//----------
+		bool FrameLog::empty() const {
+			return this->getFrameCount() == 0;
+		}
+
+		//----------
+		FrameLog::Time FrameLog::getFirstTime() const {
+			lock_guard<mutex> lock(this->indexMutex);
+			if (!this->chunks.empty()) {
+				return this->chunks.front().firstTime;
+			}
+			else if (!this->currentChunk.times.empty()) {
+				return this->currentChunk.times.front();
+			}
+			else {
+				return Time(0);
+			}
+		}
+
+		//----------
+		FrameLog::Time FrameLog::getLastTime() const {
+			lock_guard<mutex> lock(this->indexMutex);
+			if (!this->currentChunk.times.empty()) {
+				return this->currentChunk.times.back();
+			}
+			else if (!this->chunks.empty()) {
+				return this->chunks.back().lastTime;
+			}
+			else {
+				return Time(0);
+			}
+		}
+
+		//----------
+		size_t FrameLog::getChunkCount() const {
+			lock_guard<mutex> lock(this->indexMutex);
+			return this->chunks.size();
+		}
+
+		//----------
+		FrameLog::ChunkInfo FrameLog::getChunkInfo(size_t chunkIndex) const {
+			lock_guard<mutex> lock(this->indexMutex);
+			if (chunkIndex >= this->chunks.size()) {
+				throw(ofxRulr::Exception("Frame log chunk index " + ofToString(chunkIndex) + " is out of range"));
+			}
+			return this->chunks[chunkIndex];
+		}
+
+		//----------
+		size_t FrameLog::findChunk(const Time & time) const {
+			lock_guard<mutex> lock(this->indexMutex);
+			auto findChunk = lower_bound(this->chunks.begin(), this->chunks.end(), time, [](const ChunkInfo & chunk, const Time & time) {
+				return chunk.lastTime < time;
+			});
+			return findChunk - this->chunks.begin();
+		}
+
+		//----------
+		void FrameLog::readChunk(size_t chunkIndex, vector<Time> & times, vector<string> & payloads) const {
+			ChunkInfo chunkInfo;
+			{
+				//wait for the chunk to be written if it's still queued
+				unique_lock<mutex> lock(this->indexMutex);
+				if (chunkIndex >= this->chunks.size()) {
+					throw(ofxRulr::Exception("Frame log chunk index " + ofToString(chunkIndex) + " is out of range"));
+				}
+				this->writeQueueChanged.wait(lock, [this, chunkIndex]() {
+					return chunkIndex < this->writtenChunkCount || chunkIndex >= this->chunks.size();
+				});
+				if (chunkIndex >= this->writtenChunkCount) {
+					//the chunks after it moved down when one failed to write
+					throw(ofxRulr::Exception("Frame log chunk index " + ofToString(chunkIndex) + " is out of range (" + this->writeError + ")"));
+				}
+				chunkInfo = this->chunks[chunkIndex];
+			}
+
+			lock_guard<mutex> lock(this->fileMutex);
+			this->map();
+
+			const auto begin = this->memory->begin();
+			const auto size = (size_t) (this->memory->end() - begin);
+			if (chunkInfo.offset + sizeof(ChunkHeader) > size) {
+				throw(ofxRulr::Exception("Frame log [" + this->filename + "] is truncated"));
+			}
+
+			ChunkHeader header;
+			memcpy(&header, begin + chunkInfo.offset, sizeof(header));
+			const auto entriesStart = chunkInfo.offset + sizeof(ChunkHeader);
+			const auto payloadStart = entriesStart + header.frameCount * sizeof(FrameEntry);
+			if (header.marker != chunkMarker
+				|| payloadStart + header.payloadBytes > size) {
+				throw(ofxRulr::Exception("Frame log [" + this->filename + "] has a malformed chunk at " + ofToString(chunkInfo.offset)));
+			}
+
+			times.resize(header.frameCount);
+			payloads.resize(header.frameCount);
+			for (uint32_t i = 0; i < header.frameCount; i++) {
+				FrameEntry entry;
+				memcpy(&entry, begin + entriesStart + i * sizeof(FrameEntry), sizeof(entry));
+				if ((uint64_t) entry.offset + entry.size > header.payloadBytes) {
+					throw(ofxRulr::Exception("Frame log [" + this->filename + "] has a malformed frame in chunk at " + ofToString(chunkInfo.offset)));
+				}
+				times[i] = Time(entry.time);
+				payloads[i].assign(begin + payloadStart + entry.offset, entry.size);
+			}
+		}
+
+		//----------
+		void FrameLog::rewrite(const function<bool(Time &)> & transform) {
+			this->flush();
+
+			const auto filename = this->filename;
+			const auto rewriteFilename = filename + ".rewrite";
+			{
+				Poco::File rewriteFile(rewriteFilename);
+				if (rewriteFile.exists()) {
+					rewriteFile.remove();
+				}
+			}
+
+			//stream chunk by chunk so that only one chunk is in memory at a time
+			{
+				FrameLog rewriteLog;
+				rewriteLog.maxChunkFrames = this->maxChunkFrames;
+				rewriteLog.maxChunkBytes = this->maxChunkBytes;
+				rewriteLog.open(rewriteFilename);
+
+				vector<Time> times;
+				vector<string> payloads;
+				const auto chunkCount = this->getChunkCount();
+				for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++) {
+					this->readChunk(chunkIndex, times, payloads);
+					for (size_t i = 0; i < times.size(); i++) {
+						if (transform(times[i])) {
+							rewriteLog.append(times[i], move(payloads[i]));
+						}
+					}
+				}
+				rewriteLog.close();
+			}
+
+			this->close();
+			Poco::File(rewriteFilename).renameTo(filename);
+			this->open(filename);
+		}
+
+		//----------
+		void FrameLog::copyTo(const string & filename) {
+			this->flush();
+
+			lock_guard<mutex> lock(this->fileMutex);
+			this->memory.reset();
+			Poco::File(this->filename).copyTo(filename);
+		}
+
+		//----------
+		void FrameLog::clear() {
+			this->flush();
+
+			{
+				lock_guard<mutex> lock(this->fileMutex);
+				this->memory.reset();
+				Poco::File(this->filename).setSize(preambleSize);
+			}
+
+			lock_guard<mutex> lock(this->indexMutex);
+			this->chunks.clear();
+			this->fileSize = preambleSize;
+			this->frameCount = 0;
+			this->writtenChunkCount = 0;
+			this->writeError.clear();
+			this->droppedFrameCount = 0;
+		}
+
+		//----------
+		void FrameLog::queueCurrentChunk() {
+			//nb : indexMutex is held by the caller
+			if (this->currentChunk.times.empty()) {
+				return;
+			}
+
+			ChunkInfo chunkInfo;
+			chunkInfo.offset = this->fileSize;
+			chunkInfo.frameCount = this->currentChunk.times.size();
+			chunkInfo.firstTime = this->currentChunk.times.front();
+			chunkInfo.lastTime = this->currentChunk.times.back();
+			this->chunks.push_back(chunkInfo);
+			this->fileSize += getChunkSize(chunkInfo.frameCount, this->currentChunk.payloadBytes);
+
+			this->writeQueue.push_back(make_shared<PendingChunk>(move(this->currentChunk)));
+			this->currentChunk = PendingChunk();
+			this->writeQueueChanged.notify_all();
+		}
+
+		//----------
+		void FrameLog::writerThreadFunction() {
+			while (true) {
+				shared_ptr<PendingChunk> chunk;
+				size_t offset;
+				{
+					unique_lock<mutex> lock(this->indexMutex);
+					this->writeQueueChanged.wait(lock, [this]() {
+						return !this->writeQueue.empty() || !this->writerThreadRunning;
+					});
+					if (this->writeQueue.empty()) {
+						//only leave once everything has been written
+						return;
+					}
+					chunk = this->writeQueue.front();
+					offset = this->chunks[this->writtenChunkCount].offset; // chunks are written in the order they're queued
+				}
+
+				string error;
+				try {
+					this->writeChunk(*chunk, offset);
+				}
+				catch (const ofxRulr::Exception & e) {
+					error = e.what();
+				}
+
+				{
+					lock_guard<mutex> lock(this->indexMutex);
+					this->writeQueue.pop_front();
+					if (error.empty()) {
+						this->writtenChunkCount++;
+					}
+					else {
+						//drop the chunk from the index, and move the chunks queued after it down into its place
+						const auto failedChunk = this->chunks.begin() + this->writtenChunkCount;
+						const auto failedChunkSize = getChunkSize(chunk->times.size(), chunk->payloadBytes);
+						this->frameCount -= failedChunk->frameCount;
+						this->droppedFrameCount += failedChunk->frameCount;
+						this->fileSize -= failedChunkSize;
+						for (auto it = this->chunks.erase(failedChunk); it != this->chunks.end(); it++) {
+							it->offset -= failedChunkSize;
+						}
+						this->writeError = error;
+					}
+				}
+				this->writeQueueChanged.notify_all();
+			}
+		}
+
+		//----------
+		void FrameLog::writeChunk(const PendingChunk & chunk, size_t chunkOffset) {
+			ChunkHeader header;
+			header.marker = chunkMarker;
+			header.frameCount = (uint32_t) chunk.times.size();
+			header.payloadBytes = chunk.payloadBytes;
+
+			vector<FrameEntry> entries(chunk.times.size());
+			uint32_t offset = 0;
+			for (size_t i = 0; i < entries.size(); i++) {
+				entries[i].time = chunk.times[i].count();
+				entries[i].offset = offset;
+				entries[i].size = (uint32_t) chunk.payloads[i].size();
+				offset += entries[i].size;
+			}
+
+			//the mapping may stop us writing to the file (e.g. on Windows), so release it until the next read
+			lock_guard<mutex> lock(this->fileMutex);
+			this->memory.reset();
+
+			ofstream file(this->filename, ios::binary | ios::out | ios::app);
+			if (!file.is_open()) {
+				throw(ofxRulr::Exception("Couldn't open frame log [" + this->filename + "] for writing"));
+			}
+			file.write((const char *) &header, sizeof(header));
+			file.write((const char *) entries.data(), entries.size() * sizeof(FrameEntry));
+			for (const auto & payload : chunk.payloads) {
+				file.write(payload.data(), payload.size());
+			}
+			if (!file.good()) {
+				//cut off whatever we managed to write, so the next chunk goes where the index expects it
+				file.close();
+				try {
+					Poco::File(this->filename).setSize(chunkOffset);
+				}
+				catch (const Poco::Exception &) {
+				}
+				throw(ofxRulr::Exception("Failed to write to frame log [" + this->filename + "]"));
+			}
+		}
+
+		//----------
+		void FrameLog::scan() {
+			ifstream file(this->filename, ios::binary | ios::in);
+			if (!file.is_open()) {
+				throw(ofxRulr::Exception("Couldn't open frame log [" + this->filename + "]"));
+			}
+			file.seekg(0, ios::end);
+			const auto size = (size_t) file.tellg();
+			file.seekg(0, ios::beg);
+
+			char fileMagic[sizeof(magic)];
+			uint32_t fileVersion = 0;
+			file.read(fileMagic, sizeof(fileMagic));
+			file.read((char *) &fileVersion, sizeof(fileVersion));
+			if (!file.good() || memcmp(fileMagic, magic, sizeof(magic)) != 0) {
+				throw(ofxRulr::Exception("[" + this->filename + "] is not a frame log"));
+			}
+			if (fileVersion != version) {
+				throw(ofxRulr::Exception("Frame log [" + this->filename + "] has unsupported version " + ofToString(fileVersion)));
+			}
+
+			//read only the chunk headers and the first and last frame entries of each chunk
+			size_t offset = preambleSize;
+			while (offset + sizeof(ChunkHeader) <= size) {
+				ChunkHeader header;
+				file.seekg(offset);
+				file.read((char *) &header, sizeof(header));
+				if (!file.good()
+					|| header.marker != chunkMarker
+					|| header.frameCount == 0
+					|| offset + getChunkSize(header.frameCount, header.payloadBytes) > size) {
+					break;
+				}
+
+				FrameEntry firstEntry, lastEntry;
+				file.read((char *) &firstEntry, sizeof(firstEntry));
+				file.seekg(offset + sizeof(ChunkHeader) + (header.frameCount - 1) * sizeof(FrameEntry));
+				file.read((char *) &lastEntry, sizeof(lastEntry));
+				if (!file.good()) {
+					break;
+				}
+
+				ChunkInfo chunkInfo;
+				chunkInfo.offset = offset;
+				chunkInfo.frameCount = header.frameCount;
+				chunkInfo.firstTime = Time(firstEntry.time);
+				chunkInfo.lastTime = Time(lastEntry.time);
+				this->chunks.push_back(chunkInfo);
+				this->frameCount += header.frameCount;
+
+				offset += getChunkSize(header.frameCount, header.payloadBytes);
+			}
+			file.close();
+
+			//drop anything after the last complete chunk, so that new chunks follow on from it
+			if (offset < size) {
+				ofLogWarning("FrameLog") << "[" << this->filename << "] ends with an incomplete chunk (" << (size - offset) << " bytes), which has been removed";
+				Poco::File(this->filename).setSize(offset);
+			}
+
+			this->fileSize = offset;
+			this->writtenChunkCount = this->chunks.size();
+		}
+
+		//----------
+		void FrameLog::map() const {
+			//nb : fileMutex is held by the caller
+			if (this->memory) {
+				return;
+			}
+			try {
+				this->memory = make_unique<Poco::SharedMemory>(Poco::File(this->filename), Poco::SharedMemory::AM_READ);
+			}
+			catch (const Poco::Exception & e) {
+				throw(ofxRulr::Exception("Couldn't map frame log [" + this->filename + "] : " + e.displayText()));
+			}
+		}
+	}
+}
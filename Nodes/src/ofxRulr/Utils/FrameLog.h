@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Poco {
+	class SharedMemory;
+}
+
+namespace ofxRulr {
+	namespace Utils {
+		///Append-only log of timestamped frames on disk, for recordings which are too long to keep in memory.
+		///Frames are gathered into chunks, and each full chunk is written by a background thread. Chunks are read through
+		/// a memory mapping of the file, and the chunk index (first / last time of each chunk) is kept in memory so
+		/// that finding the frame at a time is a binary search over chunks and then over the frames in that chunk.
+		///A log which was cut short (e.g. the app crashed whilst recording) loses only the chunks which weren't written.
+		///A chunk which fails to write is removed from the file and the index (so the log stays readable and can still
+		/// be appended to), and the error is kept for getWriteError().
+		///
+		///File layout (little endian) :
+		/// "RULRFLOG", uint32 version, then the chunks. Each chunk is :
+		/// uint32 'CHNK', uint32 frame count, uint64 payload size,
+		/// { int64 time [us], uint32 offset, uint32 size } per frame, then the payloads
+		class FrameLog {
+		public:
+			typedef std::chrono::microseconds Time;
+
+			struct ChunkInfo {
+				size_t offset; // of the chunk header in the file
+				size_t frameCount;
+				Time firstTime;
+				Time lastTime;
+			};
+
+			FrameLog();
+			~FrameLog();
+
+			///Opens an existing log or creates a new one. Throws if the file isn't a frame log.
+			void open(const std::string & filename);
+			void close();
+			bool isOpen() const;
+			const std::string & getFilename() const;
+
+			///Frames must be appended in time order. The payload is moved into the log.
+			void append(const Time &, std::string && payload);
+
+			///Writes any frames which are still in memory, and waits until they are on disk (or have failed to write)
+			void flush();
+
+			///The last error from writing a chunk (empty if every chunk has been written), and the frames lost to errors
+			std::string getWriteError() const;
+			size_t getDroppedFrameCount() const;
+
+			size_t getFrameCount() const;
+			bool empty() const;
+			Time getFirstTime() const;
+			Time getLastTime() const;
+
+			///Only chunks which have been flushed (i.e. not frames still being gathered) are in the index
+			size_t getChunkCount() const;
+			ChunkInfo getChunkInfo(size_t chunkIndex) const;
+
+			///The first chunk with a frame at or after this time (getChunkCount() if there isn't one)
+			size_t findChunk(const Time &) const;
+
+			///Copies the frames of a chunk out of the file
+			void readChunk(size_t chunkIndex, std::vector<Time> & times, std::vector<std::string> & payloads) const;
+
+			///Streams the frames into a new file (chunk by chunk) which then replaces this one.
+			///The function can change each frame's time, or return false to drop the frame. Times must stay in order.
+			void rewrite(const std::function<bool(Time &)> &);
+
+			///Flushes and copies the file (e.g. into the project folder). The log stays open at its current filename.
+			void copyTo(const std::string & filename);
+
+			///Removes all frames (the file is truncated)
+			void clear();
+
+			size_t maxChunkFrames = 256;
+			size_t maxChunkBytes = 4 * 1024 * 1024;
+		protected:
+			struct PendingChunk {
+				std::vector<Time> times;
+				std::vector<std::string> payloads;
+				size_t payloadBytes = 0;
+			};
+
+			void queueCurrentChunk();
+			void writerThreadFunction();
+			void writeChunk(const PendingChunk &, size_t chunkOffset);
+			void scan();
+			void map() const;
+
+			std::string filename;
+
+			//index of chunks on disk (or queued for disk)
+			std::vector<ChunkInfo> chunks;
+			size_t fileSize = 0; // including queued chunks
+			size_t frameCount = 0; // including frames which are still being gathered
+			size_t writtenChunkCount = 0;
+			PendingChunk currentChunk;
+			mutable std::mutex indexMutex;
+
+			//background writer
+			std::deque<std::shared_ptr<PendingChunk>> writeQueue;
+			mutable std::condition_variable writeQueueChanged; // also notified when a chunk has been written
+			std::thread writerThread;
+			bool writerThreadRunning = false;
+			std::string writeError;
+			size_t droppedFrameCount = 0;
+
+			//the mapping is released whilst writing, and mapped again when next read
+			mutable std::unique_ptr<Poco::SharedMemory> memory;
+			mutable std::mutex fileMutex;
+		};
+	}
+}
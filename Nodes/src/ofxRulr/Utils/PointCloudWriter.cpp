@@ -0,0 +1,171 @@
+#include "pch_RulrNodes.h"
+#include "PointCloudWriter.h"
+
+#include "ofxRulr/Exception.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			const char magic[8] = { 'R', 'U', 'L', 'R', 'P', 'N', 'T', 'S' };
+			const uint32_t version = 1;
+			const int vertexCountDigits = 10;
+
+			enum Flags : uint32_t {
+				TexCoords = 1,
+				Colors = 2
+			};
+
+			//----------
+			template<typename T>
+			void append(vector<char> & buffer, const T & value) {
+				auto bytes = (const char *) &value;
+				buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+			}
+
+			//----------
+			void append(vector<char> & buffer, const void * data, size_t size) {
+				auto bytes = (const char *) data;
+				buffer.insert(buffer.end(), bytes, bytes + size);
+			}
+		}
+
+		//----------
+		PointCloudWriter::PointCloudWriter(const string & filename, Format format, bool hasTexCoords, bool hasColors)
+		: filename(filename)
+		, format(format)
+		, hasTexCoords(hasTexCoords)
+		, hasColors(hasColors) {
+			this->file.open(ofToDataPath(filename).c_str(), ios::out | ios::binary | ios::trunc);
+			if (!this->file.is_open()) {
+				throw(ofxRulr::Exception("Couldn't open [" + filename + "] for writing"));
+			}
+
+			switch (format) {
+			case Format::PLY:
+			{
+				this->file << "ply\n"
+					<< "format binary_little_endian 1.0\n"
+					<< "comment ofxRulr\n"
+					<< "element vertex ";
+				this->vertexCountPosition = this->file.tellp();
+				this->file << string(vertexCountDigits, '0') << "\n"
+					<< "property float x\n"
+					<< "property float y\n"
+					<< "property float z\n";
+				if (hasTexCoords) {
+					this->file << "property float u\n"
+						<< "property float v\n";
+				}
+				if (hasColors) {
+					this->file << "property uchar red\n"
+						<< "property uchar green\n"
+						<< "property uchar blue\n";
+				}
+				this->file << "end_header\n";
+				break;
+			}
+			case Format::Chunked:
+			{
+				uint32_t flags = 0;
+				if (hasTexCoords) {
+					flags |= Flags::TexCoords;
+				}
+				if (hasColors) {
+					flags |= Flags::Colors;
+				}
+				this->file.write(magic, sizeof(magic));
+				this->file.write((const char *) &version, sizeof(version));
+				this->file.write((const char *) &flags, sizeof(flags));
+				break;
+			}
+			}
+		}
+
+		//----------
+		PointCloudWriter::~PointCloudWriter() {
+			try {
+				this->close();
+			}
+			RULR_CATCH_ALL_TO_ERROR;
+		}
+
+		//----------
+		void PointCloudWriter::write(const ofVec3f * positions
+			, const ofVec2f * texCoords
+			, const uint8_t * luminances
+			, size_t count) {
+			if (!this->file.is_open()) {
+				throw(ofxRulr::Exception("PointCloudWriter is closed"));
+			}
+			if (count == 0) {
+				return;
+			}
+
+			//ofVec3f / ofVec2f are packed floats, so they can be copied as they are
+			this->buffer.clear();
+			switch (this->format) {
+			case Format::PLY:
+				//interleaved vertices
+				for (size_t i = 0; i < count; i++) {
+					append(this->buffer, positions[i]);
+					if (this->hasTexCoords) {
+						append(this->buffer, texCoords[i]);
+					}
+					if (this->hasColors) {
+						const uint8_t color[3] = { luminances[i], luminances[i], luminances[i] };
+						append(this->buffer, color, sizeof(color));
+					}
+				}
+				break;
+			case Format::Chunked:
+				append(this->buffer, (uint32_t) count);
+				append(this->buffer, positions, sizeof(ofVec3f) * count);
+				if (this->hasTexCoords) {
+					append(this->buffer, texCoords, sizeof(ofVec2f) * count);
+				}
+				if (this->hasColors) {
+					append(this->buffer, luminances, count);
+				}
+				break;
+			}
+
+			this->file.write(this->buffer.data(), this->buffer.size());
+			this->pointCount += count;
+		}
+
+		//----------
+		void PointCloudWriter::close() {
+			if (!this->file.is_open()) {
+				return;
+			}
+
+			if (this->format == Format::PLY) {
+				auto vertexCount = ofToString(this->pointCount, vertexCountDigits, '0');
+				if (vertexCount.size() > vertexCountDigits) {
+					this->file.close();
+					throw(ofxRulr::Exception("Too many points for PLY header in [" + this->filename + "]"));
+				}
+				this->file.seekp(this->vertexCountPosition);
+				this->file << vertexCount;
+			}
+
+			auto failed = this->file.fail();
+			this->file.close();
+			if (failed) {
+				throw(ofxRulr::Exception("Failed to write [" + this->filename + "]"));
+			}
+		}
+
+		//----------
+		size_t PointCloudWriter::getPointCount() const {
+			return this->pointCount;
+		}
+
+		//----------
+		PointCloudWriter::Format PointCloudWriter::getFormatForFilename(const string & filename) {
+			return ofToLower(ofFilePath::getFileExt(filename)) == "ply"
+				? Format::PLY
+				: Format::Chunked;
+		}
+	}
+}
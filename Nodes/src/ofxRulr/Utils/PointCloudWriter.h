@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ofVec2f.h"
+#include "ofVec3f.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Writes a point cloud to disk as it arrives, so that the whole cloud never needs to be in memory.
+		///
+		///PLY : binary little endian, vertex properties x, y, z [, u, v] [, red, green, blue]. The vertex count is
+		/// written with leading zeros when the file is opened and overwritten on close.
+		///
+		///Chunked (little endian) :
+		/// "RULRPNTS", uint32 version, uint32 flags (1 = tex coords, 2 = colors), then the chunks. Each chunk is :
+		/// uint32 point count, float32 xyz per point, [float32 uv per point], [uint8 luminance per point]
+		///A file which is cut short loses only its last chunk.
+		class PointCloudWriter {
+		public:
+			enum class Format {
+				PLY,
+				Chunked
+			};
+
+			///Throws if the file can't be opened
+			PointCloudWriter(const std::string & filename, Format, bool hasTexCoords, bool hasColors);
+			~PointCloudWriter();
+
+			///texCoords / luminances are ignored if the file doesn't have them
+			void write(const ofVec3f * positions
+				, const ofVec2f * texCoords
+				, const uint8_t * luminances
+				, size_t count);
+
+			///Writes the vertex count (for PLY) and closes the file. Throws if the file couldn't be written.
+			void close();
+
+			size_t getPointCount() const;
+
+			///.ply is PLY, anything else is Chunked
+			static Format getFormatForFilename(const std::string &);
+		protected:
+			std::ofstream file;
+			std::string filename;
+			Format format;
+			bool hasTexCoords;
+			bool hasColors;
+			size_t pointCount = 0;
+			std::streampos vertexCountPosition; // for PLY
+			std::vector<char> buffer;
+		};
+	}
+}
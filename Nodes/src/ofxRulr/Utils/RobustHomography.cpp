@@ -0,0 +1,453 @@
+#include "pch_RulrNodes.h"
+#include "RobustHomography.h"
+
+#include "ofxRulr/Exception.h"
+#include "ofxRulr/Utils/ThreadPool.h"
+
+#include "opencv2/calib3d/calib3d.hpp"
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			//----------
+			uint32_t nextRandom(uint32_t & state) {
+				//xorshift32
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				return state;
+			}
+
+			//----------
+			double cross(const cv::Point2f & a, const cv::Point2f & b, const cv::Point2f & c) {
+				return ((double) b.x - a.x) * ((double) c.y - a.y) - ((double) b.y - a.y) * ((double) c.x - a.x);
+			}
+
+			//----------
+			bool hasCollinearTriple(const cv::Point2f * points, double minimumArea) {
+				for (int i = 0; i < 4; i++) {
+					//the triple which leaves out point i
+					const auto & a = points[(i + 1) % 4];
+					const auto & b = points[(i + 2) % 4];
+					const auto & c = points[(i + 3) % 4];
+					if (abs(cross(a, b, c)) < minimumArea) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			//----------
+			//translate to the centroid and scale to a mean distance of sqrt(2)
+			void getNormalization(const cv::Point2f * points, double & offsetX, double & offsetY, double & scale) {
+				offsetX = 0.0;
+				offsetY = 0.0;
+				for (int i = 0; i < 4; i++) {
+					offsetX += points[i].x;
+					offsetY += points[i].y;
+				}
+				offsetX /= 4.0;
+				offsetY /= 4.0;
+
+				double meanDistance = 0.0;
+				for (int i = 0; i < 4; i++) {
+					meanDistance += sqrt((points[i].x - offsetX) * (points[i].x - offsetX) + (points[i].y - offsetY) * (points[i].y - offsetY));
+				}
+				meanDistance /= 4.0;
+				scale = meanDistance > 0.0 ? sqrt(2.0) / meanDistance : 1.0;
+			}
+
+			//----------
+			//the homography (h[8] = 1) which maps 4 source points onto 4 target points, by solving the 8x8 linear system
+			bool solveMinimal(const cv::Point2f * sources, const cv::Point2f * targets, double * h) {
+				double sourceX, sourceY, sourceScale, targetX, targetY, targetScale;
+				getNormalization(sources, sourceX, sourceY, sourceScale);
+				getNormalization(targets, targetX, targetY, targetScale);
+
+				double A[8][9];
+				for (int i = 0; i < 4; i++) {
+					const auto x = (sources[i].x - sourceX) * sourceScale;
+					const auto y = (sources[i].y - sourceY) * sourceScale;
+					const auto u = (targets[i].x - targetX) * targetScale;
+					const auto v = (targets[i].y - targetY) * targetScale;
+
+					double rowU[9] = { x, y, 1, 0, 0, 0, -x * u, -y * u, u };
+					double rowV[9] = { 0, 0, 0, x, y, 1, -x * v, -y * v, v };
+					memcpy(A[i * 2], rowU, sizeof(rowU));
+					memcpy(A[i * 2 + 1], rowV, sizeof(rowV));
+				}
+
+				//gaussian elimination with partial pivoting
+				for (int column = 0; column < 8; column++) {
+					int pivot = column;
+					for (int row = column + 1; row < 8; row++) {
+						if (abs(A[row][column]) > abs(A[pivot][column])) {
+							pivot = row;
+						}
+					}
+					if (abs(A[pivot][column]) < 1e-12) {
+						return false;
+					}
+					if (pivot != column) {
+						swap(A[pivot], A[column]);
+					}
+					for (int row = column + 1; row < 8; row++) {
+						const auto factor = A[row][column] / A[column][column];
+						for (int k = column; k < 9; k++) {
+							A[row][k] -= factor * A[column][k];
+						}
+					}
+				}
+				double normalized[9];
+				for (int row = 7; row >= 0; row--) {
+					auto value = A[row][8];
+					for (int k = row + 1; k < 8; k++) {
+						value -= A[row][k] * normalized[k];
+					}
+					normalized[row] = value / A[row][row];
+				}
+				normalized[8] = 1.0;
+
+				//h = targetNormalization^-1 * normalized * sourceNormalization
+				const double N[3][3] = {
+					{ normalized[0], normalized[1], normalized[2] }
+					, { normalized[3], normalized[4], normalized[5] }
+					, { normalized[6], normalized[7], normalized[8] }
+				};
+				const double S[3][3] = {
+					{ sourceScale, 0, -sourceScale * sourceX }
+					, { 0, sourceScale, -sourceScale * sourceY }
+					, { 0, 0, 1 }
+				};
+				const double TInverse[3][3] = {
+					{ 1.0 / targetScale, 0, targetX }
+					, { 0, 1.0 / targetScale, targetY }
+					, { 0, 0, 1 }
+				};
+				double NS[3][3];
+				for (int i = 0; i < 3; i++) {
+					for (int j = 0; j < 3; j++) {
+						NS[i][j] = N[i][0] * S[0][j] + N[i][1] * S[1][j] + N[i][2] * S[2][j];
+					}
+				}
+				for (int i = 0; i < 3; i++) {
+					for (int j = 0; j < 3; j++) {
+						h[i * 3 + j] = TInverse[i][0] * NS[0][j] + TInverse[i][1] * NS[1][j] + TInverse[i][2] * NS[2][j];
+					}
+				}
+
+				if (abs(h[8]) < 1e-12) {
+					return false;
+				}
+				const auto normalize = 1.0 / h[8];
+				for (int i = 0; i < 9; i++) {
+					h[i] *= normalize;
+					if (!std::isfinite(h[i])) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			//----------
+			//squared transfer error, or a negative value if the point maps to infinity
+			double getSquaredError(const double * h, const cv::Point2f & source, const cv::Point2f & target) {
+				const auto w = h[6] * source.x + h[7] * source.y + h[8];
+				if (abs(w) < 1e-12) {
+					return -1.0;
+				}
+				const auto dx = (h[0] * source.x + h[1] * source.y + h[2]) / w - target.x;
+				const auto dy = (h[3] * source.x + h[4] * source.y + h[5]) / w - target.y;
+				return dx * dx + dy * dy;
+			}
+		}
+
+		//----------
+		RobustHomography::RobustHomography(const cv::Size & sourceSize, const Settings & settings)
+		: settings(settings)
+		, sourceSize(sourceSize) {
+			this->settings.gridSize = max(this->settings.gridSize, 2);
+			this->settings.samplesPerCell = max(this->settings.samplesPerCell, 1);
+			this->cellScale.x = (float) this->settings.gridSize / (float) max(sourceSize.width, 1);
+			this->cellScale.y = (float) this->settings.gridSize / (float) max(sourceSize.height, 1);
+
+			const auto cellCount = (size_t) this->settings.gridSize * this->settings.gridSize;
+			this->reservoirSources.resize(cellCount * this->settings.samplesPerCell);
+			this->reservoirTargets.resize(cellCount * this->settings.samplesPerCell);
+			this->seenPerCell.assign(cellCount, 0);
+			this->randomState = this->settings.seed * 2654435761u + 1;
+		}
+
+		//----------
+		void RobustHomography::add(const cv::Point2f & source, const cv::Point2f & target) {
+			const auto gridSize = this->settings.gridSize;
+			const auto cellX = min(max((int) (source.x * this->cellScale.x), 0), gridSize - 1);
+			const auto cellY = min(max((int) (source.y * this->cellScale.y), 0), gridSize - 1);
+			const auto cellIndex = cellX + cellY * gridSize;
+
+			//reservoir sampling : the n'th correspondence in a cell replaces a random slot with probability samplesPerCell / n
+			auto & seen = this->seenPerCell[cellIndex];
+			const auto samplesPerCell = (uint32_t) this->settings.samplesPerCell;
+			uint32_t slot;
+			if (seen < samplesPerCell) {
+				slot = seen;
+			}
+			else {
+				slot = nextRandom(this->randomState) % (seen + 1);
+			}
+			seen++;
+
+			if (slot < samplesPerCell) {
+				const auto index = (size_t) cellIndex * samplesPerCell + slot;
+				this->reservoirSources[index] = source;
+				this->reservoirTargets[index] = target;
+			}
+			this->correspondenceCount++;
+			this->gathered = false;
+		}
+
+		//----------
+		void RobustHomography::transformSources(const function<void(vector<cv::Point2f> &)> & transform) {
+			this->gatherSamples();
+			if (!this->sources.empty()) {
+				transform(this->sources);
+			}
+		}
+
+		//----------
+		RobustHomography::Result RobustHomography::find() {
+			this->gatherSamples();
+
+			const auto sampleCount = this->sources.size();
+			const auto nonEmptyCellCount = this->cellStarts.size() - 1;
+			if (sampleCount < 4 || nonEmptyCellCount < 4) {
+				throw(ofxRulr::Exception("Not enough correspondences to find a homography"));
+			}
+
+			const auto confidence = min(max((double) this->settings.confidence, 0.0), 0.999999);
+			const auto batchSize = (size_t) max(this->settings.batchSize, 1);
+			const auto maximumIterations = (size_t) max(this->settings.maximumIterations, 1);
+
+			Hypothesis best;
+			best.cost = numeric_limits<double>::max();
+			best.inlierCount = 0;
+			bool found = false;
+
+			size_t iterations = 0;
+			size_t requiredIterations = maximumIterations;
+			vector<Hypothesis> batch(batchSize);
+			auto randomState = this->settings.seed * 2246822519u + 7;
+
+			while (iterations < requiredIterations) {
+				//make the hypotheses here so that the sequence doesn't depend on the threads
+				size_t hypothesisCount = 0;
+				for (size_t i = 0; i < batchSize && iterations < requiredIterations; i++) {
+					iterations++;
+					if (this->makeHypothesis(randomState, batch[hypothesisCount])) {
+						hypothesisCount++;
+					}
+				}
+
+				const auto costLimit = best.cost;
+				ThreadPool::X().parallelFor(0, hypothesisCount, [this, &batch, costLimit](size_t i) {
+					this->scoreHypothesis(batch[i], costLimit);
+				}, 1, ThreadPool::Priority::Batch);
+
+				for (size_t i = 0; i < hypothesisCount; i++) {
+					if (batch[i].cost < best.cost) {
+						best = batch[i];
+						found = true;
+					}
+				}
+
+				//how many hypotheses we need to have drawn an all inlier sample at least once
+				if (best.inlierCount > 0) {
+					const auto inlierRatio = (double) best.inlierCount / (double) sampleCount;
+					const auto allInlierProbability = pow(inlierRatio, 4);
+					if (allInlierProbability >= 1.0) {
+						requiredIterations = iterations;
+					}
+					else if (allInlierProbability > 0.0) {
+						const auto required = log(1.0 - confidence) / log(1.0 - allInlierProbability);
+						requiredIterations = min(maximumIterations, (size_t) ceil(required));
+					}
+				}
+			}
+
+			if (!found) {
+				throw(ofxRulr::Exception("No homography hypothesis could be made from the correspondences"));
+			}
+
+			Result result;
+			result.correspondenceCount = this->correspondenceCount;
+			result.sampleCount = sampleCount;
+			result.iterations = iterations;
+			this->refine(best.h, result.homography, result.inlierCount, result.rmsError);
+			return result;
+		}
+
+		//----------
+		vector<float> RobustHomography::getTransferErrors(const cv::Mat & homography
+			, const vector<cv::Point2f> & sources
+			, const vector<cv::Point2f> & targets) {
+			double h[9];
+			cv::Mat homography64;
+			homography.convertTo(homography64, CV_64F);
+			memcpy(h, homography64.ptr<double>(), sizeof(h));
+
+			vector<float> errors(sources.size());
+			const size_t chunkSize = 1 << 16;
+			const auto chunkCount = (sources.size() + chunkSize - 1) / chunkSize;
+			ThreadPool::X().parallelFor(0, chunkCount, [&](size_t chunkIndex) {
+				const auto end = min(sources.size(), (chunkIndex + 1) * chunkSize);
+				for (auto i = chunkIndex * chunkSize; i < end; i++) {
+					const auto squaredError = getSquaredError(h, sources[i], targets[i]);
+					errors[i] = squaredError < 0.0
+						? numeric_limits<float>::infinity()
+						: (float) sqrt(squaredError);
+				}
+			}, 1, ThreadPool::Priority::Batch);
+			return errors;
+		}
+
+		//----------
+		void RobustHomography::gatherSamples() {
+			if (this->gathered) {
+				return;
+			}
+
+			this->sources.clear();
+			this->targets.clear();
+			this->cellStarts.clear();
+
+			const auto samplesPerCell = (uint32_t) this->settings.samplesPerCell;
+			for (size_t cellIndex = 0; cellIndex < this->seenPerCell.size(); cellIndex++) {
+				const auto count = min(this->seenPerCell[cellIndex], samplesPerCell);
+				if (count == 0) {
+					continue;
+				}
+				this->cellStarts.push_back((uint32_t) this->sources.size());
+				const auto begin = cellIndex * samplesPerCell;
+				this->sources.insert(this->sources.end(), this->reservoirSources.begin() + begin, this->reservoirSources.begin() + begin + count);
+				this->targets.insert(this->targets.end(), this->reservoirTargets.begin() + begin, this->reservoirTargets.begin() + begin + count);
+			}
+			this->cellStarts.push_back((uint32_t) this->sources.size());
+
+			this->gathered = true;
+		}
+
+		//----------
+		bool RobustHomography::makeHypothesis(uint32_t & randomState, Hypothesis & hypothesis) const {
+			const auto nonEmptyCellCount = (uint32_t) this->cellStarts.size() - 1;
+
+			//4 different cells, then a sample from each
+			uint32_t cells[4];
+			for (int i = 0; i < 4; i++) {
+				bool unique;
+				do {
+					cells[i] = nextRandom(randomState) % nonEmptyCellCount;
+					unique = true;
+					for (int j = 0; j < i; j++) {
+						if (cells[j] == cells[i]) {
+							unique = false;
+						}
+					}
+				} while (!unique);
+			}
+
+			cv::Point2f sources[4];
+			cv::Point2f targets[4];
+			for (int i = 0; i < 4; i++) {
+				const auto begin = this->cellStarts[cells[i]];
+				const auto count = this->cellStarts[cells[i] + 1] - begin;
+				const auto index = begin + nextRandom(randomState) % count;
+				sources[i] = this->sources[index];
+				targets[i] = this->targets[index];
+			}
+
+			if (hasCollinearTriple(sources, 1.0) || hasCollinearTriple(targets, 1.0)) {
+				return false;
+			}
+			return solveMinimal(sources, targets, hypothesis.h);
+		}
+
+		//----------
+		void RobustHomography::scoreHypothesis(Hypothesis & hypothesis, double costLimit) const {
+			const auto thresholdSquared = (double) this->settings.inlierThreshold * this->settings.inlierThreshold;
+			const auto count = this->sources.size();
+
+			double cost = 0.0;
+			size_t inlierCount = 0;
+			for (size_t i = 0; i < count; i++) {
+				const auto squaredError = getSquaredError(hypothesis.h, this->sources[i], this->targets[i]);
+				if (squaredError >= 0.0 && squaredError < thresholdSquared) {
+					cost += squaredError;
+					inlierCount++;
+				}
+				else {
+					cost += thresholdSquared;
+				}
+
+				//give up once this can't beat the best so far
+				if ((i & 0xff) == 0xff && cost > costLimit) {
+					break;
+				}
+			}
+			hypothesis.cost = cost;
+			hypothesis.inlierCount = inlierCount;
+		}
+
+		//----------
+		void RobustHomography::refine(const double * h, cv::Mat & refined, size_t & inlierCount, double & rmsError) const {
+			const auto thresholdSquared = (double) this->settings.inlierThreshold * this->settings.inlierThreshold;
+
+			cv::Mat homography(3, 3, CV_64F);
+			memcpy(homography.ptr<double>(), h, sizeof(double) * 9);
+
+			vector<cv::Point2f> inlierSources;
+			vector<cv::Point2f> inlierTargets;
+			auto findInliers = [&](const cv::Mat & candidate) {
+				auto values = candidate.ptr<double>();
+				inlierSources.clear();
+				inlierTargets.clear();
+				double sumSquaredError = 0.0;
+				for (size_t i = 0; i < this->sources.size(); i++) {
+					const auto squaredError = getSquaredError(values, this->sources[i], this->targets[i]);
+					if (squaredError >= 0.0 && squaredError < thresholdSquared) {
+						inlierSources.push_back(this->sources[i]);
+						inlierTargets.push_back(this->targets[i]);
+						sumSquaredError += squaredError;
+					}
+				}
+				return inlierSources.empty()
+					? 0.0
+					: sqrt(sumSquaredError / (double) inlierSources.size());
+			};
+
+			rmsError = findInliers(homography);
+			for (int iteration = 0; iteration < this->settings.refineIterations && inlierSources.size() >= 4; iteration++) {
+				//least squares (with OpenCV's own Levenberg-Marquardt polish) on the inliers
+				cv::Mat candidate = cv::findHomography(inlierSources, inlierTargets, 0);
+				if (candidate.empty()) {
+					break;
+				}
+				candidate.convertTo(candidate, CV_64F);
+
+				const auto previousInlierCount = inlierSources.size();
+				const auto previousRmsError = rmsError;
+				const auto candidateRmsError = findInliers(candidate);
+				if (inlierSources.size() < previousInlierCount
+					|| (inlierSources.size() == previousInlierCount && candidateRmsError >= previousRmsError)) {
+					//no better, so keep what we had
+					rmsError = findInliers(homography);
+					break;
+				}
+				homography = candidate;
+				rmsError = candidateRmsError;
+			}
+
+			refined = homography;
+			inlierCount = inlierSources.size();
+		}
+	}
+}
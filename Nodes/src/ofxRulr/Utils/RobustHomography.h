@@ -0,0 +1,84 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Robust homography for dense correspondences (e.g. every active pixel of a structured light scan).
+		///Correspondences are stratified over a grid on the source image as they are added : each cell keeps a uniform
+		/// random sample of at most samplesPerCell of the correspondences which land in it (reservoir sampling), so the
+		/// full set is never stored.
+		///Each hypothesis is made from 4 samples in 4 different cells (so that they're spread over the image), and
+		/// hypotheses are scored in parallel batches with MSAC (truncated squared transfer error). We stop once the best
+		/// inlier ratio so far says that further hypotheses are unlikely to do better (at the requested confidence).
+		///The best hypothesis is then refined by least squares on its inliers, repeated whilst the inliers change.
+		class RobustHomography {
+		public:
+			struct Settings {
+				int gridSize = 32; // cells along each side of the source image
+				int samplesPerCell = 16;
+				float inlierThreshold = 2.0f; // [px] transfer error in the target image
+				float confidence = 0.999f;
+				int maximumIterations = 5000;
+				int batchSize = 64; // hypotheses scored in parallel between termination checks
+				int refineIterations = 3;
+				uint32_t seed = 0;
+			};
+
+			struct Result {
+				cv::Mat homography; // 3x3 CV_64F, source to target
+				size_t correspondenceCount = 0; // added
+				size_t sampleCount = 0; // kept by the stratification
+				size_t inlierCount = 0; // of the samples
+				size_t iterations = 0; // hypotheses scored
+				double rmsError = 0.0; // [px] over the inliers
+			};
+
+			RobustHomography(const cv::Size & sourceSize, const Settings &);
+
+			void add(const cv::Point2f & source, const cv::Point2f & target);
+
+			///Change the sampled source points in place (e.g. to undistort them). Call after adding all correspondences.
+			void transformSources(const std::function<void(std::vector<cv::Point2f> &)> &);
+
+			///Throws if there aren't enough samples or no hypothesis is found
+			Result find();
+
+			///Transfer errors [px] of source -> target for each correspondence under the homography (computed in parallel)
+			static std::vector<float> getTransferErrors(const cv::Mat & homography
+				, const std::vector<cv::Point2f> & sources
+				, const std::vector<cv::Point2f> & targets);
+		protected:
+			struct Hypothesis {
+				double h[9];
+				double cost;
+				size_t inlierCount;
+			};
+
+			void gatherSamples();
+			bool makeHypothesis(uint32_t & randomState, Hypothesis &) const;
+			void scoreHypothesis(Hypothesis &, double costLimit) const;
+			void refine(const double * h, cv::Mat & refined, size_t & inlierCount, double & rmsError) const;
+
+			Settings settings;
+			cv::Size sourceSize;
+			cv::Point2f cellScale;
+			size_t correspondenceCount = 0;
+
+			//reservoirs, samplesPerCell slots per cell
+			std::vector<cv::Point2f> reservoirSources;
+			std::vector<cv::Point2f> reservoirTargets;
+			std::vector<uint32_t> seenPerCell;
+			uint32_t randomState;
+
+			//gathered from the reservoirs, ordered by cell
+			std::vector<cv::Point2f> sources;
+			std::vector<cv::Point2f> targets;
+			std::vector<uint32_t> cellStarts; // of the non-empty cells (plus one past the end)
+			bool gathered = false;
+		};
+	}
+}
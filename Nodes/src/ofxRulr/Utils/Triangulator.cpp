@@ -0,0 +1,266 @@
+#include "pch_RulrNodes.h"
+#include "Triangulator.h"
+
+#include "ofxRulr/Utils/ThreadPool.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace {
+			//flat per-tile working arrays, reused by each worker
+			struct Scratch {
+				vector<uint32_t> cameraIndices;
+				vector<float> cameraX;
+				vector<float> cameraY;
+				vector<cv::Point2f> distortedPoints;
+				vector<cv::Point2f> undistortedPoints;
+				vector<float> undistortedX;
+				vector<float> undistortedY;
+				vector<float> projectorX;
+				vector<float> projectorY;
+				vector<float> x;
+				vector<float> y;
+				vector<float> z;
+				vector<float> lengthSquared;
+
+				void clear() {
+					this->cameraIndices.clear();
+					this->cameraX.clear();
+					this->cameraY.clear();
+					this->projectorX.clear();
+					this->projectorY.clear();
+				}
+			};
+		}
+
+		//----------
+		size_t Triangulator::Tile::size() const {
+			return this->positions.size();
+		}
+
+		//----------
+		void Triangulator::Tile::clear() {
+			this->positions.clear();
+			this->texCoords.clear();
+			this->luminances.clear();
+		}
+
+		//----------
+		Triangulator::Triangulator(const ofxRay::Camera & camera
+			, const ofxRay::Projector & projector
+			, const cv::Mat & cameraMatrix
+			, const cv::Mat & distortionCoefficients)
+		: camera(fitRayModel(camera))
+		, projector(fitRayModel(projector)) {
+			if (!distortionCoefficients.empty() && cv::countNonZero(distortionCoefficients) > 0) {
+				if (cameraMatrix.empty()) {
+					throw(ofxRulr::Exception("Triangulator : the camera matrix is needed to undistort the camera"));
+				}
+				cameraMatrix.convertTo(this->cameraMatrix, CV_64F);
+				distortionCoefficients.convertTo(this->distortionCoefficients, CV_64F);
+			}
+		}
+
+		//----------
+		size_t Triangulator::triangulate(const ofxGraycode::DataSet & dataSet
+			, const Settings & settings
+			, const function<void(const Tile &)> & receiver) const {
+			const int height = dataSet.getHeight();
+			const int tileRows = max(settings.tileRows, 1);
+			const size_t tileCount = (height + tileRows - 1) / tileRows;
+			if (tileCount == 0) {
+				return 0;
+			}
+
+			//enough tiles per batch to keep the workers busy whilst bounding what we hold before it's received
+			auto & threadPool = ThreadPool::X();
+			vector<Tile> batch(min<size_t>(max<size_t>(threadPool.getPoolSize(), 1) * 4, tileCount));
+
+			size_t pointCount = 0;
+			for (size_t batchBegin = 0; batchBegin < tileCount; batchBegin += batch.size()) {
+				const auto batchEnd = min(batchBegin + batch.size(), tileCount);
+				threadPool.parallelFor(batchBegin, batchEnd, [&](size_t tileIndex) {
+					const int rowBegin = (int) tileIndex * tileRows;
+					const int rowEnd = min(rowBegin + tileRows, height);
+					this->triangulateTile(dataSet, settings, rowBegin, rowEnd, batch[tileIndex - batchBegin]);
+				}, 1, ThreadPool::Priority::Batch);
+
+				for (size_t i = 0; i < batchEnd - batchBegin; i++) {
+					const auto & tile = batch[i];
+					if (tile.size() > 0) {
+						receiver(tile);
+						pointCount += tile.size();
+					}
+				}
+			}
+
+			return pointCount;
+		}
+
+		//----------
+		size_t Triangulator::getActiveCount(const ofxGraycode::DataSet & dataSet) {
+			const auto & active = dataSet.getActive();
+			const auto activeData = active.getData();
+			const size_t size = (size_t) dataSet.getWidth() * (size_t) dataSet.getHeight();
+
+			size_t activeCount = 0;
+			for (size_t i = 0; i < size; i++) {
+				activeCount += activeData[i] != 0;
+			}
+			return activeCount;
+		}
+
+		//----------
+		Triangulator::RayModel Triangulator::fitRayModel(const ofxRay::Projector & view) {
+			RayModel rayModel;
+			rayModel.origin = view.getPosition();
+
+			//the point where the ray through a pixel crosses the plane 1 unit in front of the view is affine in the
+			// pixel coordinates (whatever the ray's own origin and length), so 3 pixels define it
+			const auto forward = view.getLookAtDir().getNormalized();
+			auto getPointAtUnitDepth = [&](float x, float y) {
+				const auto ray = view.castPixel(ofVec2f(x, y));
+				const auto along = (1.0f - (ray.s - rayModel.origin).dot(forward)) / ray.t.dot(forward);
+				return ray.s + ray.t * along;
+			};
+
+			const auto width = (float) view.getWidth();
+			const auto height = (float) view.getHeight();
+			const auto topLeft = getPointAtUnitDepth(0.0f, 0.0f);
+			const auto topRight = getPointAtUnitDepth(width, 0.0f);
+			const auto bottomLeft = getPointAtUnitDepth(0.0f, height);
+
+			rayModel.direction = topLeft - rayModel.origin;
+			rayModel.directionPerX = (topRight - topLeft) / width;
+			rayModel.directionPerY = (bottomLeft - topLeft) / height;
+			return rayModel;
+		}
+
+		//----------
+		void Triangulator::triangulateTile(const ofxGraycode::DataSet & dataSet
+			, const Settings & settings
+			, int rowBegin
+			, int rowEnd
+			, Tile & tile) const {
+			tile.clear();
+
+			const int width = dataSet.getWidth();
+			const uint32_t payloadWidth = dataSet.getPayloadWidth();
+			const auto projectorInCamera = dataSet.getData().getData();
+			const auto activeData = dataSet.getActive().getData();
+			const auto medianData = dataSet.getMedian().getData();
+
+			thread_local Scratch scratch;
+			scratch.clear();
+
+			//gather the active pixels
+			for (int y = rowBegin; y < rowEnd; y++) {
+				const auto rowOffset = (uint32_t) (y * width);
+				for (int x = 0; x < width; x++) {
+					const auto cameraIndex = rowOffset + x;
+					if (activeData[cameraIndex]) {
+						const auto projectorIndex = (uint32_t) projectorInCamera[cameraIndex];
+						scratch.cameraIndices.push_back(cameraIndex);
+						scratch.cameraX.push_back((float) x);
+						scratch.cameraY.push_back((float) y);
+						scratch.projectorX.push_back((float) (projectorIndex % payloadWidth));
+						scratch.projectorY.push_back((float) (projectorIndex / payloadWidth));
+					}
+				}
+			}
+
+			const auto count = scratch.cameraIndices.size();
+			if (count == 0) {
+				return;
+			}
+			scratch.x.resize(count);
+			scratch.y.resize(count);
+			scratch.z.resize(count);
+			scratch.lengthSquared.resize(count);
+
+			//the ray model is of an ideal pinhole, so the lens distortion is taken out of the camera pixels first
+			// (keeping the result in pixels of the same camera matrix)
+			auto cameraX = scratch.cameraX.data();
+			auto cameraY = scratch.cameraY.data();
+			if (!this->distortionCoefficients.empty()) {
+				scratch.distortedPoints.resize(count);
+				for (size_t i = 0; i < count; i++) {
+					scratch.distortedPoints[i] = cv::Point2f(cameraX[i], cameraY[i]);
+				}
+				cv::undistortPoints(scratch.distortedPoints
+					, scratch.undistortedPoints
+					, this->cameraMatrix
+					, this->distortionCoefficients
+					, cv::noArray()
+					, this->cameraMatrix);
+
+				scratch.undistortedX.resize(count);
+				scratch.undistortedY.resize(count);
+				for (size_t i = 0; i < count; i++) {
+					scratch.undistortedX[i] = scratch.undistortedPoints[i].x;
+					scratch.undistortedY[i] = scratch.undistortedPoints[i].y;
+				}
+				cameraX = scratch.undistortedX.data();
+				cameraY = scratch.undistortedY.data();
+			}
+
+			//closest points between the lines o1 + s * d1 and o2 + t * d2. Parallel rays give inf / nan, which fail the
+			// length test below
+			{
+				const auto & cameraRays = this->camera;
+				const auto & projectorRays = this->projector;
+				const auto w0 = cameraRays.origin - projectorRays.origin;
+
+				const auto projectorX = scratch.projectorX.data();
+				const auto projectorY = scratch.projectorY.data();
+				auto outX = scratch.x.data();
+				auto outY = scratch.y.data();
+				auto outZ = scratch.z.data();
+				auto outLengthSquared = scratch.lengthSquared.data();
+
+				for (size_t i = 0; i < count; i++) {
+					const auto d1x = cameraRays.direction.x + cameraX[i] * cameraRays.directionPerX.x + cameraY[i] * cameraRays.directionPerY.x;
+					const auto d1y = cameraRays.direction.y + cameraX[i] * cameraRays.directionPerX.y + cameraY[i] * cameraRays.directionPerY.y;
+					const auto d1z = cameraRays.direction.z + cameraX[i] * cameraRays.directionPerX.z + cameraY[i] * cameraRays.directionPerY.z;
+					const auto d2x = projectorRays.direction.x + projectorX[i] * projectorRays.directionPerX.x + projectorY[i] * projectorRays.directionPerY.x;
+					const auto d2y = projectorRays.direction.y + projectorX[i] * projectorRays.directionPerX.y + projectorY[i] * projectorRays.directionPerY.y;
+					const auto d2z = projectorRays.direction.z + projectorX[i] * projectorRays.directionPerX.z + projectorY[i] * projectorRays.directionPerY.z;
+
+					const auto a = d1x * d1x + d1y * d1y + d1z * d1z;
+					const auto b = d1x * d2x + d1y * d2y + d1z * d2z;
+					const auto c = d2x * d2x + d2y * d2y + d2z * d2z;
+					const auto d = d1x * w0.x + d1y * w0.y + d1z * w0.z;
+					const auto e = d2x * w0.x + d2y * w0.y + d2z * w0.z;
+					const auto inverseDenominator = 1.0f / (a * c - b * b);
+					const auto s = (b * e - c * d) * inverseDenominator;
+					const auto t = (a * e - b * d) * inverseDenominator;
+
+					const auto p1x = cameraRays.origin.x + s * d1x;
+					const auto p1y = cameraRays.origin.y + s * d1y;
+					const auto p1z = cameraRays.origin.z + s * d1z;
+					const auto gapX = projectorRays.origin.x + t * d2x - p1x;
+					const auto gapY = projectorRays.origin.y + t * d2y - p1y;
+					const auto gapZ = projectorRays.origin.z + t * d2z - p1z;
+
+					outX[i] = p1x + 0.5f * gapX;
+					outY[i] = p1y + 0.5f * gapY;
+					outZ[i] = p1z + 0.5f * gapZ;
+					outLengthSquared[i] = gapX * gapX + gapY * gapY + gapZ * gapZ;
+				}
+			}
+
+			//keep the points where the rays (nearly) meet
+			const auto maxLengthSquared = settings.maxLength * settings.maxLength;
+			for (size_t i = 0; i < count; i++) {
+				if (scratch.lengthSquared[i] < maxLengthSquared) {
+					tile.positions.emplace_back(scratch.x[i], scratch.y[i], scratch.z[i]);
+					if (settings.giveTexCoords) {
+						tile.texCoords.emplace_back(scratch.cameraX[i], scratch.cameraY[i]);
+					}
+					if (settings.giveColor) {
+						tile.luminances.push_back(medianData[scratch.cameraIndices[i]]);
+					}
+				}
+			}
+		}
+	}
+}
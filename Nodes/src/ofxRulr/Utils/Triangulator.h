@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ofxGraycode.h"
+#include "ofxRay.h"
+
+#include <functional>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Triangulates a graycode scan by intersecting the camera ray and the projector ray of each active camera pixel.
+		///For an ideal pinhole, the (unnormalised) direction of the ray through a pixel is an affine function of the
+		/// pixel's coordinates. We fit that function once per view from the view's own castPixel, and then each point
+		/// is the closed form midpoint of the shortest segment between its two rays. If the camera's distortion
+		/// coefficients are given, its pixels are undistorted (per tile, with cv::undistortPoints) before they meet the
+		/// model. The projector is taken as undistorted.
+		///Rows of the camera image are split into tiles which are solved in parallel. Each tile is gathered into flat
+		/// arrays and solved in branch free loops (so that the compiler can vectorise them), then points whose rays pass
+		/// further apart than maxLength are dropped.
+		///Tiles are handed to the receiver in order on the calling thread, one batch at a time, so the whole point cloud
+		/// is never held in memory.
+		class Triangulator {
+		public:
+			struct Settings {
+				float maxLength = 0.05f; // [m] distance between the camera ray and the projector ray
+				bool giveColor = true;
+				bool giveTexCoords = true;
+				int tileRows = 16; // camera rows per tile
+			};
+
+			struct Tile {
+				std::vector<ofVec3f> positions;
+				std::vector<ofVec2f> texCoords; // camera pixel (if giveTexCoords)
+				std::vector<uint8_t> luminances; // median of the scan at the camera pixel (if giveColor)
+
+				size_t size() const;
+				void clear();
+			};
+
+			Triangulator(const ofxRay::Camera & camera
+				, const ofxRay::Projector & projector
+				, const cv::Mat & cameraMatrix = cv::Mat()
+				, const cv::Mat & distortionCoefficients = cv::Mat());
+
+			///Returns the number of points found. The receiver is called for each tile which has points, in camera row order.
+			size_t triangulate(const ofxGraycode::DataSet &
+				, const Settings &
+				, const std::function<void(const Tile &)> & receiver) const;
+
+			static size_t getActiveCount(const ofxGraycode::DataSet &);
+		protected:
+			///direction(x, y) = direction + x * directionPerX + y * directionPerY, for pixel (x, y)
+			struct RayModel {
+				ofVec3f origin;
+				ofVec3f direction;
+				ofVec3f directionPerX;
+				ofVec3f directionPerY;
+			};
+
+			static RayModel fitRayModel(const ofxRay::Projector &);
+
+			void triangulateTile(const ofxGraycode::DataSet &
+				, const Settings &
+				, int rowBegin
+				, int rowEnd
+				, Tile &) const;
+
+			RayModel camera;
+			RayModel projector;
+
+			cv::Mat cameraMatrix;
+			cv::Mat distortionCoefficients; // empty if the camera has no distortion
+		};
+	}
+}
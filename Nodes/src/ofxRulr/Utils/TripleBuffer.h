@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Lock free hand over of the latest value from one writer thread to one reader thread.
+		///The writer fills getWriteBuffer() and then publishes it. The reader fetches the latest published value whenever
+		/// it's ready for one, so values which are published faster than they are read are dropped rather than queued.
+		///Neither side ever waits for the other, and each side only touches its own slot.
+		template<typename T>
+		class TripleBuffer {
+		public:
+			//----------
+			T & getWriteBuffer() {
+				return this->slots[this->writeIndex];
+			}
+
+			//----------
+			///Swap the write buffer into the middle slot
+			void publish() {
+				auto previous = this->middle.exchange(this->writeIndex | FreshFlag, memory_order_acq_rel);
+				this->writeIndex = previous & IndexMask;
+			}
+
+			//----------
+			///Returns true if a new value has been published since the last fetch (the read buffer is then that value)
+			bool fetch() {
+				if (!(this->middle.load(memory_order_acquire) & FreshFlag)) {
+					return false;
+				}
+				auto previous = this->middle.exchange(this->readIndex, memory_order_acq_rel);
+				this->readIndex = previous & IndexMask;
+				return true;
+			}
+
+			//----------
+			const T & getReadBuffer() const {
+				return this->slots[this->readIndex];
+			}
+		protected:
+			static const uint8_t IndexMask = 0x3;
+			static const uint8_t FreshFlag = 0x4;
+
+			T slots[3];
+			uint8_t writeIndex = 0; // owned by the writer
+			uint8_t readIndex = 1; // owned by the reader
+			atomic<uint8_t> middle{ 2 }; // slot index, with FreshFlag if it hasn't been fetched
+		};
+	}
+}
@@ -21,6 +21,12 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			EnttecUsbPro::~EnttecUsbPro() {
+				this->stopOutputThread();
+				this->disconnect();
+			}
+
 			//----------
 			void EnttecUsbPro::init() {
 				RULR_NODE_SERIALIZATION_LISTENERS;
@@ -51,30 +57,35 @@ namespace ofxRulr {
 			void EnttecUsbPro::connect() {
 				this->disconnect();
 
+				//open the port before handing it to the output thread
 				try {
-					this->sender = make_shared<ofSerial>();
-					this->sender->setup(this->portName.get(), 57600);
-					if (!this->sender->isInitialized()) {
+					auto sender = make_shared<ofSerial>();
+					sender->setup(this->portName.get(), 57600);
+					if (!sender->isInitialized()) {
 						throw(Exception("Failed to open port " + this->portName.get()));
 					}
+
+					lock_guard<mutex> lock(this->outputMutex);
+					this->sender = sender;
 				}
 				RULR_CATCH_ALL_TO_ALERT;
-				if (this->sender && !this->sender->isInitialized()) {
-					this->sender.reset();
-				}
 			}
 
 			//----------
 			void EnttecUsbPro::disconnect() {
-				if (this->sender) {
-					this->sender->close();
-					this->sender.reset();
+				shared_ptr<ofSerial> sender;
+				{
+					lock_guard<mutex> lock(this->outputMutex);
+					swap(sender, this->sender);
+				}
+				if (sender) {
+					sender->close();
 				}
 			}
 
 			//----------
-			void EnttecUsbPro::sendUniverse(UniverseIndex index, shared_ptr<Universe> universe) {
-				if (this->sender && universe) {
+			void EnttecUsbPro::sendUniverse(UniverseIndex index, const Value * channels) {
+				if (this->sender) {
 					//code taken from ofxDmx
 
 					//we only have one universe, so send it
@@ -91,7 +102,7 @@ namespace ofxRulr {
 
 														// data
 					packet[4] = DMX_START_CODE; // first data byte
-					memcpy(packet + 5, universe->getChannels() + 1, 512);
+					memcpy(packet + 5, channels + 1, 512);
 
 					// end
 					packet[packetSize - 1] = DMX_PRO_END_MSG;
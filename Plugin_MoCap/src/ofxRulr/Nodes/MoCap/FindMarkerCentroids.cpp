@@ -9,6 +9,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			FindMarkerCentroids::~FindMarkerCentroids() {
+				this->close();
+			}
+
 			//----------
 			std::string FindMarkerCentroids::getTypeName() const {
 				return "MoCap::FindMarkerCentroids";
@@ -16,14 +21,31 @@ namespace ofxRulr {
 
 			//----------
 			void FindMarkerCentroids::init() {
+				RULR_NODE_INSPECTOR_LISTENER;
+
 				this->manageParameters(this->parameters);
 			}
 
+			//----------
+			void FindMarkerCentroids::populateInspector(ofxCvGui::InspectArguments & inspectArgs) {
+				auto inspector = inspectArgs.inspector;
+				inspector->addButton("Benchmark local difference", [this]() {
+					try {
+						this->benchmarkLocalDifference();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+				inspector->addLiveValue<string>("Benchmark result", [this]() {
+					return this->benchmarkResult;
+				});
+			}
+
 			//----------
 			void FindMarkerCentroids::processFrame(shared_ptr<ofxMachineVision::Frame> incomingFrame) {
 				//create the ouput frame;
 				auto outgoingFrame = make_shared<FindMarkerCentroidsFrame>();
 				outgoingFrame->imageFrame = incomingFrame; 
+				outgoingFrame->arrivalTime = this->getArrivalTime();
 
 				//convert to grayscale if needs be
 				outgoingFrame->image = ofxCv::toCv(incomingFrame->getPixels());
@@ -42,45 +64,139 @@ namespace ofxRulr {
 					throw(ofxRulr::Exception("Image format not supported by FindContourMarkers"));
 				}
 
+				auto workspace = this->borrowWorkspace();
+
 				//local difference
+				this->processLocalDifference(*outgoingFrame, *workspace);
+
+				//find the blobs
+				if (this->parameters.blobFinder.useConnectedComponents) {
+					this->findBlobsConnectedComponents(*outgoingFrame, *workspace);
+				}
+				else {
+					this->findBlobsContours(*outgoingFrame);
+				}
+				auto count = outgoingFrame->boundingRects.size();
+
+				//get moments centers
+				outgoingFrame->centroids.reserve(count);
+				for (size_t i = 0; i < count; i++) {
+					const auto & moment = outgoingFrame->moments[i];
+					outgoingFrame->centroids.emplace_back(
+						moment.m10 / moment.m00 + outgoingFrame->boundingRects[i].x - outgoingFrame->dilationSize
+						, moment.m01 / moment.m00 + outgoingFrame->boundingRects[i].y - outgoingFrame->dilationSize
+					);
+				}
+
+				//keep for benchmarking (the frame holds the camera frame which owns the pixels)
 				{
-					//iterative blur
-					{
-						int blurSize = this->parameters.localDifference.blurSize;
-
-						cv::blur(outgoingFrame->image, outgoingFrame->blurred, cv::Size(blurSize / 2, blurSize / 2));
-						blurSize /= 2;
-						while (blurSize > 1) {
-							if (blurSize <= 32) {
-								cv::blur(outgoingFrame->blurred, outgoingFrame->blurred, cv::Size(blurSize, blurSize));
-								break;
-							}
-							cv::blur(outgoingFrame->blurred, outgoingFrame->blurred, cv::Size(blurSize / 2, blurSize / 2));
-							blurSize /= 2;
-						}
+					auto lock = unique_lock<mutex>(this->lastFrameMutex);
+					this->lastFrame = outgoingFrame;
+				}
+
+				//announce the new frame
+				this->emitFrame(outgoingFrame);
+			}
+
+			//----------
+			shared_ptr<FindMarkerCentroids::Workspace> FindMarkerCentroids::borrowWorkspace() {
+				unique_ptr<Workspace> workspace;
+				{
+					auto lock = unique_lock<mutex>(this->idleWorkspacesMutex);
+					if (!this->idleWorkspaces.empty()) {
+						workspace = move(this->idleWorkspaces.back());
+						this->idleWorkspaces.pop_back();
 					}
+				}
+				if (!workspace) {
+					workspace = make_unique<Workspace>();
+				}
+
+				return shared_ptr<Workspace>(workspace.release(), [this](Workspace * workspace) {
+					auto lock = unique_lock<mutex>(this->idleWorkspacesMutex);
+					this->idleWorkspaces.emplace_back(workspace);
+				});
+			}
 
-					outgoingFrame->difference = outgoingFrame->image - outgoingFrame->blurred;
-					outgoingFrame->difference *= this->parameters.localDifference.differenceAmplify;
+			//----------
+			void FindMarkerCentroids::processLocalDifference(FindMarkerCentroidsFrame & frame, Workspace & workspace) {
+				Utils::LocalDifference::Settings settings;
+				{
+					settings.blurSize = (int) this->parameters.localDifference.blurSize.get();
+					settings.threshold = this->parameters.localDifference.threshold.get();
+					settings.differenceAmplify = this->parameters.localDifference.differenceAmplify.get();
+				}
 
-					cv::threshold(outgoingFrame->difference
-						, outgoingFrame->binary
-						, this->parameters.localDifference.threshold
-						, 255
-						, CV_THRESH_BINARY);
+				if (this->parameters.localDifference.useFastKernel) {
+					//the frame is shared with downstream nodes, so it gets its own output images
+					workspace.localDifference.process(frame.image
+						, frame.binary
+						, &frame.difference
+						, settings);
 				}
+				else {
+					Utils::LocalDifference::processOpenCV(frame.image
+						, frame.blurred
+						, frame.difference
+						, frame.binary
+						, settings);
+				}
+			}
+
+			//----------
+			void FindMarkerCentroids::findBlobsConnectedComponents(FindMarkerCentroidsFrame & frame, Workspace & workspace) {
+				auto & blobs = workspace.blobs;
+				workspace.connectedComponents.process(frame.binary
+					, frame.image
+					, blobs
+					, (size_t) this->parameters.blobFinder.bandCount.get());
+
+				frame.boundingRects.reserve(blobs.size());
+				for (const auto & blob : blobs) {
+					const auto & rect = blob.boundingRect;
 
+					//check area
+					if (rect.area() <= this->parameters.contourFilter.minimumArea) {
+						continue;
+					}
+
+					//check if it touches edge of frame
+					if (this->touchesEdge(frame, rect)) {
+						continue;
+					}
+
+					if (blob.m00 <= 0.0) {
+						continue;
+					}
+
+					//moments are relative to the dilated rect (as with the contours method)
+					auto moment = blob.getMoments(cv::Point2i(rect.x - frame.dilationSize, rect.y - frame.dilationSize));
+
+					//check circularity
+					float circularity = 4 * CV_PI * moment.m00 / (blob.perimeter * blob.perimeter) / pow(max(rect.width, rect.height), this->parameters.contourFilter.circularityGamma.get());
+					if (circularity < this->parameters.contourFilter.minimumCircularity.get()) {
+						continue;
+					}
+
+					frame.boundingRects.push_back(rect);
+					frame.moments.push_back(moment);
+					frame.circularity.push_back(circularity);
+				}
+			}
+
+			//----------
+			void FindMarkerCentroids::findBlobsContours(FindMarkerCentroidsFrame & frame) {
 				//find the contours
-				cv::findContours(outgoingFrame->binary
-					, outgoingFrame->contours
+				cv::findContours(frame.binary
+					, frame.contours
 					, CV_RETR_EXTERNAL
 					, CV_CHAIN_APPROX_NONE);
 
-				auto count = outgoingFrame->contours.size();
+				auto count = frame.contours.size();
 
 				//find the bounding rectangles (check if valid also)
-				outgoingFrame->boundingRects.reserve(count);
-				for (const auto & contour : outgoingFrame->contours) {
+				frame.boundingRects.reserve(count);
+				for (const auto & contour : frame.contours) {
 					auto rect = cv::boundingRect(contour);
 
 					//check area
@@ -88,27 +204,20 @@ namespace ofxRulr {
 						continue;
 					}
 
-					//check if it touches edge of frame (we use a threshold of 2px for rejections)
-					{
-						const int distanceThreshold = 2;
-						auto bottomRight = rect.br();
-						if (rect.x <= distanceThreshold
-							|| rect.y <= distanceThreshold
-							|| outgoingFrame->image.cols - bottomRight.x <= distanceThreshold
-							|| outgoingFrame->image.rows - bottomRight.y <= distanceThreshold) {
-							continue;
-						}
+					//check if it touches edge of frame
+					if (this->touchesEdge(frame, rect)) {
+						continue;
 					}
 
 					//create a dilated rect for finding moments
 					auto dilatedRect = rect;
 					{
-						dilatedRect.x -= outgoingFrame->dilationSize;
-						dilatedRect.y -= outgoingFrame->dilationSize;
-						dilatedRect.width += outgoingFrame->dilationSize;
-						dilatedRect.height += outgoingFrame->dilationSize;
+						dilatedRect.x -= frame.dilationSize;
+						dilatedRect.y -= frame.dilationSize;
+						dilatedRect.width += frame.dilationSize;
+						dilatedRect.height += frame.dilationSize;
 					}
-					auto moment = cv::moments(outgoingFrame->image(dilatedRect));
+					auto moment = cv::moments(frame.image(dilatedRect));
 
 					//check circularity
 					//https://github.com/opencv/opencv/blob/master/modules/features2d/src/blobdetector.cpp#L225
@@ -122,24 +231,43 @@ namespace ofxRulr {
 						}
 					}
 					
-					outgoingFrame->boundingRects.push_back(rect);
-					outgoingFrame->moments.push_back(moment);
-					outgoingFrame->circularity.push_back(circularity);
+					frame.boundingRects.push_back(rect);
+					frame.moments.push_back(moment);
+					frame.circularity.push_back(circularity);
 				}
-				count = outgoingFrame->boundingRects.size();
+			}
 
-				//get moments centers
-				outgoingFrame->centroids.reserve(count);
-				for (size_t i = 0; i < count; i++) {
-					const auto & moment = outgoingFrame->moments[i];
-					outgoingFrame->centroids.emplace_back(
-						moment.m10 / moment.m00 + outgoingFrame->boundingRects[i].x - outgoingFrame->dilationSize
-						, moment.m01 / moment.m00 + outgoingFrame->boundingRects[i].y - outgoingFrame->dilationSize
-					);
+			//----------
+			bool FindMarkerCentroids::touchesEdge(const FindMarkerCentroidsFrame & frame, const cv::Rect & rect) const {
+				//we use a threshold of 2px for rejections
+				const int distanceThreshold = 2;
+				auto bottomRight = rect.br();
+				return rect.x <= distanceThreshold
+					|| rect.y <= distanceThreshold
+					|| frame.image.cols - bottomRight.x <= distanceThreshold
+					|| frame.image.rows - bottomRight.y <= distanceThreshold;
+			}
+
+			//----------
+			void FindMarkerCentroids::benchmarkLocalDifference() {
+				shared_ptr<FindMarkerCentroidsFrame> frame;
+				{
+					auto lock = unique_lock<mutex>(this->lastFrameMutex);
+					frame = this->lastFrame;
+				}
+				if (!frame) {
+					throw(ofxRulr::Exception("No frame has been processed yet. Connect a camera first."));
 				}
 
-				//announce the new frame
-				this->onNewFrame(outgoingFrame);
+				Utils::LocalDifference::Settings settings;
+				{
+					settings.blurSize = (int) this->parameters.localDifference.blurSize.get();
+					settings.threshold = this->parameters.localDifference.threshold.get();
+					settings.differenceAmplify = this->parameters.localDifference.differenceAmplify.get();
+				}
+
+				this->benchmarkResult = Utils::LocalDifference::benchmark(frame->image, settings);
+				ofLogNotice("MoCap::FindMarkerCentroids") << this->benchmarkResult;
 			}
 		}
 	}
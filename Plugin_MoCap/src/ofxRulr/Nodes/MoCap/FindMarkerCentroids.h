@@ -2,19 +2,22 @@
 
 #include "ThreadedProcessNode.h"
 #include "ofxRulr/Nodes/Item/Camera.h"
+#include "ofxRulr/Utils/LocalDifference.h"
+#include "ofxRulr/Utils/ConnectedComponents.h"
 
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
 			struct FindMarkerCentroidsFrame {
 				shared_ptr<ofxMachineVision::Frame> imageFrame;
+				chrono::high_resolution_clock::time_point arrivalTime; // when the camera frame arrived
 
 				cv::Mat image;
-				cv::Mat blurred;
+				cv::Mat blurred; // only filled when the fast kernel is disabled
 				cv::Mat difference;
 				cv::Mat binary;
 
-				vector<vector<cv::Point2i>> contours;
+				vector<vector<cv::Point2i>> contours; // only filled when connected components are disabled
 				vector<cv::Rect> boundingRects;
 				const int dilationSize = 2; // used for calculating moments
 				vector<cv::Moments> moments;
@@ -27,17 +30,42 @@ namespace ofxRulr {
 				, FindMarkerCentroidsFrame> {
 			public:
 				FindMarkerCentroids();
+				virtual ~FindMarkerCentroids();
 				virtual string getTypeName() const override;
 				void init();
+				void populateInspector(ofxCvGui::InspectArguments &);
 			protected:
 				void processFrame(shared_ptr<ofxMachineVision::Frame>) override;
+				struct Workspace {
+					Utils::LocalDifference localDifference;
+					Utils::ConnectedComponents connectedComponents;
+					vector<Utils::ConnectedComponents::Blob> blobs;
+				};
+
+				///Returns the workspace to the pool when released
+				shared_ptr<Workspace> borrowWorkspace();
+
+				void processLocalDifference(FindMarkerCentroidsFrame &, Workspace &);
+				void findBlobsConnectedComponents(FindMarkerCentroidsFrame &, Workspace &);
+				void findBlobsContours(FindMarkerCentroidsFrame &);
+				bool touchesEdge(const FindMarkerCentroidsFrame &, const cv::Rect &) const;
+				void benchmarkLocalDifference();
+
+				//frames are processed concurrently, so each worker borrows its own workspace (with its own scratch buffers)
+				vector<unique_ptr<Workspace>> idleWorkspaces;
+				mutex idleWorkspacesMutex;
+
+				shared_ptr<FindMarkerCentroidsFrame> lastFrame;
+				mutex lastFrameMutex;
+				string benchmarkResult;
 
 				struct : ofParameterGroup {
 					struct : ofParameterGroup {
 						ofParameter<float> blurSize{ "Blur size", 100, 0, 1000 };
 						ofParameter<float> threshold{ "Threshold", 30, 0, 255 };
 						ofParameter<float> differenceAmplify{ "Difference amplify", 4, 1, 16 };
-						PARAM_DECLARE("LocalDifference", blurSize, threshold, differenceAmplify);
+						ofParameter<bool> useFastKernel{ "Use fast kernel", true };
+						PARAM_DECLARE("LocalDifference", blurSize, threshold, differenceAmplify, useFastKernel);
 					} localDifference;
 
 					struct : ofParameterGroup {
@@ -47,7 +75,13 @@ namespace ofxRulr {
 						PARAM_DECLARE("Contour filter", minimumArea, circularityGamma, minimumCircularity);
 					} contourFilter;
 
-					PARAM_DECLARE("FindMarkerCentroids", localDifference, contourFilter);
+					struct : ofParameterGroup {
+						ofParameter<bool> useConnectedComponents{ "Use connected components", false }; // measures circularity differently to findContours, so Minimum circularity needs retuning
+						ofParameter<int> bandCount{ "Parallel bands", 1, 1, 16 };
+						PARAM_DECLARE("Blob finder", useConnectedComponents, bandCount);
+					} blobFinder;
+
+					PARAM_DECLARE("FindMarkerCentroids", localDifference, contourFilter, blobFinder);
 				} parameters;
 			};
 		}
@@ -2,6 +2,7 @@
 #include "MatchMarkers.h"
 
 #include "ofxRulr/Nodes/Item/Camera.h"
+#include "ofxRulr/Utils/Assignment.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -64,6 +65,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			MatchMarkers::~MatchMarkers() {
+				this->close();
+			}
+
 			//----------
 			std::string MatchMarkers::getTypeName() const {
 				return "MoCap::MatchMarkers";
@@ -200,6 +206,12 @@ namespace ofxRulr {
 				//get the distance threshold
 				outputFrame->distanceThresholdSquared = this->parameters.trackingDistanceThreshold.get();
 				outputFrame->distanceThresholdSquared *= outputFrame->distanceThresholdSquared;
+				outputFrame->assignment = this->parameters.assignment.get();
+
+				//index the centroids (cells the size of the largest search radius)
+				outputFrame->centroidGrid = make_shared<Utils::PointGrid>();
+				outputFrame->centroidGrid->build(incomingFrame->centroids
+					, max(this->parameters.trackingDistanceThreshold.get(), this->parameters.refindTrackingThreshold.get()));
 
 				//process the normal tracking search
 				this->processTrackingSearch(outputFrame);
@@ -248,7 +260,7 @@ namespace ofxRulr {
 					this->needsForceUseCapture.store(false);
 				}
 
-				this->onNewFrame.notifyListeners(move(outputFrame));
+				this->emitFrame(move(outputFrame));
 			}
 
 			//----------
@@ -307,6 +319,7 @@ namespace ofxRulr {
 					if (searchFrame->result.success) {
 						//now check it with the tracking distance threshold
 						searchFrame->distanceThresholdSquared = this->parameters.trackingDistanceThreshold;
+						searchFrame->distanceThresholdSquared *= searchFrame->distanceThresholdSquared;
 						this->processModelViewTransform(searchFrame);
 
 						if (searchFrame->result.success) {
@@ -341,33 +354,61 @@ namespace ofxRulr {
 				//clear the result
 				outputFrame->result = MatchMarkersFrame::Result();
 
-				for (size_t centroidIndex = 0; centroidIndex < outputFrame->incomingFrame->centroids.size(); centroidIndex++) {
-					const auto & centroid = outputFrame->incomingFrame->centroids[centroidIndex];
-
-					map<float, size_t> matchesByDistance; // { distanceSquared, marker index in incoming frame vector}
-
-														  //find all matching markers
+				//find all centroid / marker pairs within the threshold
+				vector<Utils::Assignment::Candidate> candidates; // row is centroid index, column is marker index
+				{
+					const auto distanceThreshold = sqrt(outputFrame->distanceThresholdSquared);
 					for (size_t i = 0; i < outputFrame->search.count; i++) {
-						//find distance
-						const auto & markerProjected = outputFrame->search.projectedMarkerImagePoints[i];
-						const auto delta = centroid - markerProjected;
-						const auto distanceSquared = delta.x * delta.x + delta.y * delta.y;
-
-						if (distanceSquared < outputFrame->distanceThresholdSquared) {
-							matchesByDistance.emplace(distanceSquared, i);
-						}
+						outputFrame->centroidGrid->forEachWithin(outputFrame->search.projectedMarkerImagePoints[i]
+							, distanceThreshold
+							, [&candidates, i](size_t centroidIndex, float distanceSquared) {
+							candidates.push_back({ centroidIndex, i, distanceSquared });
+						});
 					}
+				}
 
-					if (matchesByDistance.empty()) {
-						//no match found
-						continue;
+				//choose the matches
+				vector<Utils::Assignment::Candidate> matches;
+				switch (outputFrame->assignment.get()) {
+				case MatchAssignment::Greedy:
+					matches = Utils::Assignment::solveGreedy(candidates);
+					break;
+				case MatchAssignment::Optimal:
+					matches = Utils::Assignment::solveOptimal(candidates);
+					break;
+				case MatchAssignment::Nearest:
+				default:
+				{
+					//nearest marker for each centroid (the lowest marker index wins a tie)
+					sort(candidates.begin(), candidates.end(), [](const Utils::Assignment::Candidate & a, const Utils::Assignment::Candidate & b) {
+						if (a.row != b.row) {
+							return a.row < b.row;
+						}
+						if (a.cost != b.cost) {
+							return a.cost < b.cost;
+						}
+						return a.column < b.column;
+					});
+					for (const auto & candidate : candidates) {
+						if (matches.empty() || matches.back().row != candidate.row) {
+							matches.push_back(candidate);
+						}
 					}
+					break;
+				}
+				}
 
-					auto matchIndex = matchesByDistance.begin()->second;
+				//output in centroid order
+				sort(matches.begin(), matches.end(), [](const Utils::Assignment::Candidate & a, const Utils::Assignment::Candidate & b) {
+					return a.row < b.row;
+				});
+				for (const auto & match : matches) {
+					const auto centroidIndex = match.row;
+					const auto matchIndex = match.column;
 					outputFrame->result.markerListIndicies.push_back(matchIndex);
 					outputFrame->result.markerIDs.push_back(outputFrame->search.markerIDs[matchIndex]);
 					outputFrame->result.projectedPoints.push_back(outputFrame->search.projectedMarkerImagePoints[matchIndex]);
-					outputFrame->result.centroids.push_back(centroid);
+					outputFrame->result.centroids.push_back(outputFrame->incomingFrame->centroids[centroidIndex]);
 					outputFrame->result.centroidIndex.push_back(centroidIndex);
 					outputFrame->result.objectSpacePoints.push_back(outputFrame->search.objectSpacePoints[matchIndex]);
 				}
@@ -3,10 +3,18 @@
 #include "ThreadedProcessNode.h"
 #include "FindMarkerCentroids.h"
 #include "Body.h"
+#include "ofxRulr/Utils/PointGrid.h"
 
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
+			///Nearest : each centroid takes its nearest projected marker (a marker can be used more than once)
+			///Greedy : closest pairs first, each centroid and marker is used at most once
+			///Optimal : one-to-one assignment with the least total squared distance
+			MAKE_ENUM(MatchAssignment
+				, (Nearest, Greedy, Optimal)
+				, ("Nearest", "Greedy", "Optimal"));
+
 			struct CameraDescription {
 				cv::Mat cameraMatrix;
 				cv::Mat distortionCoefficients;
@@ -32,6 +40,10 @@ namespace ofxRulr {
 				} search;
 
 				float distanceThresholdSquared;
+				MatchAssignment assignment;
+
+				//built once per frame and shared by all the pose hypotheses we try
+				shared_ptr<Utils::PointGrid> centroidGrid;
 
 				struct Result {
 					bool success = false;
@@ -68,6 +80,7 @@ namespace ofxRulr {
 				};
 				
 				MatchMarkers();
+				virtual ~MatchMarkers();
 				string getTypeName() const override;
 				void init();
 				void update();
@@ -86,8 +99,9 @@ namespace ofxRulr {
 				struct : ofParameterGroup {
 					ofParameter<float> trackingDistanceThreshold{ "Tracking distance threshold [px]", 20, 0, 300 };
 					ofParameter<float> refindTrackingThreshold{ "Re-find tracking threshold [px]", 30, 0, 300 };
+					ofParameter<MatchAssignment> assignment{ "Assignment", MatchAssignment::Nearest };
 					ofParameter<WhenDrawWorld> whenDraw{ "Draw when", WhenDrawWorld::Selected };
-					PARAM_DECLARE("MatchMarkers", trackingDistanceThreshold, refindTrackingThreshold, whenDraw);
+					PARAM_DECLARE("MatchMarkers", trackingDistanceThreshold, refindTrackingThreshold, assignment, whenDraw);
 				} parameters;
 
 				Utils::CaptureSet<Capture> captures;
@@ -9,6 +9,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			OSCRelay::~OSCRelay() {
+				this->close();
+			}
+
 			//----------
 			std::string OSCRelay::getTypeName() const {
 				return "MoCap::OSCRelay";
@@ -81,7 +86,7 @@ namespace ofxRulr {
 					sender->sendBundle(bundle);
 				}
 				
-				this->onNewFrame.notifyListeners(shared_ptr<void*>());
+				this->emitFrame(shared_ptr<void*>());
 			}
 
 			//----------
@@ -12,6 +12,7 @@ namespace ofxRulr {
 			, void *> {
 			public:
 				OSCRelay();
+				virtual ~OSCRelay();
 				string getTypeName() const override;
 				void init();
 				void serialize(Json::Value &);
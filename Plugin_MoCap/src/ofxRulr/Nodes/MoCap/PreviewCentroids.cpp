@@ -12,7 +12,7 @@ namespace ofxRulr {
 
 			//----------
 			PreviewCentroids::~PreviewCentroids() {
-
+				this->close();
 			}
 
 			//----------
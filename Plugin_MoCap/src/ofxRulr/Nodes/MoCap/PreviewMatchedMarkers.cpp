@@ -9,6 +9,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			PreviewMatchedMarkers::~PreviewMatchedMarkers() {
+				this->close();
+			}
+
 			//----------
 			std::string PreviewMatchedMarkers::getTypeName() const {
 				return "MoCap::PreviewMatchedMarkers";
@@ -11,6 +11,7 @@ namespace ofxRulr {
 				, void *> {
 			public:
 				PreviewMatchedMarkers();
+				virtual ~PreviewMatchedMarkers();
 				string getTypeName() const override;
 				void init();
 				void update();
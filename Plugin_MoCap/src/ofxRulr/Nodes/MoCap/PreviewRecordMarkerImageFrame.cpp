@@ -10,6 +10,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			PreviewRecordMarkerImagesFrame::~PreviewRecordMarkerImagesFrame() {
+				this->close();
+			}
+
 			//----------
 			std::string PreviewRecordMarkerImagesFrame::getTypeName() const {
 				return "MoCap::PreviewRecordMarkerImagesFrame";
@@ -88,7 +93,7 @@ namespace ofxRulr {
 					auto lock = unique_lock<mutex>(this->previewFrameMutex);
 					this->previewFrame = incomingFrame;
 				}
-				this->onNewFrame(shared_ptr<void *>());
+				this->emitFrame(shared_ptr<void *>());
 			}
 
 			//----------
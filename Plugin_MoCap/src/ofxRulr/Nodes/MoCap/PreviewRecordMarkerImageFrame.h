@@ -11,6 +11,7 @@ namespace ofxRulr {
 				, void *> {
 			public:
 				PreviewRecordMarkerImagesFrame();
+				virtual ~PreviewRecordMarkerImagesFrame();
 				virtual string getTypeName() const override;
 				void init();
 				void update();
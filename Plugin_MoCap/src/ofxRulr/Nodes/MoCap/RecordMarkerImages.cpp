@@ -9,6 +9,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			RecordMarkerImages::~RecordMarkerImages() {
+				this->close();
+			}
+
 			//----------
 			string RecordMarkerImages::getTypeName() const {
 				return "MoCap::RecordMarkerImages";
@@ -20,8 +25,6 @@ namespace ofxRulr {
 					this->parameters.recording.enabled = false;
 				};
 
-				this->threadPool = make_unique<Utils::ThreadPool>(4, 100);
-
 				this->manageParameters(this->parameters);
 			}
 
@@ -97,17 +100,13 @@ namespace ofxRulr {
 						fs << "contours" << outgoingFrame->contours;
 					}
 				}
-				this->onNewFrame(outgoingFrame);
-			}
-
-			//----------
-			size_t RecordMarkerImages::getThreadPoolSize() const {
-				return thread::hardware_concurrency() - 1;
+				this->emitFrame(outgoingFrame);
 			}
 
 			//----------
-			size_t RecordMarkerImages::getThreadPoolQueueSize() const {
-				return 100;
+			size_t RecordMarkerImages::getMaxFramesInFlight() const {
+				//recording is limited by disk rather than CPU, so allow a deep queue
+				return Utils::ThreadPool::X().getPoolSize() + 100;
 			}
 		}
 	}
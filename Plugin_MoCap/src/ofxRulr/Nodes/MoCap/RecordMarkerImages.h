@@ -24,13 +24,13 @@ namespace ofxRulr {
 				, RecordMarkerImagesFrame> {
 			public:
 				RecordMarkerImages();
+				virtual ~RecordMarkerImages();
 				virtual string getTypeName() const override;
 				void init();
 			protected:
 				void processFrame(shared_ptr<ofxMachineVision::Frame>) override;
 
-				size_t getThreadPoolSize() const override;
-				size_t getThreadPoolQueueSize() const override;
+				size_t getMaxFramesInFlight() const override;
 
 				struct : ofParameterGroup {
 					struct : ofParameterGroup {
@@ -52,8 +52,6 @@ namespace ofxRulr {
 
 					PARAM_DECLARE("RecordMarkerImages", localDifference, contourFilter, recording);
 				} parameters;
-
-				unique_ptr<Utils::ThreadPool> threadPool;
 			};
 		}
 	}
@@ -4,6 +4,7 @@
 #include "ofxRulr/Nodes/Procedure/Calibrate/StereoCalibrate.h"
 #include "ofxRulr/Nodes/Item/Camera.h"
 #include "ofxRulr/Nodes/Item/AbstractBoard.h"
+#include "ofxRulr/Utils/StereoPoseSolver.h"
 
 namespace ofxRulr {
 	namespace Nodes {
@@ -306,6 +307,28 @@ namespace ofxRulr {
 				, cv::Mat & rotationVector
 				, cv::Mat & translation
 				, bool useExtrinsicGuess) {
+				return this->solvePnPStereo(stereoCalibrateNode
+					, imagePointsA
+					, imagePointsB
+					, objectPointsA
+					, objectPointsB
+					, rotationVector
+					, translation
+					, useExtrinsicGuess
+					, this->parameters.solver.get());
+			}
+
+			//----------
+			bool StereoSolvePnP::solvePnPStereo(shared_ptr<Procedure::Calibrate::StereoCalibrate> stereoCalibrateNode
+				, const vector<cv::Point2f> & imagePointsA
+				, const vector<cv::Point2f> & imagePointsB
+				, const vector<cv::Point3f> & objectPointsA
+				, const vector<cv::Point3f> & objectPointsB
+				, cv::Mat & rotationVector
+				, cv::Mat & translation
+				, bool useExtrinsicGuess
+				, StereoSolver solver
+				, bool optimiseNonLinearFit) {
 
 				//check vectors are of equal length
 				if (imagePointsA.size() != objectPointsA.size()
@@ -528,6 +551,29 @@ namespace ofxRulr {
 						return false;
 					}
 				}
+				else if (solver == StereoSolver::LevenbergMarquardt) {
+					//We have points in both cameras, refine from the initial guess (e.g. the previous frame's pose)
+					Utils::StereoPoseSolver::Camera cameraA(model.system.cameraMatrixA, model.system.distortionCoefficientsA);
+					Utils::StereoPoseSolver::Camera cameraB(model.system.cameraMatrixB, model.system.distortionCoefficientsB);
+
+					auto result = Utils::StereoPoseSolver::solve(cameraA
+						, cameraB
+						, rotationVectorStereoInverse
+						, translationStereoInverse
+						, imagePointsA
+						, objectPointsA
+						, imagePointsB
+						, objectPointsB
+						, rotationVector
+						, translation
+						, Utils::StereoPoseSolver::Settings());
+					success = result.success;
+
+					if (!success) {
+						rotationVector = model.system.initialRotationVector;
+						translation = model.system.initialTranslation;
+					}
+				}
 				else {
 					//We have points in both cameras, let's do the thing!!
 					double residual = 0.0;
@@ -570,9 +616,14 @@ namespace ofxRulr {
 					double residualBefore;
 					model.getResidualOnSet(dataSet, residualBefore, NULL);
 
-					//HACK
-					//success = fit.optimise(model, &dataSet, &residual);
-					success = true;
+					if (optimiseNonLinearFit) {
+						success = fit.optimise(model, &dataSet, &residual);
+					}
+					else {
+						//HACK
+						//success = fit.optimise(model, &dataSet, &residual);
+						success = true;
+					}
 
 					model.cacheModel();
 
@@ -639,6 +690,7 @@ namespace ofxRulr {
 			//----------
 			void StereoSolvePnP::init() {
 				RULR_NODE_UPDATE_LISTENER;
+				RULR_NODE_INSPECTOR_LISTENER;
 				RULR_NODE_DRAW_WORLD_LISTENER;
 
 				this->addInput<Procedure::Calibrate::StereoCalibrate>();
@@ -740,11 +792,129 @@ namespace ofxRulr {
 						, rotationVector
 						, translation
 						, false)) {
+						this->lastSolve.imagePointsA = imagePointsA;
+						this->lastSolve.imagePointsB = imagePointsB;
+						this->lastSolve.objectPointsA = objectPointsA;
+						this->lastSolve.objectPointsB = objectPointsB;
+						this->lastSolve.previousRotationVector = this->lastSolve.rotationVector;
+						this->lastSolve.previousTranslation = this->lastSolve.translation;
+						this->lastSolve.rotationVector = rotationVector;
+						this->lastSolve.translation = translation;
 					}
 				}
 				RULR_CATCH_ALL_TO_ERROR;
 			}
 
+			//----------
+			void StereoSolvePnP::populateInspector(ofxCvGui::InspectArguments & inspectArgs) {
+				auto inspector = inspectArgs.inspector;
+				inspector->addButton("Benchmark solvers", [this]() {
+					try {
+						this->benchmarkSolvers();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+				inspector->addLiveValue<string>("Benchmark result", [this]() {
+					return this->benchmarkResult;
+				});
+			}
+
+			//----------
+			void StereoSolvePnP::benchmarkSolvers() {
+				this->throwIfMissingAConnection<Procedure::Calibrate::StereoCalibrate>();
+				auto stereoCalibrateNode = this->getInput<Procedure::Calibrate::StereoCalibrate>();
+				stereoCalibrateNode->throwIfACameraIsDisconnected();
+
+				const auto & data = this->lastSolve;
+				if (data.imagePointsA.empty() || data.imagePointsB.empty()) {
+					throw(ofxRulr::Exception("No board has been found in both cameras yet"));
+				}
+				if (data.previousRotationVector.empty()) {
+					throw(ofxRulr::Exception("The board needs to be found in two frames to benchmark a warm start"));
+				}
+
+				//for measuring reprojection error
+				const auto & openCVCalibration = stereoCalibrateNode->getOpenCVCalibration();
+				cv::Mat rotationVectorStereoInverse;
+				cv::Mat translationStereoInverse;
+				{
+					auto stereoTransform = ofxCv::makeMatrix(openCVCalibration.rotationVector, openCVCalibration.translation);
+					ofxCv::decomposeMatrix(stereoTransform.getInverse(), rotationVectorStereoInverse, translationStereoInverse);
+				}
+				auto cameraNodeA = stereoCalibrateNode->getInput<Item::Camera>("Camera A");
+				auto cameraNodeB = stereoCalibrateNode->getInput<Item::Camera>("Camera B");
+				Utils::StereoPoseSolver::Camera cameraA(cameraNodeA->getCameraMatrix(), cameraNodeA->getDistortionCoefficients());
+				Utils::StereoPoseSolver::Camera cameraB(cameraNodeB->getCameraMatrix(), cameraNodeB->getDistortionCoefficients());
+
+				struct Trial {
+					string name;
+					StereoSolver solver;
+					bool warmStart;
+					double millisPerSolve = 0.0;
+					double reprojectionError = 0.0;
+				};
+				vector<Trial> trials = {
+					{ "ofxNonLinearFit (cold)", StereoSolver::NonLinearFit, false }
+					, { "Levenberg-Marquardt (cold)", StereoSolver::LevenbergMarquardt, false }
+					, { "Levenberg-Marquardt (warm)", StereoSolver::LevenbergMarquardt, true }
+				};
+
+				const int iterations = 100;
+				for (auto & trial : trials) {
+					cv::Mat rotationVector;
+					cv::Mat translation;
+
+					auto startTime = chrono::high_resolution_clock::now();
+					for (int i = 0; i < iterations; i++) {
+						//warm start is from the previous frame's result, as when tracking
+						rotationVector = data.previousRotationVector.clone();
+						translation = data.previousTranslation.clone();
+						this->solvePnPStereo(stereoCalibrateNode
+							, data.imagePointsA
+							, data.imagePointsB
+							, data.objectPointsA
+							, data.objectPointsB
+							, rotationVector
+							, translation
+							, trial.warmStart
+							, trial.solver
+							, true);
+					}
+					chrono::duration<double, milli> duration = chrono::high_resolution_clock::now() - startTime;
+
+					trial.millisPerSolve = duration.count() / (double) iterations;
+					trial.reprojectionError = Utils::StereoPoseSolver::getReprojectionError(cameraA
+						, cameraB
+						, rotationVectorStereoInverse
+						, translationStereoInverse
+						, data.imagePointsA
+						, data.objectPointsA
+						, data.imagePointsB
+						, data.objectPointsB
+						, rotationVector
+						, translation);
+				}
+
+				stringstream message;
+				message << (data.imagePointsA.size() + data.imagePointsB.size()) << " points, " << iterations << " iterations" << endl;
+				for (const auto & trial : trials) {
+					message << trial.name << " : " << trial.millisPerSolve << "ms, RMS " << trial.reprojectionError << "px" << endl;
+				}
+
+				//regression check : the new solver shouldn't be less accurate than the existing path
+				const auto & existing = trials[0];
+				bool passed = true;
+				for (size_t i = 1; i < trials.size(); i++) {
+					if (trials[i].reprojectionError > existing.reprojectionError + 1e-3) {
+						passed = false;
+					}
+				}
+				message << "Accuracy check : " << (passed ? "PASS" : "FAIL");
+
+				this->benchmarkResult = message.str();
+				ofLogNotice("MoCap::StereoSolvePnP") << this->benchmarkResult;
+			}
+
 			//----------
 			ofxCvGui::PanelPtr StereoSolvePnP::getPanel() {
 				return this->panel;
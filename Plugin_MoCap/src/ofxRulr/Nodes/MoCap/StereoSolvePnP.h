@@ -9,12 +9,17 @@
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
+			MAKE_ENUM(StereoSolver
+				, (LevenbergMarquardt, NonLinearFit)
+				, ("Levenberg-Marquardt", "ofxNonLinearFit"));
+
 			class StereoSolvePnP : public Nodes::Base {
 			public:
 				StereoSolvePnP();
 				string getTypeName() const override;
 				void init();
 				void update();
+				void populateInspector(ofxCvGui::InspectArguments &);
 				ofxCvGui::PanelPtr getPanel() override;
 				void drawWorld();
 				
@@ -28,8 +33,23 @@ namespace ofxRulr {
 					, bool useExtrinsicGuess);
 
 			protected:
+				bool solvePnPStereo(shared_ptr<Procedure::Calibrate::StereoCalibrate> stereoCalibrateNode
+					, const vector<cv::Point2f> & imagePointsA
+					, const vector<cv::Point2f> & imagePointsB
+					, const vector<cv::Point3f> & objectPointsA
+					, const vector<cv::Point3f> & objectPointsB
+					, cv::Mat & rotationVector
+					, cv::Mat & translation
+					, bool useExtrinsicGuess
+					, StereoSolver
+					, bool optimiseNonLinearFit = false); // the live ofxNonLinearFit path only uses the initial guess
+
+				///Times each solver on the last board found and checks Levenberg-Marquardt is at least as accurate as the existing path
+				void benchmarkSolvers();
+
 				struct : ofParameterGroup {
 					ofParameter<FindBoardMode> findBoardMode{ "Mode", FindBoardMode::Optimized };
+					ofParameter<StereoSolver> solver{ "Solver", StereoSolver::LevenbergMarquardt };
 
 					struct : ofParameterGroup {
 						ofParameter<bool> a{ "A", true };
@@ -38,7 +58,7 @@ namespace ofxRulr {
 						PARAM_DECLARE("Draw", a, b, stereo);
 					} draw;
 
-					PARAM_DECLARE("StereoSolvePnP", findBoardMode, draw);
+					PARAM_DECLARE("StereoSolvePnP", findBoardMode, solver, draw);
 				} parameters;
 
 				struct {
@@ -51,6 +71,19 @@ namespace ofxRulr {
 					ofMatrix4x4 transformStereoResult;
 				} dataPreview;
 
+				//the last board we solved for, used for benchmarking
+				struct {
+					vector<cv::Point2f> imagePointsA;
+					vector<cv::Point2f> imagePointsB;
+					vector<cv::Point3f> objectPointsA;
+					vector<cv::Point3f> objectPointsB;
+					cv::Mat rotationVector;
+					cv::Mat translation;
+					cv::Mat previousRotationVector; // the frame before's pose, which warm starts begin from
+					cv::Mat previousTranslation;
+				} lastSolve;
+				string benchmarkResult;
+
 				ofxCvGui::PanelPtr panel;
 			};
 		}
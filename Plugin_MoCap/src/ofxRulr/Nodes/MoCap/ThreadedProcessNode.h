@@ -2,61 +2,314 @@
 
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Utils/ThreadPool.h"
+#include "ofxRulr/Utils/LatencyHistogram.h"
 
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
+			///LatestWins : a single slot mailbox, a new frame replaces any frame waiting to be processed (one frame processed at a time)
+			///Ordered : frames are processed in parallel but output in the order they arrived
+			///BoundedLatency : frames which have waited longer than the maximum latency are discarded before processing
+			MAKE_ENUM(BackpressureMode
+				, (LatestWins, Ordered, BoundedLatency)
+				, ("Latest wins", "Ordered", "Bounded latency"));
+
 			template<class IncomingNodeType
 				, class IncomingFrameType
 				, class OutgoingFrameType>
 				class ThreadedProcessNode : public Nodes::Base {
 			private:
+				typedef chrono::high_resolution_clock Clock;
+
+				struct IncomingFrame {
+					shared_ptr<IncomingFrameType> frame;
+					Clock::time_point arrivalTime;
+					BackpressureMode mode;
+					uint64_t sequenceIndex = 0;
+				};
+
+				//outgoing frames from the processFrame call on this thread
+				struct ProcessContext {
+					Clock::time_point arrivalTime;
+					bool holdOutgoingFrames = false;
+					vector<shared_ptr<OutgoingFrameType>> outgoingFrames;
+				};
+
+				static ProcessContext * & getCurrentContext() {
+					thread_local ProcessContext * currentContext = nullptr;
+					return currentContext;
+				}
+
 				atomic<float> processingTime = 0;
 				atomic<int> processedFramesSinceLastAppFrame = 0;
 				atomic<int> droppedFramesSinceLastAppFrame = 0;
+				atomic<size_t> framesInFlight = 0;
+				atomic<bool> closing = false;
 
 				float processedFramesPerSecond = 0.0f;
 				float droppedFramesPerSecond = 0.0f;
-				unique_ptr<Utils::ThreadPool> threadPool;
+
+				//LatestWins
+				unique_ptr<IncomingFrame> mailbox;
+				bool mailboxBeingProcessed = false;
+				mutex mailboxMutex;
+
+				//Ordered
+				uint64_t nextSequenceIndex = 0;
+				uint64_t nextSequenceIndexToOutput = 0;
+				map<uint64_t, pair<Clock::time_point, vector<shared_ptr<OutgoingFrameType>>>> reorderBuffer;
+				uint64_t nextBatchIndex = 0;
+				mutex reorderMutex;
+
+				//frames popped from the reorder buffer are output in batches, one batch at a time in the order they were popped
+				uint64_t nextBatchIndexToOutput = 0;
+				mutex outputOrderMutex;
+				condition_variable outputOrderChanged;
+
+				Utils::LatencyHistogram latencyHistogram;
 
 				struct : ofParameterGroup {
 					ofParameter<bool> performInParentThread{ "Perform in parent thread", false };
-					PARAM_DECLARE("ThreadedProcessNode", performInParentThread);
+					ofParameter<BackpressureMode> backpressureMode{ "Backpressure mode", BackpressureMode::Ordered };
+					ofParameter<float> maximumLatency{ "Maximum latency [ms]", 30, 1, 1000 };
+					PARAM_DECLARE("ThreadedProcessNode", performInParentThread, backpressureMode, maximumLatency);
 				} parameters;
+
+				//----------
+				void receiveFrame(shared_ptr<IncomingFrameType> incomingFrame) {
+					if (this->closing.load()) {
+						return;
+					}
+
+					IncomingFrame incoming;
+					incoming.frame = incomingFrame;
+					incoming.arrivalTime = Clock::now();
+					incoming.mode = this->parameters.backpressureMode.get();
+
+					if (this->parameters.performInParentThread) {
+						//there's no queue in this case, so we just output directly
+						incoming.mode = BackpressureMode::LatestWins;
+						this->processIncoming(incoming);
+						return;
+					}
+
+					if (incoming.mode == BackpressureMode::LatestWins) {
+						bool needsDispatch = false;
+						{
+							auto lock = unique_lock<mutex>(this->mailboxMutex);
+							if (this->mailbox) {
+								this->droppedFramesSinceLastAppFrame++;
+							}
+							else {
+								this->framesInFlight++;
+							}
+							this->mailbox = make_unique<IncomingFrame>(move(incoming));
+							if (!this->mailboxBeingProcessed) {
+								this->mailboxBeingProcessed = true;
+								needsDispatch = true;
+							}
+						}
+						if (needsDispatch) {
+							auto dispatched = Utils::ThreadPool::X().performAsync([this]() {
+								this->processMailbox();
+							}, Utils::ThreadPool::Priority::CameraFrame);
+
+							if (!dispatched) {
+								auto lock = unique_lock<mutex>(this->mailboxMutex);
+								this->mailbox.reset();
+								this->mailboxBeingProcessed = false;
+								this->framesInFlight--;
+								this->droppedFramesSinceLastAppFrame++;
+							}
+						}
+						return;
+					}
+
+					if (this->framesInFlight.fetch_add(1) >= this->getMaxFramesInFlight()) {
+						this->framesInFlight--;
+						this->droppedFramesSinceLastAppFrame++;
+						return;
+					}
+
+					if (incoming.mode == BackpressureMode::Ordered) {
+						auto lock = unique_lock<mutex>(this->reorderMutex);
+						incoming.sequenceIndex = this->nextSequenceIndex++;
+					}
+
+					auto dispatched = Utils::ThreadPool::X().performAsync([this, incoming]() {
+						this->processIncoming(incoming);
+						this->framesInFlight--;
+					}, Utils::ThreadPool::Priority::CameraFrame);
+
+					if (!dispatched) {
+						if (incoming.mode == BackpressureMode::Ordered) {
+							//release the sequence slot so later frames aren't held back
+							this->outputInOrder(incoming.sequenceIndex, incoming.arrivalTime, {});
+						}
+						this->framesInFlight--;
+						this->droppedFramesSinceLastAppFrame++;
+					}
+				}
+
+				//----------
+				void processMailbox() {
+					unique_ptr<IncomingFrame> incoming;
+					{
+						auto lock = unique_lock<mutex>(this->mailboxMutex);
+						swap(incoming, this->mailbox);
+					}
+
+					while (incoming) {
+						this->processIncoming(*incoming);
+						incoming.reset();
+
+						{
+							auto lock = unique_lock<mutex>(this->mailboxMutex);
+							swap(incoming, this->mailbox);
+							if (!incoming) {
+								this->mailboxBeingProcessed = false;
+							}
+						}
+
+						//this must be the last time we touch 'this' (see destructor)
+						this->framesInFlight--;
+					}
+				}
+
+				//----------
+				void processIncoming(const IncomingFrame & incoming) {
+					if (incoming.mode == BackpressureMode::BoundedLatency) {
+						auto age = Clock::now() - incoming.arrivalTime;
+						if (age > chrono::microseconds((int64_t) (this->parameters.maximumLatency.get() * 1000.0f))) {
+							this->droppedFramesSinceLastAppFrame++;
+							return;
+						}
+					}
+
+					ProcessContext context;
+					context.arrivalTime = incoming.arrivalTime;
+					context.holdOutgoingFrames = incoming.mode == BackpressureMode::Ordered;
+
+					auto previousContext = getCurrentContext();
+					getCurrentContext() = &context;
+					try {
+						auto timeStart = Clock::now();
+						this->processFrame(incoming.frame);
+						chrono::duration<float, ratio<1, 1000>> duration = Clock::now() - timeStart;
+						this->processingTime.store(duration.count());
+						this->processedFramesSinceLastAppFrame++;
+					}
+					RULR_CATCH_ALL_TO_ERROR;
+					getCurrentContext() = previousContext;
+
+					if (incoming.mode == BackpressureMode::Ordered) {
+						this->outputInOrder(incoming.sequenceIndex, incoming.arrivalTime, context.outgoingFrames);
+					}
+				}
+
+				//----------
+				void outputInOrder(uint64_t sequenceIndex, const Clock::time_point & arrivalTime, const vector<shared_ptr<OutgoingFrameType>> & outgoingFrames) {
+					//pop whichever frames are now ready
+					vector<pair<Clock::time_point, vector<shared_ptr<OutgoingFrameType>>>> batch;
+					uint64_t batchIndex;
+					{
+						auto lock = unique_lock<mutex>(this->reorderMutex);
+						this->reorderBuffer[sequenceIndex] = make_pair(arrivalTime, outgoingFrames);
+
+						auto it = this->reorderBuffer.begin();
+						while (it != this->reorderBuffer.end() && it->first == this->nextSequenceIndexToOutput) {
+							batch.push_back(move(it->second));
+							it = this->reorderBuffer.erase(it);
+							this->nextSequenceIndexToOutput++;
+						}
+						if (batch.empty()) {
+							return;
+						}
+						batchIndex = this->nextBatchIndex++;
+					}
+
+					//listeners are called without the reorder lock (so they can't deadlock against incoming frames),
+					// and a later batch popped by another worker waits for ours
+					auto lock = unique_lock<mutex>(this->outputOrderMutex);
+					this->outputOrderChanged.wait(lock, [this, batchIndex]() {
+						return this->nextBatchIndexToOutput == batchIndex;
+					});
+					try {
+						for (auto & frames : batch) {
+							for (auto & outgoingFrame : frames.second) {
+								this->notifyOutgoingFrame(outgoingFrame, &frames.first);
+							}
+						}
+					}
+					RULR_CATCH_ALL_TO_ERROR; // later batches must still be output
+					this->nextBatchIndexToOutput++;
+					this->outputOrderChanged.notify_all();
+				}
+
+				//----------
+				void notifyOutgoingFrame(shared_ptr<OutgoingFrameType> outgoingFrame, const Clock::time_point * arrivalTime) {
+					if (arrivalTime) {
+						this->latencyHistogram.add(Clock::now() - *arrivalTime);
+					}
+					this->onNewFrame.notifyListeners(outgoingFrame);
+				}
 			protected:
 				virtual void processFrame(shared_ptr<IncomingFrameType> incomingFrame) = 0;
-				virtual size_t getThreadPoolSize() const { return 2; }
-				virtual size_t getThreadPoolQueueSize() const { return 3; }
+
+				///Call this from processFrame to output a frame (rather than notifying onNewFrame directly)
+				void emitFrame(shared_ptr<OutgoingFrameType> outgoingFrame) {
+					auto context = getCurrentContext();
+					if (context) {
+						if (context->holdOutgoingFrames) {
+							context->outgoingFrames.push_back(outgoingFrame);
+						}
+						else {
+							this->notifyOutgoingFrame(outgoingFrame, &context->arrivalTime);
+						}
+					}
+					else {
+						this->notifyOutgoingFrame(outgoingFrame, nullptr);
+					}
+				}
+
+				///When the frame being processed arrived at this node (call from processFrame)
+				Clock::time_point getArrivalTime() const {
+					auto context = getCurrentContext();
+					return context ? context->arrivalTime : Clock::now();
+				}
+
+				///In Ordered and BoundedLatency modes, incoming frames are dropped whilst this many are being processed or waiting.
+				virtual size_t getMaxFramesInFlight() const { return 5; }
+
+				///Stops accepting frames and waits for any in flight (which call processFrame on the shared thread pool).
+				///processFrame uses the derived class's members, so call this first in your destructor.
+				void close() {
+					this->closing.store(true);
+					while (this->framesInFlight.load() > 0) {
+						this_thread::sleep_for(chrono::milliseconds(1));
+					}
+				}
 			public:
-				ThreadedProcessNode() {
+				ThreadedProcessNode()
+				: latencyHistogram(chrono::milliseconds(100), 50) {
 					RULR_NODE_INIT_LISTENER;
 				}
 
+				virtual ~ThreadedProcessNode() {
+					//by now the derived class has been destroyed, so it's too late to wait for frames here
+					if (!this->closing.load() || this->framesInFlight.load() > 0) {
+						ofLogError("ofxRulr::Nodes::MoCap::ThreadedProcessNode") << "Destroyed without close() being called first";
+					}
+				}
+
 				void init() {
 					RULR_NODE_INSPECTOR_LISTENER;
 					RULR_NODE_UPDATE_LISTENER;
 
-					this->threadPool = make_unique<Utils::ThreadPool>(this->getThreadPoolSize(), this->getThreadPoolQueueSize());
-
 					auto input = this->addInput<IncomingNodeType>();
 					input->onNewConnection += [this](shared_ptr<IncomingNodeType> inputNode) {
 						inputNode->onNewFrame.addListener([this](shared_ptr<IncomingFrameType> incomingFrame) {
-							auto action = [this, incomingFrame]() {
-								auto timeStart = chrono::high_resolution_clock::now();
-								this->processFrame(incomingFrame);
-								chrono::duration<float, ratio<1, 1000>> duration = chrono::high_resolution_clock::now() - timeStart;
-								this->processingTime.store(duration.count());
-								this->processedFramesSinceLastAppFrame++;
-							};
-
-							if (this->parameters.performInParentThread) {
-								action();
-							}
-							else {
-								if (!this->threadPool->performAsync(action)) {
-									this->droppedFramesSinceLastAppFrame++;
-								}
-							}
+							this->receiveFrame(incomingFrame);
 						}, this);
 					};
 					input->onDeleteConnection += [this](shared_ptr<IncomingNodeType> inputNode) {
@@ -65,6 +318,8 @@ namespace ofxRulr {
 						}
 					};
 
+					this->parameters.backpressureMode.addListener(this, &ThreadedProcessNode::callbackBackpressureMode);
+
 					this->manageParameters(this->parameters);
 				}
 
@@ -84,8 +339,8 @@ namespace ofxRulr {
 						return this->processingTime.load();
 					});
 
-					inspector->addLiveValueHistory("Queue size", [this]() {
-						return this->threadPool->getQueueSize();
+					inspector->addLiveValueHistory("Frames in flight", [this]() {
+						return (float) this->framesInFlight.load();
 					});
 
 					inspector->addLiveValueHistory("Frames processed [Hz]", [this]() {
@@ -94,6 +349,17 @@ namespace ofxRulr {
 					inspector->addLiveValueHistory("Dropped frames [Hz]", [this]() {
 						return this->droppedFramesPerSecond;
 					});
+
+					inspector->addTitle("Latency (arrival to output)", ofxCvGui::Widgets::Title::Level::H3);
+					inspector->add(this->latencyHistogram.makeView());
+					inspector->addButton("Clear latency history", [this]() {
+						this->latencyHistogram.clear();
+					});
+				}
+
+				void callbackBackpressureMode(BackpressureMode &) {
+					//each mode has different latency characteristics
+					this->latencyHistogram.clear();
 				}
 
 				//happens in 'our thread'
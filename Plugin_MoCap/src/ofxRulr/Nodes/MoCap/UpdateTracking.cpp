@@ -12,6 +12,11 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			UpdateTracking::~UpdateTracking() {
+				this->close();
+			}
+
 			//----------
 			std::string UpdateTracking::getTypeName() const {
 				return "MoCap::UpdateTracking";
@@ -36,7 +41,7 @@ namespace ofxRulr {
 						while (this->trackingUpdateToMainThread.tryReceive(updateTrackingFrame)) {}
 
 						if (updateTrackingFrame) {
-							rigidBodyNode->setTransform(updateTrackingFrame->transform);
+							rigidBodyNode->setTransform(updateTrackingFrame->transform, updateTrackingFrame->measurementTime);
 						}
 					}
 				}
@@ -62,6 +67,9 @@ namespace ofxRulr {
 				auto outgoingFrame = make_shared<UpdateTrackingFrame>();
 				outgoingFrame->incomingFrame = incomingFrame;
 				outgoingFrame->updateTarget = this->parameters.updateTarget;
+				outgoingFrame->measurementTime = incomingFrame->incomingFrame
+					? incomingFrame->incomingFrame->arrivalTime
+					: this->getArrivalTime();
 				outgoingFrame->bodyModelViewRotationVector = incomingFrame->modelViewRotationVector;
 				outgoingFrame->bodyModelViewTranslation = incomingFrame->modelViewTranslation;
 				
@@ -139,7 +147,7 @@ namespace ofxRulr {
 						break;
 				}
 
-				this->onNewFrame.notifyListeners(outgoingFrame);
+				this->emitFrame(outgoingFrame);
 				this->trackingUpdateToMainThread.send(outgoingFrame);
 			}
 		}
@@ -24,6 +24,7 @@ namespace ofxRulr {
 				cv::Mat modelRotationVector;
 				cv::Mat modelTranslation;
 				ofMatrix4x4 transform;
+				chrono::high_resolution_clock::time_point measurementTime; // when the camera frame arrived
 			};
 
 			class UpdateTracking : public ThreadedProcessNode<MatchMarkers
@@ -31,6 +32,7 @@ namespace ofxRulr {
 				, UpdateTrackingFrame> {
 			public:
 				UpdateTracking();
+				virtual ~UpdateTracking();
 				string getTypeName() const override;
 				void init();
 				void update();
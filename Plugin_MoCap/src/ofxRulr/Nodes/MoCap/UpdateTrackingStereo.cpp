@@ -13,6 +13,15 @@ namespace ofxRulr {
 				RULR_NODE_INIT_LISTENER;
 			}
 
+			//----------
+			UpdateTrackingStereo::~UpdateTrackingStereo() {
+				//frames are processed on the shared thread pool, so wait for any which still reference us
+				this->closing.store(true);
+				while (this->framesInFlight.load() > 0) {
+					this_thread::sleep_for(chrono::milliseconds(1));
+				}
+			}
+
 			//----------
 			std::string UpdateTrackingStereo::getTypeName() const {
 				return "MoCap::UpdateTrackingStereo";
@@ -26,19 +35,15 @@ namespace ofxRulr {
 				this->addInput<Body>();
 				this->addInput<Procedure::Calibrate::StereoCalibrate>();
 
-				this->threadPool = make_unique<Utils::ThreadPool>(2, 10);
+				this->manageParameters(this->parameters);
+
 				this->stereoSolvePnP = make_unique<StereoSolvePnP>();
 
 				{
 					auto input = this->addInput<MatchMarkers>("MatchMarkers A");
 					input->onNewConnection += [this](shared_ptr<MatchMarkers> inputNode) {
 						inputNode->onNewFrame.addListener([this](shared_ptr<MatchMarkersFrame> incomingFrame) {
-							if (!this->threadPool->performAsync([this, incomingFrame]() {
-								this->processFrame(incomingFrame, 0);
-								this->processedFramesSinceLastAppFrame++;
-							})) {
-								this->droppedFramesSinceLastAppFrame++;
-							}
+							this->processFrameAsync(incomingFrame, 0);
 						}, this);
 					};
 					input->onDeleteConnection += [this](shared_ptr<MatchMarkers> inputNode) {
@@ -52,12 +57,7 @@ namespace ofxRulr {
 					auto input = this->addInput<MatchMarkers>("MatchMarkers B");
 					input->onNewConnection += [this](shared_ptr<MatchMarkers> inputNode) {
 						inputNode->onNewFrame.addListener([this](shared_ptr<MatchMarkersFrame> incomingFrame) {
-							if (!this->threadPool->performAsync([this, incomingFrame]() {
-								this->processFrame(incomingFrame, 1);
-								this->processedFramesSinceLastAppFrame++;
-							})) {
-								this->droppedFramesSinceLastAppFrame++;
-							}
+							this->processFrameAsync(incomingFrame, 1);
 						}, this);
 					};
 					input->onDeleteConnection += [this](shared_ptr<MatchMarkers> inputNode) {
@@ -82,6 +82,9 @@ namespace ofxRulr {
 
 				while (this->computeTimeChannel.tryReceive(this->computeTime)) {}
 
+				this->synchroniser.setTolerance(chrono::microseconds((int64_t) (this->parameters.tolerance.get() * 1000.0f)));
+				this->useArrivalTime.store(this->parameters.timestamp.get() == SynchroniseTimestamp::Arrival);
+
 				auto processedFramesPerSecond = (float)processedFramesSinceLastAppFrame.load() / ofGetLastFrameTime();
 				this->processedFramesPerSecond = ofLerp(this->processedFramesPerSecond, processedFramesPerSecond, 0.1f);
 				this->processedFramesSinceLastAppFrame.store(0);
@@ -104,40 +107,64 @@ namespace ofxRulr {
 					return this->computeTime;
 				});
 
+				inspector->addTitle("Synchronisation (skew within sets)", ofxCvGui::Widgets::Title::Level::H3);
+				inspector->addLiveValue<size_t>("Matched sets", [this]() {
+					return this->synchroniser.getMatchedCount();
+				});
+				inspector->addLiveValue<size_t>("Unmatched frames", [this]() {
+					return this->synchroniser.getUnmatchedCount();
+				});
+				inspector->add(this->synchroniser.getSkewHistogram().makeView());
+				inspector->addButton("Clear", [this]() {
+					this->synchroniser.clear();
+				});
+
 			}
 
 			//----------
-			void UpdateTrackingStereo::processFrame(shared_ptr<MatchMarkersFrame> incomingFrame, bool cameraIndex) {
-				vector<shared_ptr<MatchMarkersFrame>> markerTrackingResults;
-				this->markerTrackingMutex.lock();
-				{
-					this->markerTracking[cameraIndex] = incomingFrame;
-					markerTrackingResults = this->markerTracking;
-				}
-				this->markerTrackingMutex.unlock();
-
-				if (cameraIndex != this->cameraWhichSendsSecond) {
+			void UpdateTrackingStereo::processFrameAsync(shared_ptr<MatchMarkersFrame> incomingFrame, size_t cameraIndex) {
+				if (this->closing.load()) {
 					return;
 				}
 
-				//maybe we've got tracking!
-				for (const auto & markerTrackingResult : markerTrackingResults) {
-					if (!markerTrackingResult) {
-						//not enough data to continue yet
+				//take the arrival time before we queue
+				chrono::nanoseconds timestamp = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch());
+				if (!this->useArrivalTime.load()) {
+					if (!incomingFrame->incomingFrame || !incomingFrame->incomingFrame->imageFrame) {
 						return;
 					}
+					timestamp = incomingFrame->incomingFrame->imageFrame->getTimestamp();
 				}
 
-				this->processCameraSet(markerTrackingResults, incomingFrame);
+				//limit the work we have queued on the shared pool (previously 2 threads with a queue of 10)
+				if (this->framesInFlight.fetch_add(1) >= 12) {
+					this->framesInFlight--;
+					this->droppedFramesSinceLastAppFrame++;
+					return;
+				}
 
-				//clean it out
-				this->markerTrackingMutex.lock();
-				{
-					for (auto & markerTrackingResult : this->markerTracking) {
-						markerTrackingResult.reset();
+				auto dispatched = Utils::ThreadPool::X().performAsync([this, incomingFrame, cameraIndex, timestamp]() {
+					try {
+						this->processFrame(incomingFrame, cameraIndex, timestamp);
+						this->processedFramesSinceLastAppFrame++;
 					}
+					RULR_CATCH_ALL_TO_ERROR;
+					this->framesInFlight--;
+				}, Utils::ThreadPool::Priority::CameraFrame);
+
+				if (!dispatched) {
+					this->framesInFlight--;
+					this->droppedFramesSinceLastAppFrame++;
+				}
+			}
+
+			//----------
+			void UpdateTrackingStereo::processFrame(shared_ptr<MatchMarkersFrame> incomingFrame, size_t cameraIndex, chrono::nanoseconds timestamp) {
+				//the set is processed by whichever thread delivers its last frame
+				Utils::FrameSynchroniser<MatchMarkersFrame>::FrameSet markerTrackingResults;
+				if (this->synchroniser.push(cameraIndex, incomingFrame, timestamp, markerTrackingResults)) {
+					this->processCameraSet(markerTrackingResults, incomingFrame);
 				}
-				this->markerTrackingMutex.unlock();
 			}
 
 			//----------
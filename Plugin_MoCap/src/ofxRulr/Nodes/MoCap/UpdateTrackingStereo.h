@@ -2,6 +2,7 @@
 
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Utils/ThreadPool.h"
+#include "ofxRulr/Utils/FrameSynchroniser.h"
 
 #include "StereoSolvePnP.h"
 
@@ -12,9 +13,16 @@
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MoCap {
+			///Camera : the capture time reported by the camera (cameras need a shared clock)
+			///Arrival : the time the frame arrived at this node
+			MAKE_ENUM(SynchroniseTimestamp
+				, (Camera, Arrival)
+				, ("Camera", "Arrival"));
+
 			class UpdateTrackingStereo : public Nodes::Base {
 			public:
 				UpdateTrackingStereo();
+				~UpdateTrackingStereo();
 				string getTypeName() const override;
 				void init();
 				void update();
@@ -25,14 +33,23 @@ namespace ofxRulr {
 			protected:
 				atomic<int> processedFramesSinceLastAppFrame = 0;
 				atomic<int> droppedFramesSinceLastAppFrame = 0;
-				unique_ptr<Utils::ThreadPool> threadPool;
+				atomic<size_t> framesInFlight = 0;
+				atomic<bool> closing = false;
 				float processedFramesPerSecond = 0.0f;
 				float droppedFramesPerSecond = 0.0f;
 
-				void processFrame(shared_ptr<MatchMarkersFrame> incomingFrame, bool cameraIndex);
+				void processFrameAsync(shared_ptr<MatchMarkersFrame> incomingFrame, size_t cameraIndex);
+				void processFrame(shared_ptr<MatchMarkersFrame> incomingFrame, size_t cameraIndex, chrono::nanoseconds timestamp);
 				void processCameraSet(vector<shared_ptr<MatchMarkersFrame>>, shared_ptr<MatchMarkersFrame> incomingFrame);
 
-				atomic<bool> cameraWhichSendsSecond = 1;
+				struct : ofParameterGroup {
+					ofParameter<float> tolerance{ "Tolerance [ms]", 5.0f, 0.0f, 100.0f };
+					ofParameter<SynchroniseTimestamp> timestamp{ "Timestamp", SynchroniseTimestamp::Camera };
+					PARAM_DECLARE("Synchronise", tolerance, timestamp);
+				} parameters;
+
+				Utils::FrameSynchroniser<MatchMarkersFrame> synchroniser{ 2 };
+				atomic<bool> useArrivalTime{ false };
 
 				unique_ptr<StereoSolvePnP> stereoSolvePnP;
 
@@ -42,9 +59,6 @@ namespace ofxRulr {
 				shared_ptr<Procedure::Calibrate::StereoCalibrate> stereoCalibrateNode;
 				mutex stereoCalibrateNodeMutex;
 
-				vector<shared_ptr<MatchMarkersFrame>> markerTracking{ 2 };
-				mutex markerTrackingMutex;
-
 				ofThreadChannel<float> computeTimeChannel;
 				float computeTime;
 			};
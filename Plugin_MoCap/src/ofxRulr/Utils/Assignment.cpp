@@ -0,0 +1,136 @@
+#include "pch_Plugin_MoCap.h"
+#include "Assignment.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace Assignment {
+			//----------
+			vector<Candidate> solveGreedy(vector<Candidate> candidates) {
+				sort(candidates.begin(), candidates.end(), [](const Candidate & a, const Candidate & b) {
+					return a.cost < b.cost;
+				});
+
+				set<size_t> usedRows;
+				set<size_t> usedColumns;
+				vector<Candidate> result;
+				for (const auto & candidate : candidates) {
+					if (usedRows.count(candidate.row) || usedColumns.count(candidate.column)) {
+						continue;
+					}
+					usedRows.insert(candidate.row);
+					usedColumns.insert(candidate.column);
+					result.push_back(candidate);
+				}
+				return result;
+			}
+
+			//----------
+			vector<Candidate> solveOptimal(const vector<Candidate> & candidates) {
+				if (candidates.empty()) {
+					return vector<Candidate>();
+				}
+
+				//only the rows and columns which appear in candidates take part
+				map<size_t, size_t> rowIndices;
+				map<size_t, size_t> columnIndices;
+				vector<size_t> rows;
+				vector<size_t> columns;
+				double totalCost = 0.0;
+				for (const auto & candidate : candidates) {
+					if (rowIndices.emplace(candidate.row, rows.size()).second) {
+						rows.push_back(candidate.row);
+					}
+					if (columnIndices.emplace(candidate.column, columns.size()).second) {
+						columns.push_back(candidate.column);
+					}
+					totalCost += max(candidate.cost, 0.0f);
+				}
+
+				//the method needs n <= m, so we transpose if needs be
+				const bool transpose = rows.size() > columns.size();
+				const auto n = transpose ? columns.size() : rows.size();
+				const auto m = transpose ? rows.size() : columns.size();
+
+				//pairs which aren't candidates cost more than any set of candidates,
+				// so the solution uses as few of them as possible (i.e. maximises the count of real pairs)
+				const double disallowedCost = totalCost + 1.0;
+				vector<double> cost(n * m, disallowedCost);
+				vector<bool> allowed(n * m, false);
+				for (const auto & candidate : candidates) {
+					auto row = rowIndices[candidate.row];
+					auto column = columnIndices[candidate.column];
+					auto index = transpose ? column * m + row : row * m + column;
+					if (!allowed[index] || cost[index] > candidate.cost) {
+						cost[index] = max(candidate.cost, 0.0f);
+						allowed[index] = true;
+					}
+				}
+
+				//Hungarian method with potentials (1-based indices, column 0 is a sentinel)
+				const auto infinity = numeric_limits<double>::infinity();
+				vector<double> u(n + 1, 0.0), v(m + 1, 0.0);
+				vector<size_t> p(m + 1, 0), way(m + 1, 0);
+				for (size_t i = 1; i <= n; i++) {
+					p[0] = i;
+					size_t j0 = 0;
+					vector<double> minimumV(m + 1, infinity);
+					vector<bool> used(m + 1, false);
+					do {
+						used[j0] = true;
+						auto i0 = p[j0];
+						auto delta = infinity;
+						size_t j1 = 0;
+						for (size_t j = 1; j <= m; j++) {
+							if (used[j]) {
+								continue;
+							}
+							auto current = cost[(i0 - 1) * m + (j - 1)] - u[i0] - v[j];
+							if (current < minimumV[j]) {
+								minimumV[j] = current;
+								way[j] = j0;
+							}
+							if (minimumV[j] < delta) {
+								delta = minimumV[j];
+								j1 = j;
+							}
+						}
+						for (size_t j = 0; j <= m; j++) {
+							if (used[j]) {
+								u[p[j]] += delta;
+								v[j] -= delta;
+							}
+							else {
+								minimumV[j] -= delta;
+							}
+						}
+						j0 = j1;
+					} while (p[j0] != 0);
+
+					do {
+						auto j1 = way[j0];
+						p[j0] = p[j1];
+						j0 = j1;
+					} while (j0 != 0);
+				}
+
+				//read back the pairs which were real candidates
+				vector<Candidate> result;
+				for (size_t j = 1; j <= m; j++) {
+					if (p[j] == 0) {
+						continue;
+					}
+					auto index = (p[j] - 1) * m + (j - 1);
+					if (!allowed[index]) {
+						continue;
+					}
+					Candidate candidate;
+					candidate.row = transpose ? rows[j - 1] : rows[p[j] - 1];
+					candidate.column = transpose ? columns[p[j] - 1] : columns[j - 1];
+					candidate.cost = (float) cost[index];
+					result.push_back(candidate);
+				}
+				return result;
+			}
+		}
+	}
+}
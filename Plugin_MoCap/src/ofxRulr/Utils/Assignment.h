@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		namespace Assignment {
+			///A possible pairing and its cost (e.g. squared distance). Pairs which aren't listed are not allowed.
+			struct Candidate {
+				size_t row;
+				size_t column;
+				float cost;
+			};
+
+			///Picks the cheapest remaining candidate whose row and column are both still free, until none are left
+			std::vector<Candidate> solveGreedy(std::vector<Candidate> candidates);
+
+			///Minimum total cost one-to-one assignment (Hungarian method), maximising the number of pairs first.
+			///The cost is O(n^3) in the number of rows and columns which appear in the candidates.
+			std::vector<Candidate> solveOptimal(const std::vector<Candidate> & candidates);
+		}
+	}
+}
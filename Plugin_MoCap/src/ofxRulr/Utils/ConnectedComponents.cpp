@@ -0,0 +1,251 @@
+#include "pch_Plugin_MoCap.h"
+#include "ConnectedComponents.h"
+
+#include "ofxRulr/Utils/ThreadPool.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		//----------
+		cv::Moments ConnectedComponents::Blob::getMoments(const cv::Point2i & origin) const {
+			cv::Moments moments;
+
+			const double x = origin.x;
+			const double y = origin.y;
+			moments.m00 = this->m00;
+			moments.m10 = this->m10 - x * this->m00;
+			moments.m01 = this->m01 - y * this->m00;
+			moments.m20 = this->m20 - 2.0 * x * this->m10 + x * x * this->m00;
+			moments.m11 = this->m11 - x * this->m01 - y * this->m10 + x * y * this->m00;
+			moments.m02 = this->m02 - 2.0 * y * this->m01 + y * y * this->m00;
+
+			//central moments don't depend on the origin
+			if (this->m00 > 0.0) {
+				auto centerX = this->m10 / this->m00;
+				auto centerY = this->m01 / this->m00;
+				moments.mu20 = this->m20 - centerX * this->m10;
+				moments.mu11 = this->m11 - centerX * this->m01;
+				moments.mu02 = this->m02 - centerY * this->m01;
+
+				auto inverseM00Squared = 1.0 / (this->m00 * this->m00);
+				moments.nu20 = moments.mu20 * inverseM00Squared;
+				moments.nu11 = moments.mu11 * inverseM00Squared;
+				moments.nu02 = moments.mu02 * inverseM00Squared;
+			}
+
+			return moments;
+		}
+
+		//----------
+		void ConnectedComponents::process(const cv::Mat & binary, const cv::Mat & image, vector<Blob> & blobs, size_t bandCount) {
+			if (binary.type() != CV_8UC1 || image.type() != CV_8UC1) {
+				throw(ofxRulr::Exception("ConnectedComponents requires 8-bit single channel images"));
+			}
+			if (binary.size() != image.size()) {
+				throw(ofxRulr::Exception("ConnectedComponents requires the binary image and the intensity image to be the same size"));
+			}
+
+			blobs.clear();
+			const auto height = binary.rows;
+			if (height == 0) {
+				return;
+			}
+
+			//label each band of rows
+			{
+				bandCount = max<size_t>(bandCount, 1);
+				const auto bandHeight = (int) ((height + bandCount - 1) / bandCount);
+				bandCount = (height + bandHeight - 1) / bandHeight;
+				this->bands.resize(bandCount);
+
+				auto labelBandIndex = [&](size_t bandIndex) {
+					auto rowBegin = (int) bandIndex * bandHeight;
+					auto rowEnd = min(rowBegin + bandHeight, height);
+					labelBand(binary, image, rowBegin, rowEnd, this->bands[bandIndex]);
+				};
+
+				if (bandCount == 1) {
+					labelBandIndex(0);
+				}
+				else {
+					ThreadPool::X().parallelFor(0, bandCount, labelBandIndex, 1, ThreadPool::Priority::CameraFrame);
+				}
+			}
+
+			//stitch the bands together
+			vector<Run> * runs;
+			if (bandCount == 1) {
+				runs = &this->bands.front().runs;
+			}
+			else {
+				this->mergedRuns.clear();
+				size_t previousBandBegin = 0;
+				for (size_t bandIndex = 0; bandIndex < bandCount; bandIndex++) {
+					const auto & band = this->bands[bandIndex];
+					const auto bandBegin = this->mergedRuns.size();
+					for (auto run : band.runs) {
+						run.parent += (uint32_t) bandBegin;
+						this->mergedRuns.push_back(run);
+					}
+
+					if (bandIndex > 0) {
+						const auto & previousBand = this->bands[bandIndex - 1];
+						connectRows(this->mergedRuns
+							, previousBandBegin + previousBand.lastRowBegin
+							, previousBandBegin + previousBand.runs.size()
+							, bandBegin
+							, bandBegin + band.firstRowEnd);
+					}
+					previousBandBegin = bandBegin;
+				}
+				runs = &this->mergedRuns;
+			}
+
+			//sum the runs into their blobs
+			this->blobIndices.assign(runs->size(), -1);
+			for (uint32_t i = 0; i < runs->size(); i++) {
+				const auto & run = (*runs)[i];
+				auto & blobIndex = this->blobIndices[findRoot(*runs, i)];
+				if (blobIndex < 0) {
+					blobIndex = (int) blobs.size();
+					blobs.emplace_back();
+					blobs.back().boundingRect = cv::Rect(run.xStart, run.y, run.xEnd - run.xStart, 1);
+				}
+				auto & blob = blobs[blobIndex];
+
+				//extents
+				{
+					auto & rect = blob.boundingRect;
+					auto left = min(rect.x, run.xStart);
+					auto right = max(rect.x + rect.width, run.xEnd);
+					auto top = min(rect.y, run.y);
+					auto bottom = max(rect.y + rect.height, run.y + 1);
+					rect = cv::Rect(left, top, right - left, bottom - top);
+				}
+
+				const auto length = run.xEnd - run.xStart;
+				const double y = run.y;
+				blob.area += length;
+				blob.m00 += (double) run.sumIntensity;
+				blob.m10 += (double) run.sumXIntensity;
+				blob.m01 += y * (double) run.sumIntensity;
+				blob.m20 += (double) run.sumXXIntensity;
+				blob.m11 += y * (double) run.sumXIntensity;
+				blob.m02 += y * y * (double) run.sumIntensity;
+
+				//each run has 2 end edges and a top and bottom edge, except where it meets the rows above or below
+				blob.perimeter += (double) (2 + 2 * length - 2 * run.overlapAbove);
+			}
+
+			for (auto & blob : blobs) {
+				blob.perimeter *= PI / 4.0;
+			}
+		}
+
+		//----------
+		void ConnectedComponents::labelBand(const cv::Mat & binary, const cv::Mat & image, int rowBegin, int rowEnd, Band & band) {
+			const auto width = binary.cols;
+
+			band.runs.clear();
+			band.firstRowEnd = 0;
+			band.lastRowBegin = 0;
+
+			size_t previousRowBegin = 0;
+			size_t previousRowEnd = 0;
+
+			for (int y = rowBegin; y < rowEnd; y++) {
+				auto binaryRow = binary.ptr<uint8_t>(y);
+				auto imageRow = image.ptr<uint8_t>(y);
+				const auto rowRunsBegin = band.runs.size();
+
+				int x = 0;
+				while (x < width) {
+					//skip the background (which is most of the image) 8 pixels at a time
+					while (x + 8 <= width) {
+						uint64_t block;
+						memcpy(&block, binaryRow + x, sizeof(block));
+						if (block != 0) {
+							break;
+						}
+						x += 8;
+					}
+					while (x < width && binaryRow[x] == 0) {
+						x++;
+					}
+					if (x >= width) {
+						break;
+					}
+
+					Run run;
+					run.y = y;
+					run.xStart = x;
+					run.parent = (uint32_t) band.runs.size();
+					run.overlapAbove = 0;
+					run.sumIntensity = 0;
+					run.sumXIntensity = 0;
+					run.sumXXIntensity = 0;
+					for (; x < width && binaryRow[x] != 0; x++) {
+						const int64_t intensity = imageRow[x];
+						run.sumIntensity += intensity;
+						run.sumXIntensity += intensity * x;
+						run.sumXXIntensity += intensity * x * x;
+					}
+					run.xEnd = x;
+					band.runs.push_back(run);
+				}
+
+				const auto rowRunsEnd = band.runs.size();
+				if (y == rowBegin) {
+					band.firstRowEnd = rowRunsEnd;
+				}
+				else {
+					connectRows(band.runs, previousRowBegin, previousRowEnd, rowRunsBegin, rowRunsEnd);
+				}
+				band.lastRowBegin = rowRunsBegin;
+
+				previousRowBegin = rowRunsBegin;
+				previousRowEnd = rowRunsEnd;
+			}
+		}
+
+		//----------
+		void ConnectedComponents::connectRows(vector<Run> & runs, size_t aboveBegin, size_t aboveEnd, size_t belowBegin, size_t belowEnd) {
+			auto above = aboveBegin;
+			for (auto below = belowBegin; below < belowEnd; below++) {
+				auto & run = runs[below];
+
+				//runs above which end before this one starts (diagonals included) can't touch this run or any later run
+				while (above < aboveEnd && runs[above].xEnd < run.xStart) {
+					above++;
+				}
+
+				for (auto candidate = above; candidate < aboveEnd && runs[candidate].xStart <= run.xEnd; candidate++) {
+					const auto & runAbove = runs[candidate];
+					unite(runs, (uint32_t) candidate, (uint32_t) below);
+					run.overlapAbove += max(0, min(runAbove.xEnd, run.xEnd) - max(runAbove.xStart, run.xStart));
+				}
+			}
+		}
+
+		//----------
+		uint32_t ConnectedComponents::findRoot(vector<Run> & runs, uint32_t index) {
+			while (runs[index].parent != index) {
+				//path halving
+				runs[index].parent = runs[runs[index].parent].parent;
+				index = runs[index].parent;
+			}
+			return index;
+		}
+
+		//----------
+		void ConnectedComponents::unite(vector<Run> & runs, uint32_t a, uint32_t b) {
+			a = findRoot(runs, a);
+			b = findRoot(runs, b);
+			if (a < b) {
+				runs[b].parent = a;
+			}
+			else if (b < a) {
+				runs[a].parent = b;
+			}
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Finds the 8-connected blobs in a binary image in a single scan over the rows.
+		///Each row is split into runs of set pixels, runs which touch a run in the row above are joined with a
+		/// union-find, and the statistics of each run (intensity moments, extents, shared edges) are summed into its blob.
+		///Bands of rows can be labelled in parallel and are stitched together at their boundaries.
+		///An instance holds scratch buffers which are reused between calls, use one instance per thread.
+		class ConnectedComponents {
+		public:
+			struct Blob {
+				cv::Rect boundingRect;
+				int area = 0; // count of set pixels
+
+				//raw moments of the image intensity over the pixels of the blob (in image coordinates)
+				double m00 = 0.0;
+				double m10 = 0.0;
+				double m01 = 0.0;
+				double m20 = 0.0;
+				double m11 = 0.0;
+				double m02 = 0.0;
+
+				///Length of the pixel boundary scaled by pi / 4 (which is exact for a large disc)
+				double perimeter = 0.0;
+
+				///Moments relative to origin (like cv::moments on an ROI with that origin). Third order moments are not calculated.
+				cv::Moments getMoments(const cv::Point2i & origin) const;
+			};
+
+			///binary and image must be 8-bit single channel and the same size. image provides the intensity for the moments.
+			void process(const cv::Mat & binary
+				, const cv::Mat & image
+				, std::vector<Blob> & blobs
+				, size_t bandCount = 1);
+		protected:
+			struct Run {
+				int y;
+				int xStart;
+				int xEnd; // exclusive
+				uint32_t parent;
+				int overlapAbove; // pixels shared with runs in the row above (4-connected)
+				int64_t sumIntensity;
+				int64_t sumXIntensity;
+				int64_t sumXXIntensity;
+			};
+
+			struct Band {
+				std::vector<Run> runs;
+				size_t firstRowEnd = 0; // runs [0, firstRowEnd) are in the first row of the band
+				size_t lastRowBegin = 0; // runs [lastRowBegin, end) are in the last row of the band
+			};
+
+			static void labelBand(const cv::Mat & binary, const cv::Mat & image, int rowBegin, int rowEnd, Band &);
+			static void connectRows(std::vector<Run> & runs, size_t aboveBegin, size_t aboveEnd, size_t belowBegin, size_t belowEnd);
+			static uint32_t findRoot(std::vector<Run> & runs, uint32_t index);
+			static void unite(std::vector<Run> & runs, uint32_t a, uint32_t b);
+
+			std::vector<Band> bands;
+			std::vector<Run> mergedRuns;
+			std::vector<int> blobIndices;
+		};
+	}
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "ofxRulr/Utils/LatencyHistogram.h"
+#include "ofxRulr/Exception.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Groups frames from N cameras into sets which were captured at the same time, by their timestamps.
+		///Each camera has a fixed size buffer of frames waiting for a match. When a frame arrives we look in every other
+		/// camera's buffer for the frame nearest to it in time. If they are all within the tolerance then the set is returned
+		/// straight away (on the calling thread, so no latency is added), and those frames and any older ones are removed.
+		///Frames which are pushed out of a full buffer, or are left behind by a newer set, are counted as unmatched.
+		template<typename FrameType>
+		class FrameSynchroniser {
+		public:
+			typedef chrono::nanoseconds Timestamp;
+			typedef vector<shared_ptr<FrameType>> FrameSet;
+
+			FrameSynchroniser(size_t cameraCount = 2, size_t bufferSize = 8)
+			: skewHistogram(chrono::milliseconds(20), 40) {
+				this->setCameraCount(cameraCount, bufferSize);
+			}
+
+			///Clears any waiting frames
+			void setCameraCount(size_t cameraCount, size_t bufferSize = 8) {
+				lock_guard<mutex> lock(this->buffersMutex);
+				this->buffers.clear();
+				this->buffers.resize(cameraCount);
+				for (auto & buffer : this->buffers) {
+					buffer.reserve(bufferSize);
+				}
+				this->bufferSize = max(bufferSize, (size_t) 1);
+			}
+
+			size_t getCameraCount() const {
+				lock_guard<mutex> lock(this->buffersMutex);
+				return this->buffers.size();
+			}
+
+			void setTolerance(const Timestamp & tolerance) {
+				lock_guard<mutex> lock(this->buffersMutex);
+				this->tolerance = tolerance;
+			}
+
+			Timestamp getTolerance() const {
+				lock_guard<mutex> lock(this->buffersMutex);
+				return this->tolerance;
+			}
+
+			///Returns true and fills frameSet (one frame per camera, in camera order) if this frame completes a set
+			bool push(size_t cameraIndex, shared_ptr<FrameType> frame, const Timestamp & timestamp, FrameSet & frameSet) {
+				lock_guard<mutex> lock(this->buffersMutex);
+				if (cameraIndex >= this->buffers.size()) {
+					throw(ofxRulr::Exception("FrameSynchroniser : camera index " + ofToString(cameraIndex) + " is out of range"));
+				}
+
+				//add the frame, pushing out the oldest if the buffer is full
+				{
+					auto & buffer = this->buffers[cameraIndex];
+					if (buffer.size() >= this->bufferSize) {
+						auto oldest = min_element(buffer.begin(), buffer.end(), [](const Entry & a, const Entry & b) {
+							return a.timestamp < b.timestamp;
+						});
+						buffer.erase(oldest);
+						this->unmatchedCount++;
+					}
+					buffer.push_back({ frame, timestamp });
+				}
+
+				//find the nearest frame in time from each camera
+				auto earliest = timestamp;
+				auto latest = timestamp;
+				vector<size_t> chosenIndices(this->buffers.size());
+				for (size_t i = 0; i < this->buffers.size(); i++) {
+					const auto & buffer = this->buffers[i];
+					if (i == cameraIndex) {
+						chosenIndices[i] = buffer.size() - 1;
+						continue;
+					}
+
+					auto bestIndex = buffer.size();
+					auto bestDistance = this->tolerance;
+					for (size_t j = 0; j < buffer.size(); j++) {
+						const auto distance = getDistance(buffer[j].timestamp, timestamp);
+						if (distance <= bestDistance) {
+							bestIndex = j;
+							bestDistance = distance;
+						}
+					}
+					if (bestIndex == buffer.size()) {
+						//this camera doesn't have a frame for this time (yet)
+						return false;
+					}
+
+					chosenIndices[i] = bestIndex;
+					earliest = min(earliest, buffer[bestIndex].timestamp);
+					latest = max(latest, buffer[bestIndex].timestamp);
+				}
+				if (latest - earliest > this->tolerance) {
+					return false;
+				}
+
+				//take the set, and remove anything older than it
+				frameSet.resize(this->buffers.size());
+				for (size_t i = 0; i < this->buffers.size(); i++) {
+					auto & buffer = this->buffers[i];
+					const auto chosenTimestamp = buffer[chosenIndices[i]].timestamp;
+					frameSet[i] = buffer[chosenIndices[i]].frame;
+
+					auto sizeBefore = buffer.size();
+					buffer.erase(remove_if(buffer.begin(), buffer.end(), [&chosenTimestamp](const Entry & entry) {
+						return entry.timestamp <= chosenTimestamp;
+					}), buffer.end());
+					this->unmatchedCount += sizeBefore - buffer.size() - 1;
+				}
+				this->matchedCount++;
+				this->skewHistogram.add(latest - earliest);
+
+				return true;
+			}
+
+			void clear() {
+				lock_guard<mutex> lock(this->buffersMutex);
+				for (auto & buffer : this->buffers) {
+					buffer.clear();
+				}
+				this->matchedCount = 0;
+				this->unmatchedCount = 0;
+				this->skewHistogram.clear();
+			}
+
+			size_t getMatchedCount() const {
+				lock_guard<mutex> lock(this->buffersMutex);
+				return this->matchedCount;
+			}
+
+			size_t getUnmatchedCount() const {
+				lock_guard<mutex> lock(this->buffersMutex);
+				return this->unmatchedCount;
+			}
+
+			///Spread of the timestamps within each set which has been matched
+			const LatencyHistogram & getSkewHistogram() const {
+				return this->skewHistogram;
+			}
+		protected:
+			struct Entry {
+				shared_ptr<FrameType> frame;
+				Timestamp timestamp;
+			};
+
+			static Timestamp getDistance(const Timestamp & a, const Timestamp & b) {
+				return a > b ? a - b : b - a;
+			}
+
+			vector<vector<Entry>> buffers;
+			size_t bufferSize = 8;
+			Timestamp tolerance = chrono::milliseconds(5);
+
+			size_t matchedCount = 0;
+			size_t unmatchedCount = 0;
+			LatencyHistogram skewHistogram;
+
+			mutable mutex buffersMutex;
+		};
+	}
+}
@@ -0,0 +1,328 @@
+#include "pch_Plugin_MoCap.h"
+#include "LocalDifference.h"
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define RULR_LOCALDIFFERENCE_AVX2
+	#define RULR_LOCALDIFFERENCE_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define RULR_LOCALDIFFERENCE_SSE2
+#endif
+
+namespace ofxRulr {
+	namespace Utils {
+		//----------
+		// BORDER_REFLECT_101 (the cv::blur default), e.g. for n = 5 : 2 1 | 0 1 2 3 4 | 3 2
+		inline int reflect101(int index, int count) {
+			if (count == 1) {
+				return 0;
+			}
+			while (index < 0 || index >= count) {
+				if (index < 0) {
+					index = -index;
+				}
+				if (index >= count) {
+					index = 2 * count - 2 - index;
+				}
+			}
+			return index;
+		}
+
+		//----------
+		inline void addRow(int32_t * accumulator, const int32_t * row, int width) {
+			int x = 0;
+#if defined(RULR_LOCALDIFFERENCE_AVX2)
+			for (; x + 8 <= width; x += 8) {
+				auto sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (accumulator + x))
+					, _mm256_loadu_si256((const __m256i *) (row + x)));
+				_mm256_storeu_si256((__m256i *) (accumulator + x), sum);
+			}
+#elif defined(RULR_LOCALDIFFERENCE_SSE2)
+			for (; x + 4 <= width; x += 4) {
+				auto sum = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (accumulator + x))
+					, _mm_loadu_si128((const __m128i *) (row + x)));
+				_mm_storeu_si128((__m128i *) (accumulator + x), sum);
+			}
+#endif
+			for (; x < width; x++) {
+				accumulator[x] += row[x];
+			}
+		}
+
+		//----------
+		inline void subtractRow(int32_t * accumulator, const int32_t * row, int width) {
+			int x = 0;
+#if defined(RULR_LOCALDIFFERENCE_AVX2)
+			for (; x + 8 <= width; x += 8) {
+				auto difference = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (accumulator + x))
+					, _mm256_loadu_si256((const __m256i *) (row + x)));
+				_mm256_storeu_si256((__m256i *) (accumulator + x), difference);
+			}
+#elif defined(RULR_LOCALDIFFERENCE_SSE2)
+			for (; x + 4 <= width; x += 4) {
+				auto difference = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (accumulator + x))
+					, _mm_loadu_si128((const __m128i *) (row + x)));
+				_mm_storeu_si128((__m128i *) (accumulator + x), difference);
+			}
+#endif
+			for (; x < width; x++) {
+				accumulator[x] -= row[x];
+			}
+		}
+
+		//----------
+		vector<int> LocalDifference::getBlurPasses(int blurSize) {
+			vector<int> passes;
+
+			if (blurSize / 2 < 1) {
+				return passes;
+			}
+			passes.push_back(blurSize / 2);
+			blurSize /= 2;
+			while (blurSize > 1) {
+				if (blurSize <= 32) {
+					passes.push_back(blurSize);
+					break;
+				}
+				passes.push_back(blurSize / 2);
+				blurSize /= 2;
+			}
+			return passes;
+		}
+
+		//----------
+		void LocalDifference::process(const cv::Mat & image, cv::Mat & binary, cv::Mat * difference, const Settings & settings) {
+			if (image.type() != CV_8UC1) {
+				throw(ofxRulr::Exception("LocalDifference requires an 8-bit single channel image"));
+			}
+
+			binary.create(image.size(), CV_8UC1);
+			if (difference) {
+				difference->create(image.size(), CV_8UC1);
+			}
+
+			auto passes = getBlurPasses(settings.blurSize);
+			if (passes.empty()) {
+				//no blur means no difference
+				binary.setTo(0);
+				if (difference) {
+					difference->setTo(0);
+				}
+				return;
+			}
+
+			//all passes except the last write to our scratch images
+			const cv::Mat * source = &image;
+			for (size_t i = 0; i + 1 < passes.size(); i++) {
+				auto & destination = this->passImages[i % 2];
+				this->boxFilter(*source, destination, passes[i]);
+				source = &destination;
+			}
+
+			//the last pass goes straight to the binary image
+			this->boxFilterDifference(*source, image, binary, difference, passes.back(), settings);
+		}
+
+		//----------
+		void LocalDifference::processOpenCV(const cv::Mat & image, cv::Mat & blurred, cv::Mat & difference, cv::Mat & binary, const Settings & settings) {
+			auto passes = getBlurPasses(settings.blurSize);
+			if (passes.empty()) {
+				blurred = image.clone();
+			}
+			else {
+				cv::blur(image, blurred, cv::Size(passes[0], passes[0]));
+				for (size_t i = 1; i < passes.size(); i++) {
+					cv::blur(blurred, blurred, cv::Size(passes[i], passes[i]));
+				}
+			}
+
+			difference = image - blurred;
+			difference *= settings.differenceAmplify;
+
+			cv::threshold(difference
+				, binary
+				, settings.threshold
+				, 255
+				, CV_THRESH_BINARY);
+		}
+
+		//----------
+		string LocalDifference::benchmark(const cv::Mat & image, const Settings & settings, int iterations) {
+			typedef chrono::high_resolution_clock Clock;
+
+			cv::Mat blurred, differenceOpenCV, binaryOpenCV;
+			auto startOpenCV = Clock::now();
+			for (int i = 0; i < iterations; i++) {
+				processOpenCV(image, blurred, differenceOpenCV, binaryOpenCV, settings);
+			}
+			chrono::duration<double, milli> durationOpenCV = Clock::now() - startOpenCV;
+
+			LocalDifference localDifference;
+			cv::Mat difference, binary;
+			auto start = Clock::now();
+			for (int i = 0; i < iterations; i++) {
+				localDifference.process(image, binary, &difference, settings);
+			}
+			chrono::duration<double, milli> duration = Clock::now() - start;
+
+			//differences are expected only where rounding moves a pixel across the threshold
+			cv::Mat mismatch;
+			cv::compare(binary, binaryOpenCV, mismatch, cv::CMP_NE);
+			auto mismatchCount = cv::countNonZero(mismatch);
+
+			stringstream message;
+			message << image.cols << "x" << image.rows << ", " << iterations << " iterations" << endl
+				<< "OpenCV chain : " << (durationOpenCV.count() / iterations) << "ms per frame" << endl
+				<< "Fused kernel : " << (duration.count() / iterations) << "ms per frame" << endl
+				<< "Speed up : " << (durationOpenCV.count() / duration.count()) << "x" << endl
+				<< "Binary pixels which differ : " << mismatchCount
+				<< " (" << (100.0 * mismatchCount / (double) image.total()) << "%)";
+			return message.str();
+		}
+
+		//----------
+		template<typename RowFunction>
+		void LocalDifference::boxFilterRows(const cv::Mat & source, int size, RowFunction rowFunction) {
+			const auto width = source.cols;
+			const auto height = source.rows;
+			const auto left = size / 2; // matches the cv::blur default anchor
+			const auto right = size - 1 - left;
+
+			this->rowSums.resize((size_t) size * width);
+			this->columnSums.assign(width, 0);
+			this->paddedRow.resize(width + size);
+
+			auto getRowSums = [this, width](int slot) {
+				return this->rowSums.data() + (size_t) slot * width;
+			};
+
+			//fill the window for the first row
+			for (int i = 0; i < size; i++) {
+				auto rowSums = getRowSums(i);
+				this->horizontalSums(source.ptr<uint8_t>(reflect101(i - left, height)), width, size, rowSums);
+				addRow(this->columnSums.data(), rowSums, width);
+			}
+			rowFunction(0, this->columnSums.data());
+
+			//then slide the window down, the row leaving the window shares a slot with the row entering
+			for (int y = 1; y < height; y++) {
+				auto rowSums = getRowSums((y - 1) % size);
+				subtractRow(this->columnSums.data(), rowSums, width);
+				this->horizontalSums(source.ptr<uint8_t>(reflect101(y + right, height)), width, size, rowSums);
+				addRow(this->columnSums.data(), rowSums, width);
+
+				rowFunction(y, this->columnSums.data());
+			}
+		}
+
+		//----------
+		void LocalDifference::boxFilter(const cv::Mat & source, cv::Mat & destination, int size) {
+			destination.create(source.size(), CV_8UC1);
+			const auto width = source.cols;
+			const float inverseArea = 1.0f / (float) (size * size);
+
+			this->boxFilterRows(source, size, [&](int y, const int32_t * columnSums) {
+				auto output = destination.ptr<uint8_t>(y);
+				int x = 0;
+#if defined(RULR_LOCALDIFFERENCE_SSE2)
+				const auto scale = _mm_set1_ps(inverseArea);
+				const auto half = _mm_set1_ps(0.5f);
+				for (; x + 4 <= width; x += 4) {
+					auto sums = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (columnSums + x)));
+					auto values = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sums, scale), half));
+					auto packed = _mm_packus_epi16(_mm_packs_epi32(values, values), _mm_setzero_si128());
+					*(int32_t *) (output + x) = _mm_cvtsi128_si32(packed);
+				}
+#endif
+				for (; x < width; x++) {
+					output[x] = (uint8_t) ((float) columnSums[x] * inverseArea + 0.5f);
+				}
+			});
+		}
+
+		//----------
+		void LocalDifference::boxFilterDifference(const cv::Mat & source, const cv::Mat & image, cv::Mat & binary, cv::Mat * difference, int size, const Settings & settings) {
+			const auto width = source.cols;
+			const float inverseArea = 1.0f / (float) (size * size);
+			const auto amplify = settings.differenceAmplify;
+			const auto threshold = settings.threshold;
+
+			this->boxFilterRows(source, size, [&](int y, const int32_t * columnSums) {
+				auto imageRow = image.ptr<uint8_t>(y);
+				auto binaryRow = binary.ptr<uint8_t>(y);
+				auto differenceRow = difference ? difference->ptr<uint8_t>(y) : nullptr;
+
+				int x = 0;
+#if defined(RULR_LOCALDIFFERENCE_SSE2)
+				const auto scale = _mm_set1_ps(inverseArea);
+				const auto half = _mm_set1_ps(0.5f);
+				const auto zero = _mm_setzero_ps();
+				const auto maximum = _mm_set1_ps(255.0f);
+				const auto amplifyVector = _mm_set1_ps(amplify);
+				const auto thresholdVector = _mm_set1_ps(threshold);
+				for (; x + 4 <= width; x += 4) {
+					//blurred value, rounded to 8 bit as the separate passes would do
+					auto sums = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (columnSums + x)));
+					auto blurred = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sums, scale), half)));
+
+					//widen 4 pixels of the image to float
+					auto imagePixels = _mm_cvtsi32_si128(*(const int32_t *) (imageRow + x));
+					imagePixels = _mm_unpacklo_epi8(imagePixels, _mm_setzero_si128());
+					imagePixels = _mm_unpacklo_epi16(imagePixels, _mm_setzero_si128());
+					auto imageValues = _mm_cvtepi32_ps(imagePixels);
+
+					//saturated difference (image - blurred), amplified
+					auto amplified = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(imageValues, blurred), zero), amplifyVector);
+					amplified = _mm_min_ps(amplified, maximum);
+
+					//threshold (0xFFFFFFFF where true), packed down to 0xFF bytes
+					auto mask = _mm_castps_si128(_mm_cmpgt_ps(amplified, thresholdVector));
+					mask = _mm_packs_epi16(_mm_packs_epi32(mask, mask), _mm_setzero_si128());
+					*(int32_t *) (binaryRow + x) = _mm_cvtsi128_si32(mask);
+
+					if (differenceRow) {
+						auto values = _mm_cvttps_epi32(_mm_add_ps(amplified, half));
+						auto packed = _mm_packus_epi16(_mm_packs_epi32(values, values), _mm_setzero_si128());
+						*(int32_t *) (differenceRow + x) = _mm_cvtsi128_si32(packed);
+					}
+				}
+#endif
+				for (; x < width; x++) {
+					auto blurred = (int) ((float) columnSums[x] * inverseArea + 0.5f);
+					auto amplified = min((float) max((int) imageRow[x] - blurred, 0) * amplify, 255.0f);
+					binaryRow[x] = amplified > threshold ? 255 : 0;
+					if (differenceRow) {
+						differenceRow[x] = (uint8_t) (amplified + 0.5f);
+					}
+				}
+			});
+		}
+
+		//----------
+		void LocalDifference::horizontalSums(const uint8_t * sourceRow, int width, int size, int32_t * sumsRow) {
+			const auto left = size / 2;
+
+			//copy the row with its borders reflected, so the running sum below has no branches
+			auto padded = this->paddedRow.data();
+			const auto paddedWidth = width + size - 1;
+			for (int i = 0; i < min(left, paddedWidth); i++) {
+				padded[i] = sourceRow[reflect101(i - left, width)];
+			}
+			memcpy(padded + left, sourceRow, width);
+			for (int i = left + width; i < paddedWidth; i++) {
+				padded[i] = sourceRow[reflect101(i - left, width)];
+			}
+
+			int32_t sum = 0;
+			for (int i = 0; i < size; i++) {
+				sum += padded[i];
+			}
+			sumsRow[0] = sum;
+			for (int x = 1; x < width; x++) {
+				sum += (int32_t) padded[x + size - 1] - (int32_t) padded[x - 1];
+				sumsRow[x] = sum;
+			}
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+#include <string>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Finds bright spots by thresholding the difference between an image and a blurred copy of itself.
+		///The blur is a chain of box filters (see getBlurPasses) computed with running sums, so the cost per pixel
+		/// doesn't depend on the blur size. The last blur pass is fused with the difference, amplify and threshold,
+		/// so the blurred image itself is never written.
+		///An instance holds scratch buffers which are reused between calls, use one instance per thread.
+		class LocalDifference {
+		public:
+			struct Settings {
+				int blurSize = 100;
+				float threshold = 30.0f;
+				float differenceAmplify = 4.0f;
+			};
+
+			///The box filter sizes which approximate a blur of blurSize (matches the original iterative cv::blur chain)
+			static std::vector<int> getBlurPasses(int blurSize);
+
+			///image must be 8-bit single channel. difference is optional (pass nullptr if you don't need it)
+			void process(const cv::Mat & image
+				, cv::Mat & binary
+				, cv::Mat * difference
+				, const Settings &);
+
+			///The original OpenCV implementation (a pass per step), kept for reference and benchmarking
+			static void processOpenCV(const cv::Mat & image
+				, cv::Mat & blurred
+				, cv::Mat & difference
+				, cv::Mat & binary
+				, const Settings &);
+
+			///Times both implementations on the image and reports the speed up and how many binary pixels differ
+			static std::string benchmark(const cv::Mat & image, const Settings &, int iterations = 20);
+		protected:
+			void boxFilter(const cv::Mat & source, cv::Mat & destination, int size);
+			void boxFilterDifference(const cv::Mat & source
+				, const cv::Mat & image
+				, cv::Mat & binary
+				, cv::Mat * difference
+				, int size
+				, const Settings &);
+
+			template<typename RowFunction>
+			void boxFilterRows(const cv::Mat & source, int size, RowFunction rowFunction);
+			void horizontalSums(const uint8_t * sourceRow, int width, int size, int32_t * sumsRow);
+
+			std::vector<int32_t> rowSums; // ring buffer of horizontal sums, one row per row of the kernel
+			std::vector<int32_t> columnSums; // running vertical sum of rowSums
+			std::vector<uint8_t> paddedRow; // source row with the border reflected
+			cv::Mat passImages[2]; // intermediate blur passes
+		};
+	}
+}
@@ -0,0 +1,96 @@
+#include "pch_Plugin_MoCap.h"
+#include "PointGrid.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		//----------
+		void PointGrid::build(const vector<cv::Point2f> & points, float cellSize) {
+			this->sortedPoints.clear();
+			this->sortedIndices.clear();
+			this->cellStarts.clear();
+			this->columns = 0;
+			this->rows = 0;
+
+			//find the bounds (ignoring points which aren't finite)
+			bool first = true;
+			for (const auto & point : points) {
+				if (!isfinite(point.x) || !isfinite(point.y)) {
+					continue;
+				}
+				if (first) {
+					this->minimum = point;
+					this->maximum = point;
+					first = false;
+				}
+				else {
+					this->minimum.x = min(this->minimum.x, point.x);
+					this->minimum.y = min(this->minimum.y, point.y);
+					this->maximum.x = max(this->maximum.x, point.x);
+					this->maximum.y = max(this->maximum.y, point.y);
+				}
+			}
+			if (first) {
+				return;
+			}
+
+			//don't let the grid get much bigger than the point count
+			{
+				const auto maximumCells = 4 * points.size() + 16;
+				auto width = this->maximum.x - this->minimum.x;
+				auto height = this->maximum.y - this->minimum.y;
+				cellSize = max(cellSize, 1e-3f);
+				while ((width / cellSize + 1.0f) * (height / cellSize + 1.0f) > (float) maximumCells) {
+					cellSize *= 2.0f;
+				}
+				this->inverseCellSize = 1.0f / cellSize;
+				this->columns = (int) (width * this->inverseCellSize) + 1;
+				this->rows = (int) (height * this->inverseCellSize) + 1;
+			}
+
+			//counting sort the points into the cells
+			vector<uint32_t> cellIndices(points.size());
+			this->cellStarts.assign((size_t) this->columns * this->rows + 1, 0);
+			for (size_t i = 0; i < points.size(); i++) {
+				const auto & point = points[i];
+				if (!isfinite(point.x) || !isfinite(point.y)) {
+					cellIndices[i] = UINT32_MAX;
+					continue;
+				}
+				cellIndices[i] = (uint32_t) (this->getCellY(point.y) * this->columns + this->getCellX(point.x));
+				this->cellStarts[cellIndices[i] + 1]++;
+			}
+			for (size_t i = 1; i < this->cellStarts.size(); i++) {
+				this->cellStarts[i] += this->cellStarts[i - 1];
+			}
+
+			this->sortedPoints.resize(this->cellStarts.back());
+			this->sortedIndices.resize(this->cellStarts.back());
+			auto cellFill = this->cellStarts;
+			for (size_t i = 0; i < points.size(); i++) {
+				if (cellIndices[i] == UINT32_MAX) {
+					continue;
+				}
+				auto position = cellFill[cellIndices[i]]++;
+				this->sortedPoints[position] = points[i];
+				this->sortedIndices[position] = (uint32_t) i;
+			}
+		}
+
+		//----------
+		size_t PointGrid::size() const {
+			return this->sortedPoints.size();
+		}
+
+		//----------
+		int PointGrid::getCellX(float x) const {
+			auto cell = floor((x - this->minimum.x) * this->inverseCellSize);
+			return (int) min(max(cell, 0.0f), (float) (this->columns - 1));
+		}
+
+		//----------
+		int PointGrid::getCellY(float y) const {
+			auto cell = floor((y - this->minimum.y) * this->inverseCellSize);
+			return (int) min(max(cell, 0.0f), (float) (this->rows - 1));
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Uniform grid over a set of 2D points for fixed radius searches (e.g. matching projections to centroids).
+		///The points are stored sorted by cell, so a search only reads the cells which overlap the search radius.
+		///Build once, then search from as many threads as you like.
+		class PointGrid {
+		public:
+			///cellSize is best set to the typical search radius
+			void build(const std::vector<cv::Point2f> & points, float cellSize);
+
+			///Calls function(index, distanceSquared) for each point within radius of position (index is into the vector given to build)
+			template<typename Function>
+			void forEachWithin(const cv::Point2f & position, float radius, Function function) const {
+				if (this->sortedPoints.empty()) {
+					return;
+				}
+
+				//this also rejects NaN positions
+				if (!(position.x >= this->minimum.x - radius && position.x <= this->maximum.x + radius
+					&& position.y >= this->minimum.y - radius && position.y <= this->maximum.y + radius)) {
+					return;
+				}
+
+				const auto radiusSquared = radius * radius;
+				const auto cellXBegin = this->getCellX(position.x - radius);
+				const auto cellXEnd = this->getCellX(position.x + radius) + 1;
+				const auto cellYBegin = this->getCellY(position.y - radius);
+				const auto cellYEnd = this->getCellY(position.y + radius) + 1;
+
+				for (auto cellY = cellYBegin; cellY < cellYEnd; cellY++) {
+					//cells in a row are contiguous
+					const auto rowOffset = cellY * this->columns;
+					const auto begin = this->cellStarts[rowOffset + cellXBegin];
+					const auto end = this->cellStarts[rowOffset + cellXEnd];
+					for (auto i = begin; i < end; i++) {
+						const auto delta = this->sortedPoints[i] - position;
+						const auto distanceSquared = delta.x * delta.x + delta.y * delta.y;
+						if (distanceSquared < radiusSquared) {
+							function((size_t) this->sortedIndices[i], distanceSquared);
+						}
+					}
+				}
+			}
+
+			size_t size() const;
+		protected:
+			int getCellX(float x) const;
+			int getCellY(float y) const;
+
+			cv::Point2f minimum;
+			cv::Point2f maximum;
+			float inverseCellSize = 1.0f;
+			int columns = 0;
+			int rows = 0;
+
+			std::vector<uint32_t> cellStarts; // size is cells + 1
+			std::vector<cv::Point2f> sortedPoints;
+			std::vector<uint32_t> sortedIndices;
+		};
+	}
+}
@@ -0,0 +1,503 @@
+#include "pch_Plugin_MoCap.h"
+#include "StereoPoseSolver.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		struct StereoPose {
+			double rotation[9]; // row major
+			double translation[3];
+		};
+
+		struct NormalEquations {
+			double JtJ[6][6];
+			double Jtr[6];
+		};
+
+		//----------
+		inline void rotationVectorToMatrix(const double rotationVector[3], double rotation[9]) {
+			const auto theta = sqrt(rotationVector[0] * rotationVector[0]
+				+ rotationVector[1] * rotationVector[1]
+				+ rotationVector[2] * rotationVector[2]);
+
+			double a, b;
+			if (theta < 1e-8) {
+				//small angle (first order)
+				a = 1.0;
+				b = 0.5;
+			}
+			else {
+				a = sin(theta) / theta;
+				b = (1.0 - cos(theta)) / (theta * theta);
+			}
+
+			const auto x = rotationVector[0];
+			const auto y = rotationVector[1];
+			const auto z = rotationVector[2];
+
+			//R = I + a [r]x + b [r]x^2
+			rotation[0] = 1.0 - b * (y * y + z * z);
+			rotation[1] = -a * z + b * x * y;
+			rotation[2] = a * y + b * x * z;
+			rotation[3] = a * z + b * x * y;
+			rotation[4] = 1.0 - b * (x * x + z * z);
+			rotation[5] = -a * x + b * y * z;
+			rotation[6] = -a * y + b * x * z;
+			rotation[7] = a * x + b * y * z;
+			rotation[8] = 1.0 - b * (x * x + y * y);
+		}
+
+		//----------
+		inline void matrixToRotationVector(const double rotation[9], double rotationVector[3]) {
+			const auto cosTheta = max(-1.0, min(1.0, (rotation[0] + rotation[4] + rotation[8] - 1.0) / 2.0));
+			const auto theta = acos(cosTheta);
+
+			const double skew[3] = {
+				rotation[7] - rotation[5]
+				, rotation[2] - rotation[6]
+				, rotation[3] - rotation[1]
+			};
+
+			if (theta < 1e-6) {
+				for (int i = 0; i < 3; i++) {
+					rotationVector[i] = 0.5 * skew[i];
+				}
+			}
+			else if (PI - theta < 1e-4) {
+				//near 180 degrees the skew part vanishes, so take the axis from the diagonal
+				double axis[3];
+				for (int i = 0; i < 3; i++) {
+					axis[i] = sqrt(max(0.0, (rotation[i * 4] - cosTheta) / (1.0 - cosTheta)));
+				}
+
+				//fix the signs relative to the largest component
+				int largest = 0;
+				for (int i = 1; i < 3; i++) {
+					if (axis[i] > axis[largest]) {
+						largest = i;
+					}
+				}
+				for (int i = 0; i < 3; i++) {
+					if (i != largest && rotation[largest * 3 + i] + rotation[i * 3 + largest] < 0.0) {
+						axis[i] = -axis[i];
+					}
+				}
+				if (skew[largest] < 0.0) {
+					for (int i = 0; i < 3; i++) {
+						axis[i] = -axis[i];
+					}
+				}
+
+				for (int i = 0; i < 3; i++) {
+					rotationVector[i] = theta * axis[i];
+				}
+			}
+			else {
+				const auto scale = theta / (2.0 * sin(theta));
+				for (int i = 0; i < 3; i++) {
+					rotationVector[i] = scale * skew[i];
+				}
+			}
+		}
+
+		//----------
+		inline void multiply(const double a[9], const double b[9], double result[9]) {
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					result[i * 3 + j] = a[i * 3 + 0] * b[0 * 3 + j]
+						+ a[i * 3 + 1] * b[1 * 3 + j]
+						+ a[i * 3 + 2] * b[2 * 3 + j];
+				}
+			}
+		}
+
+		//----------
+		inline void transform(const double rotation[9], const double translation[3], const double point[3], double result[3]) {
+			for (int i = 0; i < 3; i++) {
+				result[i] = rotation[i * 3 + 0] * point[0]
+					+ rotation[i * 3 + 1] * point[1]
+					+ rotation[i * 3 + 2] * point[2]
+					+ translation[i];
+			}
+		}
+
+		//----------
+		//returns false if the point is behind the camera. jacobian is d(u, v) / d(X, Y, Z) (2x3 row major)
+		inline bool project(const StereoPoseSolver::Camera & camera, const double point[3], double projected[2], double * jacobian) {
+			if (point[2] <= 1e-12) {
+				return false;
+			}
+
+			const auto inverseZ = 1.0 / point[2];
+			const auto x = point[0] * inverseZ;
+			const auto y = point[1] * inverseZ;
+
+			const auto & k = camera.distortion;
+			const auto r2 = x * x + y * y;
+			const auto numerator = 1.0 + r2 * (k[0] + r2 * (k[1] + r2 * k[4]));
+			const auto denominator = 1.0 + r2 * (k[5] + r2 * (k[6] + r2 * k[7]));
+			const auto radial = numerator / denominator;
+
+			const auto p1 = k[2];
+			const auto p2 = k[3];
+			const auto xDistorted = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+			const auto yDistorted = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+
+			projected[0] = camera.fx * xDistorted + camera.cx;
+			projected[1] = camera.fy * yDistorted + camera.cy;
+
+			if (jacobian) {
+				const auto numeratorDerivative = k[0] + r2 * (2.0 * k[1] + r2 * 3.0 * k[4]);
+				const auto denominatorDerivative = k[5] + r2 * (2.0 * k[6] + r2 * 3.0 * k[7]);
+				const auto radialDerivative = (numeratorDerivative * denominator - numerator * denominatorDerivative) / (denominator * denominator); // d radial / d r2
+
+				const auto dxd_dx = radial + 2.0 * x * x * radialDerivative + 2.0 * p1 * y + 6.0 * p2 * x;
+				const auto dxd_dy = 2.0 * x * y * radialDerivative + 2.0 * p1 * x + 2.0 * p2 * y;
+				const auto dyd_dx = dxd_dy;
+				const auto dyd_dy = radial + 2.0 * y * y * radialDerivative + 6.0 * p1 * y + 2.0 * p2 * x;
+
+				//dx/dP = (1/Z, 0, -x/Z), dy/dP = (0, 1/Z, -y/Z)
+				jacobian[0] = camera.fx * dxd_dx * inverseZ;
+				jacobian[1] = camera.fx * dxd_dy * inverseZ;
+				jacobian[2] = -camera.fx * (dxd_dx * x + dxd_dy * y) * inverseZ;
+				jacobian[3] = camera.fy * dyd_dx * inverseZ;
+				jacobian[4] = camera.fy * dyd_dy * inverseZ;
+				jacobian[5] = -camera.fy * (dyd_dx * x + dyd_dy * y) * inverseZ;
+			}
+
+			return true;
+		}
+
+		//----------
+		//sum of squared residuals. normalEquations are filled if not null, with derivatives for the update
+		// R' = exp([dw]x) R, t' = t + dt of camera A's pose
+		inline double accumulate(const StereoPose & pose
+			, const StereoPose & stereo
+			, const StereoPoseSolver::Camera & cameraA
+			, const StereoPoseSolver::Camera & cameraB
+			, const vector<cv::Point2f> & imagePointsA
+			, const vector<cv::Point3f> & objectPointsA
+			, const vector<cv::Point2f> & imagePointsB
+			, const vector<cv::Point3f> & objectPointsB
+			, NormalEquations * normalEquations
+			, size_t & pointCount) {
+			double cost = 0.0;
+			pointCount = 0;
+			if (normalEquations) {
+				memset(normalEquations, 0, sizeof(NormalEquations));
+			}
+
+			for (int cameraIndex = 0; cameraIndex < 2; cameraIndex++) {
+				const auto isCameraB = cameraIndex == 1;
+				const auto & camera = isCameraB ? cameraB : cameraA;
+				const auto & imagePoints = isCameraB ? imagePointsB : imagePointsA;
+				const auto & objectPoints = isCameraB ? objectPointsB : objectPointsA;
+
+				for (size_t i = 0; i < objectPoints.size(); i++) {
+					const double objectPoint[3] = { objectPoints[i].x, objectPoints[i].y, objectPoints[i].z };
+
+					//point in camera A (and its rotated part, for the rotation derivative)
+					double rotated[3];
+					const double zero[3] = { 0.0, 0.0, 0.0 };
+					transform(pose.rotation, zero, objectPoint, rotated);
+					double pointInA[3] = {
+						rotated[0] + pose.translation[0]
+						, rotated[1] + pose.translation[1]
+						, rotated[2] + pose.translation[2]
+					};
+
+					double pointInCamera[3];
+					if (isCameraB) {
+						transform(stereo.rotation, stereo.translation, pointInA, pointInCamera);
+					}
+					else {
+						memcpy(pointInCamera, pointInA, sizeof(pointInCamera));
+					}
+
+					double projected[2];
+					double projectJacobian[6];
+					if (!project(camera, pointInCamera, projected, normalEquations ? projectJacobian : nullptr)) {
+						continue;
+					}
+
+					const double residual[2] = {
+						projected[0] - (double) imagePoints[i].x
+						, projected[1] - (double) imagePoints[i].y
+					};
+					cost += residual[0] * residual[0] + residual[1] * residual[1];
+					pointCount++;
+
+					if (!normalEquations) {
+						continue;
+					}
+
+					//dP/d(dw, dt) in camera A is [ -[RX]x | I ] (3x6)
+					double dPointInA[3][6] = {
+						{ 0.0, rotated[2], -rotated[1], 1.0, 0.0, 0.0 }
+						, { -rotated[2], 0.0, rotated[0], 0.0, 1.0, 0.0 }
+						, { rotated[1], -rotated[0], 0.0, 0.0, 0.0, 1.0 }
+					};
+
+					//camera B sees the point through the stereo rotation
+					double dPoint[3][6];
+					if (isCameraB) {
+						for (int row = 0; row < 3; row++) {
+							for (int column = 0; column < 6; column++) {
+								dPoint[row][column] = stereo.rotation[row * 3 + 0] * dPointInA[0][column]
+									+ stereo.rotation[row * 3 + 1] * dPointInA[1][column]
+									+ stereo.rotation[row * 3 + 2] * dPointInA[2][column];
+							}
+						}
+					}
+					else {
+						memcpy(dPoint, dPointInA, sizeof(dPoint));
+					}
+
+					//chain through the projection to get 2 rows of the Jacobian
+					double J[2][6];
+					for (int row = 0; row < 2; row++) {
+						for (int column = 0; column < 6; column++) {
+							J[row][column] = projectJacobian[row * 3 + 0] * dPoint[0][column]
+								+ projectJacobian[row * 3 + 1] * dPoint[1][column]
+								+ projectJacobian[row * 3 + 2] * dPoint[2][column];
+						}
+					}
+
+					for (int a = 0; a < 6; a++) {
+						for (int b = a; b < 6; b++) {
+							normalEquations->JtJ[a][b] += J[0][a] * J[0][b] + J[1][a] * J[1][b];
+						}
+						normalEquations->Jtr[a] += J[0][a] * residual[0] + J[1][a] * residual[1];
+					}
+				}
+			}
+
+			//fill the lower triangle
+			if (normalEquations) {
+				for (int a = 0; a < 6; a++) {
+					for (int b = 0; b < a; b++) {
+						normalEquations->JtJ[a][b] = normalEquations->JtJ[b][a];
+					}
+				}
+			}
+
+			return cost;
+		}
+
+		//----------
+		//solves A x = b for symmetric positive definite A (Cholesky)
+		inline bool solveCholesky(const double A[6][6], const double b[6], double x[6]) {
+			double L[6][6] = { 0 };
+			for (int i = 0; i < 6; i++) {
+				for (int j = 0; j <= i; j++) {
+					auto sum = A[i][j];
+					for (int k = 0; k < j; k++) {
+						sum -= L[i][k] * L[j][k];
+					}
+					if (i == j) {
+						if (sum <= 0.0) {
+							return false;
+						}
+						L[i][i] = sqrt(sum);
+					}
+					else {
+						L[i][j] = sum / L[j][j];
+					}
+				}
+			}
+
+			double y[6];
+			for (int i = 0; i < 6; i++) {
+				auto sum = b[i];
+				for (int k = 0; k < i; k++) {
+					sum -= L[i][k] * y[k];
+				}
+				y[i] = sum / L[i][i];
+			}
+			for (int i = 5; i >= 0; i--) {
+				auto sum = y[i];
+				for (int k = i + 1; k < 6; k++) {
+					sum -= L[k][i] * x[k];
+				}
+				x[i] = sum / L[i][i];
+			}
+			return true;
+		}
+
+		//----------
+		inline StereoPose makePose(const cv::Mat & rotationVector, const cv::Mat & translation) {
+			cv::Mat_<double> rotationVector64 = rotationVector.reshape(1, 3);
+			cv::Mat_<double> translation64 = translation.reshape(1, 3);
+
+			StereoPose pose;
+			const double rotationVectorArray[3] = { rotationVector64(0), rotationVector64(1), rotationVector64(2) };
+			rotationVectorToMatrix(rotationVectorArray, pose.rotation);
+			for (int i = 0; i < 3; i++) {
+				pose.translation[i] = translation64(i);
+			}
+			return pose;
+		}
+
+#pragma mark Camera
+		//----------
+		StereoPoseSolver::Camera::Camera()
+		: fx(1.0)
+		, fy(1.0)
+		, cx(0.0)
+		, cy(0.0) {
+			memset(this->distortion, 0, sizeof(this->distortion));
+		}
+
+		//----------
+		StereoPoseSolver::Camera::Camera(const cv::Mat & cameraMatrix, const cv::Mat & distortionCoefficients)
+		: Camera() {
+			cv::Mat_<double> cameraMatrix64 = cameraMatrix;
+			this->fx = cameraMatrix64(0, 0);
+			this->fy = cameraMatrix64(1, 1);
+			this->cx = cameraMatrix64(0, 2);
+			this->cy = cameraMatrix64(1, 2);
+
+			if (!distortionCoefficients.empty()) {
+				cv::Mat_<double> distortionCoefficients64 = distortionCoefficients.reshape(1, (int) distortionCoefficients.total());
+				if (distortionCoefficients64.total() > 8) {
+					throw(ofxRulr::Exception("StereoPoseSolver supports up to 8 distortion coefficients"));
+				}
+				for (size_t i = 0; i < distortionCoefficients64.total(); i++) {
+					this->distortion[i] = distortionCoefficients64((int) i);
+				}
+			}
+		}
+
+#pragma mark StereoPoseSolver
+		//----------
+		StereoPoseSolver::Result StereoPoseSolver::solve(const Camera & cameraA
+			, const Camera & cameraB
+			, const cv::Mat & stereoRotationVector
+			, const cv::Mat & stereoTranslation
+			, const vector<cv::Point2f> & imagePointsA
+			, const vector<cv::Point3f> & objectPointsA
+			, const vector<cv::Point2f> & imagePointsB
+			, const vector<cv::Point3f> & objectPointsB
+			, cv::Mat & rotationVector
+			, cv::Mat & translation
+			, const Settings & settings) {
+			if (imagePointsA.size() != objectPointsA.size()
+				|| imagePointsB.size() != objectPointsB.size()) {
+				throw(ofxRulr::Exception("StereoPoseSolver requires sets of image points and object points with equal length per camera."));
+			}
+
+			Result result;
+
+			const auto stereo = makePose(stereoRotationVector, stereoTranslation);
+			auto pose = makePose(rotationVector, translation);
+
+			NormalEquations normalEquations;
+			auto cost = accumulate(pose, stereo, cameraA, cameraB
+				, imagePointsA, objectPointsA, imagePointsB, objectPointsB
+				, &normalEquations, result.pointCount);
+
+			//we need at least as many residuals as parameters
+			if (result.pointCount < 3) {
+				return result;
+			}
+			result.initialReprojectionError = sqrt(cost / (double) result.pointCount);
+
+			auto lambda = settings.initialLambda;
+			for (result.iterations = 0; result.iterations < settings.maxIterations; result.iterations++) {
+				//damp the diagonal (Marquardt scaling) and solve for the step
+				double A[6][6];
+				memcpy(A, normalEquations.JtJ, sizeof(A));
+				for (int i = 0; i < 6; i++) {
+					A[i][i] += lambda * max(normalEquations.JtJ[i][i], 1e-12);
+				}
+				double negativeJtr[6];
+				for (int i = 0; i < 6; i++) {
+					negativeJtr[i] = -normalEquations.Jtr[i];
+				}
+				double step[6];
+				if (!solveCholesky(A, negativeJtr, step)) {
+					lambda *= 10.0;
+					continue;
+				}
+
+				//apply the step
+				auto candidate = pose;
+				{
+					double incrementRotation[9];
+					rotationVectorToMatrix(step, incrementRotation);
+					multiply(incrementRotation, pose.rotation, candidate.rotation);
+					for (int i = 0; i < 3; i++) {
+						candidate.translation[i] += step[3 + i];
+					}
+				}
+
+				size_t candidatePointCount;
+				auto candidateCost = accumulate(candidate, stereo, cameraA, cameraB
+					, imagePointsA, objectPointsA, imagePointsB, objectPointsB
+					, nullptr, candidatePointCount);
+
+				if (candidatePointCount == result.pointCount && candidateCost < cost) {
+					const auto improvement = cost - candidateCost;
+					pose = candidate;
+					cost = candidateCost;
+					lambda = max(lambda / 10.0, 1e-12);
+
+					double stepNormSquared = 0.0;
+					for (int i = 0; i < 6; i++) {
+						stepNormSquared += step[i] * step[i];
+					}
+					if (stepNormSquared < settings.parameterTolerance * settings.parameterTolerance
+						|| improvement < settings.relativeCostTolerance * cost) {
+						result.iterations++;
+						break;
+					}
+
+					accumulate(pose, stereo, cameraA, cameraB
+						, imagePointsA, objectPointsA, imagePointsB, objectPointsB
+						, &normalEquations, result.pointCount);
+				}
+				else {
+					//step was too ambitious (or moved points behind a camera)
+					lambda *= 10.0;
+					if (lambda > 1e12) {
+						break;
+					}
+				}
+			}
+
+			result.reprojectionError = sqrt(cost / (double) result.pointCount);
+			result.success = isfinite(result.reprojectionError);
+
+			if (result.success) {
+				double rotationVectorArray[3];
+				matrixToRotationVector(pose.rotation, rotationVectorArray);
+				rotationVector = (cv::Mat_<double>(3, 1) << rotationVectorArray[0], rotationVectorArray[1], rotationVectorArray[2]);
+				translation = (cv::Mat_<double>(3, 1) << pose.translation[0], pose.translation[1], pose.translation[2]);
+			}
+
+			return result;
+		}
+
+		//----------
+		double StereoPoseSolver::getReprojectionError(const Camera & cameraA
+			, const Camera & cameraB
+			, const cv::Mat & stereoRotationVector
+			, const cv::Mat & stereoTranslation
+			, const vector<cv::Point2f> & imagePointsA
+			, const vector<cv::Point3f> & objectPointsA
+			, const vector<cv::Point2f> & imagePointsB
+			, const vector<cv::Point3f> & objectPointsB
+			, const cv::Mat & rotationVector
+			, const cv::Mat & translation) {
+			size_t pointCount;
+			auto cost = accumulate(makePose(rotationVector, translation)
+				, makePose(stereoRotationVector, stereoTranslation)
+				, cameraA, cameraB
+				, imagePointsA, objectPointsA, imagePointsB, objectPointsB
+				, nullptr, pointCount);
+			if (pointCount == 0) {
+				return 0.0;
+			}
+			return sqrt(cost / (double) pointCount);
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Levenberg-Marquardt solve for the pose of an object seen by a stereo pair (6 parameters, camera A's extrinsics).
+		///Jacobians are closed form, all the working is fixed size on the stack, and the solve is warm started from the pose passed in.
+		///Camera B's pose is the stereo transform applied after camera A's pose (the same as cv::composeRT(poseA, stereo)).
+		class StereoPoseSolver {
+		public:
+			struct Camera {
+				Camera();
+				Camera(const cv::Mat & cameraMatrix, const cv::Mat & distortionCoefficients);
+
+				double fx, fy, cx, cy;
+				double distortion[8]; // k1, k2, p1, p2, k3, k4, k5, k6 (missing coefficients are zero)
+			};
+
+			struct Settings {
+				int maxIterations = 20;
+				double initialLambda = 1e-3;
+				double parameterTolerance = 1e-9; // stop when the step is smaller than this
+				double relativeCostTolerance = 1e-9; // stop when the cost improves by less than this fraction
+			};
+
+			struct Result {
+				bool success = false;
+				int iterations = 0;
+				size_t pointCount = 0;
+				double initialReprojectionError = 0.0; // RMS [px]
+				double reprojectionError = 0.0; // RMS [px]
+			};
+
+			///rotationVector and translation (CV_64F 3x1 or convertible) are the initial guess, and are replaced by the result
+			static Result solve(const Camera & cameraA
+				, const Camera & cameraB
+				, const cv::Mat & stereoRotationVector
+				, const cv::Mat & stereoTranslation
+				, const std::vector<cv::Point2f> & imagePointsA
+				, const std::vector<cv::Point3f> & objectPointsA
+				, const std::vector<cv::Point2f> & imagePointsB
+				, const std::vector<cv::Point3f> & objectPointsB
+				, cv::Mat & rotationVector
+				, cv::Mat & translation
+				, const Settings &);
+
+			///RMS reprojection error [px] over both cameras for a pose
+			static double getReprojectionError(const Camera & cameraA
+				, const Camera & cameraB
+				, const cv::Mat & stereoRotationVector
+				, const cv::Mat & stereoTranslation
+				, const std::vector<cv::Point2f> & imagePointsA
+				, const std::vector<cv::Point3f> & objectPointsA
+				, const std::vector<cv::Point2f> & imagePointsB
+				, const std::vector<cv::Point3f> & objectPointsB
+				, const cv::Mat & rotationVector
+				, const cv::Mat & translation);
+		};
+	}
+}
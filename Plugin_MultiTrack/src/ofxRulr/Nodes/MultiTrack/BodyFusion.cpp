@@ -0,0 +1,522 @@
+#include "pch_MultiTrack.h"
+#include "BodyFusion.h"
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MultiTrack {
+			//----------
+			template<typename Function>
+			void BodyFusion::forNeighbourCells(const ofVec3f & position, Function && function) const {
+				//cells are as wide as the gate, so the 3x3 cells around the position hold everything within it
+				auto x = (int32_t) floor(position.x / this->cellSize);
+				auto z = (int32_t) floor(position.z / this->cellSize);
+				for (int32_t j = z - 1; j <= z + 1; j++) {
+					for (int32_t i = x - 1; i <= x + 1; i++) {
+						auto findCell = this->cells.find(((CellKey) i << 32) | (CellKey) (uint32_t) j);
+						if (findCell == this->cells.end()) {
+							continue;
+						}
+						for (auto trackIndex : findCell->second) {
+							function(trackIndex);
+						}
+					}
+				}
+			}
+
+			//----------
+			const CombinedBodySet & BodyFusion::update(const WorldBodies & worldBodies, const Settings & settings, Clock::time_point now) {
+				auto startTime = chrono::high_resolution_clock::now();
+
+				this->cellSize = max(settings.mergeDistanceThreshold, 0.001f);
+				const auto gateSquared = settings.mergeDistanceThreshold * settings.mergeDistanceThreshold;
+				auto distanceSquaredXZ = [](const ofVec3f & a, const ofVec3f & b) {
+					auto dx = a.x - b.x;
+					auto dz = a.z - b.z;
+					return dx * dx + dz * dz;
+				};
+
+				this->statistics = Statistics();
+
+				//gather the bodies
+				this->observations.clear();
+				for (const auto & subscriberBodies : worldBodies) {
+					for (const auto & body : subscriberBodies.second) {
+						if (!body.tracked) {
+							continue;
+						}
+						Observation observation = {
+							subscriberBodies.first,
+							&body,
+							getCentroid(body),
+							0,
+							false
+						};
+						this->observations.push_back(observation);
+					}
+				}
+				this->statistics.bodyCount = this->observations.size();
+
+				CombinedBodySet newCombinedBodies;
+				auto assign = [&newCombinedBodies](Observation & observation, BodyIndex trackIndex) {
+					observation.trackIndex = trackIndex;
+					observation.assigned = true;
+					newCombinedBodies[trackIndex].originalBodiesWorldSpace[observation.subscriberID] = *observation.body;
+				};
+				auto trackHasSubscriber = [&newCombinedBodies](BodyIndex trackIndex, SubscriberID subscriberID) {
+					auto findTrack = newCombinedBodies.find(trackIndex);
+					return findTrack != newCombinedBodies.end()
+						&& findTrack->second.originalBodiesWorldSpace.find(subscriberID) != findTrack->second.originalBodiesWorldSpace.end();
+				};
+
+				//--
+				//Keep bodies with the tracks they were in last frame
+				//--
+				//
+				{
+					map<pair<SubscriberID, uint64_t>, size_t> observationBySource;
+					for (size_t i = 0; i < this->observations.size(); i++) {
+						const auto & observation = this->observations[i];
+						observationBySource.emplace(make_pair(observation.subscriberID, (uint64_t) observation.body->bodyId), i);
+					}
+
+					for (const auto & track : this->tracks) {
+						//nb : sensors reuse bodyIds, so a link is only kept whilst it's unbroken
+						if (track.second.lastSeen != this->lastUpdate) {
+							continue;
+						}
+						for (const auto & source : track.second.sources) {
+							auto findObservation = observationBySource.find(source);
+							if (findObservation != observationBySource.end()) {
+								auto & observation = this->observations[findObservation->second];
+								if (!observation.assigned) {
+									assign(observation, track.first);
+								}
+							}
+						}
+					}
+				}
+				//
+				//--
+
+
+
+				//--
+				//Assign bodies to the nearest predicted tracks
+				//--
+				//
+				this->cells.clear();
+				map<BodyIndex, ofVec3f> predictedPositions;
+				for (const auto & track : this->tracks) {
+					auto dt = min(chrono::duration<float>(now - track.second.lastSeen).count(), settings.trackTimeout);
+					auto predictedPosition = track.second.position + track.second.velocity * dt;
+					predictedPositions.emplace_hint(predictedPositions.end(), track.first, predictedPosition);
+					this->addToCell(predictedPosition, track.first);
+				}
+
+				this->candidates.clear();
+				for (size_t i = 0; i < this->observations.size(); i++) {
+					const auto & observation = this->observations[i];
+					if (observation.assigned) {
+						continue;
+					}
+					this->forNeighbourCells(observation.centroid, [&](BodyIndex trackIndex) {
+						this->statistics.comparisonCount++;
+						auto distanceSquared = distanceSquaredXZ(observation.centroid, predictedPositions[trackIndex]);
+						if (distanceSquared < gateSquared) {
+							Candidate candidate = { distanceSquared, i, trackIndex };
+							this->candidates.push_back(candidate);
+						}
+					});
+				}
+
+				//nearest pairs first (ties in the order bodies arrived, then by track index)
+				sort(this->candidates.begin(), this->candidates.end(), [](const Candidate & a, const Candidate & b) {
+					if (a.distance != b.distance) {
+						return a.distance < b.distance;
+					}
+					if (a.observation != b.observation) {
+						return a.observation < b.observation;
+					}
+					return a.trackIndex < b.trackIndex;
+				});
+				for (const auto & candidate : this->candidates) {
+					auto & observation = this->observations[candidate.observation];
+					if (!observation.assigned && !trackHasSubscriber(candidate.trackIndex, observation.subscriberID)) {
+						assign(observation, candidate.trackIndex);
+					}
+				}
+				//
+				//--
+
+
+
+				//--
+				//Group the remaining bodies into new tracks
+				//--
+				//
+				this->cells.clear();
+				map<BodyIndex, ofVec3f> newTrackPositions;
+				for (auto & observation : this->observations) {
+					if (observation.assigned) {
+						continue;
+					}
+
+					auto nearestDistanceSquared = gateSquared;
+					BodyIndex nearestTrackIndex = 0;
+					bool foundTrack = false;
+					this->forNeighbourCells(observation.centroid, [&](BodyIndex trackIndex) {
+						this->statistics.comparisonCount++;
+						auto distanceSquared = distanceSquaredXZ(observation.centroid, newTrackPositions[trackIndex]);
+						if (distanceSquared < nearestDistanceSquared && !trackHasSubscriber(trackIndex, observation.subscriberID)) {
+							nearestDistanceSquared = distanceSquared;
+							nearestTrackIndex = trackIndex;
+							foundTrack = true;
+						}
+					});
+
+					if (!foundTrack) {
+						nearestTrackIndex = this->nextTrackIndex++;
+						this->tracks[nearestTrackIndex] = Track();
+						newTrackPositions[nearestTrackIndex] = observation.centroid;
+						this->addToCell(observation.centroid, nearestTrackIndex);
+						this->statistics.newTrackCount++;
+					}
+					assign(observation, nearestTrackIndex);
+				}
+				//
+				//--
+
+
+
+				//--
+				//Calculate the merged bodies and filter the tracks
+				//--
+				//
+				for (auto & newCombinedBody : newCombinedBodies) {
+					auto & track = this->tracks[newCombinedBody.first];
+					auto & combinedBody = newCombinedBody.second;
+
+					combinedBody.combinedBody = mean(combinedBody.originalBodiesWorldSpace, settings.mergeSettings);
+					filter(track, combinedBody.combinedBody, chrono::duration<float>(now - track.lastSeen).count(), settings);
+
+					track.lastSeen = now;
+					track.sources.clear();
+					for (const auto & originalBody : combinedBody.originalBodiesWorldSpace) {
+						track.sources[originalBody.first] = (uint64_t) originalBody.second.bodyId;
+					}
+				}
+				//
+				//--
+
+
+
+				//--
+				//Remove inactive bodies and tracks
+				//--
+				//
+				for (auto newCombinedBodyIterator = newCombinedBodies.begin(); newCombinedBodyIterator != newCombinedBodies.end(); ) {
+					if (newCombinedBodyIterator->second.combinedBody.tracked) {
+						newCombinedBodyIterator++;
+					}
+					else {
+						newCombinedBodyIterator = newCombinedBodies.erase(newCombinedBodyIterator);
+					}
+				}
+
+				for (auto trackIterator = this->tracks.begin(); trackIterator != this->tracks.end(); ) {
+					if (chrono::duration<float>(now - trackIterator->second.lastSeen).count() > settings.trackTimeout) {
+						trackIterator = this->tracks.erase(trackIterator);
+					}
+					else {
+						trackIterator++;
+					}
+				}
+				//
+				//--
+
+				this->combinedBodies = move(newCombinedBodies);
+				this->lastUpdate = now;
+
+				this->statistics.trackCount = this->tracks.size();
+				this->statistics.duration = chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
+
+				return this->combinedBodies;
+			}
+
+			//----------
+			const CombinedBodySet & BodyFusion::getCombinedBodies() const {
+				return this->combinedBodies;
+			}
+
+			//----------
+			const BodyFusion::Statistics & BodyFusion::getStatistics() const {
+				return this->statistics;
+			}
+
+			//----------
+			void BodyFusion::clear() {
+				this->tracks.clear();
+				this->combinedBodies.clear();
+				this->statistics = Statistics();
+			}
+
+			//----------
+			string BodyFusion::benchmark(size_t sensorCount, size_t peopleCount, size_t frameCount, const Settings & settings) {
+				//sensors on a grid, each seeing the people within viewRadius (so most people are seen by 2 or more sensors)
+				const float sensorSpacing = 3.0f; // [m]
+				const float viewRadius = 2.5f; // [m]
+				const float walkingSpeed = 1.2f; // [m/s]
+				const float noise = 0.02f; // [m] per joint
+				const float calibrationError = 0.03f; // [m] per sensor
+				const auto framePeriod = chrono::microseconds(1000000 / 30);
+
+				if (sensorCount == 0 || peopleCount == 0 || frameCount == 0) {
+					throw(ofxRulr::Exception("BodyFusion::benchmark needs sensors, people and frames"));
+				}
+
+				//deterministic so that runs can be compared
+				uint32_t randomState = 1;
+				auto random = [&randomState](float minimum, float maximum) {
+					randomState ^= randomState << 13;
+					randomState ^= randomState >> 17;
+					randomState ^= randomState << 5;
+					return ofMap((float) randomState, 0.0f, (float) numeric_limits<uint32_t>::max(), minimum, maximum);
+				};
+
+				auto columns = (size_t) ceil(sqrt((double) sensorCount));
+				auto rows = (sensorCount + columns - 1) / columns;
+				const ofVec3f areaMinimum(-viewRadius / 2.0f, 0, -viewRadius / 2.0f);
+				const ofVec3f areaMaximum((columns - 1) * sensorSpacing + viewRadius / 2.0f, 0, (rows - 1) * sensorSpacing + viewRadius / 2.0f);
+
+				struct Sensor {
+					ofVec3f position;
+					ofVec3f offset;
+					uint64_t nextBodyId = 0;
+					map<size_t, uint64_t> bodyIdForPerson;
+				};
+				vector<Sensor> sensors(sensorCount);
+				for (size_t i = 0; i < sensorCount; i++) {
+					sensors[i].position = ofVec3f((i % columns) * sensorSpacing, 0, (i / columns) * sensorSpacing);
+					sensors[i].offset = ofVec3f(random(-1, 1), random(-1, 1), random(-1, 1)) * calibrationError;
+				}
+
+				struct Person {
+					ofVec3f position;
+					ofVec3f velocity;
+				};
+				vector<Person> people(peopleCount);
+				for (auto & person : people) {
+					person.position = ofVec3f(random(areaMinimum.x, areaMaximum.x), 0, random(areaMinimum.z, areaMaximum.z));
+					auto heading = random(0, TWO_PI);
+					person.velocity = ofVec3f(cos(heading), 0, sin(heading)) * walkingSpeed;
+				}
+
+				//a standing skeleton, joints from the floor upwards
+				vector<ofVec3f> skeleton(JointType_Count);
+				for (int i = 0; i < JointType_Count; i++) {
+					skeleton[i] = ofVec3f(0.15f * sin((float) i), 1.7f * (float) i / (float) (JointType_Count - 1), 0.1f * cos((float) i));
+				}
+				const ofVec2f centreOfDepthMap(DepthMapSize::Width / 2, DepthMapSize::Height / 2);
+
+				BodyFusion bodyFusion;
+				auto time = Clock::now();
+				chrono::duration<double, milli> totalDuration(0), maximumDuration(0);
+				size_t bodyCount = 0, trackCount = 0, visibleCount = 0, comparisonCount = 0;
+				size_t idSwitches = 0, splitPersonFrames = 0, mixedTrackFrames = 0;
+				map<size_t, BodyIndex> previousTrackForPerson;
+
+				for (size_t frame = 0; frame < frameCount; frame++) {
+					//walk, turning back at the edges
+					const auto dt = chrono::duration<float>(framePeriod).count();
+					for (auto & person : people) {
+						person.position += person.velocity * dt;
+						if (person.position.x < areaMinimum.x || person.position.x > areaMaximum.x) {
+							person.velocity.x = -person.velocity.x;
+						}
+						if (person.position.z < areaMinimum.z || person.position.z > areaMaximum.z) {
+							person.velocity.z = -person.velocity.z;
+						}
+					}
+
+					//what each sensor sees
+					WorldBodies worldBodies;
+					map<pair<SubscriberID, uint64_t>, size_t> personForSource;
+					for (size_t sensorIndex = 0; sensorIndex < sensorCount; sensorIndex++) {
+						auto & sensor = sensors[sensorIndex];
+						auto & bodies = worldBodies[sensorIndex];
+						for (size_t personIndex = 0; personIndex < peopleCount; personIndex++) {
+							const auto & person = people[personIndex];
+							if (person.position.squareDistance(sensor.position) > viewRadius * viewRadius) {
+								//out of view, the person gets a new bodyId when they come back
+								sensor.bodyIdForPerson.erase(personIndex);
+								continue;
+							}
+
+							auto findBodyId = sensor.bodyIdForPerson.find(personIndex);
+							if (findBodyId == sensor.bodyIdForPerson.end()) {
+								findBodyId = sensor.bodyIdForPerson.emplace(personIndex, sensor.nextBodyId++).first;
+							}
+
+							ofxKinectForWindows2::Data::Body body;
+							body.tracked = true;
+							body.bodyId = findBodyId->second;
+							for (int i = 0; i < JointType_Count; i++) {
+								auto jointType = (JointType) i;
+								ofVec3f position = person.position + skeleton[i] + sensor.offset
+									+ ofVec3f(random(-1, 1), random(-1, 1), random(-1, 1)) * noise;
+								Vector4 orientation = { 0, 0, 0, 1 };
+								_Joint rawJoint = {
+									jointType,
+									(CameraSpacePoint&)position,
+									TrackingState::TrackingState_Tracked
+								};
+								_JointOrientation rawJointOrientation = {
+									jointType,
+									orientation
+								};
+								body.joints[jointType].set(rawJoint, rawJointOrientation, centreOfDepthMap);
+							}
+							personForSource[make_pair((SubscriberID) sensorIndex, (uint64_t) body.bodyId)] = personIndex;
+							bodies.push_back(body);
+						}
+					}
+
+					auto startTime = chrono::high_resolution_clock::now();
+					const auto & combinedBodies = bodyFusion.update(worldBodies, settings, time);
+					chrono::duration<double, milli> duration = chrono::high_resolution_clock::now() - startTime;
+					totalDuration += duration;
+					maximumDuration = max(maximumDuration, duration);
+					time += framePeriod;
+
+					bodyCount += bodyFusion.getStatistics().bodyCount;
+					comparisonCount += bodyFusion.getStatistics().comparisonCount;
+					trackCount += combinedBodies.size();
+
+					//score the tracks against the people
+					map<size_t, set<BodyIndex>> tracksForPerson;
+					for (const auto & combinedBody : combinedBodies) {
+						set<size_t> peopleInTrack;
+						for (const auto & originalBody : combinedBody.second.originalBodiesWorldSpace) {
+							auto person = personForSource[make_pair(originalBody.first, (uint64_t) originalBody.second.bodyId)];
+							peopleInTrack.insert(person);
+							tracksForPerson[person].insert(combinedBody.first);
+						}
+						if (peopleInTrack.size() > 1) {
+							mixedTrackFrames++;
+						}
+					}
+					visibleCount += tracksForPerson.size();
+
+					map<size_t, BodyIndex> trackForPerson;
+					for (const auto & personTracks : tracksForPerson) {
+						if (personTracks.second.size() > 1) {
+							splitPersonFrames++;
+						}
+						auto track = *personTracks.second.begin();
+						trackForPerson[personTracks.first] = track;
+
+						auto findPrevious = previousTrackForPerson.find(personTracks.first);
+						if (findPrevious != previousTrackForPerson.end()
+							&& personTracks.second.find(findPrevious->second) == personTracks.second.end()) {
+							idSwitches++;
+						}
+					}
+					previousTrackForPerson = move(trackForPerson);
+				}
+
+				stringstream message;
+				message << sensorCount << " sensors, " << peopleCount << " people, " << frameCount << " frames, "
+					<< (bodyCount / frameCount) << " bodies per frame" << endl
+					<< "Fusion : " << (totalDuration.count() / frameCount) << "ms per frame (max " << maximumDuration.count() << "ms), "
+					<< (comparisonCount / frameCount) << " comparisons per frame" << endl
+					<< "Tracks per frame : " << ((float) trackCount / frameCount) << " (people in view " << ((float) visibleCount / frameCount) << ")" << endl
+					<< "Index switches : " << idSwitches << ", "
+					<< "split person frames : " << splitPersonFrames << ", "
+					<< "mixed track frames : " << mixedTrackFrames;
+				return message.str();
+			}
+
+			//----------
+			BodyFusion::CellKey BodyFusion::getCellKey(const ofVec3f & position) const {
+				auto x = (int32_t) floor(position.x / this->cellSize);
+				auto z = (int32_t) floor(position.z / this->cellSize);
+				return ((CellKey) x << 32) | (CellKey) (uint32_t) z;
+			}
+
+			//----------
+			void BodyFusion::addToCell(const ofVec3f & position, BodyIndex trackIndex) {
+				this->cells[this->getCellKey(position)].push_back(trackIndex);
+			}
+
+			//----------
+			ofVec3f BodyFusion::getCentroid(const ofxKinectForWindows2::Data::Body & body) {
+				//mean of the tracked joints (or of all joints if none are tracked)
+				ofVec3f trackedSum, sum;
+				size_t trackedCount = 0;
+				for (const auto & joint : body.joints) {
+					const auto & position = joint.second.getPosition();
+					if (joint.second.getTrackingState() == TrackingState::TrackingState_Tracked) {
+						trackedSum += position;
+						trackedCount++;
+					}
+					sum += position;
+				}
+
+				if (trackedCount > 0) {
+					return trackedSum / (float) trackedCount;
+				}
+				else if (!body.joints.empty()) {
+					return sum / (float) body.joints.size();
+				}
+				else {
+					return ofVec3f();
+				}
+			}
+
+			//----------
+			void BodyFusion::filter(Track & track, ofxKinectForWindows2::Data::Body & body, float dt, const Settings & settings) {
+				auto isNew = !track.initialised || dt <= 0.0f;
+				auto step = [&](ofVec3f & position, ofVec3f & velocity, const ofVec3f & measured) {
+					if (isNew) {
+						position = measured;
+						velocity = ofVec3f();
+						return;
+					}
+					auto predicted = position + velocity * dt;
+					auto residual = measured - predicted;
+					position = predicted + residual * settings.positionGain;
+					velocity += residual * (settings.velocityGain / dt);
+				};
+
+				step(track.position, track.velocity, getCentroid(body));
+
+				for (auto & joint : body.joints) {
+					auto findJointFilter = track.joints.find(joint.first);
+					if (findJointFilter == track.joints.end()) {
+						//joints which appear later start from where they are
+						auto & jointFilter = track.joints[joint.first];
+						jointFilter.position = joint.second.getPosition();
+						continue;
+					}
+
+					auto & jointFilter = findJointFilter->second;
+					step(jointFilter.position, jointFilter.velocity, joint.second.getPosition());
+
+					auto orientation = joint.second.getOrientation();
+					_Joint rawJoint = {
+						joint.first,
+						(CameraSpacePoint&)jointFilter.position,
+						joint.second.getTrackingState()
+					};
+					_JointOrientation rawJointOrientation = {
+						joint.first,
+						(Vector4&)orientation
+					};
+					joint.second.set(rawJoint, rawJointOrientation, joint.second.getPositionInDepthMap());
+				}
+
+				track.initialised = true;
+			}
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Utils.h"
+
+#include <chrono>
+#include <unordered_map>
+
+namespace ofxRulr {
+	namespace Nodes {
+		namespace MultiTrack {
+			///Fuses the bodies seen by all the sensors into tracks, each with an index which persists whilst the person is seen.
+			///Each frame :
+			/// 1. A body whose (subscriber, bodyId) belonged to a track in the previous frame stays with that track.
+			/// 2. Other bodies are assigned to the track whose predicted centroid is nearest (within mergeDistanceThreshold
+			///  on the floor plane), nearest pairs first. A track takes at most one body from each subscriber.
+			/// 3. Bodies which are left over are grouped into new tracks in the same way.
+			///Tracks are found through a spatial hash on the floor plane (cells of mergeDistanceThreshold), so each body is
+			/// only compared with the tracks in its own cell and the 8 around it, and the cost per frame grows with the
+			/// number of bodies rather than with its square.
+			///Each track's centroid and joints are smoothed with an alpha-beta filter, whose velocity also predicts where
+			/// the track will be in the next frame. A track which isn't seen is kept (but not output) for trackTimeout, so
+			/// that a person who drops out for a moment keeps their index.
+			class BodyFusion {
+			public:
+				typedef std::chrono::steady_clock Clock;
+				typedef map<SubscriberID, vector<ofxKinectForWindows2::Data::Body>> WorldBodies;
+
+				struct Settings {
+					float mergeDistanceThreshold = 0.3f; // [m]
+					MergeSettings mergeSettings = { true, 50.0f };
+					float positionGain = 1.0f; // 1 = no smoothing
+					float velocityGain = 0.0f; // 0 = no prediction
+					float trackTimeout = 0.5f; // [s]
+				};
+
+				struct Statistics {
+					size_t bodyCount = 0; // bodies coming in
+					size_t trackCount = 0; // tracks alive (including those not seen this frame)
+					size_t newTrackCount = 0;
+					size_t comparisonCount = 0; // body to track distances measured
+					float duration = 0.0f; // [s]
+				};
+
+				///Bodies are in world space. Returns the tracks which were seen this frame.
+				const CombinedBodySet & update(const WorldBodies &, const Settings &, Clock::time_point now = Clock::now());
+				const CombinedBodySet & getCombinedBodies() const;
+				const Statistics & getStatistics() const;
+
+				///Forgets all tracks (indices carry on from where they were)
+				void clear();
+
+				///Fuses a synthetic crowd walking through a grid of sensors, and reports the time per frame and how
+				/// well the tracks follow the people.
+				static std::string benchmark(size_t sensorCount, size_t peopleCount, size_t frameCount, const Settings &);
+			protected:
+				struct JointFilter {
+					ofVec3f position;
+					ofVec3f velocity;
+				};
+
+				struct Track {
+					ofVec3f position; // centroid
+					ofVec3f velocity;
+					map<JointType, JointFilter> joints;
+					Clock::time_point lastSeen;
+					map<SubscriberID, uint64_t> sources; // the bodyId seen from each subscriber when last seen
+					bool initialised = false;
+				};
+
+				struct Observation {
+					SubscriberID subscriberID;
+					const ofxKinectForWindows2::Data::Body * body;
+					ofVec3f centroid;
+					BodyIndex trackIndex;
+					bool assigned;
+				};
+
+				struct Candidate {
+					float distance;
+					size_t observation;
+					BodyIndex trackIndex;
+				};
+
+				typedef int64_t CellKey;
+				CellKey getCellKey(const ofVec3f & position) const;
+				void addToCell(const ofVec3f & position, BodyIndex);
+				template<typename Function>
+				void forNeighbourCells(const ofVec3f & position, Function &&) const;
+
+				static ofVec3f getCentroid(const ofxKinectForWindows2::Data::Body &);
+				static void filter(Track &, ofxKinectForWindows2::Data::Body &, float dt, const Settings &);
+
+				map<BodyIndex, Track> tracks;
+				BodyIndex nextTrackIndex = 0;
+				Clock::time_point lastUpdate;
+				CombinedBodySet combinedBodies;
+				Statistics statistics;
+
+				//kept between frames to save allocations
+				float cellSize = 1.0f;
+				std::unordered_map<CellKey, vector<BodyIndex>> cells;
+				vector<Observation> observations;
+				vector<Candidate> candidates;
+			};
+		}
+	}
+}
@@ -22,7 +22,7 @@ namespace ofxRulr {
 				this->thread = std::thread([&]() {
 					this->socket.connectTo(this->hostName, this->port);
 
-					while (threadRunning) {
+					while (this->threadRunning) {
 						this->idleFunction();
 					}
 				});
@@ -36,56 +36,55 @@ namespace ofxRulr {
 					stringstream message;
 					message << "Client #" << this->clientIndex << endl;
 					message << this->hostName << ":" << this->port;
+					auto droppedPacketCount = this->getDroppedPacketCount();
+					if (droppedPacketCount > 0) {
+						message << endl << droppedPacketCount << " packets dropped";
+					}
 					ofxCvGui::Utils::drawText(message.str(), bounds);
 				};
-				this->setHeight(60);
+				this->setHeight(80);
 			}
 
 			//----------
 			ClientHandler::Client::~Client() {
 				this->threadRunning = false;
+				this->outboxChanged.notify_all();
 				this->thread.join();
 			}
 
 			//----------
-			void ClientHandler::Client::beginFrame() {
-				this->currentFrame = make_shared<Frame>();
-				Message message("/begin");
-				this->currentFrame->packetWriter.startBundle();
-				this->currentFrame->packetWriter.addMessage(message);
+			void ClientHandler::Client::send(const shared_ptr<const Packet> & packet) {
+				this->send(Packets{ packet });
 			}
 
 			//----------
-			void ClientHandler::Client::add(const oscpkt::Message & message) {
-				if (this->currentFrame) {
-					this->currentFrame->packetWriter.addMessage(message);
-
-					if (this->currentFrame->packetWriter.packetSize() > 2048) {
-						this->currentFrame->packetWriter.endBundle();
-						this->pushFrame();
-						this->currentFrame = make_shared<Frame>();
-						this->currentFrame->packetWriter.startBundle();
+			void ClientHandler::Client::send(const Packets & packets) {
+				//if the client can't keep up then drop everything waiting, and start again from a keyframe
+				const size_t maxOutboxSize = 1024;
+				{
+					lock_guard<mutex> lock(this->outboxMutex);
+					if (this->outbox.size() + packets.size() > maxOutboxSize) {
+						this->droppedPacketCount += this->outbox.size();
+						this->outbox.clear();
+						this->needsKeyframe = true;
 					}
+					this->outbox.insert(this->outbox.end(), packets.begin(), packets.end());
 				}
+				this->outboxChanged.notify_one();
 			}
 
 			//----------
-			void ClientHandler::Client::endFrame() {
-				if (this->currentFrame) {
-					Message message("/end");
-					this->currentFrame->packetWriter.addMessage(message);
-					this->currentFrame->packetWriter.endBundle();
-					this->pushFrame();
-				}
+			bool ClientHandler::Client::takeNeedsKeyframe() {
+				lock_guard<mutex> lock(this->outboxMutex);
+				auto needsKeyframe = this->needsKeyframe;
+				this->needsKeyframe = false;
+				return needsKeyframe;
 			}
 
 			//----------
-			void ClientHandler::Client::pushFrame() {
-				this->outboxMutex.lock();
-				this->outbox.push_back(this->currentFrame);
-				this->outboxMutex.unlock();
-
-				this->currentFrame.reset();
+			size_t ClientHandler::Client::getDroppedPacketCount() const {
+				lock_guard<mutex> lock(this->outboxMutex);
+				return this->droppedPacketCount;
 			}
 
 			//----------
@@ -105,19 +104,20 @@ namespace ofxRulr {
 
 			//----------
 			void ClientHandler::Client::idleFunction() {
-				//make an empty copy of outbox which we'll swap in
-				vector<shared_ptr<Frame>> outbox;
+				deque<shared_ptr<const Packet>> outbox;
 
-				//move the outbox into this thread
-				this->outboxMutex.lock();
-				outbox.swap(this->outbox);
-				this->outboxMutex.unlock();
+				//sleep until there's something to send, then move the outbox into this thread
+				{
+					unique_lock<mutex> lock(this->outboxMutex);
+					this->outboxChanged.wait_for(lock, chrono::milliseconds(100), [this]() {
+						return !this->outbox.empty() || !this->threadRunning;
+					});
+					outbox.swap(this->outbox);
+				}
 
-				//leave early if there's nothing to party with
-				for(auto frame : outbox) {
-					this->socket.sendPacket(frame->packetWriter.packetData(), frame->packetWriter.packetSize());
+				for (const auto & packet : outbox) {
+					this->socket.sendPacket(packet->data(), packet->size());
 				}
-				outbox.clear();
 			}
 
 #pragma mark ClientHandler
@@ -146,6 +146,7 @@ namespace ofxRulr {
 
 				this->port.set("Port", 2046);
 				this->enabled.set("Enabled", true);
+				this->manageParameters(this->streamParameters);
 
 				this->view = make_shared<Panels::Scroll>();
 			}
@@ -200,6 +201,30 @@ namespace ofxRulr {
 				inspector->addLiveValue<size_t>("Client count", [this]() {
 					return this->clients.size();
 				});
+
+				inspector->addTitle("Stream", ofxCvGui::Widgets::Title::Level::H3);
+				inspector->addLiveValue<string>("Last frame", [this]() {
+					const auto & statistics = this->encoder.getStatistics();
+					stringstream message;
+					message << (statistics.keyframe ? "Keyframe, " : "Delta, ")
+						<< statistics.sentCount << "/" << statistics.channelCount << " channels, "
+						<< statistics.packetCount << " packets, "
+						<< statistics.byteCount << " B";
+					return message.str();
+				});
+				inspector->addButton("Send keyframe", [this]() {
+					this->keyframeRequested = true;
+				});
+
+				inspector->addButton("Benchmark encoder", [this]() {
+					try {
+						this->benchmarkEncoder();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+				inspector->addLiveValue<string>("Benchmark result", [this]() {
+					return this->benchmarkResult;
+				});
 			}
 
 			//----------
@@ -327,110 +352,48 @@ namespace ofxRulr {
 			}
 
 			//----------
-			void serializeChannel(shared_ptr<ClientHandler::Client> client, shared_ptr<Channel> channel, string prefix = "") {
-				for (const auto & subChannelIt : channel->getSubChannels()) {
-					auto name = subChannelIt.first;
-					auto subChannel = subChannelIt.second;
-
-					auto address = prefix + "/" + name;
-					Message message(address);
-
-					auto valueType = subChannel->getValueType();
-					switch (valueType) {
-					case Channel::Type::Bool:
-					{
-						message.pushBool(subChannel->getValue<bool>());
-						break;
-					}
-					case Channel::Type::Int:
-					{
-						message.pushInt32(subChannel->getValue<int>());
-						break;
-					}
-					case Channel::Type::Int32:
-					{
-						message.pushInt32(subChannel->getValue<int32_t>());
-						break;
-					}
-					case Channel::Type::Int64:
-					{
-						message.pushInt64(subChannel->getValue<int64_t>());
-						break;
-					}
-					case Channel::Type::UInt32:
-					{
-						message.pushInt32(subChannel->getValue<uint32_t>());
-						break;
-					}
-					case Channel::Type::UInt64:
-					{
-						message.pushInt64(subChannel->getValue<uint64_t>());
-						break;
-					}
-					case Channel::Type::Float:
-					{
-						message.pushFloat(subChannel->getValue<float>());
-						break;
-					}
-					case Channel::Type::String:
-					{
-						message.pushStr(subChannel->getValue<string>());
-						break;
-					}
-					case Channel::Type::Vec3f:
-					{
-						auto & value = subChannel->getValue<ofVec3f>();
-						for (int i = 0; i < 3; i++) {
-							message.pushFloat(value[i]);
-						}
-						break;
-					}
-					case Channel::Type::Vec4f:
-					{
-						auto & value = subChannel->getValue<ofVec4f>();
-						for (int i = 0; i < 4; i++) {
-							message.pushFloat(value[i]);
-						}
-						break;
-					}
-					case Channel::Type::IntVector:
-					{
-						auto & value = subChannel->getValue<vector<int>>();
-						for(auto & subValue : value) {
-							message.pushInt32(subValue);
-						}
-						break;
-					}
-					default:
-						break;
-					}
-					client->add(message);
+			void ClientHandler::buildOutgoingMessages() {
+				if (this->clients.empty()) {
+					return;
+				}
 
-					serializeChannel(client, subChannel, address);
+				//decide if this frame is a keyframe (all channels), or only the channels which have changed
+				auto keyframe = !this->streamParameters.sendChangesOnly.get()
+					|| this->keyframeRequested
+					|| this->streamParameters.keyframeInterval.get() <= 1
+					|| this->frameIndex % (uint64_t) this->streamParameters.keyframeInterval.get() == 0;
+				for (auto & clientIt : this->clients) {
+					//nb : check every client so that all their flags are cleared
+					if (clientIt.second->takeNeedsKeyframe()) {
+						keyframe = true;
+					}
 				}
-			}
+				this->keyframeRequested = false;
+				this->frameIndex++;
 
-			//----------
-			void ClientHandler::buildOutgoingMessages() {
+				//encode once for all clients
+				auto maxPacketSize = (size_t) max(this->streamParameters.maxPacketSize.get(), 256);
+				Utils::ChannelStreamEncoder::Packets packets;
 				auto databaseNode = this->getInput<Data::Channels::Database>();
+				if (databaseNode) {
+					packets = this->encoder.encode(databaseNode->getChannelTable(), keyframe, maxPacketSize);
+				}
+				else {
+					packets = this->encoder.encode(Table(), keyframe, maxPacketSize);
+				}
 
-				for (auto clientIt : this->clients) {
-					auto client = clientIt.second;
-
-					client->beginFrame();
-
-					{
-						Message message("/clientIndex");
-						message.pushInt32(clientIt.first);
-						client->add(message);
-					}
-
-					if (databaseNode) {
-						auto rootChannel = databaseNode->getRootChannel();
-						serializeChannel(client, rootChannel);
+				for (auto & clientIt : this->clients) {
+					vector<Message> headerMessages;
+					headerMessages.emplace_back("/begin");
+					headerMessages.emplace_back("/clientIndex");
+					headerMessages.back().pushInt32(clientIt.first);
+					if (keyframe) {
+						headerMessages.emplace_back("/keyframe");
 					}
 
-					client->endFrame();
+					auto & client = clientIt.second;
+					client->send(Utils::ChannelStreamEncoder::makePacket(headerMessages));
+					client->send(packets);
 				}
 			}
 
@@ -489,6 +452,77 @@ namespace ofxRulr {
 
 				this->needsRebuildView = false;
 			}
+
+			//----------
+			void ClientHandler::benchmarkEncoder() {
+				//a tree like the one made by World : bodies, each with some channels
+				const size_t bodyCount = 200;
+				const size_t valuesPerBody = 24;
+				const size_t frameCount = 200;
+
+				auto rootChannel = make_shared<Channel>("");
+				auto & bodiesChannel = rootChannel->getSubChannel("bodies");
+				vector<Channel *> channels;
+				for (size_t i = 0; i < bodyCount; i++) {
+					auto & bodyChannel = bodiesChannel.getSubChannel(ofToString(i));
+					for (size_t j = 0; j < valuesPerBody; j++) {
+						auto & channel = bodyChannel.getSubChannel("value" + ofToString(j));
+						channel = ofVec3f(i, j, 0);
+						channels.push_back(&channel);
+					}
+				}
+
+				Table table;
+				table.update(rootChannel);
+
+				//send to ourselves so that the cost of sending is included
+				UdpSocket receiver;
+				receiver.bindTo(0);
+				UdpSocket sender;
+				sender.connectTo("127.0.0.1", receiver.boundPort());
+				if (!receiver.isOk() || !sender.isOk()) {
+					throw(ofxRulr::Exception("Couldn't open loopback sockets for benchmark"));
+				}
+
+				auto maxPacketSize = (size_t) max(this->streamParameters.maxPacketSize.get(), 256);
+
+				auto run = [&](bool sendChangesOnly) {
+					Utils::ChannelStreamEncoder encoder;
+					chrono::high_resolution_clock::duration encodeDuration(0), sendDuration(0);
+					size_t byteCount = 0;
+
+					for (size_t frame = 0; frame < frameCount; frame++) {
+						//10% of the values change each frame
+						for (size_t i = frame % 10; i < channels.size(); i += 10) {
+							*channels[i] = ofVec3f(i, frame, 0);
+						}
+
+						auto startTime = chrono::high_resolution_clock::now();
+						auto packets = encoder.encode(table, !sendChangesOnly || frame == 0, maxPacketSize);
+						auto encodedTime = chrono::high_resolution_clock::now();
+						for (const auto & packet : packets) {
+							sender.sendPacket(packet->data(), packet->size());
+						}
+						auto sentTime = chrono::high_resolution_clock::now();
+
+						encodeDuration += encodedTime - startTime;
+						sendDuration += sentTime - encodedTime;
+						byteCount += encoder.getStatistics().byteCount;
+
+						while (receiver.receiveNextPacket(0)) { }
+					}
+
+					stringstream message;
+					message << (sendChangesOnly ? "Changes" : "Full") << " : "
+						<< chrono::duration_cast<chrono::microseconds>(encodeDuration).count() / frameCount << "us encode, "
+						<< chrono::duration_cast<chrono::microseconds>(sendDuration).count() / frameCount << "us send, "
+						<< byteCount / frameCount << "B per frame";
+					return message.str();
+				};
+
+				this->benchmarkResult = run(false) + "\n" + run(true);
+				ofLogNotice("MultiTrack::ClientHandler") << "Benchmark (" << channels.size() << " channels, " << frameCount << " frames)" << endl << this->benchmarkResult;
+			}
 		}
 	}
 }
\ No newline at end of file
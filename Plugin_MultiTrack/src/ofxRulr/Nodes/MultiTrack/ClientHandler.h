@@ -2,12 +2,16 @@
 
 #include "ofxRulr/Nodes/Base.h"
 #include "ofxRulr/Data/Channels/Channel.h"
+#include "ofxRulr/Utils/ChannelStreamEncoder.h"
 
 #include "ofxCvGui/Panels/Scroll.h"
 
 #include "oscpkt/udp.hh"
 #include "oscpkt/oscpkt.hh"
 
+#include <condition_variable>
+#include <deque>
+
 namespace ofxRulr {
 	namespace Nodes {
 		namespace MultiTrack {
@@ -15,17 +19,20 @@ namespace ofxRulr {
 			public:
 				class Client : public ofxCvGui::Element {
 				public:
-					struct Frame {
-						oscpkt::PacketWriter packetWriter;
-					};
+					typedef Utils::ChannelStreamEncoder::Packet Packet;
+					typedef Utils::ChannelStreamEncoder::Packets Packets;
 
 					Client(const string & hostName, int port, int clientIndex);
 					~Client();
 					
-					void beginFrame();
-					void add(const oscpkt::Message &);
-					void endFrame();
-					void pushFrame();
+					///Packets are shared between clients, and are sent from this client's thread
+					void send(const shared_ptr<const Packet> &);
+					void send(const Packets &);
+
+					///True if this client needs a complete frame (e.g. it is new, or its outbox overflowed). Clears the flag.
+					bool takeNeedsKeyframe();
+
+					size_t getDroppedPacketCount() const;
 
 					int getClientIndex() const;
 					const string & getHostName() const;
@@ -39,14 +46,15 @@ namespace ofxRulr {
 					int clientIndex;
 
 					thread thread;
-					bool threadRunning = false;
+					atomic<bool> threadRunning{ false };
 
 					oscpkt::UdpSocket socket;
 
-					vector<shared_ptr<Frame>> outbox;
-					mutex outboxMutex;
-
-					shared_ptr<Frame> currentFrame;
+					deque<shared_ptr<const Packet>> outbox;
+					mutable mutex outboxMutex;
+					condition_variable outboxChanged;
+					bool needsKeyframe = true;
+					size_t droppedPacketCount = 0;
 				};
 
 				ClientHandler();
@@ -74,10 +82,23 @@ namespace ofxRulr {
 				void buildOutgoingMessages();
 
 				void rebuildView();
+				void benchmarkEncoder();
 
 				ofParameter<int> port;
 				ofParameter<bool> enabled;
 
+				struct : ofParameterGroup {
+					ofParameter<bool> sendChangesOnly{ "Send changes only", true };
+					ofParameter<int> keyframeInterval{ "Keyframe interval [frames]", 60 };
+					ofParameter<int> maxPacketSize{ "Max packet size [B]", 2048 };
+					PARAM_DECLARE("Stream", sendChangesOnly, keyframeInterval, maxPacketSize);
+				} streamParameters;
+
+				Utils::ChannelStreamEncoder encoder;
+				uint64_t frameIndex = 0;
+				bool keyframeRequested = false;
+				string benchmarkResult;
+
 				bool needsReopenServer = true;
 				uint64_t lastReopenAttempt = 0;
 				bool needsRebuildView = true;
@@ -286,6 +286,7 @@ namespace ofxRulr {
 						//Clear previous data.
 						this->dataToSolve.clear();
 						this->solveSets.clear();
+						this->poseGraphResult = ofxRulr::Utils::PoseGraph::Result();
 
 						//Start the timer.
 						this->captureStartTime = chrono::system_clock::now(); 
@@ -354,20 +355,21 @@ namespace ofxRulr {
 					//GUI.
 					inspector->addTitle("Solve", ofxCvGui::Widgets::Title::Level::H1);
 
-					auto buttonSolveNL = inspector->addButton("Solve NL", [this]() {
+					auto buttonSolveRansac = inspector->addButton("Solve RANSAC", [this]() {
 						try {
-							ofxRulr::Utils::ScopedProcess scopedProcess("Solve");
-
-							//Get crackin'
-							for (auto & it : this->solveSets) {
-								it.second.solveNL();
-							}
-
-							//Repeat.
-							this->setupSolveSets();
-							ofxCvGui::refreshInspector(this);
+							this->solve([](ofxRulr::Utils::SolveSet & solveSet) {
+								solveSet.solveRansac();
+							});
+						}
+						RULR_CATCH_ALL_TO_ALERT;
+					});
+					buttonSolveRansac->setHeight(100.0f);
 
-							scopedProcess.end();
+					auto buttonSolveNL = inspector->addButton("Solve NL", [this]() {
+						try {
+							this->solve([](ofxRulr::Utils::SolveSet & solveSet) {
+								solveSet.solveNL();
+							});
 						}
 						RULR_CATCH_ALL_TO_ALERT;
 					});
@@ -375,27 +377,37 @@ namespace ofxRulr {
 
 					auto buttonSolveCV = inspector->addButton("Solve CV", [this]() {
 						try {
-							ofxRulr::Utils::ScopedProcess scopedProcess("Solve");
-
-							//Get crackin'
-							for (auto & it : this->solveSets) {
-								it.second.solveCv();
-							}
-
-							//Repeat.
-							this->setupSolveSets();
-							ofxCvGui::refreshInspector(this);
-
-							scopedProcess.end();
+							this->solve([](ofxRulr::Utils::SolveSet & solveSet) {
+								solveSet.solveCv();
+							});
 						}
 						RULR_CATCH_ALL_TO_ALERT;
 					});
 					buttonSolveCV->setHeight(100.0f);
 
+					inspector->addParameterGroup(parameters.solve);
+
+					inspector->addTitle("Pose graph", ofxCvGui::Widgets::Title::Level::H2);
+					inspector->addIndicator("Success", [this]() {
+						if (this->poseGraphResult.success) {
+							return ofxCvGui::Widgets::Indicator::Status::Good;
+						}
+						return ofxCvGui::Widgets::Indicator::Status::Error;
+					});
+					inspector->addLiveValue<size_t>("Subscribers", [this]() {
+						return this->poseGraphResult.transforms.size();
+					});
+					inspector->addLiveValue<float>("RMS error [m]", [this]() {
+						return this->poseGraphResult.rmsError;
+					});
+					inspector->addLiveValue<size_t>("Iterations", [this]() {
+						return this->poseGraphResult.iterations;
+					});
+
 					for (auto & it : this->solveSets) {
 						auto & result = it.second.getResult();
 
-						inspector->addTitle("Solver " + ofToString(it.first), ofxCvGui::Widgets::Title::Level::H2);
+						inspector->addTitle("Solver " + ofToString(it.first.first) + " -> " + ofToString(it.first.second), ofxCvGui::Widgets::Title::Level::H2);
 
 						inspector->addParameterGroup(it.second.parameters);
 						inspector->addIndicator("Success", [this, result]() {
@@ -407,10 +419,17 @@ namespace ofxRulr {
 						inspector->addLiveValue<float>("Residual", [this, result]() {
 							return result.residual;
 						});
+						auto size = it.second.size();
+						inspector->addLiveValue<string>("Inliers", [this, result, size]() {
+							return ofToString(result.inlierCount) + " / " + ofToString(size);
+						});
 					}
 
 					auto buttonConfirm = inspector->addButton("Apply", [this]() {
-						this->applyTransforms();
+						try {
+							this->applyTransforms();
+						}
+						RULR_CATCH_ALL_TO_ALERT;
 					});
 					buttonConfirm->setHeight(100.0f);
 
@@ -576,59 +595,106 @@ namespace ofxRulr {
 				void Calibrate::setupSolveSets() {
 					if (!this->solveSets.empty()) return;
 
-					//Go through subscribers in pairs.
-					for (auto & srcIt = this->dataToSolve.begin(); srcIt != this->dataToSolve.end(); ++srcIt) {
-						//Make sure there is a next element to work with.
-						auto & dstIt = next(srcIt);
-						if (dstIt != this->dataToSolve.end()) {
+					const auto minimumSharedFrames = (size_t) this->parameters.solve.minimumSharedFrames.get();
+
+					//Go through every pair of subscribers, so that loops between them can be closed by the pose graph.
+					for (auto srcIt = this->dataToSolve.begin(); srcIt != this->dataToSolve.end(); ++srcIt) {
+						for (auto dstIt = next(srcIt); dstIt != this->dataToSolve.end(); ++dstIt) {
 							vector<ofVec3f> srcPoints;
 							vector<ofVec3f> dstPoints;
-							
-							auto & srcFrames = srcIt->second;
-							auto & dstFrames = dstIt->second;
-							for (auto & kIt : srcFrames) {
-								auto frameNum = kIt.first;
+
+							const auto & srcFrames = srcIt->second;
+							const auto & dstFrames = dstIt->second;
+							for (const auto & kIt : srcFrames) {
 								//Make sure the frame numbers match.
-								if (dstFrames.find(frameNum) != dstFrames.end()) {
+								auto findDstFrame = dstFrames.find(kIt.first);
+								if (findDstFrame != dstFrames.end()) {
 									//Add the points.
-									srcPoints.push_back(srcFrames[frameNum].position);
-									dstPoints.push_back(dstFrames[frameNum].position);
+									srcPoints.push_back(kIt.second.position);
+									dstPoints.push_back(findDstFrame->second.position);
 								}
 							}
 
-							if (srcPoints.size()) {
+							if (srcPoints.size() >= minimumSharedFrames) {
 								// Set up the solver.
-								auto & solver = this->solveSets[dstIt->first];
+								auto & solver = this->solveSets[make_pair(srcIt->first, dstIt->first)];
 								solver.setup(srcPoints, dstPoints);
 							}
 						}
 					}
 				}
 
+				//----------
+				void Calibrate::solve(const function<void(ofxRulr::Utils::SolveSet &)> & solvePair) {
+					ofxRulr::Utils::ScopedProcess scopedProcess("Solve");
+
+					this->setupSolveSets();
+					if (this->solveSets.empty()) {
+						throw(ofxRulr::Exception("No pair of subscribers saw the marker in enough of the same frames"));
+					}
+
+					//Get crackin'
+					for (auto & it : this->solveSets) {
+						solvePair(it.second);
+					}
+					this->solvePoseGraph();
+
+					ofxCvGui::refreshInspector(this);
+					scopedProcess.end();
+				}
+
+				//----------
+				void Calibrate::solvePoseGraph() {
+					this->throwIfMissingAConnection<World>();
+
+					ofxRulr::Utils::PoseGraph poseGraph;
+					for (const auto & it : this->solveSets) {
+						const auto & solveSet = it.second;
+						if (!solveSet.getResult().success) {
+							continue;
+						}
+
+						ofxRulr::Utils::PoseGraph::Edge edge;
+						edge.a = it.first.first;
+						edge.b = it.first.second;
+						edge.transform = solveSet.getResult().transform;
+						solveSet.getInliers(solveSet.parameters.ransacSettings.inlierThreshold, edge.pointsInA, edge.pointsInB);
+						if (edge.pointsInA.size() >= 3) {
+							poseGraph.addEdge(edge);
+						}
+					}
+
+					//The first subscriber keeps its transform.
+					auto & subscribers = this->getInput<World>()->getSubscribers();
+					for (auto & it : subscribers) {
+						auto subscriberNode = it.second.lock();
+						if (subscriberNode) {
+							this->poseGraphResult = poseGraph.solve(it.first, subscriberNode->getTransform(), this->parameters.solve.poseGraphIterations);
+							return;
+						}
+					}
+					throw(ofxRulr::Exception("No subscribers are connected to the World"));
+				}
+
 				//----------
 				void Calibrate::applyTransforms() {
-					//Apply the transforms in sequence.
-					ofMatrix4x4 currTransform;
-					bool firstFound = false;
+					if (!this->poseGraphResult.success) {
+						this->solvePoseGraph();
+					}
+
 					auto & subscribers = this->getInput<World>()->getSubscribers();
 					for (auto & it : subscribers) {
-						auto weak_subscriber = it.second;
-						if (!weak_subscriber.expired()) {
-							auto subscriberNode = weak_subscriber.lock();
-							if (!firstFound) {
-								currTransform = subscriberNode->getTransform();
-								firstFound = true;
-							}
-							else {
-								auto & result = this->solveSets[it.first].getResult();
-								if (!result.success) {
-									ofLogWarning("Calibrate") << "Result for Subscriber " << it.first << " was unsuccessful, use at your own risk!";
-								}
+						auto subscriberNode = it.second.lock();
+						if (!subscriberNode) {
+							continue;
+						}
 
-								currTransform *= result.transform.getInverse();
-								subscriberNode->setTransform(currTransform);
-							}
+						auto findTransform = this->poseGraphResult.transforms.find(it.first);
+						if (findTransform == this->poseGraphResult.transforms.end()) {
+							ofLogWarning("Calibrate") << "Subscriber " << it.first << " isn't joined to the others by a successful solve, so its transform is unchanged.";
+							continue;
 						}
+						subscriberNode->setTransform(findTransform->second);
 					}
 				}
 
@@ -670,7 +736,7 @@ namespace ofxRulr {
 					{
 						auto & jsonSolveSets = json["solveSets"];
 						for (auto & it : this->solveSets) {
-							auto const subscriberKey = ofToString(it.first);
+							auto const subscriberKey = ofToString(it.first.first) + "-" + ofToString(it.first.second);
 							auto & jsonSubscriber = jsonSolveSets[subscriberKey];
 							it.second.serialize(jsonSubscriber);
 						}
@@ -721,18 +787,27 @@ namespace ofxRulr {
 					}
 					{
 						this->solveSets.clear();
+						this->poseGraphResult = ofxRulr::Utils::PoseGraph::Result();
 						const auto & jsonSolveSets = json["solveSets"];
 						const auto subscriberKeys = jsonSolveSets.getMemberNames();
 						for (const auto & subscriberKey : subscriberKeys) {
+							//Older files only solved neighbouring subscribers (keyed by dst), those are rebuilt from the data below.
+							auto subscribers = ofSplitString(subscriberKey, "-");
+							if (subscribers.size() != 2) {
+								continue;
+							}
+
 							const auto & jsonSubscriber = jsonSolveSets[subscriberKey];
 							ofxRulr::Utils::SolveSet solveSet;
 							solveSet.deserialize(jsonSubscriber);
-							size_t subscriberFirst = ofToInt(subscriberKey);
-							this->solveSets.emplace(subscriberFirst, solveSet);
+							auto subscriberPair = make_pair((size_t) ofToInt(subscribers[0]), (size_t) ofToInt(subscribers[1]));
+							this->solveSets.emplace(subscriberPair, solveSet);
 						}
 					}
 
 					ofxRulr::Utils::Serializable::deserialize(json["parameters"], this->parameters);
+
+					this->setupSolveSets();
 				}
 			}
 		}
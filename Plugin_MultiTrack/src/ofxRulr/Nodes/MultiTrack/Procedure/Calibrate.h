@@ -2,6 +2,7 @@
 
 #include "ofxRulr/Nodes/Procedure/Base.h"
 #include "ofxRulr/Utils/SolveSet.h"
+#include "ofxRulr/Utils/PoseGraph.h"
 #include "ofxMultiTrack/Frame.h"
 
 namespace ofxRulr {
@@ -42,8 +43,13 @@ namespace ofxRulr {
 					vector<Marker> findMarkersInFrame(const ofxMultiTrack::Frame & frame);
 					bool mapMarkerToWorld(Marker & marker, int frameWidth, int frameHeight, const unsigned short * depthData, const float * lutData);
 
+					///A solve set for each pair of subscribers which saw the marker in enough of the same frames
 					void setupSolveSets();
 
+					///Solve each pair with solvePair, then find all the subscriber transforms together with the pose graph
+					void solve(const function<void(ofxRulr::Utils::SolveSet &)> & solvePair);
+					void solvePoseGraph();
+
 					void applyTransforms();
 
 				protected:
@@ -56,7 +62,8 @@ namespace ofxRulr {
 					chrono::system_clock::time_point captureStartTime;
 					map<size_t, vector<Marker>> dataToPreview;
 					map<size_t, map<size_t, Marker>> dataToSolve;
-					map<size_t, ofxRulr::Utils::SolveSet> solveSets;
+					map<pair<size_t, size_t>, ofxRulr::Utils::SolveSet> solveSets; // by (src, dst) subscriber
+					ofxRulr::Utils::PoseGraph::Result poseGraphResult;
 
 					ofTexture infrared;
 					ofImage threshold;
@@ -76,6 +83,12 @@ namespace ofxRulr {
 							PARAM_DECLARE("Find Marker", threshold, minimumArea, clipNear, clipFar);
 						} findMarker;
 
+						struct : ofParameterGroup {
+							ofParameter<int> minimumSharedFrames{ "Minimum shared frames", 10, 3, 1000 };
+							ofParameter<int> poseGraphIterations{ "Pose graph iterations", 100, 0, 1000 };
+							PARAM_DECLARE("Solve", minimumSharedFrames, poseGraphIterations);
+						} solve;
+
 						struct : ofParameterGroup {
 							ofParameter<bool> liveMarker{ "Live Marker", false };
 							ofParameter<bool> drawPoints{ "Draw Points", true };
@@ -83,7 +96,7 @@ namespace ofxRulr {
 							PARAM_DECLARE("Debug World", liveMarker, drawPoints, drawLines);
 						} debugWorld;
 
-						PARAM_DECLARE("Calibrate", capture, findMarker, debugWorld);
+						PARAM_DECLARE("Calibrate", capture, findMarker, solve, debugWorld);
 					} parameters;
 				};
 			}
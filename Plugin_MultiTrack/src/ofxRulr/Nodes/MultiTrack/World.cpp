@@ -160,6 +160,22 @@ namespace ofxRulr {
 						return 0.0f;
 					});
 				}
+
+				args.inspector->addLiveValue<size_t>("Tracks", [this]() {
+					return this->bodyFusion.getStatistics().trackCount;
+				});
+				args.inspector->addLiveValue<float>("Fusion time [ms]", [this]() {
+					return this->bodyFusion.getStatistics().duration * 1000.0f;
+				});
+				args.inspector->addButton("Benchmark fusion", [this]() {
+					try {
+						this->benchmarkFusion();
+					}
+					RULR_CATCH_ALL_TO_ALERT;
+				});
+				args.inspector->addLiveValue<string>("Benchmark result", [this]() {
+					return this->benchmarkResult;
+				});
 			}
 
 
@@ -171,7 +187,7 @@ namespace ofxRulr {
 			//----------
 			void World::performFusion() {
 				auto worldBodiesUnmerged = this->getWorldBodiesUnmerged();
-				this->combinedBodies = this->combineWorldBodies(worldBodiesUnmerged);
+				this->combinedBodies = this->bodyFusion.update(worldBodiesUnmerged, this->getFusionSettings());
 			}
 
 			//----------
@@ -200,137 +216,6 @@ namespace ofxRulr {
 				return worldBodiesUnmerged;
 			}
 
-			//----------
-			CombinedBodySet World::combineWorldBodies(WorldBodiesUnmerged worldBodiesUnmerged) const {
-				const auto & mergeDistanceThreshold = this->parameters.fusion.mergeDistanceThreshold.get();
-				Bodies mergedWorldBodies;
-
-				auto previousFrameCombinedBodies = this->combinedBodies;
-				CombinedBodySet newCombinedBodies;
-
-				// 1. Update any bodies which had been seen previously
-				// 2. Add any bodies which weren't seen previously (adding them to existing when distance is low)
-				// 3. Calculate the merged position
-				// as bodies are handled, we remove them from our WorldBodiesUnmerged set
-				// 4. Remove inactive bodies
-
-				//--
-				//Update bodies seen previously
-				//--
-				//
-				// 1. Go through existing bodies
-				// 2. Go through the sources of that body
-				// 3. See if it still has this body index
-				for (const auto & oldCombinedBodyIterator : previousFrameCombinedBodies) {
-					const auto & bodyIndex = oldCombinedBodyIterator.first;
-
-					for (const auto & originalBodiesIterator : oldCombinedBodyIterator.second.originalBodiesWorldSpace) {
-						const auto & originalBodyIndex = originalBodiesIterator.second.bodyId;
-						const auto & subscriberID = originalBodiesIterator.first;
-
-						auto findSubscriber = worldBodiesUnmerged.find(subscriberID);
-						if (findSubscriber != worldBodiesUnmerged.end()) {
-							auto & subscriber = findSubscriber->second;
-							//find if we have matching body index
-							for (auto subscriberBodyIterator = subscriber.begin(); subscriberBodyIterator != subscriber.end(); ) {
-								if (subscriberBodyIterator->bodyId == originalBodyIndex) {
-									//we've found a body which we'd tagged before
-									auto & combinedBody = newCombinedBodies[oldCombinedBodyIterator.first];
-
-									//assign it the new body
-									combinedBody.originalBodiesWorldSpace[subscriberID] = *subscriberBodyIterator;
-
-									//remove it from the unassigned set
-									subscriberBodyIterator = subscriber.erase(subscriberBodyIterator);
-								}
-								else {
-									subscriberBodyIterator++;
-								}
-							}
-						}
-					}
-				}
-				//
-				//--
-
-
-
-				//--
-				//Add subscriber body to existing combined bodies
-				//--
-				//
-				for (auto & subscriber : worldBodiesUnmerged) {
-					auto & bodies = subscriber.second;
-					for (auto bodyIterator = bodies.begin(); bodyIterator != bodies.end(); ) {
-						// now we have a body belonging to a subscriber
-
-						bool addedToExistingBody = false;
-
-						//check this body against any built bodies so far (this is often empty)
-						for (auto & combinedBody : newCombinedBodies) {
-							//find the mean of the combinedBody
-							auto meanOfExistingBodies = mean(combinedBody.second.originalBodiesWorldSpace, this->getMergeSettings());
-
-							//if the distance between this body and that body is < threshold, add it to the combined body
-							auto distance = meanDistance(meanOfExistingBodies, *bodyIterator, true);
-							if (distance < this->parameters.fusion.mergeDistanceThreshold) {
-								combinedBody.second.originalBodiesWorldSpace[subscriber.first] = *bodyIterator;
-								addedToExistingBody = true;
-								break;
-							}
-						}
-
-						if (!addedToExistingBody) {
-							static BodyIndex bodyIndex = 0;
-							auto & combinedBody = newCombinedBodies[bodyIndex];
-							combinedBody.originalBodiesWorldSpace[subscriber.first] = *bodyIterator;
-							bodyIndex++;
-						}
-
-						//erase this body from unassigned bodies
-						bodyIterator = bodies.erase(bodyIterator);
-					}
-				}
-				//
-				//--
-
-
-
-				// now newCombinedBodies is populated
-
-
-
-				//--
-				//Calculate the merged position
-				//--
-				//
-				for (auto & newCombinedBody : newCombinedBodies) {
-					newCombinedBody.second.combinedBody = mean(newCombinedBody.second.originalBodiesWorldSpace, this->getMergeSettings());
-				}
-				//
-				//--
-
-
-
-				//--
-				//Remove inactive bodies
-				//--
-				//
-				for (auto newCombinedBodyIterator = newCombinedBodies.begin(); newCombinedBodyIterator != newCombinedBodies.end(); ) {
-					if (newCombinedBodyIterator->second.combinedBody.tracked) {
-						newCombinedBodyIterator++;
-					}
-					else {
-						newCombinedBodyIterator = newCombinedBodies.erase(newCombinedBodyIterator);
-					}
-
-				}
-				//
-				//--
-
-				return newCombinedBodies;
-			}
-
 			//----------
 			void World::populateDatabase(Data::Channels::Channel & rootChannel) {
 				auto & combined = rootChannel["combined"];
@@ -346,16 +231,20 @@ namespace ofxRulr {
 
 					//remove untracked bodies from database
 					{
-						auto & bodyChannels = bodies["body"].getSubChannels();
-						for (auto bodyChannelIterator = bodyChannels.begin(); bodyChannelIterator != bodyChannels.end(); ) {
-							const auto bodyIndex = ofToInt(bodyChannelIterator->first);
+						auto & bodiesChannel = bodies["body"];
+						vector<string> untrackedBodyNames;
+						for (const auto & bodyChannel : bodiesChannel.getSubChannels()) {
+							const auto bodyIndex = ofToInt(bodyChannel.first);
 							if (this->combinedBodies.find(bodyIndex) == this->combinedBodies.end()) {
-								bodyChannelIterator = bodyChannels.erase(bodyChannelIterator);
-							}
-							else {
-								bodyChannelIterator++;
+								untrackedBodyNames.push_back(bodyChannel.first);
+								this->bodyJointChannels.erase(bodyIndex);
 							}
 						}
+
+						//nb : removeSubChannel notifies the hierarchy change (so tables and cached channels are refreshed)
+						for (const auto & untrackedBodyName : untrackedBodyNames) {
+							bodiesChannel.removeSubChannel(untrackedBodyName);
+						}
 					}
 
 
@@ -369,6 +258,7 @@ namespace ofxRulr {
 						if (!body.tracked) {
 							bodyChannel.removeSubChannel("centroid");
 							bodyChannel.removeSubChannel("joints");
+							this->bodyJointChannels.erase(combinedBody.first);
 						}
 						else {
 							//We use the base of the spine as the centroid
@@ -383,13 +273,28 @@ namespace ofxRulr {
 							auto & jointsChannel = bodyChannel["joints"];
 							jointsChannel["count"] = (int) body.joints.size();
 
+							//look up the joint channels by name only when they are new (or the hierarchy has changed)
+							auto & cachedJoints = this->bodyJointChannels[combinedBody.first];
+							if (cachedJoints.jointsChannel.lock().get() != &jointsChannel
+								|| cachedJoints.hierarchyVersion != jointsChannel.getHierarchyVersion()) {
+								cachedJoints.jointsChannel = jointsChannel.shared_from_this();
+								cachedJoints.joints.clear();
+							}
+
 							for (auto & joint : body.joints) {
-								auto jointName = ofxKinectForWindows2::toString(joint.first);
-								auto & jointChannel = jointsChannel[jointName];
-								jointChannel["position"] = joint.second.getPosition();
-								jointChannel["orientation"] = joint.second.getOrientation().asVec4();
-								jointChannel["trackingState"] = joint.second.getTrackingState() == TrackingState::TrackingState_Tracked;
+								auto & jointChannels = cachedJoints.joints[joint.first];
+								if (!jointChannels.position) {
+									auto jointName = ofxKinectForWindows2::toString(joint.first);
+									auto & jointChannel = jointsChannel[jointName];
+									jointChannels.position = &jointChannel["position"];
+									jointChannels.orientation = &jointChannel["orientation"];
+									jointChannels.trackingState = &jointChannel["trackingState"];
+								}
+								*jointChannels.position = joint.second.getPosition();
+								*jointChannels.orientation = joint.second.getOrientation().asVec4();
+								*jointChannels.trackingState = joint.second.getTrackingState() == TrackingState::TrackingState_Tracked;
 							}
+							cachedJoints.hierarchyVersion = jointsChannel.getHierarchyVersion();
 						}
 					}
  				}
@@ -403,6 +308,28 @@ namespace ofxRulr {
 				};
 				return mergeSettings;
 			}
+
+			//----------
+			BodyFusion::Settings World::getFusionSettings() const {
+				BodyFusion::Settings settings;
+				settings.mergeDistanceThreshold = this->parameters.fusion.mergeDistanceThreshold;
+				settings.mergeSettings = this->getMergeSettings();
+				settings.positionGain = this->parameters.fusion.positionGain;
+				settings.velocityGain = this->parameters.fusion.velocityGain;
+				settings.trackTimeout = this->parameters.fusion.trackTimeout;
+				return settings;
+			}
+
+			//----------
+			void World::benchmarkFusion() {
+				//a crowd walking through more sensors than a World can take, so that there is headroom
+				const size_t sensorCount = 24;
+				const size_t peopleCount = 200;
+				const size_t frameCount = 300;
+
+				this->benchmarkResult = BodyFusion::benchmark(sensorCount, peopleCount, frameCount, this->getFusionSettings());
+				ofLogNotice("MultiTrack::World") << "Fusion benchmark" << endl << this->benchmarkResult;
+			}
 		}
 	}
 }
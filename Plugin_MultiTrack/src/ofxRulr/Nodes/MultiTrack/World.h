@@ -1,5 +1,6 @@
 #pragma once
 
+#include "BodyFusion.h"
 #include "Subscriber.h"
 #include "Utils.h"
 
@@ -11,7 +12,7 @@ namespace ofxRulr {
 			class World : public Nodes::Base {
 			public:
 				enum Constants : size_t {
-					NumSubscribers = 6
+					NumSubscribers = 12
 				};
 
 				World();
@@ -24,6 +25,7 @@ namespace ofxRulr {
 				map<size_t, weak_ptr<Subscriber>> & getSubscribers();
 
 				MergeSettings getMergeSettings() const;
+				BodyFusion::Settings getFusionSettings() const;
 			protected:
 				struct : ofParameterGroup {
 					struct : ofParameterGroup {
@@ -31,7 +33,10 @@ namespace ofxRulr {
 						ofParameter<float> mergeDistanceThreshold{ "Merge distance threshold", 0.3, 0.0, 5.0 };
 						ofParameter<bool> crossoverEnabled{ "Crossover enabled", true };
 						ofParameter<float> crossoverMargin{ "Crossover margin [px]", 50 };
-						PARAM_DECLARE("Fusion", enabled, mergeDistanceThreshold, crossoverEnabled, crossoverMargin);
+						ofParameter<float> positionGain{ "Position gain", 0.7, 0.0, 1.0 };
+						ofParameter<float> velocityGain{ "Velocity gain", 0.2, 0.0, 1.0 };
+						ofParameter<float> trackTimeout{ "Track timeout [s]", 0.5, 0.0, 10.0 };
+						PARAM_DECLARE("Fusion", enabled, mergeDistanceThreshold, crossoverEnabled, crossoverMargin, positionGain, velocityGain, trackTimeout);
 					} fusion;
 
 					struct : ofParameterGroup {
@@ -46,6 +51,7 @@ namespace ofxRulr {
 
 				Subscribers subscribers;
 
+				BodyFusion bodyFusion;
 				CombinedBodySet combinedBodies;
 
 				typedef vector<ofxKinectForWindows2::Data::Body> Bodies;
@@ -53,8 +59,23 @@ namespace ofxRulr {
 
 				void performFusion();
 				WorldBodiesUnmerged getWorldBodiesUnmerged() const;
-				CombinedBodySet combineWorldBodies(WorldBodiesUnmerged worldBodiesUnmerged) const;
 				void populateDatabase(Data::Channels::Channel & rootChannel);
+
+				void benchmarkFusion();
+				string benchmarkResult;
+
+				///The joint channels of each body, kept whilst the hierarchy beneath the body's joints channel is unchanged
+				struct JointChannels {
+					Data::Channels::Channel * position = nullptr;
+					Data::Channels::Channel * orientation = nullptr;
+					Data::Channels::Channel * trackingState = nullptr;
+				};
+				struct BodyJointChannels {
+					weak_ptr<Data::Channels::Channel> jointsChannel;
+					uint64_t hierarchyVersion = 0;
+					map<JointType, JointChannels> joints;
+				};
+				map<BodyIndex, BodyJointChannels> bodyJointChannels;
 			};
 		}
 	}
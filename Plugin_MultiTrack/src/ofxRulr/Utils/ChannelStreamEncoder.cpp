@@ -0,0 +1,247 @@
+#include "pch_MultiTrack.h"
+#include "ChannelStreamEncoder.h"
+
+using namespace ofxRulr::Data::Channels;
+using namespace oscpkt;
+
+namespace ofxRulr {
+	namespace Utils {
+#pragma mark BundleWriter
+		//----------
+		///Writes elements into bundles, starting a new bundle (i.e. a new packet) when the current one would exceed the maximum size
+		class ChannelStreamEncoder::BundleWriter {
+		public:
+			BundleWriter(Packets & packets, size_t maxPacketSize)
+			: packets(packets)
+			, maxPacketSize(maxPacketSize) {
+
+			}
+
+			void add(const vector<char> & element) {
+				const auto elementSize = sizeof(uint32_t) + element.size();
+				if (!this->packet || (this->packet->size() + elementSize > this->maxPacketSize && this->packet->size() > headerSize)) {
+					this->flush();
+					this->packet = make_shared<Packet>();
+					this->packet->reserve(this->maxPacketSize);
+
+					//'#bundle' then the 'immediate' time tag
+					const char header[headerSize] = { '#', 'b', 'u', 'n', 'd', 'l', 'e', 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+					this->packet->insert(this->packet->end(), header, header + headerSize);
+				}
+
+				//element size is big endian
+				const auto size = (uint32_t) element.size();
+				const char sizeBytes[4] = { (char) (size >> 24), (char) (size >> 16), (char) (size >> 8), (char) size };
+				this->packet->insert(this->packet->end(), sizeBytes, sizeBytes + 4);
+				this->packet->insert(this->packet->end(), element.begin(), element.end());
+			}
+
+			void flush() {
+				if (this->packet) {
+					this->packets.push_back(this->packet);
+					this->packet.reset();
+				}
+			}
+		protected:
+			static const size_t headerSize = 16;
+			Packets & packets;
+			size_t maxPacketSize;
+			shared_ptr<Packet> packet;
+		};
+
+#pragma mark ChannelStreamEncoder
+		//----------
+		ChannelStreamEncoder::Packets ChannelStreamEncoder::encode(const Table & table, bool keyframe, size_t maxPacketSize) {
+			this->statistics = Statistics();
+			this->statistics.keyframe = keyframe;
+
+			if (&table != this->table || table.getGeneration() != this->tableGeneration) {
+				this->remapEntries(table);
+			}
+
+			Packets packets;
+			BundleWriter writer(packets, maxPacketSize);
+
+			const auto & tableEntries = table.getEntries();
+			this->statistics.channelCount = tableEntries.size();
+			for (size_t i = 0; i < tableEntries.size(); i++) {
+				const auto & tableEntry = tableEntries[i];
+				const auto & channel = *tableEntry.channel;
+				auto & entry = this->entries[i];
+
+				auto send = keyframe;
+				if (!entry.built || entry.version != channel.getVersion()) {
+					Message message(tableEntry.address);
+					pushValue(message, channel);
+
+					vector<char> bytes;
+					encodeMessage(message, bytes);
+					if (!entry.built || bytes != entry.message) {
+						entry.message.swap(bytes);
+						send = true;
+					}
+					entry.version = channel.getVersion();
+					entry.built = true;
+					this->statistics.rebuiltCount++;
+				}
+
+				if (send) {
+					writer.add(entry.message);
+					this->statistics.sentCount++;
+				}
+			}
+
+			{
+				//built once, thread safe (several ClientHandlers may be encoding at once)
+				static const vector<char> endMessage = []() {
+					vector<char> message;
+					encodeMessage(Message("/end"), message);
+					return message;
+				}();
+				writer.add(endMessage);
+				writer.flush();
+			}
+
+			this->statistics.packetCount = packets.size();
+			for (const auto & packet : packets) {
+				this->statistics.byteCount += packet->size();
+			}
+			return packets;
+		}
+
+		//----------
+		void ChannelStreamEncoder::clear() {
+			this->entries.clear();
+			this->table = nullptr;
+		}
+
+		//----------
+		const ChannelStreamEncoder::Statistics & ChannelStreamEncoder::getStatistics() const {
+			return this->statistics;
+		}
+
+		//----------
+		shared_ptr<const ChannelStreamEncoder::Packet> ChannelStreamEncoder::makePacket(const vector<Message> & messages) {
+			PacketWriter packetWriter;
+			packetWriter.startBundle();
+			for (const auto & message : messages) {
+				packetWriter.addMessage(message);
+			}
+			packetWriter.endBundle();
+
+			auto data = packetWriter.packetData();
+			return make_shared<const Packet>(data, data + packetWriter.packetSize());
+		}
+
+		//----------
+		void ChannelStreamEncoder::pushValue(Message & message, const Channel & channel) {
+			switch (channel.getValueType()) {
+			case Channel::Type::Bool:
+			{
+				message.pushBool(channel.getValue<bool>());
+				break;
+			}
+			case Channel::Type::Int:
+			{
+				message.pushInt32(channel.getValue<int>());
+				break;
+			}
+			case Channel::Type::Int32:
+			{
+				message.pushInt32(channel.getValue<int32_t>());
+				break;
+			}
+			case Channel::Type::Int64:
+			{
+				message.pushInt64(channel.getValue<int64_t>());
+				break;
+			}
+			case Channel::Type::UInt32:
+			{
+				message.pushInt32(channel.getValue<uint32_t>());
+				break;
+			}
+			case Channel::Type::UInt64:
+			{
+				message.pushInt64(channel.getValue<uint64_t>());
+				break;
+			}
+			case Channel::Type::Float:
+			{
+				message.pushFloat(channel.getValue<float>());
+				break;
+			}
+			case Channel::Type::String:
+			{
+				message.pushStr(channel.getValue<string>());
+				break;
+			}
+			case Channel::Type::Vec3f:
+			{
+				auto & value = channel.getValue<ofVec3f>();
+				for (int i = 0; i < 3; i++) {
+					message.pushFloat(value[i]);
+				}
+				break;
+			}
+			case Channel::Type::Vec4f:
+			{
+				auto & value = channel.getValue<ofVec4f>();
+				for (int i = 0; i < 4; i++) {
+					message.pushFloat(value[i]);
+				}
+				break;
+			}
+			case Channel::Type::IntVector:
+			{
+				auto & value = channel.getValue<vector<int>>();
+				for (auto & subValue : value) {
+					message.pushInt32(subValue);
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		//----------
+		void ChannelStreamEncoder::remapEntries(const Table & table) {
+			//nb : only channels which are still alive can match (so a new channel at a recycled address won't)
+			unordered_map<const Channel *, Entry> previousEntries;
+			if (&table == this->table) {
+				for (auto & entry : this->entries) {
+					auto channel = entry.channel.lock();
+					if (channel) {
+						previousEntries[channel.get()] = move(entry);
+					}
+				}
+			}
+
+			//nb : a channel which is new to the table (or the table itself) is always sent
+			const auto & tableEntries = table.getEntries();
+			this->entries.clear();
+			this->entries.resize(tableEntries.size());
+			for (size_t i = 0; i < tableEntries.size(); i++) {
+				const auto & channel = tableEntries[i].channel;
+				auto findPrevious = previousEntries.find(channel.get());
+				if (findPrevious != previousEntries.end()) {
+					this->entries[i] = move(findPrevious->second);
+				}
+				this->entries[i].channel = channel;
+			}
+
+			this->table = &table;
+			this->tableGeneration = table.getGeneration();
+		}
+
+		//----------
+		void ChannelStreamEncoder::encodeMessage(const Message & message, vector<char> & bytes) {
+			//a single message outside of a bundle is written without a size prefix
+			PacketWriter packetWriter;
+			packetWriter.addMessage(message);
+			auto data = packetWriter.packetData();
+			bytes.assign(data, data + packetWriter.packetSize());
+		}
+	}
+}
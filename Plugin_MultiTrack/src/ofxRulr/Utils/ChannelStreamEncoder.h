@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ofxRulr/Data/Channels/Channel.h"
+#include "ofxRulr/Data/Channels/Table.h"
+
+#include "oscpkt/oscpkt.hh"
+
+#include <unordered_map>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Encodes a channel tree into OSC bundles once per frame, to be shared by every client.
+		///A channel's message is only rebuilt when the channel's version has changed (i.e. it has been assigned to),
+		/// and is only sent when its bytes differ from the last ones sent. Keyframes send every channel.
+		///Packets are immutable once encoded, so client threads can send them without copying.
+		class ChannelStreamEncoder {
+		public:
+			typedef vector<char> Packet;
+			typedef vector<shared_ptr<const Packet>> Packets;
+
+			struct Statistics {
+				bool keyframe = false;
+				size_t channelCount = 0;
+				size_t rebuiltCount = 0; // messages rebuilt because the channel's version changed
+				size_t sentCount = 0;
+				size_t packetCount = 0;
+				size_t byteCount = 0;
+			};
+
+			///The last packet ends with an /end message. An empty table gives just the /end.
+			Packets encode(const Data::Channels::Table &, bool keyframe, size_t maxPacketSize);
+
+			///Forget what has been sent (e.g. so that the next frame is complete even if it isn't a keyframe)
+			void clear();
+
+			const Statistics & getStatistics() const;
+
+			///Packs messages into one bundle
+			static shared_ptr<const Packet> makePacket(const vector<oscpkt::Message> &);
+
+			///Adds the channel's value (if it has one) as arguments
+			static void pushValue(oscpkt::Message &, const Data::Channels::Channel &);
+		protected:
+			///One per entry in the table
+			struct Entry {
+				weak_ptr<Data::Channels::Channel> channel;
+				uint64_t version = 0;
+				bool built = false;
+				vector<char> message; // the encoded message (without the bundle element size)
+			};
+
+			class BundleWriter;
+
+			///Keep what we've encoded for channels which are still in the table after it is rebuilt
+			void remapEntries(const Data::Channels::Table &);
+			static void encodeMessage(const oscpkt::Message &, vector<char> & bytes);
+
+			vector<Entry> entries;
+			const Data::Channels::Table * table = nullptr;
+			uint64_t tableGeneration = 0;
+			Statistics statistics;
+		};
+	}
+}
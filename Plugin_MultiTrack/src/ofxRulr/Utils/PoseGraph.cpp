@@ -0,0 +1,139 @@
+#include "pch_MultiTrack.h"
+#include "PoseGraph.h"
+
+#include "ofxRulr/Utils/SolveSet.h"
+
+namespace ofxRulr {
+	namespace Utils {
+		//----------
+		void PoseGraph::clear() {
+			this->edges.clear();
+		}
+
+		//----------
+		void PoseGraph::addEdge(const Edge & edge) {
+			if (edge.a == edge.b) {
+				throw(ofxRulr::Exception("Pose graph edge must join 2 different nodes"));
+			}
+			if (edge.pointsInA.size() != edge.pointsInB.size()) {
+				throw(ofxRulr::Exception("Pose graph edge points mismatch"));
+			}
+			this->edges.push_back(edge);
+		}
+
+		//----------
+		const vector<PoseGraph::Edge> & PoseGraph::getEdges() const {
+			return this->edges;
+		}
+
+		//----------
+		PoseGraph::Result PoseGraph::solve(size_t root, const ofMatrix4x4 & rootTransform, int maximumIterations, float tolerance) const {
+			Result result;
+			auto & transforms = result.transforms;
+			transforms[root] = rootTransform;
+
+			//spanning tree from the root, strongest edges first (ties go to the earlier edge)
+			while (true) {
+				const Edge * bestEdge = nullptr;
+				for (const auto & edge : this->edges) {
+					const auto hasA = transforms.find(edge.a) != transforms.end();
+					const auto hasB = transforms.find(edge.b) != transforms.end();
+					if (hasA == hasB) {
+						continue;
+					}
+					if (!bestEdge || edge.pointsInA.size() > bestEdge->pointsInA.size()) {
+						bestEdge = &edge;
+					}
+				}
+				if (!bestEdge) {
+					break;
+				}
+
+				//pointInA * worldA = pointInB * worldB, and pointInA * transform = pointInB
+				if (transforms.find(bestEdge->a) != transforms.end()) {
+					transforms[bestEdge->b] = bestEdge->transform.getInverse() * transforms[bestEdge->a];
+				}
+				else {
+					transforms[bestEdge->a] = bestEdge->transform * transforms[bestEdge->b];
+				}
+			}
+
+			//refit each node to its neighbours in turn (the root is fixed)
+			auto rmsError = this->getRmsError(transforms);
+			for (int iteration = 0; iteration < maximumIterations; iteration++) {
+				for (auto & nodeTransform : transforms) {
+					const auto node = nodeTransform.first;
+					if (node == root) {
+						continue;
+					}
+
+					vector<ofVec3f> pointsInNode;
+					vector<ofVec3f> pointsInWorld;
+					for (const auto & edge : this->edges) {
+						const vector<ofVec3f> * nodePoints;
+						const vector<ofVec3f> * otherPoints;
+						size_t other;
+						if (edge.a == node) {
+							nodePoints = &edge.pointsInA;
+							otherPoints = &edge.pointsInB;
+							other = edge.b;
+						}
+						else if (edge.b == node) {
+							nodePoints = &edge.pointsInB;
+							otherPoints = &edge.pointsInA;
+							other = edge.a;
+						}
+						else {
+							continue;
+						}
+
+						auto findOther = transforms.find(other);
+						if (findOther == transforms.end()) {
+							continue;
+						}
+						pointsInNode.insert(pointsInNode.end(), nodePoints->begin(), nodePoints->end());
+						for (const auto & point : *otherPoints) {
+							pointsInWorld.push_back(point * findOther->second);
+						}
+					}
+
+					if (pointsInNode.size() >= 3) {
+						nodeTransform.second = SolveSet::findRigidTransform(pointsInNode, pointsInWorld);
+					}
+				}
+				result.iterations++;
+
+				auto newRmsError = this->getRmsError(transforms);
+				auto improvement = rmsError - newRmsError;
+				rmsError = newRmsError;
+				if (improvement < tolerance) {
+					break;
+				}
+			}
+
+			result.rmsError = rmsError;
+			result.success = transforms.size() > 1;
+			return result;
+		}
+
+		//----------
+		float PoseGraph::getRmsError(const map<size_t, ofMatrix4x4> & transforms) const {
+			double sumSquaredError = 0.0;
+			size_t count = 0;
+			for (const auto & edge : this->edges) {
+				auto findA = transforms.find(edge.a);
+				auto findB = transforms.find(edge.b);
+				if (findA == transforms.end() || findB == transforms.end()) {
+					continue;
+				}
+				for (size_t i = 0; i < edge.pointsInA.size(); i++) {
+					sumSquaredError += (edge.pointsInA[i] * findA->second).squareDistance(edge.pointsInB[i] * findB->second);
+				}
+				count += edge.pointsInA.size();
+			}
+			return count > 0
+				? (float) sqrt(sumSquaredError / (double) count)
+				: 0.0f;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMatrix4x4.h"
+#include "ofVec3f.h"
+
+#include <map>
+#include <vector>
+
+namespace ofxRulr {
+	namespace Utils {
+		///Finds the world transform of each node (e.g. each sensor) from point correspondences between pairs of nodes.
+		///Transforms start from a spanning tree of the pairwise transforms, taking the edges with the most correspondences
+		/// first. They are then refined by block coordinate descent : each node in turn is refitted in closed form to the
+		/// points of all of its neighbours, so that the error around loops is spread over all of the edges rather than
+		/// being left on whichever edge closes the loop.
+		class PoseGraph {
+		public:
+			struct Edge {
+				size_t a;
+				size_t b;
+				ofMatrix4x4 transform; // pointInA * transform ~= pointInB
+				std::vector<ofVec3f> pointsInA;
+				std::vector<ofVec3f> pointsInB;
+			};
+
+			struct Result {
+				std::map<size_t, ofMatrix4x4> transforms; // node -> world
+				float rmsError = 0.0f; // [m] over all correspondences
+				size_t iterations = 0;
+				bool success = false;
+			};
+
+			void clear();
+			void addEdge(const Edge &);
+			const std::vector<Edge> & getEdges() const;
+
+			///The root keeps rootTransform. Nodes which can't be reached from the root are left out of the result.
+			Result solve(size_t root, const ofMatrix4x4 & rootTransform, int maximumIterations, float tolerance = 1e-6f) const;
+		protected:
+			float getRmsError(const std::map<size_t, ofMatrix4x4> & transforms) const;
+
+			std::vector<Edge> edges;
+		};
+	}
+}
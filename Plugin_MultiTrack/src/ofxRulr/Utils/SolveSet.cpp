@@ -1,8 +1,58 @@
 #include "pch_MultiTrack.h"
 #include "SolveSet.h"
 
+#include "ofxRulr/Utils/ThreadPool.h"
+
 namespace ofxRulr {
 	namespace Utils {
+		namespace {
+			//----------
+			uint32_t nextRandom(uint32_t & state) {
+				//xorshift32
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				return state;
+			}
+
+			//----------
+			//Kabsch : rotation from the SVD of the covariance of the centered points (without reflection)
+			ofMatrix4x4 fitRigid(const ofVec3f * srcPoints, const ofVec3f * dstPoints, size_t count) {
+				cv::Vec3d srcMean, dstMean;
+				for (size_t i = 0; i < count; i++) {
+					srcMean += cv::Vec3d(srcPoints[i].x, srcPoints[i].y, srcPoints[i].z);
+					dstMean += cv::Vec3d(dstPoints[i].x, dstPoints[i].y, dstPoints[i].z);
+				}
+				srcMean /= (double) count;
+				dstMean /= (double) count;
+
+				cv::Matx33d covariance = cv::Matx33d::zeros();
+				for (size_t i = 0; i < count; i++) {
+					const auto src = cv::Vec3d(srcPoints[i].x, srcPoints[i].y, srcPoints[i].z) - srcMean;
+					const auto dst = cv::Vec3d(dstPoints[i].x, dstPoints[i].y, dstPoints[i].z) - dstMean;
+					for (int r = 0; r < 3; r++) {
+						for (int c = 0; c < 3; c++) {
+							covariance(r, c) += src[r] * dst[c];
+						}
+					}
+				}
+
+				cv::Mat w, u, vt;
+				cv::SVD::compute(covariance, w, u, vt);
+				const cv::Matx33d U = u;
+				const cv::Matx33d V = cv::Matx33d(vt).t();
+				const auto reflection = cv::determinant(V * U.t()) < 0.0 ? -1.0 : 1.0;
+				const auto R = V * cv::Matx33d(1, 0, 0, 0, 1, 0, 0, 0, reflection) * U.t();
+				const cv::Vec3d t = dstMean - R * srcMean;
+
+				//ofMatrix4x4 is applied to row vectors
+				return ofMatrix4x4(R(0, 0), R(1, 0), R(2, 0), 0.0f,
+					R(0, 1), R(1, 1), R(2, 1), 0.0f,
+					R(0, 2), R(1, 2), R(2, 2), 0.0f,
+					t[0], t[1], t[2], 1.0f);
+			}
+		}
+
 		//----------
 		SolveSet::SolveSet() {
 			clear();
@@ -66,26 +116,30 @@ namespace ofxRulr {
 
 			auto fitter = make_shared<ofxNonLinearFit::Fit<ofxNonLinearFit::Models::RigidBody>>();
 
+			auto sortByResidual = [this]() {
+				sort(this->dataSet.begin(), this->dataSet.end(), [this](auto & a, auto & b) {
+					return (this->model.getResidual(a) < this->model.getResidual(b));
+				});
+			};
+
 			double residual;
 			bool success;
 			auto startTime = chrono::system_clock::now();
-			if (this->parameters.nlSettings.trimOutliers == 0.0f) {
-				//Use full data set.
-				success = fitter->optimise(this->model, &this->dataSet, &residual);
-			}
-			else {
-				//Use subset with top results. This will only work if the full set is calculated previously.
+
+			//Use full data set.
+			success = fitter->optimise(this->model, &this->dataSet, &residual);
+			sortByResidual();
+
+			if (success && this->parameters.nlSettings.trimOutliers > 0.0f) {
+				//Refit to the subset with the lowest residuals under the full fit.
 				auto firstIt = dataSet.begin();
-				auto lastIt = firstIt + (int)(this->dataSet.size() * (1.0f - this->parameters.nlSettings.trimOutliers));
+				auto lastIt = firstIt + max((int)(this->dataSet.size() * (1.0f - this->parameters.nlSettings.trimOutliers)), 1);
 				ofxNonLinearFit::Models::RigidBody::DataSet subSet(firstIt, lastIt);
 				success = fitter->optimise(this->model, &subSet, &residual);
+				sortByResidual();
 			}
 			auto endTime = chrono::system_clock::now();
 
-			sort(this->dataSet.begin(), this->dataSet.end(), [this](auto & a, auto & b) {
-				return (this->model.getResidual(a) < this->model.getResidual(b));
-			});
-
 			this->result.success = success;
 			this->result.totalTime = endTime - startTime;
 			this->result.residual = residual;
@@ -120,6 +174,195 @@ namespace ofxRulr {
 			this->completed = true;
 		}
 
+		//----------
+		void SolveSet::solveRansac() {
+			const auto count = this->dataSet.size();
+			if (count < 3) {
+				throw(ofxRulr::Exception("At least 3 points are needed to solve a rigid transform"));
+			}
+
+			const auto & settings = this->parameters.ransacSettings;
+			const auto thresholdSquared = settings.inlierThreshold * settings.inlierThreshold;
+			const auto maximumIterations = (size_t) max(settings.maximumIterations.get(), 1);
+			const auto logFailure = log(1.0 - (double) settings.confidence);
+
+			vector<ofVec3f> srcPoints(count), dstPoints(count);
+			for (size_t i = 0; i < count; i++) {
+				srcPoints[i] = this->dataSet[i].x;
+				dstPoints[i] = this->dataSet[i].xdash;
+			}
+
+			struct Hypothesis {
+				ofMatrix4x4 transform;
+				double cost;
+				size_t inlierCount;
+				bool valid;
+			};
+
+			auto startTime = chrono::system_clock::now();
+
+			//hypotheses are scored in parallel batches, and we check whether we've done enough after each batch
+			const size_t batchSize = 64;
+			vector<Hypothesis> batch(batchSize);
+			Hypothesis best;
+			best.valid = false;
+			size_t iterations = 0;
+			size_t requiredIterations = maximumIterations;
+
+			while (iterations < requiredIterations) {
+				const auto batchCount = min(batchSize, requiredIterations - iterations);
+				const auto batchBegin = iterations;
+				ThreadPool::X().parallelFor(0, batchCount, [&](size_t i) {
+					auto & hypothesis = batch[i];
+					hypothesis.valid = false;
+
+					uint32_t randomState = (uint32_t) (batchBegin + i + 1) * 2654435761u;
+					if (randomState == 0) {
+						randomState = 1;
+					}
+
+					size_t indices[3];
+					indices[0] = nextRandom(randomState) % count;
+					do {
+						indices[1] = nextRandom(randomState) % count;
+					} while (indices[1] == indices[0]);
+					do {
+						indices[2] = nextRandom(randomState) % count;
+					} while (indices[2] == indices[0] || indices[2] == indices[1]);
+
+					ofVec3f sampleSrc[3], sampleDst[3];
+					for (int j = 0; j < 3; j++) {
+						sampleSrc[j] = srcPoints[indices[j]];
+						sampleDst[j] = dstPoints[indices[j]];
+					}
+
+					//the sample must span more than the noise in both sets
+					auto isDegenerate = [thresholdSquared](const ofVec3f * points) {
+						return (points[1] - points[0]).getCrossed(points[2] - points[0]).length() < thresholdSquared;
+					};
+					if (isDegenerate(sampleSrc) || isDegenerate(sampleDst)) {
+						return;
+					}
+
+					hypothesis.transform = fitRigid(sampleSrc, sampleDst, 3);
+					hypothesis.cost = 0.0;
+					hypothesis.inlierCount = 0;
+					for (size_t j = 0; j < count; j++) {
+						const auto errorSquared = (srcPoints[j] * hypothesis.transform).squareDistance(dstPoints[j]);
+						if (errorSquared < thresholdSquared) {
+							hypothesis.cost += errorSquared;
+							hypothesis.inlierCount++;
+						}
+						else {
+							hypothesis.cost += thresholdSquared;
+						}
+					}
+					hypothesis.valid = true;
+				}, 1, ThreadPool::Priority::Batch);
+
+				//take the best in index order, so that ties always go the same way
+				for (size_t i = 0; i < batchCount; i++) {
+					if (batch[i].valid && (!best.valid || batch[i].cost < best.cost)) {
+						best = batch[i];
+					}
+				}
+				iterations += batchCount;
+
+				if (best.valid) {
+					const auto inlierRatio = (double) best.inlierCount / (double) count;
+					const auto logOutlierSample = log(1.0 - inlierRatio * inlierRatio * inlierRatio);
+					if (logOutlierSample >= 0.0) {
+						//no chance of an all-inlier sample (shouldn't happen if best has inliers)
+						continue;
+					}
+					if (logOutlierSample == -numeric_limits<double>::infinity()) {
+						break;
+					}
+					requiredIterations = min(maximumIterations, (size_t) ceil(logFailure / logOutlierSample));
+				}
+			}
+
+			this->result.success = false;
+			this->result.inlierCount = 0;
+			if (best.valid && best.inlierCount >= 3) {
+				vector<ofVec3f> inlierSrc, inlierDst;
+				auto findInliers = [&](const ofMatrix4x4 & transform, double & sumSquaredError) {
+					inlierSrc.clear();
+					inlierDst.clear();
+					sumSquaredError = 0.0;
+					for (size_t i = 0; i < count; i++) {
+						const auto errorSquared = (srcPoints[i] * transform).squareDistance(dstPoints[i]);
+						if (errorSquared < thresholdSquared) {
+							inlierSrc.push_back(srcPoints[i]);
+							inlierDst.push_back(dstPoints[i]);
+							sumSquaredError += errorSquared;
+						}
+					}
+					return inlierSrc.size();
+				};
+
+				//start from the hypothesis, so that a refinement which doesn't help leaves it as it is
+				auto transform = best.transform;
+				double sumSquaredError;
+				auto inlierCount = findInliers(transform, sumSquaredError);
+
+				//refine by least squares on the inliers, whilst that finds more inliers (or fits the same ones better)
+				for (int refineIteration = 0; refineIteration < 10 && inlierCount >= 3; refineIteration++) {
+					auto refined = fitRigid(inlierSrc.data(), inlierDst.data(), inlierSrc.size());
+
+					double refinedSumSquaredError;
+					auto refinedInlierCount = findInliers(refined, refinedSumSquaredError);
+					if (refinedInlierCount < inlierCount
+						|| (refinedInlierCount == inlierCount && refinedSumSquaredError >= sumSquaredError)) {
+						break;
+					}
+
+					const auto foundMoreInliers = refinedInlierCount > inlierCount;
+					transform = refined;
+					inlierCount = refinedInlierCount;
+					sumSquaredError = refinedSumSquaredError;
+					if (!foundMoreInliers) {
+						break;
+					}
+				}
+
+				if (inlierCount >= 3) {
+					this->result.success = true;
+					this->result.transform = transform;
+					this->result.inlierCount = inlierCount;
+					this->result.residual = sqrt(sumSquaredError / (double) inlierCount);
+				}
+			}
+
+			this->result.totalTime = chrono::system_clock::now() - startTime;
+			this->completed = true;
+		}
+
+		//----------
+		void SolveSet::getInliers(float threshold, vector<ofVec3f> & srcPoints, vector<ofVec3f> & dstPoints) const {
+			srcPoints.clear();
+			dstPoints.clear();
+
+			const auto thresholdSquared = threshold * threshold;
+			for (const auto & dataPoint : this->dataSet) {
+				if ((dataPoint.x * this->result.transform).squareDistance(dataPoint.xdash) < thresholdSquared) {
+					srcPoints.push_back(dataPoint.x);
+					dstPoints.push_back(dataPoint.xdash);
+				}
+			}
+		}
+
+		//----------
+		ofMatrix4x4 SolveSet::findRigidTransform(const vector<ofVec3f> & srcPoints, const vector<ofVec3f> & dstPoints) {
+			if (srcPoints.size() != dstPoints.size()) {
+				throw(ofxRulr::Exception("Source and destination sets mismatch!"));
+			}
+			if (srcPoints.size() < 3) {
+				throw(ofxRulr::Exception("At least 3 points are needed to solve a rigid transform"));
+			}
+			return fitRigid(srcPoints.data(), dstPoints.data(), srcPoints.size());
+		}
+
 		//----------
 		void SolveSet::serialize(Json::Value & json) {
 			{
@@ -157,9 +400,16 @@ namespace ofxRulr {
 				this->outPoints.clear();
 				const auto & jsonDataSet = json["dataSet"];
 				for (const auto & jsonDataPoint : jsonDataSet) {
+					//older files were read back with the wrong names
 					ofxNonLinearFit::Models::RigidBody::DataPoint dataPoint;
-					jsonDataPoint["x"] >> dataPoint.x;
-					jsonDataPoint["xdash"] >> dataPoint.xdash;
+					if (jsonDataPoint.isMember("src")) {
+						jsonDataPoint["src"] >> dataPoint.x;
+						jsonDataPoint["dst"] >> dataPoint.xdash;
+					}
+					else {
+						jsonDataPoint["x"] >> dataPoint.x;
+						jsonDataPoint["xdash"] >> dataPoint.xdash;
+					}
 					this->dataSet.push_back(dataPoint);
 
 					cv::Point3f inPoint = cv::Point3f(dataPoint.x.x, dataPoint.x.y, dataPoint.x.z);
@@ -181,5 +431,10 @@ namespace ofxRulr {
 		const SolveSet::Result & SolveSet::getResult() const {
 			return this->result;
 		}
+
+		//----------
+		size_t SolveSet::size() const {
+			return this->dataSet.size();
+		}
 	}
 }
\ No newline at end of file
@@ -4,15 +4,17 @@
 
 namespace ofxRulr {
 	namespace Utils {
+		///Finds the rigid transform between 2 sets of corresponding points (src * transform ~= dst).
 		class SolveSet {
 		public:
 			struct Result {
-				Result() : success(false) {};
+				Result() : success(false), inlierCount(0) {};
 
 				ofMatrix4x4 transform;
 				float residual;
 				chrono::system_clock::duration totalTime;
 				bool success;
+				size_t inlierCount; // only set by solveRansac
 			};
 
 			SolveSet();
@@ -24,11 +26,22 @@ namespace ofxRulr {
 			void solveNL();
 			void solveCv();
 
+			///Closed form rigid transforms of minimal samples, scored in parallel batches (MSAC), then refined by least
+			/// squares on the inliers. Samples are seeded by their index, so the result doesn't depend on thread timing.
+			void solveRansac();
+
 			void serialize(Json::Value &);
 			void deserialize(const Json::Value &);
 
 			bool didComplete() const;
 			const Result & getResult() const;
+			size_t size() const;
+
+			///Correspondences which are within threshold [m] of each other under the result's transform
+			void getInliers(float threshold, vector<ofVec3f> & srcPoints, vector<ofVec3f> & dstPoints) const;
+
+			///Least squares rigid transform (Kabsch) such that src * transform ~= dst. Throws if there are less than 3 points.
+			static ofMatrix4x4 findRigidTransform(const vector<ofVec3f> & srcPoints, const vector<ofVec3f> & dstPoints);
 
 			struct : ofParameterGroup {
 				struct : ofParameterGroup {
@@ -39,7 +52,13 @@ namespace ofxRulr {
 					ofParameter<float> ransacThreshold{ "RANSAC Threshold", 3.0f, 0.0f, 10.0f };
 					PARAM_DECLARE("CV Estimate", ransacThreshold);
 				} cvSettings;
-				PARAM_DECLARE("Settings", nlSettings, cvSettings);
+				struct : ofParameterGroup {
+					ofParameter<float> inlierThreshold{ "Inlier threshold [m]", 0.05f, 0.001f, 1.0f };
+					ofParameter<int> maximumIterations{ "Maximum iterations", 2000, 10, 100000 };
+					ofParameter<float> confidence{ "Confidence", 0.999f, 0.5f, 0.999999f };
+					PARAM_DECLARE("RANSAC", inlierThreshold, maximumIterations, confidence);
+				} ransacSettings;
+				PARAM_DECLARE("Settings", nlSettings, cvSettings, ransacSettings);
 			} parameters;
 
 		protected: